@@ -183,7 +183,8 @@ void Application::UpdateTimer()
 
         std::wstring windowText =
             L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+            L"   mspf: " + mspfStr +
+            GetFrameStats();
 
         SetWindowText(mWindow, windowText.c_str());
 		
@@ -193,6 +194,11 @@ void Application::UpdateTimer()
     }
 }
 
+std::wstring Application::GetFrameStats()
+{
+    return L"";
+}
+
 int Application::Run()
 {
 	MSG msg = {0};
@@ -400,6 +406,20 @@ void Application::CreateCommandObjects()
 	
     HRESULT result = mDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&mCommandQueue));
     if (FAILED(result)) { std::cerr << "Failed to create command queue!\n"; return; }
+
+    mGpuQueue.Initialize(mCommandQueue, mFence);
+
+    D3D12_COMMAND_QUEUE_DESC copyQueueDesc = {};
+    copyQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    copyQueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+
+    result = mDevice->CreateCommandQueue(&copyQueueDesc, IID_PPV_ARGS(&mCopyQueue));
+    if (FAILED(result)) { std::cerr << "Failed to create copy queue!\n"; return; }
+
+    result = mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mCopyFence));
+    if (FAILED(result)) { std::cerr << "Failed to create copy fence!\n"; return; }
+
+    mCopyGpuQueue.Initialize(mCopyQueue, mCopyFence);
 	
     result = mDevice->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
@@ -474,26 +494,13 @@ void Application::CreateRtvAndDsvDescriptorHeaps()
 
 void Application::FlushCommandQueue()
 {
-    // Advance the fence value to mark commands up to this fence point.
-    mCurrentFence++;
-
     // Add an instruction to the command queue to set a new fence point.  Because we 
     // are on the GPU timeline, the new fence point won't be set until the GPU finishes
     // processing all the commands prior to this Signal().
-    mCommandQueue->Signal(mFence, mCurrentFence);
+    UINT64 fence = mGpuQueue.Signal();
 
     // Wait until the GPU has completed commands up to this fence point.
-    if(mFence->GetCompletedValue() < mCurrentFence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, L"", false, EVENT_ALL_ACCESS);
-
-        // Fire event when GPU hits current fence.  
-        mFence->SetEventOnCompletion(mCurrentFence, eventHandle);
-
-        // Wait until the GPU hits current fence event is fired.
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    mGpuQueue.WaitForValue(fence);
 }
 
 ID3D12Resource* Application::GetCurrentBackBuffer()
@@ -645,6 +652,8 @@ LRESULT Application::InputHandler(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPa
         }
         else if((int)wParam == VK_F2)
             Set4xMsaaState(!m4xMsaaState);
+        else
+            OnKeyPressed(wParam, 0, 0);
 
         return 0;
 	}
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include "D3D12GpuQueue.h"
 #include "Shader.h"
 #include "lib/d3dUtils.h"
 
@@ -25,6 +26,7 @@ protected:
     virtual void Update() = 0;
     virtual void Draw();
     virtual void UpdateTimer();
+    virtual std::wstring GetFrameStats(); // Appended to the window caption
     virtual void OnResize();
 
     void Set4xMsaaState(bool value);
@@ -65,9 +67,15 @@ protected:
     IDXGIFactory4* mdxgiFactory;
 
     ID3D12Fence* mFence;
-    UINT64 mCurrentFence = 0;
+    D3D12GpuQueue mGpuQueue; // Signal and wait on mFence
 
     ID3D12CommandQueue* mCommandQueue;
+
+    // Uploads run on their own queue and fence, beside the frames
+    ID3D12CommandQueue* mCopyQueue = nullptr;
+    ID3D12Fence* mCopyFence = nullptr;
+    D3D12GpuQueue mCopyGpuQueue;
+
     ID3D12CommandAllocator* mDirectCmdListAlloc;
     ID3D12GraphicsCommandList* mCommandList;
 
@@ -0,0 +1,55 @@
+﻿#include "CommandListPool.h"
+
+#include <iostream>
+
+CommandListPool::CommandListPool()
+{
+}
+
+CommandListPool::~CommandListPool()
+{
+}
+
+void CommandListPool::Initialize(IRenderDevice* device)
+{
+    mDevice = device;
+}
+
+void CommandListPool::Reset()
+{
+    // Lists are reset when they are acquired again
+    mAcquired = 0;
+}
+
+ICommandList* CommandListPool::Acquire(void* initialState)
+{
+    ICommandList* list;
+    if (mAcquired < mLists.size())
+    {
+        list = mLists[mAcquired];
+    }
+    else
+    {
+        list = mDevice->CreateCommandList();
+        if (list == nullptr) { std::cerr << "Failed to create pooled command list !\n"; return nullptr; }
+        mLists.push_back(list);
+    }
+
+    // Lists are kept closed by the device between their uses
+    mDevice->ResetCommandList(list);
+    if (initialState != nullptr)
+        list->SetPipelineState(initialState);
+
+    mAcquired++;
+    return list;
+}
+
+std::uint32_t CommandListPool::GetListCount() const
+{
+    return (std::uint32_t)mLists.size();
+}
+
+std::uint32_t CommandListPool::GetAcquiredCount() const
+{
+    return mAcquired;
+}
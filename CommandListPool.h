@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "lib/RenderDevice.h"
+
+// Command lists of a device reused from frame to frame.
+// Every list handed out can be recorded on its own thread.
+class CommandListPool
+{
+public:
+    CommandListPool();
+    ~CommandListPool();
+
+    void Initialize(IRenderDevice* device);
+
+    // Make every list available again, the GPU must be done with all of them
+    void Reset();
+
+    // Return a list ready to record, created if every pooled list is already in use this frame.
+    // Not thread safe, lists are acquired on the main thread before dispatching the recording.
+    ICommandList* Acquire(void* initialState);
+
+    std::uint32_t GetListCount() const;
+    std::uint32_t GetAcquiredCount() const;
+
+private:
+    IRenderDevice* mDevice = nullptr;
+
+    std::vector<ICommandList*> mLists; // Owned by the device
+    std::uint32_t mAcquired = 0;
+};
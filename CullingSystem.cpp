@@ -0,0 +1,236 @@
+﻿#include "CullingSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+CullingSystem::CullingSystem()
+{
+}
+
+void CullingSystem::Resize(std::uint32_t itemCount)
+{
+    mItemCount = itemCount;
+
+    std::uint32_t padded = (itemCount + 3) & ~3u;
+    mCenterX.resize(padded, 0.0f);
+    mCenterY.resize(padded, 0.0f);
+    mCenterZ.resize(padded, 0.0f);
+    mRadius.resize(padded, 0.0f);
+    mMaxDistanceSq.resize(padded, 0.0f);
+    mTriangleCount.resize(padded, 0);
+}
+
+std::uint32_t CullingSystem::Size() const
+{
+    return mItemCount;
+}
+
+void CullingSystem::SetBounds(std::uint32_t index, const Float3& center, float radius, float maxDrawDistance, std::uint32_t triangleCount)
+{
+    assert(index < mItemCount);
+
+    mCenterX[index] = center.x;
+    mCenterY[index] = center.y;
+    mCenterZ[index] = center.z;
+    mRadius[index] = radius;
+    mMaxDistanceSq[index] = maxDrawDistance * maxDrawDistance;
+    mTriangleCount[index] = triangleCount;
+}
+
+Float3 CullingSystem::GetCenter(std::uint32_t index) const
+{
+    return Float3(mCenterX[index], mCenterY[index], mCenterZ[index]);
+}
+
+CullingParams CullingSystem::MakeParams(const Float3& eyePosW, const Float4x4& proj,
+                                        const Float2& renderTargetSize, float minPixelArea)
+{
+    CullingParams params;
+    params.EyePosW = eyePosW;
+    params.ProjectionScale = proj._22 * 0.5f * renderTargetSize.y;
+    params.MinPixelArea = minPixelArea;
+    return params;
+}
+
+CullingView CullingSystem::MakeView(const Float4x4& viewProj, const CullingParams& params)
+{
+    // Plane i combines the columns of the view projection (Gribb & Hartmann)
+    auto column = [&](int c) { return Float4(viewProj.m[0][c], viewProj.m[1][c], viewProj.m[2][c], viewProj.m[3][c]); };
+    auto add = [](const Float4& a, const Float4& b) { return Float4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); };
+    auto subtract = [](const Float4& a, const Float4& b) { return Float4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); };
+
+    Float4 planes[6] =
+    {
+        add(column(3), column(0)),      // Left
+        subtract(column(3), column(0)), // Right
+        add(column(3), column(1)),      // Bottom
+        subtract(column(3), column(1)), // Top
+        column(2),                      // Near, clip z start at 0 in D3D
+        subtract(column(3), column(2))  // Far
+    };
+
+    CullingView view;
+    for (int i = 0; i < 6; i++)
+        view.Planes[i] = Maths::PlaneNormalize(planes[i]);
+    view.Params = params;
+    return view;
+}
+
+void CullingSystem::Cull(const CullingView& view, std::vector<std::uint32_t>& visibleItems, CullingStats& stats) const
+{
+    CullViews(&view, 1, mScratchMasks, &visibleItems, &stats);
+}
+
+namespace
+{
+    // Items tested together, the bounds are padded to a multiple of it
+    const std::uint32_t Lanes = 4;
+
+    // View constants computed once per pass
+    struct PassView
+    {
+        float Planes[6][4];
+        float EyeX;
+        float EyeY;
+        float EyeZ;
+        float AreaScale;
+        float MinArea;
+    };
+
+    void MakePassView(const CullingView& view, PassView& pass)
+    {
+        for (int p = 0; p < 6; p++)
+        {
+            pass.Planes[p][0] = view.Planes[p].x;
+            pass.Planes[p][1] = view.Planes[p].y;
+            pass.Planes[p][2] = view.Planes[p].z;
+            pass.Planes[p][3] = view.Planes[p].w;
+        }
+
+        const CullingParams& params = view.Params;
+        pass.EyeX = params.EyePosW.x;
+        pass.EyeY = params.EyePosW.y;
+        pass.EyeZ = params.EyePosW.z;
+        pass.AreaScale = Maths::PI * params.ProjectionScale * params.ProjectionScale;
+        pass.MinArea = params.MinPixelArea;
+    }
+}
+
+void CullingSystem::CullViews(const CullingView* views, std::uint32_t viewCount, std::vector<std::uint8_t>& visibilityMasks,
+                              std::vector<std::uint32_t>* visibleItems, CullingStats* stats) const
+{
+    assert(viewCount > 0 && viewCount <= MaxViews);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    PassView passes[MaxViews];
+    for (std::uint32_t v = 0; v < viewCount; v++)
+    {
+        MakePassView(views[v], passes[v]);
+        visibleItems[v].clear();
+        stats[v] = CullingStats();
+        stats[v].ItemsTested = mItemCount;
+    }
+
+    visibilityMasks.assign(mItemCount, 0);
+
+    for (std::uint32_t i = 0; i < mItemCount; i += Lanes)
+    {
+        // Bounds are loaded once and tested against every view
+        const float* cx = &mCenterX[i];
+        const float* cy = &mCenterY[i];
+        const float* cz = &mCenterZ[i];
+        const float* radius = &mRadius[i];
+        const float* maxDistSq = &mMaxDistanceSq[i];
+
+        std::uint32_t batch = std::min(Lanes, mItemCount - i);
+
+        for (std::uint32_t v = 0; v < viewCount; v++)
+        {
+            const PassView& view = passes[v];
+
+            // Frustum stage, the sphere is outside when it is fully behind one plane.
+            // Every lane is computed without branches, the stages are read per item after.
+            bool frustum[Lanes] = { true, true, true, true };
+            for (int p = 0; p < 6; p++)
+            {
+                const float* plane = view.Planes[p];
+                for (std::uint32_t lane = 0; lane < Lanes; lane++)
+                {
+                    float d = plane[0] * cx[lane] + plane[1] * cy[lane] + plane[2] * cz[lane] + plane[3];
+                    frustum[lane] = frustum[lane] & (d >= -radius[lane]);
+                }
+            }
+
+            bool range[Lanes];
+            bool area[Lanes];
+            for (std::uint32_t lane = 0; lane < Lanes; lane++)
+            {
+                float dx = cx[lane] - view.EyeX;
+                float dy = cy[lane] - view.EyeY;
+                float dz = cz[lane] - view.EyeZ;
+                float distSq = dx * dx + dy * dy + dz * dz;
+                float radiusSq = radius[lane] * radius[lane];
+
+                // Distance stage
+                range[lane] = (maxDistSq[lane] == 0.0f) | (distSq <= maxDistSq[lane]);
+
+                // Contribution stage, projected area of a sphere is PI * (r * scale / d)^2 so the test
+                // PI * r^2 * scale^2 >= minArea * d^2 avoid any division. An eye inside the sphere always keep the item.
+                area[lane] = (radiusSq * view.AreaScale >= distSq * view.MinArea) | (distSq <= radiusSq);
+            }
+
+            CullingStats& viewStats = stats[v];
+            for (std::uint32_t lane = 0; lane < batch; lane++)
+            {
+                std::uint32_t item = i + lane;
+                if (!frustum[lane])
+                {
+                    viewStats.DrawsSkippedFrustum++;
+                    viewStats.TrianglesSkipped += mTriangleCount[item];
+                }
+                else if (!range[lane])
+                {
+                    viewStats.DrawsSkippedDistance++;
+                    viewStats.TrianglesSkipped += mTriangleCount[item];
+                }
+                else if (!area[lane])
+                {
+                    viewStats.DrawsSkippedContribution++;
+                    viewStats.TrianglesSkipped += mTriangleCount[item];
+                }
+                else
+                {
+                    viewStats.DrawsSubmitted++;
+                    viewStats.TrianglesSubmitted += mTriangleCount[item];
+                    visibilityMasks[item] |= (std::uint8_t)(1u << v);
+                    visibleItems[v].push_back(item);
+                }
+            }
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats[0].CullTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void CullingSystem::CullViewsSeparately(const CullingView* views, std::uint32_t viewCount, std::vector<std::uint8_t>& visibilityMasks,
+                                        std::vector<std::uint32_t>* visibleItems, CullingStats* stats) const
+{
+    assert(viewCount > 0 && viewCount <= MaxViews);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    visibilityMasks.assign(mItemCount, 0);
+
+    for (std::uint32_t v = 0; v < viewCount; v++)
+    {
+        CullViews(&views[v], 1, mScratchMasks, &visibleItems[v], &stats[v]);
+        for (std::uint32_t item : visibleItems[v])
+            visibilityMasks[item] |= (std::uint8_t)(1u << v);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats[0].CullTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
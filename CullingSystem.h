@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "lib/Maths.h"
+
+// Per frame culling counters, displayed in the window caption
+struct CullingStats
+{
+    std::uint32_t ItemsTested = 0;
+    std::uint32_t DrawsSubmitted = 0;
+    std::uint32_t DrawsSkippedFrustum = 0;
+    std::uint32_t DrawsSkippedDistance = 0;
+    std::uint32_t DrawsSkippedContribution = 0;
+    std::uint64_t TrianglesSubmitted = 0;
+    std::uint64_t TrianglesSkipped = 0;
+    float CullTimeMs = 0.0f;
+};
+
+// Parameters of the view we are culling against
+struct CullingParams
+{
+    Float3 EyePosW;
+
+    // Number of pixels covered by one world unit at distance 1 (Proj._22 * RenderTargetSize.y / 2)
+    float ProjectionScale = 1.0f;
+
+    // Items covering less than this many pixels on screen are dropped, 0 disable the test
+    float MinPixelArea = 1.0f;
+};
+
+// A frustum and its culling parameters (main camera, shadow cascade, reflection...)
+struct CullingView
+{
+    // World space planes, a point p is inside when dot(plane.xyz, p) + plane.w >= 0
+    Float4 Planes[6];
+    CullingParams Params;
+};
+
+// Culling of the render items on their bounding spheres.
+// Bounds are stored as structure of arrays so each test runs on 4 items at once, in lanes the
+// compiler turns into vector instructions.
+class CullingSystem
+{
+public:
+    // One bit per view in the visibility mask
+    static const std::uint32_t MaxViews = 8;
+
+    CullingSystem();
+
+    void Resize(std::uint32_t itemCount);
+    std::uint32_t Size() const;
+
+    void SetBounds(std::uint32_t index, const Float3& center, float radius, float maxDrawDistance, std::uint32_t triangleCount);
+    Float3 GetCenter(std::uint32_t index) const;
+
+    // Fill visibleItems with the index of every item that pass the frustum, distance and contribution tests
+    void Cull(const CullingView& view, std::vector<std::uint32_t>& visibleItems, CullingStats& stats) const;
+
+    // Test every item against all the views in a single pass over the bounds.
+    // visibleItems and stats are arrays of viewCount elements, bit v of visibilityMasks[i] is set
+    // when item i is visible in view v. The pass time is reported in stats[0].CullTimeMs.
+    void CullViews(const CullingView* views, std::uint32_t viewCount, std::vector<std::uint8_t>& visibilityMasks,
+                   std::vector<std::uint32_t>* visibleItems, CullingStats* stats) const;
+
+    // Same result as CullViews but with one pass per view, kept to compare the two
+    void CullViewsSeparately(const CullingView* views, std::uint32_t viewCount, std::vector<std::uint8_t>& visibilityMasks,
+                             std::vector<std::uint32_t>* visibleItems, CullingStats* stats) const;
+
+    static CullingParams MakeParams(const Float3& eyePosW, const Float4x4& proj,
+                                    const Float2& renderTargetSize, float minPixelArea);
+
+    // Extract the frustum planes of a (non transposed) view projection matrix
+    static CullingView MakeView(const Float4x4& viewProj, const CullingParams& params);
+
+private:
+    std::uint32_t mItemCount = 0;
+
+    // Padded to a multiple of 4 so the last batch can be loaded whole
+    std::vector<float> mCenterX;
+    std::vector<float> mCenterY;
+    std::vector<float> mCenterZ;
+    std::vector<float> mRadius;
+    std::vector<float> mMaxDistanceSq; // 0 means no distance limit
+    std::vector<std::uint32_t> mTriangleCount;
+
+    // Masks of Cull and of the separate passes, kept so they are not allocated again every call
+    mutable std::vector<std::uint8_t> mScratchMasks;
+};
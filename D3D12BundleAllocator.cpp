@@ -0,0 +1,102 @@
+﻿#include "D3D12BundleAllocator.h"
+
+D3D12BundleAllocator::D3D12BundleAllocator()
+{
+}
+
+D3D12BundleAllocator::~D3D12BundleAllocator()
+{
+    Release();
+}
+
+void D3D12BundleAllocator::Initialize(ID3D12Device* device, IGpuQueue* queue)
+{
+    mDevice = device;
+    mQueue = queue;
+}
+
+void D3D12BundleAllocator::CollectRetired()
+{
+    if (mRetired.empty()) return;
+
+    // Released since the last collect, every frame that can execute them is submitted already
+    UINT64 fence = 0;
+    for (Bundle& retired : mRetired)
+    {
+        if (retired.Fence != 0) continue;
+        if (fence == 0) fence = mQueue->Signal();
+        retired.Fence = fence;
+    }
+
+    UINT64 completed = mQueue->GetCompletedValue();
+    size_t kept = 0;
+    for (size_t i = 0; i < mRetired.size(); i++)
+    {
+        if (mRetired[i].Fence > completed)
+            mRetired[kept++] = mRetired[i];
+        else
+            mFree.push_back(mRetired[i]);
+    }
+    mRetired.resize(kept);
+}
+
+ICommandList& D3D12BundleAllocator::BeginBundle(void* initialPipelineState)
+{
+    CollectRetired();
+
+    ID3D12PipelineState* pipelineState = static_cast<ID3D12PipelineState*>(initialPipelineState);
+    mCurrent = Bundle();
+    if (!mFree.empty())
+    {
+        mCurrent = mFree.back();
+        mFree.pop_back();
+        mCurrent.Fence = 0;
+        mCurrent.Allocator->Reset();
+        mCurrent.List->Reset(mCurrent.Allocator, pipelineState);
+    }
+    else
+    {
+        HRESULT result = mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_BUNDLE, IID_PPV_ARGS(&mCurrent.Allocator));
+        if (FAILED(result)) { std::cerr << "Failed to create bundle allocator !\n"; }
+
+        // A new list is created open, ready to record
+        result = mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_BUNDLE, mCurrent.Allocator, pipelineState, IID_PPV_ARGS(&mCurrent.List));
+        if (FAILED(result)) { std::cerr << "Failed to create bundle !\n"; }
+    }
+
+    mCommandList.SetCommandList(mCurrent.List);
+    return mCommandList;
+}
+
+void* D3D12BundleAllocator::EndBundle()
+{
+    mCurrent.List->Close();
+    mBundles.push_back(mCurrent);
+    return mCurrent.List;
+}
+
+void D3D12BundleAllocator::ReleaseBundle(void* bundle)
+{
+    for (size_t i = 0; i < mBundles.size(); i++)
+    {
+        if (mBundles[i].List != bundle) continue;
+
+        mRetired.push_back(mBundles[i]);
+        mBundles[i] = mBundles.back();
+        mBundles.pop_back();
+        return;
+    }
+}
+
+void D3D12BundleAllocator::Release()
+{
+    for (std::vector<Bundle>* bundles : { &mBundles, &mRetired, &mFree })
+    {
+        for (Bundle& bundle : *bundles)
+        {
+            bundle.List->Release();
+            bundle.Allocator->Release();
+        }
+        bundles->clear();
+    }
+}
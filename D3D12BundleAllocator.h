@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include "D3D12CommandList.h"
+#include "lib/BundleCache.h"
+#include "lib/GpuQueue.h"
+
+// Bundles of a D3D12 device, each with its own allocator so one can be recorded again while the
+// others are still executed. A released bundle is reused once the queue is done with the frames
+// submitted before its release.
+class D3D12BundleAllocator : public IBundleAllocator
+{
+public:
+    D3D12BundleAllocator();
+    ~D3D12BundleAllocator();
+
+    D3D12BundleAllocator(const D3D12BundleAllocator& rhs) = delete;
+    D3D12BundleAllocator& operator=(const D3D12BundleAllocator& rhs) = delete;
+
+    // queue is the timeline of the queue executing the lists the bundles are executed from
+    void Initialize(ID3D12Device* device, IGpuQueue* queue);
+
+    ICommandList& BeginBundle(void* initialPipelineState) override;
+    void* EndBundle() override;
+    void ReleaseBundle(void* bundle) override;
+
+    // Release every bundle, the GPU must be done with them
+    void Release();
+
+private:
+    struct Bundle
+    {
+        ID3D12CommandAllocator* Allocator = nullptr;
+        ID3D12GraphicsCommandList* List = nullptr;
+        UINT64 Fence = 0; // Released bundles only, 0 until the queue is signaled for it
+    };
+
+    // Bundles released before the queue reached their fence are not reusable yet
+    void CollectRetired();
+
+    ID3D12Device* mDevice = nullptr;
+    IGpuQueue* mQueue = nullptr;
+    std::vector<Bundle> mBundles; // Recorded, not released
+    std::vector<Bundle> mRetired;
+    std::vector<Bundle> mFree;
+    Bundle mCurrent;
+    D3D12CommandList mCommandList;
+};
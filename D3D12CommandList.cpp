@@ -0,0 +1,178 @@
+﻿#include "D3D12CommandList.h"
+
+D3D12CommandList::D3D12CommandList()
+{
+}
+
+D3D12CommandList::D3D12CommandList(ID3D12GraphicsCommandList* commandList) : mCommandList(commandList)
+{
+}
+
+void D3D12CommandList::SetCommandList(ID3D12GraphicsCommandList* commandList)
+{
+    mCommandList = commandList;
+}
+
+ID3D12GraphicsCommandList* D3D12CommandList::GetCommandList() const
+{
+    return mCommandList;
+}
+
+void D3D12CommandList::SetPipelineState(void* pipelineState)
+{
+    mCommandList->SetPipelineState(static_cast<ID3D12PipelineState*>(pipelineState));
+}
+
+void D3D12CommandList::SetGraphicsRootSignature(void* rootSignature)
+{
+    mCommandList->SetGraphicsRootSignature(static_cast<ID3D12RootSignature*>(rootSignature));
+}
+
+void D3D12CommandList::IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t numViews, const VertexBufferBinding* views)
+{
+    D3D12_VERTEX_BUFFER_VIEW d3dViews[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    assert(numViews <= D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+    
+    for (std::uint32_t i = 0; i < numViews; i++)
+    {
+        d3dViews[i].BufferLocation = views[i].BufferLocation;
+        d3dViews[i].SizeInBytes = views[i].SizeInBytes;
+        d3dViews[i].StrideInBytes = views[i].StrideInBytes;
+    }
+    mCommandList->IASetVertexBuffers(startSlot, numViews, d3dViews);
+}
+
+void D3D12CommandList::IASetIndexBuffer(const IndexBufferBinding* view)
+{
+    D3D12_INDEX_BUFFER_VIEW d3dView;
+    d3dView.BufferLocation = view->BufferLocation;
+    d3dView.SizeInBytes = view->SizeInBytes;
+    d3dView.Format = static_cast<DXGI_FORMAT>(view->Format);
+    mCommandList->IASetIndexBuffer(&d3dView);
+}
+
+void D3D12CommandList::IASetPrimitiveTopology(std::uint32_t topology)
+{
+    mCommandList->IASetPrimitiveTopology(static_cast<D3D12_PRIMITIVE_TOPOLOGY>(topology));
+}
+
+void D3D12CommandList::SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation)
+{
+    mCommandList->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+}
+
+void D3D12CommandList::SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation)
+{
+    mCommandList->SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+}
+
+void D3D12CommandList::SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues)
+{
+    mCommandList->SetGraphicsRoot32BitConstant(rootParameterIndex, srcData, destOffsetIn32BitValues);
+}
+
+void D3D12CommandList::DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+                                            std::uint32_t startIndexLocation, std::int32_t baseVertexLocation,
+                                            std::uint32_t startInstanceLocation)
+{
+    mCommandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+VertexBufferBinding D3D12CommandList::ToBinding(const D3D12_VERTEX_BUFFER_VIEW& view)
+{
+    VertexBufferBinding binding;
+    binding.BufferLocation = view.BufferLocation;
+    binding.SizeInBytes = view.SizeInBytes;
+    binding.StrideInBytes = view.StrideInBytes;
+    return binding;
+}
+
+IndexBufferBinding D3D12CommandList::ToBinding(const D3D12_INDEX_BUFFER_VIEW& view)
+{
+    IndexBufferBinding binding;
+    binding.BufferLocation = view.BufferLocation;
+    binding.SizeInBytes = view.SizeInBytes;
+    binding.Format = view.Format;
+    return binding;
+}
+
+void D3D12CommandList::ExecuteIndirect(void* commandSignature, std::uint32_t maxCommandCount,
+                                       void* argumentBuffer, std::uint64_t argumentBufferOffset)
+{
+    mCommandList->ExecuteIndirect(static_cast<ID3D12CommandSignature*>(commandSignature), maxCommandCount,
+        static_cast<ID3D12Resource*>(argumentBuffer), argumentBufferOffset, nullptr, 0);
+}
+
+void D3D12CommandList::ExecuteBundle(void* bundle)
+{
+    mCommandList->ExecuteBundle(static_cast<ID3D12GraphicsCommandList*>(bundle));
+}
+
+void D3D12CommandList::ResourceBarrier(std::uint32_t numBarriers, const ResourceBarrierDesc* barriers)
+{
+    // Converted by chunks on the stack, a frame rarely has more barriers than a chunk
+    const std::uint32_t ChunkSize = 32;
+    D3D12_RESOURCE_BARRIER chunk[ChunkSize];
+
+    for (std::uint32_t first = 0; first < numBarriers; first += ChunkSize)
+    {
+        std::uint32_t count = std::min(ChunkSize, numBarriers - first);
+        for (std::uint32_t i = 0; i < count; i++)
+        {
+            const ResourceBarrierDesc& barrier = barriers[first + i];
+            if (barrier.Type == BarrierType::Aliasing)
+            {
+                chunk[i] = CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, static_cast<ID3D12Resource*>(barrier.Resource));
+                continue;
+            }
+
+            chunk[i] = CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(barrier.Resource),
+                (D3D12_RESOURCE_STATES)barrier.StateBefore, (D3D12_RESOURCE_STATES)barrier.StateAfter,
+                D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, (D3D12_RESOURCE_BARRIER_FLAGS)barrier.Flags);
+        }
+        mCommandList->ResourceBarrier(count, chunk);
+    }
+}
+
+void D3D12CommandList::RSSetViewports(std::uint32_t numViewports, const Viewport* viewports)
+{
+    // Same layout
+    mCommandList->RSSetViewports(numViewports, reinterpret_cast<const D3D12_VIEWPORT*>(viewports));
+}
+
+void D3D12CommandList::RSSetScissorRects(std::uint32_t numRects, const ScissorRect* rects)
+{
+    mCommandList->RSSetScissorRects(numRects, reinterpret_cast<const D3D12_RECT*>(rects));
+}
+
+void D3D12CommandList::OMSetRenderTargets(std::uint32_t numRenderTargets, const CpuDescriptor* renderTargets, CpuDescriptor depthStencil)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE d3dRenderTargets[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+    assert(numRenderTargets <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
+
+    for (std::uint32_t i = 0; i < numRenderTargets; i++)
+        d3dRenderTargets[i].ptr = (SIZE_T)renderTargets[i];
+
+    D3D12_CPU_DESCRIPTOR_HANDLE d3dDepthStencil;
+    d3dDepthStencil.ptr = (SIZE_T)depthStencil;
+    mCommandList->OMSetRenderTargets(numRenderTargets, d3dRenderTargets, false, depthStencil != 0 ? &d3dDepthStencil : nullptr);
+}
+
+void D3D12CommandList::SetDescriptorHeaps(std::uint32_t numHeaps, void* const* heaps)
+{
+    mCommandList->SetDescriptorHeaps(numHeaps, reinterpret_cast<ID3D12DescriptorHeap* const*>(heaps));
+}
+
+void D3D12CommandList::ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4])
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE view;
+    view.ptr = (SIZE_T)renderTarget;
+    mCommandList->ClearRenderTargetView(view, color, 0, nullptr);
+}
+
+void D3D12CommandList::ClearDepthStencilView(CpuDescriptor depthStencil, ClearFlags flags, float depth, std::uint8_t stencil)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE view;
+    view.ptr = (SIZE_T)depthStencil;
+    mCommandList->ClearDepthStencilView(view, (D3D12_CLEAR_FLAGS)flags, depth, stencil, 0, nullptr);
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include "lib/CommandList.h"
+#include "lib/d3dUtils.h"
+
+// ICommandList forwarding to an ID3D12GraphicsCommandList
+class D3D12CommandList : public ICommandList
+{
+public:
+    D3D12CommandList();
+    D3D12CommandList(ID3D12GraphicsCommandList* commandList);
+
+    void SetCommandList(ID3D12GraphicsCommandList* commandList);
+    ID3D12GraphicsCommandList* GetCommandList() const;
+
+    void SetPipelineState(void* pipelineState) override;
+    void SetGraphicsRootSignature(void* rootSignature) override;
+    void IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t numViews, const VertexBufferBinding* views) override;
+    void IASetIndexBuffer(const IndexBufferBinding* view) override;
+    void IASetPrimitiveTopology(std::uint32_t topology) override;
+    void SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation) override;
+    void SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation) override;
+    void SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) override;
+    void DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+                              std::uint32_t startIndexLocation, std::int32_t baseVertexLocation,
+                              std::uint32_t startInstanceLocation) override;
+    void ExecuteIndirect(void* commandSignature, std::uint32_t maxCommandCount,
+                         void* argumentBuffer, std::uint64_t argumentBufferOffset) override;
+    void ExecuteBundle(void* bundle) override;
+    void ResourceBarrier(std::uint32_t numBarriers, const ResourceBarrierDesc* barriers) override;
+    void RSSetViewports(std::uint32_t numViewports, const Viewport* viewports) override;
+    void RSSetScissorRects(std::uint32_t numRects, const ScissorRect* rects) override;
+    void OMSetRenderTargets(std::uint32_t numRenderTargets, const CpuDescriptor* renderTargets, CpuDescriptor depthStencil) override;
+    void SetDescriptorHeaps(std::uint32_t numHeaps, void* const* heaps) override;
+    void ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4]) override;
+    void ClearDepthStencilView(CpuDescriptor depthStencil, ClearFlags flags, float depth, std::uint8_t stencil) override;
+
+    static VertexBufferBinding ToBinding(const D3D12_VERTEX_BUFFER_VIEW& view);
+    static IndexBufferBinding ToBinding(const D3D12_INDEX_BUFFER_VIEW& view);
+
+private:
+    ID3D12GraphicsCommandList* mCommandList = nullptr;
+};
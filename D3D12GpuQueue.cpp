@@ -0,0 +1,44 @@
+﻿#include "D3D12GpuQueue.h"
+
+D3D12GpuQueue::D3D12GpuQueue()
+{
+}
+
+D3D12GpuQueue::~D3D12GpuQueue()
+{
+    if (mEvent != nullptr)
+        CloseHandle(mEvent);
+}
+
+void D3D12GpuQueue::Initialize(ID3D12CommandQueue* queue, ID3D12Fence* fence)
+{
+    mQueue = queue;
+    mFence = fence;
+    mCurrentFence = fence->GetCompletedValue();
+
+    // One event reused for every wait
+    if (mEvent == nullptr)
+        mEvent = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
+}
+
+std::uint64_t D3D12GpuQueue::Signal()
+{
+    // Advance the fence value to mark commands up to this fence point.
+    mCurrentFence++;
+    mQueue->Signal(mFence, mCurrentFence);
+    return mCurrentFence;
+}
+
+std::uint64_t D3D12GpuQueue::GetCompletedValue()
+{
+    return mFence->GetCompletedValue();
+}
+
+void D3D12GpuQueue::WaitForValue(std::uint64_t value)
+{
+    if (mFence->GetCompletedValue() >= value) return;
+
+    // Fire event when GPU hits the fence and wait for it.
+    mFence->SetEventOnCompletion(value, mEvent);
+    WaitForSingleObject(mEvent, INFINITE);
+}
@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#include "lib/d3dUtils.h"
+#include "lib/GpuQueue.h"
+
+// IGpuQueue over a D3D12 command queue and a fence it signals
+class D3D12GpuQueue : public IGpuQueue
+{
+public:
+    D3D12GpuQueue();
+    ~D3D12GpuQueue();
+
+    void Initialize(ID3D12CommandQueue* queue, ID3D12Fence* fence);
+
+    std::uint64_t Signal() override;
+    std::uint64_t GetCompletedValue() override;
+    void WaitForValue(std::uint64_t value) override;
+
+private:
+    ID3D12CommandQueue* mQueue = nullptr;
+    ID3D12Fence* mFence = nullptr;
+    HANDLE mEvent = nullptr;
+    UINT64 mCurrentFence = 0;
+};
@@ -0,0 +1,183 @@
+﻿#include "D3D12RenderDevice.h"
+
+D3D12RenderDevice::D3D12RenderDevice()
+{
+}
+
+D3D12RenderDevice::~D3D12RenderDevice()
+{
+    // The GPU must be done with every list and buffer
+    mStagingRing.WaitIdle();
+    mBundleAllocator.Release();
+
+    for (std::unique_ptr<CommandList>& list : mCommandLists)
+    {
+        list->GetCommandList()->Release();
+        list->Allocator->Release();
+    }
+}
+
+void D3D12RenderDevice::Initialize(ID3D12Device* device, ID3D12CommandQueue* queue, IGpuQueue* gpuQueue,
+                                   ID3D12CommandQueue* copyQueue, ID3D12Fence* copyFence, IGpuQueue* copyGpuQueue)
+{
+    mDevice = device;
+    mQueue = queue;
+    mGpuQueue = gpuQueue;
+    mCopyFence = copyFence;
+
+    mMemory.Initialize(device);
+    mStagingRing.Initialize(device, copyQueue, copyGpuQueue);
+    mBundleAllocator.Initialize(device, gpuQueue);
+}
+
+BufferHandle D3D12RenderDevice::CreateBuffer(const BufferDesc& desc)
+{
+    // Every buffer can be bound as a constant buffer
+    GpuMemoryType type = desc.Heap == BufferHeap::Upload ? GpuMemoryType::Upload : GpuMemoryType::Default;
+    GpuBufferAllocation allocation = mMemory.Allocate(type, desc.SizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+    if (!allocation.IsValid()) return InvalidBuffer;
+
+    BufferHandle handle;
+    if (!mFreeHandles.empty())
+    {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    }
+    else
+    {
+        handle = (BufferHandle)mBuffers.size();
+        mBuffers.emplace_back();
+    }
+
+    mBuffers[handle] = allocation;
+    return handle;
+}
+
+void D3D12RenderDevice::DestroyBuffer(BufferHandle buffer)
+{
+    if (buffer >= mBuffers.size() || !mBuffers[buffer].IsValid()) return;
+
+    mMemory.Free(mBuffers[buffer]);
+    mBuffers[buffer] = GpuBufferAllocation();
+    mFreeHandles.push_back(buffer);
+}
+
+void* D3D12RenderDevice::Map(BufferHandle buffer)
+{
+    if (buffer >= mBuffers.size()) return nullptr;
+    return mBuffers[buffer].Cpu;
+}
+
+GpuAddress D3D12RenderDevice::GetGpuAddress(BufferHandle buffer) const
+{
+    if (buffer >= mBuffers.size()) return 0;
+    return mBuffers[buffer].Gpu;
+}
+
+void* D3D12RenderDevice::GetResource(BufferHandle buffer, std::uint64_t& offset) const
+{
+    offset = 0;
+    if (buffer >= mBuffers.size()) return nullptr;
+
+    // The page buffer, shared with the other ranges of the page
+    offset = mBuffers[buffer].Offset;
+    return mBuffers[buffer].Resource;
+}
+
+std::uint64_t D3D12RenderDevice::UploadBuffer(BufferHandle buffer, std::uint64_t offset, const void* data, std::uint64_t size)
+{
+    if (buffer >= mBuffers.size() || !mBuffers[buffer].IsValid()) return mStagingRing.GetCompletedTicket();
+
+    // The page is promoted from COMMON to COPY_DEST by the copy, no barrier
+    const GpuBufferAllocation& destination = mBuffers[buffer];
+    mStagingRing.Upload(destination.Resource, destination.Offset + offset, data, size);
+    return mStagingRing.GetCurrentTicket();
+}
+
+std::uint64_t D3D12RenderDevice::GetCompletedUpload()
+{
+    return mStagingRing.GetCompletedTicket();
+}
+
+void D3D12RenderDevice::WaitForUploads()
+{
+    mStagingRing.WaitIdle();
+}
+
+ICommandList* D3D12RenderDevice::CreateCommandList()
+{
+    std::unique_ptr<CommandList> list(new CommandList());
+    ID3D12GraphicsCommandList* commandList = nullptr;
+
+    HRESULT result = mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&list->Allocator));
+    if (FAILED(result)) { std::cerr << "Failed to create command allocator !\n"; return nullptr; }
+
+    result = mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, list->Allocator, nullptr, IID_PPV_ARGS(&commandList));
+    if (FAILED(result)) { std::cerr << "Failed to create command list !\n"; return nullptr; }
+
+    // Created open, ResetCommandList opens it again
+    commandList->Close();
+    list->SetCommandList(commandList);
+    mCommandLists.push_back(std::move(list));
+    return mCommandLists.back().get();
+}
+
+void D3D12RenderDevice::ResetCommandList(ICommandList* commandList)
+{
+    CommandList* list = static_cast<CommandList*>(commandList);
+    if (list->Open)
+        list->GetCommandList()->Close();
+
+    list->Allocator->Reset();
+    list->GetCommandList()->Reset(list->Allocator, nullptr);
+    list->Open = true;
+}
+
+void D3D12RenderDevice::ExecuteCommandLists(std::uint32_t count, ICommandList* const* commandLists)
+{
+    mSubmitted.resize(count);
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        CommandList* list = static_cast<CommandList*>(commandLists[i]);
+        if (list->Open)
+        {
+            list->GetCommandList()->Close();
+            list->Open = false;
+        }
+        mSubmitted[i] = list->GetCommandList();
+    }
+
+    // Copies recorded since the last submission start streaming
+    mStagingRing.Flush();
+
+    // The copies the frame was built against are done, the wait is already satisfied
+    // but orders the copy queue writes before the reads of the direct queue
+    UINT64 uploadedTicket = mStagingRing.GetCompletedTicket();
+    if (uploadedTicket > mWaitedTicket)
+    {
+        mQueue->Wait(mCopyFence, mStagingRing.GetTicketFence(uploadedTicket));
+        mWaitedTicket = uploadedTicket;
+    }
+
+    mQueue->ExecuteCommandLists(count, mSubmitted.data());
+}
+
+IGpuQueue& D3D12RenderDevice::GetQueue()
+{
+    return *mGpuQueue;
+}
+
+IBundleAllocator& D3D12RenderDevice::GetBundleAllocator()
+{
+    return mBundleAllocator;
+}
+
+GpuMemoryStats D3D12RenderDevice::GetMemoryStats(GpuMemoryType type) const
+{
+    return mMemory.GetStats(type);
+}
+
+StagingStats D3D12RenderDevice::GetStagingStats() const
+{
+    return mStagingRing.GetStats();
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "D3D12BundleAllocator.h"
+#include "D3D12CommandList.h"
+#include "lib/GpuMemoryManager.h"
+#include "lib/RenderDevice.h"
+#include "lib/StagingRing.h"
+
+// IRenderDevice of the application D3D12 device.
+// Buffers are ranges of GpuMemoryManager pages, uploads go through a StagingRing on the copy queue
+// and the lists run on the direct queue. Each list has its own allocator so lists can be recorded
+// on different threads, they are closed when they are executed.
+class D3D12RenderDevice : public IRenderDevice
+{
+public:
+    D3D12RenderDevice();
+    ~D3D12RenderDevice();
+
+    D3D12RenderDevice(const D3D12RenderDevice& rhs) = delete;
+    D3D12RenderDevice& operator=(const D3D12RenderDevice& rhs) = delete;
+
+    // queue runs the lists, copyQueue the uploads, each with the fence timeline given beside it
+    void Initialize(ID3D12Device* device, ID3D12CommandQueue* queue, IGpuQueue* gpuQueue,
+                    ID3D12CommandQueue* copyQueue, ID3D12Fence* copyFence, IGpuQueue* copyGpuQueue);
+
+    BufferHandle CreateBuffer(const BufferDesc& desc) override;
+    void DestroyBuffer(BufferHandle buffer) override;
+    void* Map(BufferHandle buffer) override;
+    GpuAddress GetGpuAddress(BufferHandle buffer) const override;
+    void* GetResource(BufferHandle buffer, std::uint64_t& offset) const override;
+    std::uint64_t UploadBuffer(BufferHandle buffer, std::uint64_t offset, const void* data, std::uint64_t size) override;
+    std::uint64_t GetCompletedUpload() override;
+    void WaitForUploads() override;
+
+    ICommandList* CreateCommandList() override;
+    void ResetCommandList(ICommandList* commandList) override;
+    void ExecuteCommandLists(std::uint32_t count, ICommandList* const* commandLists) override;
+
+    IGpuQueue& GetQueue() override;
+    IBundleAllocator& GetBundleAllocator() override;
+
+    GpuMemoryStats GetMemoryStats(GpuMemoryType type) const;
+    StagingStats GetStagingStats() const;
+
+private:
+    struct CommandList : D3D12CommandList
+    {
+        ID3D12CommandAllocator* Allocator = nullptr;
+        bool Open = false;
+    };
+
+    ID3D12Device* mDevice = nullptr;
+    ID3D12CommandQueue* mQueue = nullptr;
+    IGpuQueue* mGpuQueue = nullptr;
+    ID3D12Fence* mCopyFence = nullptr;
+
+    GpuMemoryManager mMemory;
+    std::vector<GpuBufferAllocation> mBuffers; // Invalid for the free handles
+    std::vector<BufferHandle> mFreeHandles;
+
+    StagingRing mStagingRing;
+    UINT64 mWaitedTicket = 0; // Last ticket the direct queue waited for
+
+    std::vector<std::unique_ptr<CommandList>> mCommandLists;
+    std::vector<ID3D12CommandList*> mSubmitted; // ExecuteCommandLists scratch
+    D3D12BundleAllocator mBundleAllocator;
+};
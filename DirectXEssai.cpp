@@ -1,11 +1,447 @@
 #include <windows.h>
+#include <chrono>
 
+#include "HeadlessBenchmark.h"
 #include "RenderApplication.h"
+#include "Shader.h"
+#include "lib/BarrierSimulation.h"
+#include "lib/BundleBenchmark.h"
+#include "lib/CaptureReplay.h"
+#include "lib/CopyBenchmark.h"
+#include "lib/DescriptorBenchmark.h"
+#include "lib/DrawListBenchmark.h"
+#include "lib/FrameLoopSimulation.h"
+#include "lib/MappedFile.h"
+#include "lib/PipelineCacheBenchmark.h"
+#include "lib/RecordBenchmark.h"
+#include "lib/RecordingRenderDevice.h"
+#include "lib/RenderGraphBenchmark.h"
+#include "lib/RetainedDrawList.h"
+#include "lib/SortBenchmark.h"
+#include "lib/TlsfBenchmark.h"
+#include "lib/UploadStreamingSimulation.h"
+
+// The benchmarks print in a console, the application has none
+static void OpenConsole()
+{
+	AllocConsole();
+	FILE* output = nullptr;
+	freopen_s(&output, "CONOUT$", "w", stdout);
+	freopen_s(&output, "CONOUT$", "w", stderr);
+}
+
+// Run body with its output in a console titled title, kept open until a key is pressed
+static void RunConsoleBenchmark(const char* title, void(*body)())
+{
+	OpenConsole();
+	SetConsoleTitleA(title);
+	body();
+	system("pause");
+}
+
+// Record time of the draw loop split over 1 to 8 worker lists, no device needed
+static void RunRecordBenchmark()
+{
+	const UINT drawCount = 100000;
+	std::cout << drawCount << " draws sorted by pipeline and mesh, one recording list per worker\n";
+
+	double singleWorkerMs = 0.0;
+	for (UINT workers = 1; workers <= 8; workers *= 2)
+	{
+		RecordBenchmarkResult result = RunRecordBenchmark(drawCount, workers, 100, 1);
+		if (workers == 1)
+			singleWorkerMs = result.RecordMs;
+		std::cout << workers << " worker(s): " << result.RecordMs << " ms recording (worst " << result.WorstRecordMs << " ms), x"
+			<< (result.RecordMs > 0.0 ? singleWorkerMs / result.RecordMs : 0.0) << " against 1 worker, "
+			<< result.Commands << " commands, " << result.StreamBytes / 1024 << " KB, "
+			<< (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n";
+	}
+}
+
+// Word following the flag of the running benchmark, or its default argument
+static std::string sFlagArgument;
+
+// Compare the frame loop with 1 to 4 frames in flight against a fake GPU, no device needed
+static void RunFrameLoopSimulation()
+{
+	const double cpuMs = 5.0;
+	const double gpuMs = 8.0;
+	std::cout << "Frame loop, " << cpuMs << " ms CPU / " << gpuMs << " ms GPU per frame\n";
+	for (UINT frames = 1; frames <= FrameRing::MaxFrames; frames++)
+	{
+		FrameLoopSimulationResult result = SimulateFrameLoop(frames, 120, cpuMs, gpuMs);
+		std::cout << frames << " frame(s) in flight: " << result.FramesPerSecond << " fps, "
+			<< result.Waits << " CPU waits (" << result.WaitTimeMs << " ms), "
+			<< result.ReuseErrors << " resources reused too early\n";
+	}
+}
+
+// Compare memcpy and the streaming copies used to write the upload buffers
+static void RunCopyBenchmarks()
+{
+	// "partial lines" on cached memory is the write-combined access simulated with non-temporal stores
+	std::cout << "Copies into a 256 bytes stride destination, 64 MB of cached memory then of write-combined pages\n";
+	for (const CopyBenchmarkResult& result : RunCopyBenchmarks(10))
+	{
+		std::cout << result.Memory << ", " << result.Method << ", " << result.Pattern << ", " << result.PayloadSize << " bytes: "
+			<< result.GigabytesPerSecond << " GB/s, " << result.NanosecondsPerElement << " ns per element\n";
+	}
+}
+
+// Random buffer allocations in the TLSF allocator of the GPU memory pages, checked for overlaps
+static void RunTlsfBenchmark()
+{
+	const UINT64 capacities[] = { 16ull * 1024 * 1024, 64ull * 1024 * 1024, 256ull * 1024 * 1024 };
+	for (UINT64 capacity : capacities)
+	{
+		TlsfBenchmarkResult result = RunTlsfBenchmark(capacity, 1000000, 1);
+		std::cout << (capacity >> 20) << " MB: " << result.OperationNs << " ns per operation, "
+			<< result.FailedAllocations << " failed, " << result.Errors << " errors, "
+			<< result.Stats.AllocationCount << " live, " << result.Stats.FreeBlockCount << " free blocks, "
+			<< "fragmentation " << result.Stats.Fragmentation << "\n";
+	}
+}
+
+// Descriptor allocations from 1 to 8 threads, checked for indices given twice
+static void RunDescriptorBenchmark()
+{
+	for (UINT threads = 1; threads <= 8; threads *= 2)
+	{
+		DescriptorBenchmarkResult result = RunDescriptorBenchmark(threads, 1000, 8000, 1);
+		std::cout << threads << " thread(s): " << result.OperationNs << " ns per operation, "
+			<< result.FailedAllocations << " failed, " << result.Errors << " errors, peak "
+			<< result.PersistentPeak << " persistent, " << result.TransientPeak << " transient in a frame\n";
+	}
+}
+
+// Frame hitches of a mesh upload on the direct queue against the copy queue, no device needed
+static void RunUploadStreamingSimulation()
+{
+	const double cpuMs = 4.0;
+	const double gpuMs = 6.0;
+	const double transferMs = 25.0;
+	std::cout << "Upload of " << transferMs << " ms every 20 frames, " << cpuMs << " ms CPU / " << gpuMs << " ms GPU per frame\n";
+	for (UINT path = 0; path < (UINT)UploadPath::Count; path++)
+	{
+		UploadStreamingResult result = SimulateUploadStreaming((UploadPath)path, 200, cpuMs, gpuMs, transferMs, 20);
+		std::cout << GetUploadPathName(result.Path) << ": " << result.AverageFrameMs << " ms average, "
+			<< result.WorstFrameMs << " ms worst, " << result.Hitches << " hitches for " << result.Uploads << " uploads, "
+			<< result.FramesToResident << " frames until drawn\n";
+	}
+}
+
+// Barriers of the resource state trackers over random frames, replayed from the recorded lists
+static void RunBarrierSimulation()
+{
+	for (UINT workers = 1; workers <= 8; workers *= 2)
+	{
+		BarrierSimulationResult result = SimulateResourceBarriers(200, workers, 64, 1);
+		std::cout << workers << " worker list(s): " << result.Transitions << " transitions, "
+			<< result.Barriers << " barriers in " << result.BarrierCalls << " calls, "
+			<< result.SplitBarriers << " split, " << result.ResolvedBarriers << " at submit, "
+			<< (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n";
+	}
+}
+
+// Object constants written when 0, 1, 10 or 100 percent of 100k dynamic items move every frame
+static void RunDirtyConstantsBenchmark()
+{
+	const UINT movingEvery[] = { 0, 100, 10, 1 };
+	HeadlessBenchmarkDesc desc;
+	desc.ItemCount = 100000;
+	desc.StaticPercent = 0;
+	for (UINT every : movingEvery)
+	{
+		desc.MovingEvery = every;
+		HeadlessBenchmarkResult result = RunHeadlessBenchmark(desc, 300, 4.0);
+		std::cout << (every == 0 ? 0 : 100 / every) << "% moving: " << result.ObjectsWritten << " objects written, "
+			<< result.BytesUploaded / 1024.0 << " KB uploaded, " << result.UpdateMs << " ms update per frame, "
+			<< (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n";
+	}
+}
+
+// Compile time of render graphs of growing size, each compiled frame replayed and checked
+static void RunRenderGraphBenchmark()
+{
+	const UINT passCounts[] = { 16, 50, 200 };
+	for (UINT passCount : passCounts)
+	{
+		RenderGraphBenchmarkResult result = RunRenderGraphBenchmark(passCount, 1000, 1);
+		const RenderGraphStats& stats = result.Stats;
+		std::cout << passCount << " passes: " << result.CompileMs << " ms per compile (worst " << result.WorstCompileMs << " ms), "
+			<< stats.CulledPasses << " culled, " << stats.Barriers << " barriers (" << stats.SplitBarriers << " split, "
+			<< stats.AliasingBarriers << " aliasing) in " << stats.BarrierCalls << " calls, "
+			<< (stats.TransientBytes >> 20) << " MB of textures in a " << (stats.HeapBytes >> 20) << " MB heap, "
+			<< (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n";
+	}
+}
+
+static void RunBundleBenchmark()
+{
+	// 90% of the draws are static, in bundles of 256 draws
+	const UINT drawCounts[] = { 1000, 10000, 100000 };
+	for (UINT drawCount : drawCounts)
+	{
+		BundleBenchmarkResult result = RunBundleBenchmark(drawCount, 90, 256, drawCount >= 100000 ? 50 : 500, 1);
+		std::cout << drawCount << " draws (" << result.StaticDraws << " static in " << result.Bundles << " bundles): "
+			<< result.RecordAllMs << " ms recording every draw, " << result.RecordBundlesMs << " ms with the bundles ("
+			<< result.CommandsAll << " -> " << result.CommandsBundles << " commands), bundles built in " << result.BuildMs
+			<< " ms, update " << result.UnchangedUpdateMs << " ms unchanged, " << result.ChangedUpdateMs << " ms with "
+			<< result.ChangedRecorded << " recorded again, "
+			<< (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n";
+	}
+}
+
+static void RunDrawListBenchmark()
+{
+	// Items changing every frame among 200k
+	const float churns[] = { 0.1f, 1.0f, 5.0f, 20.0f };
+	for (float churn : churns)
+	{
+		DrawListBenchmarkResult result = RunDrawListBenchmark(200000, churn, 200, 1);
+		std::cout << churn << "% churn (" << result.ChangesPerFrame << " of " << result.Items << " items): "
+			<< result.RebuildMs << " ms rebuilding and sorting every key, " << result.RetainedMs
+			<< " ms merging the changes (worst " << result.WorstRetainedMs << " ms), the renderer "
+			<< (churn / 100.0f > RetainedDrawList::RebuildFraction ? "rebuilds" : "merges") << ", "
+			<< (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n";
+	}
+}
+
+// Radix sort of the draw queue keys against std::sort, from 1k to 1M visible items
+static void RunSortBenchmark()
+{
+	const UINT keyCounts[] = { 1000, 10000, 100000, 1000000 };
+	for (UINT keyCount : keyCounts)
+	{
+		SortBenchmarkResult result = RunSortBenchmark(keyCount, keyCount >= 1000000 ? 20 : 200, 1);
+		std::cout << keyCount << " keys: " << result.RadixMs << " ms radix sort (worst " << result.WorstRadixMs << " ms), "
+			<< result.StdSortMs << " ms std::sort, " << (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n";
+	}
+}
+
+// Hits and misses of the pipeline cache lookup with every request written differently, no device needed
+static void RunPipelineCacheBenchmark()
+{
+	const UINT pipelineCounts[] = { 16, 256, 4096 };
+	for (UINT pipelineCount : pipelineCounts)
+	{
+		PipelineCacheBenchmarkResult result = RunPipelineCacheBenchmark(pipelineCount, 16, 1);
+		std::cout << pipelineCount << " pipelines, " << result.Requests << " requests: " << result.Hits << " hits, "
+			<< result.Misses << " misses, " << result.KeyNs << " ns per key, " << result.LookupNs << " ns per lookup, "
+			<< (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n";
+	}
+}
+
+// Shader permutations compiled with an empty cache then loaded back from it. The runs use a cache
+// directory of their own, emptied first, so the numbers do not depend on what the application left.
+static void RunShaderCompileBenchmark()
+{
+	const wchar_t* directory = L"shader\\cache-bench";
+	CreateDirectoryW(directory, nullptr);
+	WIN32_FIND_DATAW found;
+	HANDLE search = FindFirstFileW(L"shader\\cache-bench\\*.cso", &found);
+	if (search != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			DeleteFileW((std::wstring(directory) + L"\\" + found.cFileName).c_str());
+		} while (FindNextFileW(search, &found));
+		FindClose(search);
+	}
+
+	ShaderCache& cache = Shader::GetCache();
+	cache.Initialize("shader\\cache-bench");
+
+	ThreadPool pool;
+	const char* runs[] = { "Cold", "Warm" };
+	for (const char* run : runs)
+	{
+		ShaderCacheStats before = cache.GetStats();
+		auto start = std::chrono::high_resolution_clock::now();
+
+		Shader shader(L"shader\\default.hlsl", "VS", "PS", { "INSTANCED" });
+		bool compiled = shader.Compile({ 0, shader.GetKeyword("INSTANCED") }, pool);
+
+		auto end = std::chrono::high_resolution_clock::now();
+		ShaderCacheStats after = cache.GetStats();
+		const ShaderPermutationStats& permutations = shader.GetPermutationStats();
+		std::cout << run << ": " << std::chrono::duration<double, std::milli>(end - start).count() << " ms for "
+			<< permutations.Requested << " permutations (" << permutations.Variants << " variants), "
+			<< after.Misses - before.Misses << " compiled, " << after.Hits - before.Hits << " from the cache, "
+			<< permutations.PreprocessTimeMs << " ms preprocessing (" << after.PreprocessHits - before.PreprocessHits
+			<< " skipped), " << after.KeyTimeMs - before.KeyTimeMs << " ms hashing, "
+			<< after.LoadTimeMs - before.LoadTimeMs << " ms loading, " << after.CompileTimeMs - before.CompileTimeMs << " ms compiling"
+			<< (compiled ? "" : ", failed") << "\n";
+	}
+
+	cache.Initialize("shader\\cache");
+}
+
+// Whole frames of the renderer CPU side on a recording device, no window or GPU needed
+static void RunHeadlessBenchmark()
+{
+	// Draws per item, instanced draws, then one ExecuteIndirect for the batches
+	const char* modes[] = { "One draw per item", "Instancing", "Indirect" };
+	HeadlessBenchmarkDesc desc;
+	desc.ItemCount = 100000;
+	for (int mode = 0; mode < 3; mode++)
+	{
+		desc.Instancing = mode != 0;
+		desc.Indirect = mode == 2;
+		HeadlessBenchmarkResult result = RunHeadlessBenchmark(desc, 300, 4.0);
+		std::cout << modes[mode] << ", " << desc.ItemCount << " items: "
+			<< result.UpdateMs << " ms update, " << result.RecordMs << " ms recording, " << result.SubmitMs << " ms submit (worst frame "
+			<< result.WorstFrameMs << " ms, " << result.WaitMs << " ms waiting for the queue)\n   "
+			<< result.VisibleItems << " visible items, " << result.Draws << " draws, " << result.IndirectCalls << " indirect calls, "
+			<< result.BundleCalls << " bundles, " << result.Commands << " commands, "
+			<< result.StreamBytes / 1024.0 << " KB of commands, " << result.BytesUploaded / 1024.0 << " KB uploaded per frame, stream hash "
+			<< std::hex << result.StreamHash << std::dec << ", " << (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n";
+	}
+
+	// Recording lists with 1 to 8 workers, one draw per item so the recording has the most to do
+	desc.Instancing = false;
+	desc.Indirect = false;
+	double singleWorkerMs = 0.0;
+	for (std::uint32_t workers : { 1u, 2u, 4u, 8u })
+	{
+		desc.Workers = workers;
+		HeadlessBenchmarkResult result = RunHeadlessBenchmark(desc, 300, 4.0);
+		if (workers == 1)
+			singleWorkerMs = result.RecordMs;
+		std::cout << workers << (workers == 1 ? " worker: " : " workers: ") << result.RecordMs << " ms recording, x"
+			<< (result.RecordMs > 0.0 ? singleWorkerMs / result.RecordMs : 0.0) << " against 1 worker, "
+			<< result.SubmitMs << " ms submit, " << (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n";
+	}
+}
+
+// Word following flag on the command line, defaultValue when there is none
+static std::string GetFlagArgument(const char* cmdLine, const char* flag, const std::string& defaultValue)
+{
+	const char* argument = strstr(cmdLine, flag) + strlen(flag);
+	while (*argument == ' ') argument++;
+	if (*argument == '\0' || *argument == '-') return defaultValue;
+
+	const char* end = argument;
+	while (*end != '\0' && *end != ' ') end++;
+	return std::string(argument, end);
+}
+
+// Capture frames of the headless renderer in a file that -replay runs again
+static void RunCapture()
+{
+	const std::string& path = sFlagArgument;
+	HeadlessBenchmarkDesc desc;
+	desc.ItemCount = 100000;
+	std::string error;
+	if (CaptureHeadlessFrames(desc, 120, path, &error))
+		std::cout << "120 frames of " << desc.ItemCount << " items captured in " << path << "\n";
+	else
+		std::cout << "Capture failed, " << error << "\n";
+}
+
+// Capture the setup and the first frames of the application window, it goes on drawing once they are saved
+static void RunAppCapture(HINSTANCE instance, const std::string& path)
+{
+	OpenConsole();
+
+	RenderApplication window(instance);
+	window.CaptureFrames(path, 120);
+	if (!window.Initialize())
+	{
+		std::cerr << "Window initialization failed" << std::endl;
+		system("pause");
+		return;
+	}
+
+	window.Run();
+}
+
+// Replay a capture in a loop on a recording device and give the cost of each command type
+static void RunReplay()
+{
+	const std::string& path = sFlagArgument;
+	MappedFile file;
+	std::string error;
+	if (!file.Open(path, &error))
+	{
+		std::cout << "Replay failed, " << error << "\n";
+		return;
+	}
+
+	RecordingRenderDevice device;
+	CaptureReplayResult result = ReplayCapture(file.GetData(), file.GetSize(), device, 10, true);
+	std::cout << path << ": " << result.Frames << " frames, " << result.CaptureBytes / (1024.0 * 1024.0) << " MB, "
+		<< (result.Valid ? std::string("valid") : "invalid, " + result.Error) << "\n"
+		<< "Setup " << result.SetupMs << " ms, " << result.FrameMs << " ms per frame (worst " << result.WorstFrameMs << " ms)"
+		<< (result.Relocated ? ", addresses translated" : "") << "\n"
+		<< "Per pass over the frames, noise " << result.NoiseMs << " ms:\n";
+
+	for (size_t c = 0; c < (size_t)CommandType::Count; c++)
+	{
+		const ReplayCost& cost = result.Commands[c];
+		if (cost.Count == 0) continue;
+		std::cout << "   " << GetCommandName((CommandType)c) << ": " << cost.Count << " calls, " << cost.TotalMs << " ms, "
+			<< cost.TotalMs * 1e6 / cost.Count << " ns per call\n";
+	}
+	for (size_t r = 0; r < (size_t)CaptureRecordType::Count; r++)
+	{
+		const ReplayCost& cost = result.Records[r];
+		if (cost.Count == 0) continue;
+		std::cout << "   " << GetCaptureRecordName((CaptureRecordType)r) << ": " << cost.Count << " records, " << cost.TotalMs << " ms\n";
+	}
+}
+
+// Flags running a benchmark in a console instead of the window, the first one found on the command line wins
+struct ConsoleBenchmark
+{
+	const char* Flag;
+	const char* Title;
+	void(*Body)();
+	const char* DefaultArgument; // Read from sFlagArgument, nullptr when the benchmark takes none
+};
+
+static const ConsoleBenchmark ConsoleBenchmarks[] =
+{
+	{ "-bench-record-workers", "Record worker benchmark", RunRecordBenchmark, nullptr },
+	{ "-simulate-frames", "Frame loop simulation", RunFrameLoopSimulation, nullptr },
+	{ "-simulate-uploads", "Upload streaming simulation", RunUploadStreamingSimulation, nullptr },
+	{ "-simulate-barriers", "Barrier simulation", RunBarrierSimulation, nullptr },
+	{ "-bench-copies", "Copy benchmark", RunCopyBenchmarks, nullptr },
+	{ "-bench-descriptors", "Descriptor benchmark", RunDescriptorBenchmark, nullptr },
+	{ "-bench-render-graph", "Render graph benchmark", RunRenderGraphBenchmark, nullptr },
+	{ "-bench-bundles", "Bundle benchmark", RunBundleBenchmark, nullptr },
+	{ "-bench-draw-list", "Draw list benchmark", RunDrawListBenchmark, nullptr },
+	{ "-headless", "Headless renderer benchmark", RunHeadlessBenchmark, nullptr },
+	{ "-capture", "Headless capture", RunCapture, "frames.capture" },
+	{ "-replay", "Capture replay", RunReplay, "frames.capture" },
+	{ "-bench-tlsf", "TLSF benchmark", RunTlsfBenchmark, nullptr },
+	{ "-bench-sort", "Draw key sort benchmark", RunSortBenchmark, nullptr },
+	{ "-bench-dirty-constants", "Dirty constants benchmark", RunDirtyConstantsBenchmark, nullptr },
+	{ "-bench-pipelines", "Pipeline cache benchmark", RunPipelineCacheBenchmark, nullptr },
+	{ "-bench-shaders", "Shader compile benchmark", RunShaderCompileBenchmark, nullptr },
+};
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdLine, int showCmd)
 {
-	
-	RenderApplication window = RenderApplication(hInstance);
+	// Before -capture, which is a prefix of it
+	if (strstr(cmdLine, "-capture-app") != nullptr)
+	{
+		RunAppCapture(hInstance, GetFlagArgument(cmdLine, "-capture-app", "app.capture"));
+		return 0;
+	}
+
+	for (const ConsoleBenchmark& benchmark : ConsoleBenchmarks)
+	{
+		if (strstr(cmdLine, benchmark.Flag) == nullptr)
+			continue;
+
+		if (benchmark.DefaultArgument != nullptr)
+			sFlagArgument = GetFlagArgument(cmdLine, benchmark.Flag, benchmark.DefaultArgument);
+		RunConsoleBenchmark(benchmark.Title, benchmark.Body);
+		return 0;
+	}
+
+	RenderApplication window(hInstance);
 
 	if (!window.Initialize())
 	{
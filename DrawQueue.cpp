@@ -0,0 +1,176 @@
+﻿#include "DrawQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+
+#include "lib/RadixSort.h"
+
+namespace
+{
+    const std::uint32_t ItemShift = 0;
+    const std::uint32_t DepthShift = ItemShift + DrawQueue::ItemBits;
+    const std::uint32_t MeshShift = DepthShift + DrawQueue::DepthBits;
+    const std::uint32_t PsoShift = MeshShift + DrawQueue::MeshBits;
+    const std::uint32_t PassShift = PsoShift + DrawQueue::PsoBits;
+
+    std::uint64_t Field(std::uint32_t value, std::uint32_t bits, std::uint32_t shift)
+    {
+        std::uint64_t mask = (1ull << bits) - 1;
+        assert((std::uint64_t)value <= mask);
+        return ((std::uint64_t)value & mask) << shift;
+    }
+
+    std::uint32_t Extract(std::uint64_t key, std::uint32_t bits, std::uint32_t shift)
+    {
+        return (std::uint32_t)((key >> shift) & ((1ull << bits) - 1));
+    }
+}
+
+std::uint64_t DrawQueue::MakeKey(std::uint32_t pass, std::uint32_t pso, std::uint32_t mesh, float depth, std::uint32_t item)
+{
+    depth = std::min(std::max(depth, 0.0f), 1.0f);
+    std::uint32_t depthBucket = (std::uint32_t)(depth * (float)((1u << DepthBits) - 1));
+
+    return Field(pass, PassBits, PassShift) |
+        Field(pso, PsoBits, PsoShift) |
+        Field(mesh, MeshBits, MeshShift) |
+        Field(depthBucket, DepthBits, DepthShift) |
+        Field(item, ItemBits, ItemShift);
+}
+
+std::uint32_t DrawQueue::GetPass(std::uint64_t key)
+{
+    return Extract(key, PassBits, PassShift);
+}
+
+std::uint32_t DrawQueue::GetPso(std::uint64_t key)
+{
+    return Extract(key, PsoBits, PsoShift);
+}
+
+std::uint32_t DrawQueue::GetMesh(std::uint64_t key)
+{
+    return Extract(key, MeshBits, MeshShift);
+}
+
+std::uint32_t DrawQueue::GetItem(std::uint64_t key)
+{
+    return Extract(key, ItemBits, ItemShift);
+}
+
+void DrawQueue::SetRetained(bool retained)
+{
+    mRetained = retained;
+    mKeys.clear();
+    mRetainedKeys.Clear();
+    mRetainedKeys.Apply();
+}
+
+bool DrawQueue::IsRetained() const
+{
+    return mRetained;
+}
+
+void DrawQueue::Clear()
+{
+    mKeys.clear();
+    mRetainedKeys.Clear();
+}
+
+void DrawQueue::Reserve(std::uint32_t count)
+{
+    mKeys.reserve(count);
+}
+
+void DrawQueue::Push(std::uint64_t key)
+{
+    mKeys.push_back(key);
+}
+
+void DrawQueue::Set(std::uint32_t item, std::uint64_t key)
+{
+    mRetainedKeys.Set(item, key);
+}
+
+void DrawQueue::Remove(std::uint32_t item)
+{
+    mRetainedKeys.Remove(item);
+}
+
+void DrawQueue::Resize(std::uint32_t itemCount)
+{
+    mRetainedKeys.Resize(itemCount);
+}
+
+bool DrawQueue::Contains(std::uint32_t item) const
+{
+    return mRetainedKeys.Contains(item);
+}
+
+const RetainedDrawListStats& DrawQueue::GetRetainedStats() const
+{
+    return mRetainedKeys.GetStats();
+}
+
+std::uint32_t DrawQueue::Size() const
+{
+    return (std::uint32_t)Keys().size();
+}
+
+const std::vector<std::uint64_t>& DrawQueue::Keys() const
+{
+    return mRetained ? mRetainedKeys.GetKeys() : mKeys;
+}
+
+void DrawQueue::Sort()
+{
+    if (mRetained)
+        mRetainedKeys.Apply();
+    else
+        RadixSortKeys(mKeys, mScratch);
+}
+
+void DrawQueue::BuildBatches(std::vector<DrawBatch>& batches, std::uint32_t maxBatchSize) const
+{
+    batches.clear();
+
+    // Pass, pso and mesh are the high bits of the key, the low bits are ignored to compare
+    const std::uint64_t groupMask = ~((1ull << MeshShift) - 1);
+
+    const std::vector<std::uint64_t>& keys = Keys();
+    const std::uint32_t count = (std::uint32_t)keys.size();
+    std::uint32_t first = 0;
+    while (first < count)
+    {
+        std::uint64_t group = keys[first] & groupMask;
+        std::uint32_t last = first + 1;
+        while (last < count && last - first < maxBatchSize && (keys[last] & groupMask) == group)
+            last++;
+
+        DrawBatch batch;
+        batch.FirstPacket = first;
+        batch.PacketCount = last - first;
+        batches.push_back(batch);
+
+        first = last;
+    }
+}
+
+void DrawQueue::CountStateChanges(const std::uint64_t* keys, std::uint32_t count, std::uint32_t& psoChanges, std::uint32_t& meshChanges)
+{
+    psoChanges = 0;
+    meshChanges = 0;
+
+    std::uint32_t lastPso = UINT_MAX;
+    std::uint32_t lastMesh = UINT_MAX;
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        std::uint32_t pso = GetPso(keys[i]);
+        std::uint32_t mesh = GetMesh(keys[i]);
+        if (pso != lastPso) psoChanges++;
+        if (mesh != lastMesh) meshChanges++;
+        lastPso = pso;
+        lastMesh = mesh;
+    }
+}
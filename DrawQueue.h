@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "lib/RetainedDrawList.h"
+
+// Per frame draw submission counters
+struct DrawQueueStats
+{
+    std::uint32_t Packets = 0;
+    float SortTimeMs = 0.0f;
+
+    // State changes if the packets were submitted in insertion order
+    std::uint32_t MeshChangesUnsorted = 0;
+    std::uint32_t PsoChangesUnsorted = 0;
+
+    // State changes in key order
+    std::uint32_t MeshChanges = 0;
+    std::uint32_t PsoChanges = 0;
+
+    // Retained mode, items given a new key or removed this frame
+    std::uint32_t ItemsRekeyed = 0;
+    bool Rebuilt = false; // Every key made and sorted again, the camera moved or too many items changed
+    float BuildTimeMs = 0.0f; // Keys made and sorted
+};
+
+// Run of consecutive packets sharing pass, pipeline and mesh, drawn with one instanced call
+struct DrawBatch
+{
+    std::uint32_t FirstPacket = 0;
+    std::uint32_t PacketCount = 0;
+};
+
+// Queue of 64 bits draw packets sorted before submission.
+// From most to least significant bits a key is made of
+//   pass (3) | pso (9) | mesh (14) | depth bucket (14) | item index (24)
+// so draws are grouped by pass, then pipeline, then mesh and front to back inside a mesh.
+// In retained mode the sorted keys are kept between frames: only the items whose key changed are
+// given with Set and Remove, Sort merges them in the keys of the last frame.
+class DrawQueue
+{
+public:
+    static const std::uint32_t PassBits = 3;
+    static const std::uint32_t PsoBits = 9;
+    static const std::uint32_t MeshBits = 14;
+    static const std::uint32_t DepthBits = 14;
+    static const std::uint32_t ItemBits = 24;
+
+    // depth is the normalized [0, 1] view distance, it is clamped
+    static std::uint64_t MakeKey(std::uint32_t pass, std::uint32_t pso, std::uint32_t mesh, float depth, std::uint32_t item);
+
+    static std::uint32_t GetPass(std::uint64_t key);
+    static std::uint32_t GetPso(std::uint64_t key);
+    static std::uint32_t GetMesh(std::uint64_t key);
+    static std::uint32_t GetItem(std::uint64_t key);
+
+    // Switching mode empties the queue
+    void SetRetained(bool retained);
+    bool IsRetained() const;
+
+    // Every packet is removed, in retained mode the next Sort sorts every key from scratch
+    void Clear();
+    void Reserve(std::uint32_t count);
+    void Push(std::uint64_t key);
+
+    // Retained mode, the key of an item stays until it is set again or removed
+    void Set(std::uint32_t item, std::uint64_t key);
+    void Remove(std::uint32_t item);
+    void Resize(std::uint32_t itemCount); // Items past the count are removed
+    bool Contains(std::uint32_t item) const;
+    const RetainedDrawListStats& GetRetainedStats() const;
+
+    // LSD radix sort on bytes, the passes on bytes every key share are skipped.
+    // In retained mode only the keys changed since the last Sort are sorted and merged.
+    void Sort();
+
+    std::uint32_t Size() const;
+    const std::vector<std::uint64_t>& Keys() const;
+
+    // Group the sorted packets in batches of at most maxBatchSize packets with the same pass, pso and mesh
+    void BuildBatches(std::vector<DrawBatch>& batches, std::uint32_t maxBatchSize) const;
+
+    // Count the pso and mesh changes of the keys in their current order
+    static void CountStateChanges(const std::uint64_t* keys, std::uint32_t count, std::uint32_t& psoChanges, std::uint32_t& meshChanges);
+
+private:
+    std::vector<std::uint64_t> mKeys;
+    std::vector<std::uint64_t> mScratch;
+    bool mRetained = false;
+    RetainedDrawList mRetainedKeys;
+};
@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include "lib/Maths.h"
+
+// C'est les constantes globales du monde pour chaque frame
+// Y'a tout les parametres du livre mais c'est pas forcement tout utile
+struct PassConstants
+{
+    Float4x4 View = Maths::Identity();
+    Float4x4 InvView = Maths::Identity();
+    Float4x4 Proj = Maths::Identity();
+    Float4x4 InvProj = Maths::Identity();
+    Float4x4 ViewProj = Maths::Identity();
+    Float4x4 InvViewProj = Maths::Identity();
+    Float3 EyePosW = { 0.0f, 0.0f, 0.0f };
+    float cbPerObjectPad1 = 0.0f;
+    Float2 RenderTargetSize = { 0.0f, 0.0f };
+    Float2 InvRenderTargetSize = { 0.0f, 0.0f };
+    float NearZ = 0.0f;
+    float FarZ = 0.0f;
+    float TotalTime = 0.0f;
+    float DeltaTime = 0.0f;
+};
+
+// C'est les constante pour chaque objet individuel
+struct ObjectConstants
+{
+    Float4x4 World;
+    Float4 Color;
+};
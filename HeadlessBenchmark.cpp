@@ -0,0 +1,220 @@
+﻿#include "HeadlessBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#include "Renderer.h"
+#include "lib/CaptureRenderDevice.h"
+#include "lib/RecordingRenderDevice.h"
+
+namespace
+{
+    // The recording device only compares and hashes the backend objects, fixed values keep the streams the same from run to run
+    void* MakeFakeHandle(std::uintptr_t value)
+    {
+        return (void*)value;
+    }
+
+    const float OrbitRadius = 150.0f;
+    const float OrbitDegreesPerFrame = 0.5f;
+
+    struct HeadlessFrameTimes
+    {
+        double WaitMs = 0.0;
+        double UpdateMs = 0.0;
+        double DrawMs = 0.0; // Recording and submission
+    };
+
+    // The application frame without its window: the same Renderer with fake pipeline objects and targets
+    class HeadlessScene
+    {
+    public:
+        HeadlessScene(IRenderDevice& device) : mRenderer(device) {}
+
+        ~HeadlessScene()
+        {
+            // The items are deleted with the renderer, only the meshes are ours
+            mRenderer.WaitIdle();
+            for (RenderMesh* mesh : mMeshes)
+                mRenderer.GetGeometryFactory().ReleaseMesh(mesh);
+        }
+
+        void Initialize(const HeadlessBenchmarkDesc& desc)
+        {
+            RendererPipeline pipeline;
+            pipeline.RootSignature = MakeFakeHandle(1);
+            pipeline.PipelineState = MakeFakeHandle(2);
+            pipeline.InstancedPipelineState = MakeFakeHandle(3);
+            pipeline.CommandSignature = MakeFakeHandle(4);
+            pipeline.DescriptorHeap = MakeFakeHandle(5);
+            mRenderer.Initialize(pipeline, desc.FramesInFlight);
+
+            RendererOptions options;
+            options.UseBundles = desc.Bundles;
+            options.UseInstancing = desc.Instancing;
+            options.UseIndirect = desc.Indirect;
+            options.RetainedQueue = desc.RetainedQueue;
+            options.RecordWorkers = desc.Workers;
+            options.MovingEvery = desc.MovingEvery;
+            mRenderer.SetOptions(options);
+
+            mTarget.BackBuffer = MakeFakeHandle(0x100);
+            mTarget.BackBufferView = 0x200;
+            mTarget.DepthBuffer = MakeFakeHandle(0x101);
+            mTarget.DepthView = 0x201;
+            mTarget.ScreenViewport.Width = 1920.0f;
+            mTarget.ScreenViewport.Height = 1080.0f;
+            mTarget.Scissor.Right = 1920;
+            mTarget.Scissor.Bottom = 1080;
+            mRenderer.GetResourceStates().Register(mTarget.BackBuffer, ResourceStatePresent);
+
+            mProj = Maths::PerspectiveFovLH(0.25f * Maths::PI, mTarget.ScreenViewport.Width / mTarget.ScreenViewport.Height, 0.1f, 1000.0f);
+
+            // Static boxes merged in chunks, moving boxes and spheres drawn through the draw queue
+            GeometryFactory& factory = mRenderer.GetGeometryFactory();
+            RenderMesh* box = factory.CreateBox(1.0f, 1.0f, 1.0f, 3);
+            RenderMesh* sphere = factory.CreateGeosphere(0.5f, 2);
+            mMeshes = { box, sphere };
+
+            std::uint32_t staticCount = desc.ItemCount * std::min(desc.StaticPercent, 100u) / 100;
+            std::uint32_t dynamicCount = desc.ItemCount - staticCount;
+            mRenderer.SpawnStressGrid(box, staticCount, true);
+            mRenderer.SpawnStressGrid(box, dynamicCount / 2, false);
+            mRenderer.SpawnStressGrid(sphere, dynamicCount - dynamicCount / 2, false);
+
+            // Grids start at the origin and grow along +z
+            std::uint32_t side = (std::uint32_t)ceilf(sqrtf((float)std::max(1u, desc.ItemCount)));
+            mCenter = Float3(0.0f, 0.0f, (float)side);
+        }
+
+        HeadlessFrameTimes RunFrame()
+        {
+            typedef std::chrono::high_resolution_clock Clock;
+            HeadlessFrameTimes times;
+
+            // Turn a bit around the center of the grid, looking at it
+            TRANSFORM& transform = mCamera.GetTransform();
+            transform.Rotate(0.0f, OrbitDegreesPerFrame, 0.0f);
+            transform.SetPosition(mCenter - transform.forward * OrbitRadius);
+            mCamera.UpdateMatrix();
+
+            auto start = Clock::now();
+            mRenderer.BeginFrame();
+            auto waited = Clock::now();
+            mRenderer.Update(mCamera, mProj, mTarget.ScreenViewport.Width, mTarget.ScreenViewport.Height,
+                (float)mFrame / 60.0f, 1.0f / 60.0f);
+            auto updated = Clock::now();
+            mRenderer.Draw(mTarget);
+            mRenderer.EndFrame();
+            auto drawn = Clock::now();
+            mFrame++;
+
+            times.WaitMs = std::chrono::duration<double, std::milli>(waited - start).count();
+            times.UpdateMs = std::chrono::duration<double, std::milli>(updated - waited).count();
+            times.DrawMs = std::chrono::duration<double, std::milli>(drawn - updated).count();
+            return times;
+        }
+
+        Renderer& GetRenderer() { return mRenderer; }
+
+    private:
+        Renderer mRenderer;
+        std::vector<RenderMesh*> mMeshes;
+        FrameTarget mTarget;
+        Camera mCamera;
+        Float4x4 mProj;
+        Float3 mCenter;
+        std::uint32_t mFrame = 0;
+    };
+}
+
+HeadlessBenchmarkResult RunHeadlessBenchmark(const HeadlessBenchmarkDesc& desc, std::uint32_t frames, double gpuLatencyMs)
+{
+    HeadlessBenchmarkResult result;
+    result.Frames = frames;
+
+    RecordingRenderDevice device(0, gpuLatencyMs);
+    HeadlessScene scene(device);
+    scene.Initialize(desc);
+
+    // The first frame merges the static items and records their bundles, it is not part of the frames
+    scene.RunFrame();
+    scene.GetRenderer().WaitIdle();
+    device.ResetSubmissionStats();
+
+    Renderer& renderer = scene.GetRenderer();
+    std::string indirectError;
+    for (std::uint32_t frame = 0; frame < frames; frame++)
+    {
+        HeadlessFrameTimes times = scene.RunFrame();
+
+        double recordMs = renderer.GetRecordTimeMs();
+        result.WaitMs += times.WaitMs;
+        result.UpdateMs += times.UpdateMs;
+        result.RecordMs += recordMs;
+        result.SubmitMs += times.DrawMs - recordMs;
+        result.WorstFrameMs = std::max(result.WorstFrameMs, times.UpdateMs + times.DrawMs);
+        result.VisibleItems += renderer.GetCullingStats(0).DrawsSubmitted;
+        result.BytesUploaded += (double)renderer.GetBytesWritten();
+        result.ObjectsWritten += (double)renderer.GetObjectsWritten();
+
+        // Checked in every build here, the renderer only checks them in debug
+        if (indirectError.empty() && !renderer.ValidateIndirectArguments(&indirectError))
+            indirectError = "frame " + std::to_string(frame) + ", " + indirectError;
+    }
+    renderer.WaitIdle();
+
+    SubmissionStats submitted = device.GetSubmissionStats();
+    result.Draws = (double)submitted.Draws;
+    result.Instances = (double)submitted.Instances;
+    result.IndirectCalls = (double)submitted.IndirectCalls;
+    result.BundleCalls = (double)submitted.BundleCalls;
+    result.Commands = (double)submitted.Commands;
+    result.StreamBytes = (double)submitted.StreamBytes;
+    result.Barriers = (double)submitted.Barriers;
+    result.StreamHash = submitted.StreamHash;
+
+    if (frames > 0)
+    {
+        double* averages[] = { &result.WaitMs, &result.UpdateMs, &result.RecordMs, &result.SubmitMs, &result.VisibleItems, &result.Draws,
+                               &result.Instances, &result.IndirectCalls, &result.BundleCalls, &result.Commands, &result.StreamBytes,
+                               &result.BytesUploaded, &result.ObjectsWritten, &result.Barriers };
+        for (double* value : averages)
+            *value /= frames;
+    }
+
+    result.Valid = submitted.InvalidLists == 0 && submitted.EarlyResets == 0 && submitted.Submissions == frames && indirectError.empty();
+    if (submitted.InvalidLists != 0)
+        result.Error = std::to_string(submitted.InvalidLists) + " truncated command lists";
+    else if (submitted.EarlyResets != 0)
+        result.Error = std::to_string(submitted.EarlyResets) + " command lists reset while in flight";
+    else if (submitted.Submissions != frames)
+        result.Error = std::to_string(submitted.Submissions) + " submissions for " + std::to_string(frames) + " frames";
+    else if (!indirectError.empty())
+        result.Error = indirectError;
+    return result;
+}
+
+bool CaptureHeadlessFrames(const HeadlessBenchmarkDesc& desc, std::uint32_t frames, const std::string& path, std::string* error)
+{
+    RecordingRenderDevice device;
+    CaptureRenderDevice capture(device);
+    {
+        HeadlessScene scene(capture);
+        scene.Initialize(desc);
+
+        // The static world and its bundles are part of the setup
+        scene.RunFrame();
+
+        capture.BeginFrames();
+        for (std::uint32_t frame = 0; frame < frames; frame++)
+        {
+            scene.RunFrame();
+            capture.EndFrame();
+        }
+    }
+
+    return capture.Save(path, error);
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct HeadlessBenchmarkDesc
+{
+    std::uint32_t ItemCount = 100000;
+    std::uint32_t StaticPercent = 50; // Merged in chunks replayed from their bundle
+    std::uint32_t FramesInFlight = 3;
+    std::uint32_t Workers = 4; // Command lists recorded in parallel
+    bool Instancing = true;
+    bool Indirect = false; // Batches drawn with one ExecuteIndirect
+    bool Bundles = true;
+    bool RetainedQueue = true; // Sorted keys kept between frames, only the changed ones merged
+    std::uint32_t MovingEvery = 10; // Every nth dynamic item moves, 0 for none
+};
+
+struct HeadlessBenchmarkResult
+{
+    std::uint32_t Frames = 0;
+
+    // Average CPU time of a frame, without the waits for the queue
+    double WaitMs = 0.0;
+    double UpdateMs = 0.0;
+    double RecordMs = 0.0;
+    double SubmitMs = 0.0;
+    double WorstFrameMs = 0.0;
+
+    // Average of a frame, the same for the same description and frame count
+    double VisibleItems = 0.0;
+    double Draws = 0.0;
+    double Instances = 0.0;
+    double IndirectCalls = 0.0;
+    double BundleCalls = 0.0;
+    double Commands = 0.0;
+    double StreamBytes = 0.0;
+    double BytesUploaded = 0.0;
+    double ObjectsWritten = 0.0; // Object constants copied in the frame slot
+    double Barriers = 0.0;
+    std::uint64_t StreamHash = 0; // Of every submitted stream
+
+    // The queue read every list whole, no list was reset while in flight and the indirect
+    // arguments of every frame passed ValidateIndirectArguments
+    bool Valid = false;
+    std::string Error;
+};
+
+// frames frames of the application Renderer on a recording device, each submission taking at
+// least gpuLatencyMs on the fake queue. The scene is a grid of static and moving items seen from
+// a camera going around it, the first frame merging the static items is not measured.
+HeadlessBenchmarkResult RunHeadlessBenchmark(const HeadlessBenchmarkDesc& desc, std::uint32_t frames, double gpuLatencyMs);
+
+// Capture frames frames of the same scene on a recording device in path, the scene setup
+// is replayed once and the frames in a loop
+bool CaptureHeadlessFrames(const HeadlessBenchmarkDesc& desc, std::uint32_t frames, const std::string& path, std::string* error = nullptr);
@@ -0,0 +1,103 @@
+﻿#include "LinearUploadBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+LinearUploadBuffer::LinearUploadBuffer()
+{
+}
+
+LinearUploadBuffer::~LinearUploadBuffer()
+{
+    ReleaseBuffer();
+}
+
+void LinearUploadBuffer::Initialize(IRenderDevice* device, std::uint64_t capacity)
+{
+    mDevice = device;
+    CreateBuffer(capacity);
+}
+
+void LinearUploadBuffer::CreateBuffer(std::uint64_t capacity)
+{
+    capacity = (capacity + ConstantAlignment - 1) & ~(ConstantAlignment - 1);
+
+    BufferDesc desc;
+    desc.SizeInBytes = capacity;
+    desc.Heap = BufferHeap::Upload;
+    mBuffer = mDevice->CreateBuffer(desc);
+
+    if (mBuffer == InvalidBuffer)
+    {
+        std::cerr << "Failed to create linear upload buffer !\n";
+        mAllocator.Reset(0);
+        return;
+    }
+
+    // Stay mapped for the buffer lifetime, upload buffers allow it
+    mMappedData = static_cast<std::uint8_t*>(mDevice->Map(mBuffer));
+    mGpuAddress = mDevice->GetGpuAddress(mBuffer);
+    mAllocator.Reset(capacity);
+}
+
+void LinearUploadBuffer::ReleaseBuffer()
+{
+    if (mBuffer != InvalidBuffer)
+        mDevice->DestroyBuffer(mBuffer);
+
+    mBuffer = InvalidBuffer;
+    mMappedData = nullptr;
+    mGpuAddress = 0;
+}
+
+void LinearUploadBuffer::Reset(std::uint64_t requiredBytes)
+{
+    if (requiredBytes > mAllocator.GetCapacity())
+    {
+        // Grow geometrically so a slowly increasing scene does not recreate it every frame
+        std::uint64_t capacity = std::max(requiredBytes, mAllocator.GetCapacity() * 2);
+        ReleaseBuffer();
+        CreateBuffer(capacity);
+        return;
+    }
+
+    mAllocator.Reset();
+}
+
+UploadAllocation LinearUploadBuffer::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+    UploadAllocation allocation;
+
+    std::uint64_t offset = mAllocator.Allocate(size, alignment);
+    if (offset == LinearAllocator::InvalidOffset)
+    {
+        assert(false && "Linear upload buffer is full");
+        return allocation;
+    }
+
+    allocation.Cpu = mMappedData + offset;
+    allocation.Gpu = mGpuAddress + offset;
+    allocation.Offset = offset;
+    return allocation;
+}
+
+BufferHandle LinearUploadBuffer::GetBuffer() const
+{
+    return mBuffer;
+}
+
+std::uint64_t LinearUploadBuffer::GetCapacity() const
+{
+    return mAllocator.GetCapacity();
+}
+
+std::uint64_t LinearUploadBuffer::GetUsed() const
+{
+    return mAllocator.GetUsed();
+}
+
+std::uint64_t LinearUploadBuffer::GetAllocationCount() const
+{
+    return mAllocator.GetAllocationCount();
+}
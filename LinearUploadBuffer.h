@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "lib/LinearAllocator.h"
+#include "lib/RenderDevice.h"
+
+// Piece of a LinearUploadBuffer, written through Cpu and read by the GPU at Gpu
+struct UploadAllocation
+{
+    std::uint8_t* Cpu = nullptr;
+    GpuAddress Gpu = 0;
+    std::uint64_t Offset = 0; // From the start of the buffer
+};
+
+// One persistently mapped upload buffer of the device sub-allocated linearly every frame.
+// Replace the small committed buffers we used for constants: per draw constants are
+// bump allocated at 256 bytes alignment and addressed by GPU virtual address.
+class LinearUploadBuffer
+{
+public:
+    // Constant buffer views must start on a 256 bytes boundary
+    static const std::uint64_t ConstantAlignment = 256;
+
+    LinearUploadBuffer();
+    ~LinearUploadBuffer();
+
+    LinearUploadBuffer(const LinearUploadBuffer& rhs) = delete;
+    LinearUploadBuffer& operator=(const LinearUploadBuffer& rhs) = delete;
+
+    void Initialize(IRenderDevice* device, std::uint64_t capacity);
+
+    // Start a new frame with at least requiredBytes available. The GPU must be done
+    // with the previous allocations, the buffer is recreated when it is too small.
+    void Reset(std::uint64_t requiredBytes);
+
+    // Return an empty allocation when the buffer is full
+    UploadAllocation Allocate(std::uint64_t size, std::uint64_t alignment = ConstantAlignment);
+
+    template<typename T>
+    UploadAllocation AllocateConstants(const T& data)
+    {
+        UploadAllocation allocation = Allocate(sizeof(T), ConstantAlignment);
+        if (allocation.Cpu != nullptr)
+            memcpy(allocation.Cpu, &data, sizeof(T));
+        return allocation;
+    }
+
+    BufferHandle GetBuffer() const;
+    std::uint64_t GetCapacity() const;
+    std::uint64_t GetUsed() const;
+    std::uint64_t GetAllocationCount() const;
+
+private:
+    void CreateBuffer(std::uint64_t capacity);
+    void ReleaseBuffer();
+
+    IRenderDevice* mDevice = nullptr;
+    BufferHandle mBuffer = InvalidBuffer;
+    std::uint8_t* mMappedData = nullptr;
+    GpuAddress mGpuAddress = 0;
+    LinearAllocator mAllocator;
+};
@@ -1,44 +1,70 @@
 ﻿#include "RenderApplication.h"
 
-#include "UploadBuffer.h"
-#include "lib/GeometryFactory.h"
 #include "lib/Maths.h"
 
-RenderApplication::RenderApplication(HINSTANCE instance) : Application(instance), mFactory(nullptr),
+RenderApplication::RenderApplication(HINSTANCE instance) : Application(instance),
+                                                           mBoxMesh(nullptr),
                                                            mRootSignature(nullptr),
-                                                           mCbvHeap(nullptr), mPSO(nullptr),
-                                                           shader(L"shader\\default.hlsl"), mProj(),
-                                                           mPassCB(nullptr),
+                                                           mPSO(nullptr),
+                                                           mInstancedPSO(nullptr),
+                                                           mCommandSignature(nullptr),
+                                                           shader(L"shader\\default.hlsl", "VS", "PS", { "INSTANCED" }),
+                                                           mProj(),
                                                            mLastMousePosition(),
                                                            mTurn(false)
 {
 }
 
+RenderApplication::~RenderApplication()
+{
+	// The transient textures are released with the application, the GPU must be done with them
+	if (mRenderer != nullptr)
+		mRenderer->WaitIdle();
+}
+
+void RenderApplication::CaptureFrames(const std::string& path, UINT frames)
+{
+	mCapturePath = path;
+	mCaptureFrames = frames;
+}
+
 bool RenderApplication::Initialize()
 {
 	
     camera = Camera();
 
-	XMVECTOR finalPosition = XMVectorSet(0.0f, 0.0f, -1.0f, 1.0f);
+	Float3 finalPosition = Float3(0.0f, 0.0f, -1.0f);
 	camera.GetTransform().SetPosition(finalPosition);
 	camera.GetTransform().Rotate(0.0f, 0.0f, 0.0f);
 
 	Application::Initialize();
 
+	// Mesh copies run on the copy queue, the frame lists on the direct queue
+	mRenderDevice.Initialize(mDevice, mCommandQueue, &mGpuQueue, mCopyQueue, mCopyFence, &mCopyGpuQueue);
+	if (mCaptureFrames > 0)
+		mCapture.reset(new CaptureRenderDevice(mRenderDevice));
+	mRenderer.reset(new Renderer(mCapture != nullptr ? static_cast<IRenderDevice&>(*mCapture) : mRenderDevice));
+	mTransientHeap.Initialize(mDevice, &mGpuQueue);
+
 	mCommandList->Reset(mDirectCmdListAlloc, nullptr);
 	
 	// Notre root signature
 	{
 
     	// Root parameter can be a table, root descriptor or root constants.
-    	CD3DX12_ROOT_PARAMETER slotRootParameter[2];
+    	CD3DX12_ROOT_PARAMETER slotRootParameter[5];
     	
     	// Create root CBVs.
     	slotRootParameter[0].InitAsConstantBufferView(0);
     	slotRootParameter[1].InitAsConstantBufferView(1);
 
+    	// Object array, offset of the first instance of the draw and item of every instance, for the instanced shader
+    	slotRootParameter[2].InitAsShaderResourceView(0);
+    	slotRootParameter[3].InitAsConstants(1, 2);
+    	slotRootParameter[4].InitAsShaderResourceView(1);
+
     	// A root signature is an array of root parameters.
-    	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(2, slotRootParameter, 0, nullptr, 
+    	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(5, slotRootParameter, 0, nullptr, 
 			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
     	
@@ -60,13 +86,27 @@ bool RenderApplication::Initialize()
 			serializedRootSig->GetBufferPointer(),
 			serializedRootSig->GetBufferSize(),
 			IID_PPV_ARGS(&mRootSignature));
+
+		// Pipelines compiled by a previous run are loaded back from the library file
+		mPipelineCache.Initialize(mDevice, L"pipelines.bin");
+		mPipelineCache.RegisterRootSignature(mRootSignature, serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize());
 	}
 
 
+
     BuildDescriptorHeaps();
-    BuildConstantBuffer();
 
     BuildPSO();
+    BuildCommandSignature();
+
+	RendererPipeline pipeline;
+	pipeline.RootSignature = mRootSignature;
+	pipeline.PipelineState = mPSO;
+	pipeline.InstancedPipelineState = mInstancedPSO;
+	pipeline.CommandSignature = mCommandSignature;
+	pipeline.DescriptorHeap = mDescriptors.GetShaderVisibleHeap();
+	pipeline.RealizeTransients = [this](RenderGraph& graph) { return mTransientHeap.Realize(graph); };
+	mRenderer->Initialize(pipeline, mFramesInFlight);
 
     BuildRenderableItem();
     // Execute the initialization commands.
@@ -79,83 +119,102 @@ bool RenderApplication::Initialize()
 
 	OnResize();
 
+	// The meshes and buffers created so far are the setup of the capture
+	if (mCapture != nullptr)
+		mCapture->BeginFrames();
+
     return true;
 }
 
 void RenderApplication::BuildRenderableItem()
 {
-	mFactory = new GeometryFactory(mDevice, mCommandList);
+	// Meshes are buffers of the render device, drawn once their upload is done
+	GeometryFactory& factory = mRenderer->GetGeometryFactory();
 	
-	RenderMesh* boxMesh = mFactory->CreateBox(1.0f, 1.0f, 1.0f, 3);
-	RenderMesh* circleMesh = mFactory->CreateGeosphere(2.0f, 5.0f);
-	RenderMesh* customMesh = mFactory->LoadGeometryFromFile("objects/FinalBaseMesh.obj");
+	RenderMesh* boxMesh = factory.CreateBox(1.0f, 1.0f, 1.0f, 3);
+	mBoxMesh = boxMesh;
+	RenderMesh* circleMesh = factory.CreateGeosphere(2.0f, 5.0f);
+	RenderMesh* customMesh = factory.LoadGeometryFromFile("objects/FinalBaseMesh.obj");
 	
 	RenderItem* box = new RenderItem(boxMesh);
-	box->Transform.SetPosition(XMVectorSet(5, 0, 1.0f, 1));
-	XMStoreFloat4(&box->Color, XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f));
+	box->Transform.SetPosition(Float3(5, 0, 1.0f));
+	box->SetColor(Float4(0.0f, 0.0f, 1.0f, 1.0f));
 	box->ObjCBIndex = 0;
-	AddRenderItem(box);
+	mRenderer->AddRenderItem(box);
 
 	RenderItem* box1 = new RenderItem(boxMesh);
-	box1->Transform.SetPosition(XMVectorSet(0, 0, 0, 1));
-	XMStoreFloat4(&box1->Color, XMVectorSet(0.0f, 1.0f, 0.0f, 1.0f));
+	box1->Transform.SetPosition(Float3(0, 0, 0));
+	box1->SetColor(Float4(0.0f, 1.0f, 0.0f, 1.0f));
 	box1->ObjCBIndex = 0;
-	AddRenderItem(box1);
+	mRenderer->AddRenderItem(box1);
 
 	RenderItem* circle = new RenderItem(customMesh);
-	circle->Transform.SetPosition(XMVectorSet(10, 0, 0, 1));
-	XMStoreFloat4(&circle->Color, XMVectorSet(1.0f, 0.0f, 0.0f, 1.0f));
+	circle->Transform.SetPosition(Float3(10, 0, 0));
+	circle->SetColor(Float4(1.0f, 0.0f, 0.0f, 1.0f));
 	circle->ObjCBIndex = 0;
-	AddRenderItem(circle);
+	mRenderer->AddRenderItem(circle);
 }
 
-
 void RenderApplication::BuildDescriptorHeaps()
 {
-	UINT objCount = (UINT)mRendersItems.size();
+	// One heap for every view the renderer will need, it is never recreated
+	mDescriptors.Initialize(mDevice);
+}
 
-	// Need a CBV descriptor for each object
-	UINT numDescriptors = (objCount+1);
+void RenderApplication::BuildPSO()
+{
+	// Both permutations compile side by side
+	ShaderPermutationMask instanced = shader.GetKeyword("INSTANCED");
+	shader.Compile({ 0, instanced }, mRenderer->GetThreadPool());
 
-	// Save an offset to the start of the pass CBVs.
-	mPassCbvOffset = objCount;
+	std::vector<D3D12_GRAPHICS_PIPELINE_STATE_DESC> descs = { MakePSODesc(shader, 0), MakePSODesc(shader, instanced) };
 
-	D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc;
-	cbvHeapDesc.NumDescriptors = 1;
-	cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	cbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	cbvHeapDesc.NodeMask = 0;
-	mDevice->CreateDescriptorHeap(&cbvHeapDesc,
-	                              IID_PPV_ARGS(&mCbvHeap));
-}
+	// Compiled side by side, the next GetGraphics are memory hits
+	mPipelineCache.Prewarm(descs, mRenderer->GetThreadPool());
+	mPSO = mPipelineCache.GetGraphics(descs[0]);
+	mInstancedPSO = mPipelineCache.GetGraphics(descs[1]);
 
-void RenderApplication::AddRenderItem(RenderItem* item)
-{
-	mObjectsCB.push_back(new UploadBuffer<ObjectConstants>(mDevice, 1, true));
-	mRendersItems.push_back(item);
+	mPipelineCache.Save();
 }
 
-void RenderApplication::BuildConstantBuffer()
+void RenderApplication::BuildCommandSignature()
 {
-
-	mPassCB = new UploadBuffer<PassConstants>(mDevice, 1, true);
+	// Must follow the member order of IndirectDrawArguments
+	D3D12_INDIRECT_ARGUMENT_DESC arguments[4] = {};
+	arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+	arguments[0].VertexBuffer.Slot = 0;
+	arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+	arguments[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	arguments[2].Constant.RootParameterIndex = 3;
+	arguments[2].Constant.DestOffsetIn32BitValues = 0;
+	arguments[2].Constant.Num32BitValuesToSet = 1;
+	arguments[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC desc = {};
+	desc.ByteStride = sizeof(IndirectDrawArguments);
+	desc.NumArgumentDescs = _countof(arguments);
+	desc.pArgumentDescs = arguments;
+
+	// The root constant argument needs the root signature
+	HRESULT result = mDevice->CreateCommandSignature(&desc, mRootSignature, IID_PPV_ARGS(&mCommandSignature));
+	if (FAILED(result)) { std::cerr << "Failed to create command signature !\n"; }
 }
 
-void RenderApplication::BuildPSO()
+D3D12_GRAPHICS_PIPELINE_STATE_DESC RenderApplication::MakePSODesc(Shader& pipelineShader, ShaderPermutationMask permutation)
 {
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc;
 	ZeroMemory(&psoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
-	psoDesc.InputLayout = { shader.GetInputLayout().data(), (UINT)shader.GetInputLayout().size() };
+	psoDesc.InputLayout = { pipelineShader.GetInputLayout().data(), (UINT)pipelineShader.GetInputLayout().size() };
 	psoDesc.pRootSignature = mRootSignature;
 	psoDesc.VS = 
 	{ 
-		reinterpret_cast<BYTE*>(shader.GetVertexShader()->GetBufferPointer()), 
-		shader.GetVertexShader()->GetBufferSize() 
+		reinterpret_cast<BYTE*>(pipelineShader.GetVertexShader(permutation)->GetBufferPointer()), 
+		pipelineShader.GetVertexShader(permutation)->GetBufferSize() 
 	};
 	psoDesc.PS = 
 	{ 
-		reinterpret_cast<BYTE*>(shader.GetPixelShader()->GetBufferPointer()), 
-		shader.GetPixelShader()->GetBufferSize() 
+		reinterpret_cast<BYTE*>(pipelineShader.GetPixelShader(permutation)->GetBufferPointer()), 
+		pipelineShader.GetPixelShader(permutation)->GetBufferSize() 
 	};
 	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
@@ -167,93 +226,46 @@ void RenderApplication::BuildPSO()
 	psoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
 	psoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
 	psoDesc.DSVFormat = mDepthStencilFormat;
-	HRESULT result = mDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&mPSO));
 
 	// Le shaders qui a des CONSTANT BUFFER pas pris en compte dans la signature
 	// ou dans le mInputLayout du Shader
-	
-	if (FAILED(result)) { std::cerr << "Failed to create render pipeline !\n"; }
-}
-
-void RenderApplication::DrawRenderItems()
-{
-	
-	// For each render item...
-	for(size_t i = 0; i < mRendersItems.size(); ++i)
-	{
-		auto objectCB = mObjectsCB[i]->Resource();
-		auto ri = mRendersItems[i];
-
-		D3D12_VERTEX_BUFFER_VIEW vertexBuffer = ri->Mesh->VertexBufferView();
-		D3D12_INDEX_BUFFER_VIEW indexBuffer = ri->Mesh->IndexBufferView();
-		
-		mCommandList->IASetVertexBuffers(0, 1, &vertexBuffer);
-		mCommandList->IASetIndexBuffer(&indexBuffer);
-		mCommandList->IASetPrimitiveTopology(ri->PrimitiveType);
-
-		mCommandList->SetGraphicsRootConstantBufferView(0, objectCB->GetGPUVirtualAddress());
 
-		mCommandList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
-	}
-	
+	return psoDesc;
 }
 
 void RenderApplication::Draw()
 {
-
-    // Reuse the memory associated with command recording.
-    // We can only reset when the associated command lists have finished execution on the GPU.
-	mDirectCmdListAlloc->Reset();
-
-	// A command list can be reset after it has been added to the command queue via ExecuteCommandList.
-    // Reusing the command list reuses memory.
-    mCommandList->Reset(mDirectCmdListAlloc, mPSO);
-
-	mCommandList->SetGraphicsRootSignature(mRootSignature);
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
-
-    // Indicate a state transition on the resource usage.
-	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(GetCurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-	mCommandList->ResourceBarrier(1, &barrier);
-
-	CD3DX12_CPU_DESCRIPTOR_HANDLE currentBackBufferView(mRtvHeap->GetCPUDescriptorHandleForHeapStart(), mCurrBackBuffer, mRtvDescriptorSize);
-	D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView = GetDepthStencilView();
-	// Clear the back buffer and depth buffer.
-	mCommandList->ClearRenderTargetView(currentBackBufferView, DirectX::Colors::LightSteelBlue, 0, nullptr);
-	mCommandList->ClearDepthStencilView(depthStencilView, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
-	
-	// Specify the buffers we are going to render to.
-	mCommandList->OMSetRenderTargets(1,
-		&currentBackBufferView, true, &depthStencilView);
-
-	// Bind per-pass constant buffer.  We only need to do this once per-pass.
-	auto passCB = mPassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
-
-	DrawRenderItems();
-
-	barrier = CD3DX12_RESOURCE_BARRIER::Transition(GetCurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &barrier);
-
-    // Done recording commands.
-	mCommandList->Close();
- 
-    // Add the command list to the queue for execution.
-	ID3D12CommandList* cmdsLists[] = { mCommandList };
-	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	FrameTarget target;
+	target.BackBuffer = GetCurrentBackBuffer();
+	target.BackBufferView = GetCurrentBackBufferView().ptr;
+	target.DepthBuffer = mDepthStencilBuffer;
+	target.DepthView = GetDepthStencilView().ptr;
+	target.ScreenViewport = reinterpret_cast<const Viewport&>(mScreenViewport);
+	target.Scissor = reinterpret_cast<const ScissorRect&>(mScissorRect);
+
+	// Recorded and submitted by the renderer, the back buffer ends in PRESENT
+	mRenderer->Draw(target);
 	
 	// swap the back and front buffers
 	mSwapChain->Present(0, 0);
 	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
-	// Wait until frame commands are complete.  This waiting is inefficient and is
-	// done for simplicity.  Later we will show how to organize our rendering code
-	// so we do not have to wait per frame.
-	FlushCommandQueue();
+	mRenderer->EndFrame();
+
+	if (mCapture != nullptr && mCapture->GetFrameCount() < mCaptureFrames)
+	{
+		mCapture->EndFrame();
+		if (mCapture->GetFrameCount() == mCaptureFrames)
+		{
+			// The application goes on without capturing
+			std::string error;
+			if (mCapture->Save(mCapturePath, &error))
+				std::cout << mCaptureFrames << " frames captured in " << mCapturePath << "\n";
+			else
+				std::cerr << "Capture failed, " << error << "\n";
+			mCapture->Stop();
+		}
+	}
 }
 
 void RenderApplication::Update()
@@ -261,124 +273,106 @@ void RenderApplication::Update()
 
 	float speed = 1.0f;
 
-	XMVECTOR cPosition = XMLoadFloat3(&camera.GetTransform().position);
-	XMVECTOR cForward = XMLoadFloat3(&camera.GetTransform().forward);
-	XMVECTOR cUp = XMLoadFloat3(&camera.GetTransform().up);
-	XMVECTOR cRight = XMLoadFloat3(&camera.GetTransform().right);
+	Float3 cPosition = camera.GetTransform().position;
+	Float3 cForward = camera.GetTransform().forward;
+	Float3 cUp = camera.GetTransform().up;
+	Float3 cRight = camera.GetTransform().right;
 
 	if (d3dUtils::IsKeyDown(VK_SPACE))
 	{
-		cPosition = XMVectorAdd(cPosition, cUp * mTimer.DeltaTime() * speed);
+		cPosition = cPosition + cUp * (mTimer.DeltaTime() * speed);
 		camera.GetTransform().SetPosition(cPosition);
 	}
 	
 	if (d3dUtils::IsKeyDown(VK_SHIFT))
 	{
-		cPosition = XMVectorSubtract(cPosition, cUp * mTimer.DeltaTime() * speed);
+		cPosition = cPosition - cUp * (mTimer.DeltaTime() * speed);
 		camera.GetTransform().SetPosition(cPosition);
 	}
 
 	if (d3dUtils::IsKeyDown('M'))
 	{
-		RenderItem* box1 = new RenderItem(mFactory->CreateBox(1.0f, 1.0f, 1.0f, 3));
-		box1->Transform.SetPosition(XMVectorSet(0, 2, 0, 1));
-		XMStoreFloat4(&box1->Color, XMVectorSet(0.0f, 1.0f, 0.0f, 1.0f));
+		RenderItem* box1 = new RenderItem(mBoxMesh);
+		box1->Transform.SetPosition(Float3(0, 2, 0));
+		box1->SetColor(Float4(0.0f, 1.0f, 0.0f, 1.0f));
 		box1->ObjCBIndex = 0;
-		AddRenderItem(box1);
+		mRenderer->AddRenderItem(box1);
 	}
 	
 	if (d3dUtils::IsKeyDown('Z'))
 	{
-		cPosition = XMVectorAdd(cPosition, cForward * mTimer.DeltaTime() * speed);
+		cPosition = cPosition + cForward * (mTimer.DeltaTime() * speed);
 		camera.GetTransform().SetPosition(cPosition);
 	}
 
 	if (d3dUtils::IsKeyDown('S'))
 	{
-		cPosition = XMVectorSubtract(cPosition, cForward * mTimer.DeltaTime() * speed);
+		cPosition = cPosition - cForward * (mTimer.DeltaTime() * speed);
 		camera.GetTransform().SetPosition(cPosition);
 	}
 	
 	if (d3dUtils::IsKeyDown('Q'))
 	{
-		cPosition= XMVectorSubtract(cPosition, cRight * mTimer.DeltaTime() * speed);
+		cPosition= cPosition - cRight * (mTimer.DeltaTime() * speed);
 		camera.GetTransform().SetPosition(cPosition);
 	}
 	
 	if (d3dUtils::IsKeyDown('D'))
 	{
-		cPosition = XMVectorAdd(cPosition, cRight * mTimer.DeltaTime() * speed);
+		cPosition = cPosition + cRight * (mTimer.DeltaTime() * speed);
 		camera.GetTransform().SetPosition(cPosition);
 	}
 	
 	camera.UpdateMatrix();
 	
-	UpdatePassBC();
-	UpdatePerObjectBC();
-    
-}
+	// Blocks only when the GPU still renders the frame that used this slot
+	UINT slot = mRenderer->BeginFrame();
+	mDescriptors.BeginFrame(slot);
 
-void RenderApplication::UpdatePassBC()
-{
-
-	PassConstants mMainPassCB;
-	
-	XMMATRIX view = camera.GetTransform().GetMatrix();
-	view = XMMatrixInverse(nullptr, view);
-	XMMATRIX proj = XMLoadFloat4x4(&mProj);
-
-	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-	XMVECTOR viewDet = XMMatrixDeterminant(view);
-	XMVECTOR projDet = XMMatrixDeterminant(viewProj);
-	XMVECTOR viewProjDet = XMMatrixDeterminant(proj);
-	XMMATRIX invView = XMMatrixInverse(&viewDet, view);
-	XMMATRIX invProj = XMMatrixInverse(&projDet, proj);
-	XMMATRIX invViewProj = XMMatrixInverse(&viewProjDet, viewProj);
-
-	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
-	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
-	XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(proj));
-	XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(invProj));
-	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(viewProj));
-	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-	mMainPassCB.EyePosW = camera.mView.position;
-	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
-	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
-	mMainPassCB.NearZ = 1.0f;
-	mMainPassCB.FarZ = 1000.0f;
-	mMainPassCB.TotalTime = mTimer.TotalTime();
-	mMainPassCB.DeltaTime = mTimer.DeltaTime();
-	
-	mPassCB->CopyData(0, mMainPassCB);
+	mRenderer->Update(camera, mProj, (float)mClientWidth, (float)mClientHeight, mTimer.TotalTime(), mTimer.DeltaTime());
+    
 }
 
-void RenderApplication::UpdatePerObjectBC()
+std::wstring RenderApplication::GetFrameStats()
 {
-	for(int i = 0; i < mRendersItems.size(); i++)
-	{
-		auto& e = mRendersItems[i];
-
-		e->Transform.UpdateMatrix();
-		
-		XMMATRIX world = e->Transform.GetMatrix();
-
-		ObjectConstants objConstants;
-		
-		XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-		objConstants.Color = e->Color;
-		
-		mObjectsCB[i]->CopyData(e->ObjCBIndex, objConstants);
-		
-	}
+	GpuMemoryStats meshMemory = mRenderDevice.GetMemoryStats(GpuMemoryType::Default);
+	StagingStats staging = mRenderDevice.GetStagingStats();
+	DescriptorStats descriptors = mDescriptors.GetStats();
+	PipelineCacheStats pipelines = mPipelineCache.GetStats();
+	ShaderCacheStats shaders = Shader::GetCache().GetStats();
+	return mRenderer->GetFrameStats() +
+		L"   transient: " + std::to_wstring(mTransientHeap.GetStats().HeapBytes / 1024) + L" KB" +
+		L"   mesh memory: " + std::to_wstring(meshMemory.UsedBytes / 1024) +
+		L"/" + std::to_wstring(meshMemory.HeapBytes / 1024) + L" KB in " + std::to_wstring(meshMemory.Pages) +
+		L" heaps (" + std::to_wstring(meshMemory.FreeBlocks) + L" free blocks, fragmentation " +
+		std::to_wstring(meshMemory.Fragmentation) + L")" +
+		L"   staging: " + std::to_wstring(staging.BytesUploaded / 1024) + L" KB at " +
+		std::to_wstring((UINT64)(staging.BytesPerSecond / (1024 * 1024))) + L" MB/s, peak " +
+		std::to_wstring(staging.PeakUsed / 1024) + L"/" + std::to_wstring(staging.Capacity / 1024) + L" KB" +
+		L"   descriptors: " + std::to_wstring(descriptors.PersistentUsed) + L"/" + std::to_wstring(descriptors.PersistentCapacity) +
+		L" persistent, " + std::to_wstring(descriptors.TransientUsed) + L"/" + std::to_wstring(descriptors.TransientCapacity) +
+		L" this frame" +
+		L"   shaders: " + std::to_wstring(shaders.Hits) + L" cached, " + std::to_wstring(shaders.Misses) +
+		L" compiled (" + std::to_wstring(shader.GetPermutationStats().Variants) + L" variants) in " +
+		std::to_wstring((float)(shaders.KeyTimeMs + shaders.LoadTimeMs + shaders.CompileTimeMs)) + L" ms" +
+		L"   pipelines: " + std::to_wstring(pipelines.Pipelines) + L" (" + std::to_wstring(pipelines.LibraryHits) +
+		L" from disk, " + std::to_wstring(pipelines.Created) + L" compiled in " + std::to_wstring(pipelines.CreateTimeMs) + L" ms)";
 }
 
 void RenderApplication::OnResize()
 {
+	// The swap chain buffers are created again
+	ResourceStateRegistry& states = mRenderer->GetResourceStates();
+	for (int i = 0; i < SwapChainBufferCount; i++)
+		states.Unregister(mSwapChainBuffer[i]);
+
     Application::OnResize();
 
+	for (int i = 0; i < SwapChainBufferCount; i++)
+		states.Register(mSwapChainBuffer[i], D3D12_RESOURCE_STATE_PRESENT);
+
 	// The window resized, so update the aspect ratio and recompute the projection matrix.
-	XMMATRIX ProjMatrix = XMMatrixPerspectiveFovLH(0.25f*Maths::PI, AspectRatio(), 0.1f, 1000);
-	XMStoreFloat4x4(&mProj, ProjMatrix);
+	mProj = Maths::PerspectiveFovLH(0.25f*Maths::PI, AspectRatio(), 0.1f, 1000);
 }
 
 void RenderApplication::OnMouseDown(WPARAM btnState, int x, int y)
@@ -421,4 +415,42 @@ void RenderApplication::OnMouseMove(WPARAM btnState, int x, int y)
 	camera.GetTransform().Rotate(dy,  dx, 0.0f);
 	
 }
-void RenderApplication::OnKeyPressed(WPARAM btnState, int x, int y){}
\ No newline at end of file
+void RenderApplication::OnKeyPressed(WPARAM btnState, int x, int y)
+{
+	RendererOptions options = mRenderer->GetOptions();
+	if ((int)btnState == VK_F1)
+		options.UseBundles = !options.UseBundles;
+	else if ((int)btnState == VK_F3)
+		options.CullViewsSeparately = !options.CullViewsSeparately;
+	else if ((int)btnState == VK_F4)
+	{
+		// Static items are merged in chunks, with shift they stay draw items for the instancing and indirect paths
+		mRenderer->SpawnStressGrid(mBoxMesh, 10000, !d3dUtils::IsKeyDown(VK_SHIFT));
+	}
+	else if ((int)btnState == VK_F5)
+		options.RecordWorkers = options.RecordWorkers >= Renderer::MaxRecordWorkers ? 1 : options.RecordWorkers * 2;
+	else if ((int)btnState == VK_F6)
+		options.UseInstancing = !options.UseInstancing;
+	else if ((int)btnState == VK_F7)
+		options.UseIndirect = !options.UseIndirect;
+	else if ((int)btnState == VK_F8)
+		mRenderer->ClearStressGrid();
+	else if ((int)btnState == VK_F9)
+		mRenderer->SpawnStressGrid(mBoxMesh, 100000, false); // Dynamic items, measures the per object constant updates
+	else if ((int)btnState == VK_F11)
+	{
+		mFramesInFlight = mFramesInFlight % FrameRing::MaxFrames + 1;
+		if (mFramesInFlight < FrameRing::MinFrames) mFramesInFlight = FrameRing::MinFrames;
+		mRenderer->SetFramesInFlight(mFramesInFlight);
+	}
+	else if (btnState == 'R')
+		options.RetainedQueue = !options.RetainedQueue;
+	else if (btnState == 'P')
+	{
+		// 0, 1, 10 or 100 percent of the items move every frame
+		const UINT fractions[] = { 0, 100, 10, 1 };
+		mMovingIndex = (mMovingIndex + 1) % 4;
+		options.MovingEvery = fractions[mMovingIndex];
+	}
+	mRenderer->SetOptions(options);
+}
\ No newline at end of file
@@ -1,17 +1,22 @@
 ﻿#pragma once
-#include <map>
+#include <memory>
+#include <string>
 
 #include "Application.h"
 #include "lib/d3dUtils.h"
 #include "Camera.h"
-#include "RenderObject.h"
+#include "D3D12RenderDevice.h"
+#include "Renderer.h"
 #include "Shader.h"
 #include "Transform.h"
-#include "UploadBuffer.h"
-#include "lib/GeometryFactory.h"
+#include "lib/CaptureRenderDevice.h"
+#include "lib/DescriptorHeapManager.h"
+#include "lib/PipelineStateCache.h"
+#include "lib/RenderGraphHeap.h"
 
 using namespace DirectX;
 
+// Window, input and D3D12 pipeline objects around the Renderer, which draws the frame on mRenderDevice
 class RenderApplication : public Application
 {
 
@@ -20,7 +25,11 @@ class RenderApplication : public Application
     
 public:
     RenderApplication(HINSTANCE instance);
+    ~RenderApplication();
     
+    // Call before Initialize: the renderer draws through a capture and the setup with the first frames frames are saved in path
+    void CaptureFrames(const std::string& path, UINT frames);
+
     bool Initialize() override;
     
     virtual void Update() override;
@@ -32,39 +41,42 @@ private:
     void OnMouseMove(WPARAM btnState, int x, int y) override;
     void OnKeyPressed(WPARAM btnState, int x, int y) override;
 
-    void UpdatePassBC(); // Used as global update for global world data
-    void UpdatePerObjectBC(); // Used as update for each object
-    
     void OnResize() override;
 
-    void AddRenderItem(RenderItem* item);
     void BuildRenderableItem(); // Add RenderItem who will be used
-    void BuildDescriptorHeaps(); // Build RenderItem & Pass descriptor
-    void BuildConstantBuffer(); // Build Constant Buffer for Pass & perObject
+    void BuildDescriptorHeaps(); // Shader visible heap of every view
     void BuildPSO();
+    void BuildCommandSignature();
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC MakePSODesc(Shader& pipelineShader, ShaderPermutationMask permutation); // The shader must outlive the description
 
-    void DrawRenderItems();
+    std::wstring GetFrameStats() override;
 
-    GeometryFactory* mFactory;
+    // Buffers, lists and uploads of the frame, declared before the renderer drawing on it
+    D3D12RenderDevice mRenderDevice;
+    std::unique_ptr<CaptureRenderDevice> mCapture; // In front of mRenderDevice when capturing
+    std::string mCapturePath;
+    UINT mCaptureFrames = 0;
+    std::unique_ptr<Renderer> mRenderer;
+    DescriptorHeapManager mDescriptors; // Bound on every command list
+    RenderMesh* mBoxMesh;
     
     ID3D12RootSignature* mRootSignature;
-    ID3D12DescriptorHeap* mCbvHeap;
+    PipelineStateCache mPipelineCache; // Owns the pipelines
     ID3D12PipelineState* mPSO;
+    ID3D12PipelineState* mInstancedPSO;
+    ID3D12CommandSignature* mCommandSignature; // Batches drawn with ExecuteIndirect
+    RenderGraphHeap mTransientHeap; // Transient textures of the render graph
     
-    Shader shader;
+    Shader shader; // INSTANCED keyword for the instanced and indirect draws
     Camera camera;
-    XMFLOAT4X4 mProj;
+    Float4x4 mProj;
 
-    std::vector<RenderItem*> mRendersItems;
-    
-    std::vector<UploadBuffer<ObjectConstants>*> mObjectsCB;
-    UploadBuffer<PassConstants>* mPassCB;
-    
-    UINT mPassCbvOffset = 0;
+    UINT mFramesInFlight = 3; // F11 to cycle 2, 3, 4
+    UINT mMovingIndex = 0; // P to cycle 0, 1, 10 and 100 percent of the draw items moving every frame
     
     POINT mLastMousePosition;
     float mYaw = 0.0f;
     float mPitch = 0.0f;
 
     bool mTurn;
-};
+};
\ No newline at end of file
@@ -7,5 +7,22 @@ RenderItem::RenderItem(RenderMesh* geoMesh) : Mesh(geoMesh)
     Color.y = 0.0f;
     Color.z = 0.0f;
     Color.w = 0.0f;
-    IndexCount = (UINT)Mesh->MeshData.Indices32.size();
-}
\ No newline at end of file
+    IndexCount = (std::uint32_t)Mesh->MeshData.Indices32.size();
+}
+
+void RenderItem::SetColor(const Float4& color)
+{
+    Color = color;
+    mColorChanged = true;
+}
+
+bool RenderItem::HasChanged() const
+{
+    return mColorChanged || Transform.HasChanged();
+}
+
+void RenderItem::ClearChanged()
+{
+    mColorChanged = false;
+    Transform.ClearChanged();
+}
@@ -1,26 +1,46 @@
 ﻿#pragma once
 
+#include <cstdint>
+
 #include "Transform.h"
-#include "lib/d3dUtils.h"
+#include "lib/Mesh.h"
 
 struct RenderItem
 {
     RenderItem(RenderMesh* geometry);
 
     TRANSFORM Transform;
-    DirectX::XMFLOAT4 Color;
+    Float4 Color; // Use SetColor once the item is added so the change is seen
+
+    void SetColor(const Float4& color);
+
+    // Transform or color changed since the constants were last written
+    bool HasChanged() const;
+    void ClearChanged();
     
     RenderMesh* Mesh;
 
     // Index into GPU constant buffer corresponding to the ObjectCB for this render item.
-    UINT ObjCBIndex = -1;
+    std::uint32_t ObjCBIndex = -1;
+
+    // Index of the pipeline state used to draw this item.
+    std::uint32_t PsoIndex = 0;
 
     // Primitive topology.
-    D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    std::uint32_t PrimitiveType = PrimitiveTopologyTriangleList; // D3D_PRIMITIVE_TOPOLOGY
 
     // cmdList->DrawIndexedInstanced parameters.
-    UINT IndexCount = 0;
-    UINT StartIndexLocation = 0;
+    std::uint32_t IndexCount = 0;
+    std::uint32_t StartIndexLocation = 0;
     int BaseVertexLocation = 0;
-    
+
+    // Item is not drawn past this distance from the camera, 0 means no limit.
+    float MaxDrawDistance = 0.0f;
+
+    // Never moves after spawn. Static items are merged in the static world chunks,
+    // which are static too so their constants are only written when they are added.
+    bool Static = false;
+
+private:
+    bool mColorChanged = true;
 };
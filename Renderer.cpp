@@ -0,0 +1,1005 @@
+﻿#include "Renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <unordered_set>
+
+const std::uint32_t Renderer::MaxRecordWorkers;
+const std::uint64_t Renderer::ObjectConstantsStride;
+
+namespace
+{
+	// LightSteelBlue
+	const float ClearColor[4] = { 0.690196097f, 0.768627524f, 0.870588303f, 1.0f };
+}
+
+Renderer::Renderer(IRenderDevice& device) : mDevice(device), mFactory(&device)
+{
+}
+
+Renderer::~Renderer()
+{
+	// Frame resources are released with the renderer, the queue must be done with them
+	mFrameRing.WaitIdle();
+	mStaticBundles.Clear(mDevice.GetBundleAllocator());
+
+	for (std::uint32_t i = 0; i < FrameRing::MaxFrames; i++)
+		delete mFrameResources[i].Objects;
+	delete mStaticConstants;
+
+	for (RenderItem* item : mStressItems)
+		delete item;
+}
+
+Renderer::FrameResource& Renderer::CurrentFrame()
+{
+	return mFrameResources[mCurrFrameResource];
+}
+
+void Renderer::Initialize(const RendererPipeline& pipeline, std::uint32_t framesInFlight)
+{
+	mPipeline = pipeline;
+
+	// Frame constants are grown by Reset when a frame needs more
+	for (std::uint32_t i = 0; i < FrameRing::MaxFrames; i++)
+	{
+		mFrameResources[i].CommandLists.Initialize(&mDevice);
+		mFrameResources[i].Constants.Initialize(&mDevice, 4 * 1024 * 1024);
+	}
+	mFrameRing.Initialize(&mDevice.GetQueue(), framesInFlight);
+	mDirtyTracker.Initialize(framesInFlight);
+	mDrawQueue.SetRetained(mOptions.RetainedQueue);
+
+	// The static bundles bind the object constants of their draws
+	mStaticBundles.Initialize(mPipeline.RootSignature, 0);
+}
+
+const RendererOptions& Renderer::GetOptions() const
+{
+	return mOptions;
+}
+
+void Renderer::SetOptions(const RendererOptions& options)
+{
+	// The chunks go in or out of the draw queue, or the kept keys stop being valid
+	if (options.UseBundles != mOptions.UseBundles || options.RetainedQueue != mOptions.RetainedQueue)
+		mDrawQueueRebuild = true;
+
+	mOptions = options;
+	mOptions.RecordWorkers = std::max(1u, std::min(options.RecordWorkers, MaxRecordWorkers));
+	mDrawQueue.SetRetained(mOptions.RetainedQueue);
+}
+
+void Renderer::SetFramesInFlight(std::uint32_t framesInFlight)
+{
+	// The slots are reassigned, nothing may be in flight
+	mFrameRing.WaitIdle();
+	mFrameRing.Initialize(&mDevice.GetQueue(), framesInFlight);
+	mDirtyTracker.Initialize(framesInFlight);
+}
+
+IRenderDevice& Renderer::GetDevice()
+{
+	return mDevice;
+}
+
+GeometryFactory& Renderer::GetGeometryFactory()
+{
+	return mFactory;
+}
+
+ThreadPool& Renderer::GetThreadPool()
+{
+	return mThreadPool;
+}
+
+ResourceStateRegistry& Renderer::GetResourceStates()
+{
+	return mResourceStates;
+}
+
+const CullingStats& Renderer::GetCullingStats(std::uint32_t view) const
+{
+	return mCullingStats[view];
+}
+
+const CommandRecorderStats& Renderer::GetRecorderStats() const
+{
+	return mRecorderStats;
+}
+
+const ResourceStateStats& Renderer::GetBarrierStats() const
+{
+	return mBarrierStats;
+}
+
+float Renderer::GetRecordTimeMs() const
+{
+	return mRecordTimeMs;
+}
+
+std::uint64_t Renderer::GetBytesWritten() const
+{
+	return mDirtyStats.BytesWritten;
+}
+
+std::uint32_t Renderer::GetObjectsWritten() const
+{
+	return mDirtyStats.ItemsWritten;
+}
+
+void Renderer::SpawnStressGrid(RenderMesh* mesh, std::uint32_t count, bool isStatic)
+{
+	std::uint32_t side = (std::uint32_t)ceilf(sqrtf((float)count));
+	std::uint32_t first = (std::uint32_t)mStressItems.size();
+
+	for (std::uint32_t i = 0; i < count; i++)
+	{
+		float x = (float)(i % side) * 2.0f - (float)side;
+		float z = (float)(i / side) * 2.0f;
+
+		RenderItem* box = new RenderItem(mesh);
+		box->Transform.SetPosition(Float3(x, -2.0f, z));
+		box->SetColor(Float4((float)((first + i) % 7) / 7.0f, 0.5f, 1.0f, 1.0f));
+		box->ObjCBIndex = 0;
+		box->Static = isStatic;
+		AddRenderItem(box);
+		mStressItems.push_back(box);
+	}
+}
+
+void Renderer::ClearStressGrid()
+{
+	if (mStressItems.empty()) return;
+
+	// One compaction pass instead of a search per removed item
+	std::unordered_set<RenderItem*> removed(mStressItems.begin(), mStressItems.end());
+
+	std::uint32_t kept = 0;
+	for (std::uint32_t i = 0; i < (std::uint32_t)mRendersItems.size(); i++)
+	{
+		if (removed.count(mRendersItems[i]) != 0) continue;
+		mRendersItems[kept] = mRendersItems[i];
+		mObjectConstants[kept] = mObjectConstants[i];
+		kept++;
+	}
+	mRendersItems.resize(kept);
+	mObjectConstants.resize(kept);
+	mDrawKeyDirty.resize(kept);
+	mCulling.Resize(kept);
+	mDrawQueue.Resize(kept);
+
+	// Items moved, their constants and bounds are written again at their new index
+	mDirtyTracker.Resize(kept);
+	for (std::uint32_t i = 0; i < kept; i++)
+		UpdateItemConstants(i);
+
+	// Every kept item has a new key, sorting them again is cheaper than merging
+	mDrawQueueRebuild = true;
+
+	size_t staticCount = mStaticItems.size();
+	mStaticItems.erase(std::remove_if(mStaticItems.begin(), mStaticItems.end(),
+		[&](RenderItem* item) { return removed.count(item) != 0; }), mStaticItems.end());
+	if (mStaticItems.size() != staticCount)
+		mStaticWorldDirty = true;
+
+	for (RenderItem* item : mStressItems)
+		delete item;
+	mStressItems.clear();
+}
+
+void Renderer::AddRenderItem(RenderItem* item)
+{
+	if (item->Static)
+	{
+		// Merged with the other static items on the next update
+		mStaticItems.push_back(item);
+		mStaticWorldDirty = true;
+		return;
+	}
+
+	AddDrawItem(item);
+}
+
+void Renderer::RemoveRenderItem(RenderItem* item)
+{
+	if (item->Static)
+	{
+		auto it = std::find(mStaticItems.begin(), mStaticItems.end(), item);
+		if (it == mStaticItems.end()) return;
+
+		*it = mStaticItems.back();
+		mStaticItems.pop_back();
+		mStaticWorldDirty = true;
+		return;
+	}
+
+	auto it = std::find(mRendersItems.begin(), mRendersItems.end(), item);
+	if (it != mRendersItems.end())
+		RemoveDrawItem((std::uint32_t)(it - mRendersItems.begin()));
+}
+
+void Renderer::AddDrawItem(RenderItem* item)
+{
+	mObjectConstants.push_back(ObjectConstants());
+	mRendersItems.push_back(item);
+	mDrawKeyDirty.push_back(1);
+	mCulling.Resize((std::uint32_t)mRendersItems.size());
+	mDirtyTracker.Resize((std::uint32_t)mRendersItems.size());
+
+	UpdateItemConstants((std::uint32_t)mRendersItems.size() - 1);
+}
+
+void Renderer::RemoveDrawItem(std::uint32_t index)
+{
+	// Draw items are addressed by index every frame, the last one takes the free slot
+	std::uint32_t last = (std::uint32_t)mRendersItems.size() - 1;
+	mObjectConstants[index] = mObjectConstants[last];
+	mRendersItems[index] = mRendersItems[last];
+
+	mObjectConstants.pop_back();
+	mRendersItems.pop_back();
+	mDrawKeyDirty.pop_back();
+	mCulling.Resize(last);
+	mDirtyTracker.Resize(last);
+	mDrawQueue.Resize(last);
+
+	// Only changed items are written, the moved one must be written at its new index
+	if (index < last)
+		UpdateItemConstants(index);
+}
+
+void Renderer::RebuildStaticWorld()
+{
+	// The previous chunks can still be drawn by the frames in flight
+	mFrameRing.WaitIdle();
+
+	for (RenderItem* chunk : mStaticBatcher.GetChunks())
+	{
+		auto it = std::find(mRendersItems.begin(), mRendersItems.end(), chunk);
+		if (it != mRendersItems.end())
+			RemoveDrawItem((std::uint32_t)(it - mRendersItems.begin()));
+	}
+
+	// The whole static world is replaced, wait for the chunks rather than dropping it for a few frames
+	mStaticBatcher.Build(mStaticItems, mFactory);
+	mDevice.WaitForUploads();
+
+	for (RenderItem* chunk : mStaticBatcher.GetChunks())
+		AddDrawItem(chunk);
+
+	RebuildStaticBundles();
+	mStaticWorldDirty = false;
+}
+
+void Renderer::RebuildStaticBundles()
+{
+	const std::vector<RenderItem*>& chunks = mStaticBatcher.GetChunks();
+	std::uint32_t count = (std::uint32_t)chunks.size();
+
+	if (mStaticConstants == nullptr || count > mStaticConstantsCapacity)
+	{
+		delete mStaticConstants;
+		mStaticConstantsCapacity = std::max(count, 64u);
+		mStaticConstants = new UploadBuffer<ObjectConstants>(mDevice, mStaticConstantsCapacity, true);
+	}
+	GpuAddress constantsAddress = mStaticConstants->GetGpuAddress();
+
+	// One draw per chunk, the bundle of a chunk whose mesh, pipeline and constants slot are the same is kept
+	mStaticBundleDraws.resize(count);
+	std::vector<BundleBatch> batches(count);
+	mChunkBundles.clear();
+	for (std::uint32_t c = 0; c < count; c++)
+	{
+		RenderItem* chunk = chunks[c];
+
+		ObjectConstants constants;
+		chunk->Transform.UpdateMatrix();
+		constants.World = Maths::Transpose(chunk->Transform.GetMatrix());
+		constants.Color = chunk->Color;
+		mStaticConstants->CopyData(c, constants);
+
+		BundleDraw& draw = mStaticBundleDraws[c];
+		draw = BundleDraw();
+		draw.PipelineState = mPipeline.PipelineState;
+		draw.VertexBuffer = chunk->Mesh->VertexBuffer;
+		draw.IndexBuffer = chunk->Mesh->IndexBuffer;
+		draw.Constants = constantsAddress + (std::uint64_t)c * ObjectConstantsStride;
+		draw.Topology = chunk->PrimitiveType;
+		draw.IndexCount = chunk->IndexCount;
+		draw.StartIndexLocation = chunk->StartIndexLocation;
+		draw.BaseVertexLocation = chunk->BaseVertexLocation;
+
+		batches[c].Draws = &draw;
+		batches[c].DrawCount = 1;
+		mChunkBundles[chunk] = c;
+	}
+
+	mStaticBundles.Update(batches.data(), count, mDevice.GetBundleAllocator());
+}
+
+void Renderer::DrawRenderItems(ICommandList& commandList, std::uint32_t begin, std::uint32_t end)
+{
+
+	if (mOptions.UseIndirect)
+	{
+		if (begin == end) return;
+
+		// The vertex/index buffers, first instance and draw of every batch come from the argument buffer
+		commandList.IASetPrimitiveTopology(PrimitiveTopologyTriangleList);
+		commandList.SetPipelineState(mPipeline.InstancedPipelineState);
+		commandList.ExecuteIndirect(mPipeline.CommandSignature, end - begin, mIndirectArgumentBuffer,
+			mIndirectArgumentsOffset + (std::uint64_t)begin * sizeof(IndirectDrawArguments));
+		return;
+	}
+
+	// For each batch of visible render items in key order...
+	const std::vector<std::uint64_t>& keys = mDrawQueue.Keys();
+	for(std::uint32_t b = begin; b < end; ++b)
+	{
+		const DrawBatch& batch = mDrawBatches[b];
+		auto ri = mRendersItems[DrawQueue::GetItem(keys[batch.FirstPacket])];
+
+		commandList.IASetVertexBuffers(0, 1, &ri->Mesh->VertexBuffer);
+		commandList.IASetIndexBuffer(&ri->Mesh->IndexBuffer);
+		commandList.IASetPrimitiveTopology(ri->PrimitiveType);
+
+		if (mOptions.UseInstancing)
+		{
+			// Every item of the batch share the mesh, their constants are read from the instance buffer
+			commandList.SetPipelineState(mPipeline.InstancedPipelineState);
+			commandList.SetGraphicsRoot32BitConstant(3, batch.FirstPacket, 0);
+			commandList.DrawIndexedInstanced(ri->IndexCount, batch.PacketCount, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+			continue;
+		}
+
+		commandList.SetPipelineState(mPipeline.PipelineState);
+		for (std::uint32_t k = batch.FirstPacket; k < batch.FirstPacket + batch.PacketCount; ++k)
+		{
+			std::uint32_t item = DrawQueue::GetItem(keys[k]);
+			ri = mRendersItems[item];
+
+			commandList.SetGraphicsRootConstantBufferView(0, mObjectDataAddress + (std::uint64_t)item * ObjectConstantsStride);
+
+			commandList.DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+		}
+	}
+
+}
+
+void Renderer::RecordPassSetup(ICommandList& commandList, const FrameTarget& target)
+{
+	commandList.RSSetViewports(1, &target.ScreenViewport);
+	commandList.RSSetScissorRects(1, &target.Scissor);
+	commandList.OMSetRenderTargets(1, &target.BackBufferView, target.DepthView);
+
+	if (mPipeline.DescriptorHeap != nullptr)
+		commandList.SetDescriptorHeaps(1, &mPipeline.DescriptorHeap);
+}
+
+void Renderer::RecordDrawRange(std::uint32_t worker, const FrameTarget& target, ICommandList* commandList, std::uint32_t begin, std::uint32_t end)
+{
+	CommandRecorder& recorder = mWorkerRecorders[worker];
+	recorder.SetTarget(commandList);
+	recorder.Reset(mPipeline.PipelineState);
+	recorder.ResetStats();
+
+	// The state of the back buffer before the list is only known at submit time
+	ResourceStateTracker& states = mWorkerStates[worker];
+	states.Reset();
+	states.Transition(target.BackBuffer, ResourceStateRenderTarget);
+	states.FlushBarriers(*commandList);
+
+	// Every list start with a blank state, the pass setup is recorded again
+	RecordPassSetup(*commandList, target);
+
+	recorder.SetGraphicsRootSignature(mPipeline.RootSignature);
+	recorder.SetGraphicsRootConstantBufferView(1, mPassCBAddress);
+	if (mOptions.UseInstancing || mOptions.UseIndirect)
+	{
+		recorder.SetGraphicsRootShaderResourceView(2, mObjectDataAddress);
+		recorder.SetGraphicsRootShaderResourceView(4, mInstanceItemsAddress);
+	}
+
+	DrawRenderItems(recorder, begin, end);
+
+	// Last in the list, nothing recorded after depends on the bindings the bundles leave
+	if (worker == 0)
+	{
+		for (std::uint32_t bundle : mVisibleBundles)
+			recorder.ExecuteBundle(mStaticBundles.GetBundle(bundle));
+	}
+}
+
+void Renderer::Draw(const FrameTarget& target)
+{
+
+	// Reuse the memory associated with command recording.
+	// We can only reset when the associated command lists have finished execution on the GPU,
+	// the frame ring waited for it in BeginFrame.
+	CommandListPool& commandLists = CurrentFrame().CommandLists;
+	commandLists.Reset();
+
+	// Split the sorted batches in contiguous ranges, one command list per worker
+	std::uint32_t drawCount = (std::uint32_t)mDrawBatches.size();
+	std::uint32_t workerCount = std::max(1u, std::min(mOptions.RecordWorkers, (drawCount + MinDrawsPerWorker - 1) / MinDrawsPerWorker));
+	if (mOptions.UseIndirect) workerCount = 1; // A single ExecuteIndirect for the pass
+
+	ICommandList* beginList = commandLists.Acquire(nullptr);
+	ICommandList* workerLists[MaxRecordWorkers];
+	for (std::uint32_t w = 0; w < workerCount; w++)
+		workerLists[w] = commandLists.Acquire(mPipeline.PipelineState);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	mThreadPool.ParallelFor(drawCount, workerCount, [&](std::uint32_t worker, std::uint32_t begin, std::uint32_t end)
+	{
+		RecordDrawRange(worker, target, workerLists[worker], begin, end);
+	});
+	auto end = std::chrono::high_resolution_clock::now();
+
+	mRecordWorkersUsed = workerCount;
+	mRecordTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+	mRecorderStats = CommandRecorderStats();
+	for (std::uint32_t w = 0; w < workerCount; w++)
+	{
+		const CommandRecorderStats& stats = mWorkerRecorders[w].GetStats();
+		for (size_t c = 0; c < (size_t)CommandType::Count; c++)
+		{
+			mRecorderStats.Requested[c] += stats.Requested[c];
+			mRecorderStats.Issued[c] += stats.Issued[c];
+		}
+	}
+
+	// From here the lists are recorded and resolved in submission order: the clear and scene
+	// passes of the graph go in the begin list, the worker lists follow, then the present pass.
+	ICommandList* endList = commandLists.Acquire(nullptr);
+
+	std::vector<ICommandList*> cmdsLists;
+	cmdsLists.push_back(beginList);
+
+	mBarrierStats = ResourceStateStats();
+	std::vector<ResourceBarrierDesc> resolved;
+
+	ResourceState backBufferState = ResourceStatePresent;
+	mResourceStates.Get(target.BackBuffer, backBufferState);
+
+	mRenderGraph.Reset();
+	RenderGraphResource backBuffer = mRenderGraph.Import("BackBuffer", target.BackBuffer, backBufferState, ResourceStatePresent);
+	RenderGraphResource depth = mRenderGraph.Import("Depth", target.DepthBuffer, ResourceStateDepthWrite, ResourceStateDepthWrite);
+
+	RenderGraphPass clearPass = mRenderGraph.AddPass("Clear", [&](ICommandList& commandList)
+	{
+		// Clear the back buffer and depth buffer.
+		commandList.ClearRenderTargetView(target.BackBufferView, ClearColor);
+		commandList.ClearDepthStencilView(target.DepthView, ClearFlags::DepthStencil, 1.0f, 0);
+	});
+	mRenderGraph.Write(clearPass, backBuffer, ResourceStateRenderTarget);
+	mRenderGraph.Write(clearPass, depth, ResourceStateDepthWrite);
+
+	// The draws are already recorded by the workers, their lists only need the barriers from the
+	// states the graph left the resources in
+	RenderGraphPass scenePass = mRenderGraph.AddPass("Scene", [&](ICommandList&)
+	{
+		for (std::uint32_t w = 0; w < workerCount; w++)
+		{
+			resolved.clear();
+			mWorkerStates[w].Resolve(mResourceStates, resolved);
+			mBarrierStats.Add(mWorkerStates[w].GetStats());
+
+			// The first worker barriers go at the end of the begin list, the others need a list of their own
+			if (!resolved.empty())
+			{
+				if (w > 0)
+				{
+					ICommandList* barrierList = commandLists.Acquire(nullptr);
+					barrierList->ResourceBarrier((std::uint32_t)resolved.size(), resolved.data());
+					cmdsLists.push_back(barrierList);
+				}
+				else
+				{
+					beginList->ResourceBarrier((std::uint32_t)resolved.size(), resolved.data());
+				}
+				mBarrierStats.BarrierCalls++;
+			}
+
+			cmdsLists.push_back(workerLists[w]);
+		}
+	});
+	mRenderGraph.Read(scenePass, backBuffer, ResourceStateRenderTarget);
+	mRenderGraph.Write(scenePass, backBuffer, ResourceStateRenderTarget);
+	mRenderGraph.Read(scenePass, depth, ResourceStateDepthWrite);
+	mRenderGraph.Write(scenePass, depth, ResourceStateDepthWrite);
+
+	RenderGraphPass presentPass = mRenderGraph.AddPass("Present", nullptr);
+	mRenderGraph.Read(presentPass, backBuffer, ResourceStatePresent);
+	mRenderGraph.SetSideEffect(presentPass);
+
+	std::string error;
+	if (!mRenderGraph.Compile(&error))
+		std::cerr << "Failed to compile the render graph ! " << error << "\n";
+	else if (!mPipeline.RealizeTransients || mPipeline.RealizeTransients(mRenderGraph))
+	{
+		mRenderGraph.Execute([&](RenderGraphPass pass) -> ICommandList&
+		{
+			return pass == presentPass ? *endList : *beginList;
+		}, &mResourceStates);
+	}
+
+	const RenderGraphStats& graphStats = mRenderGraph.GetStats();
+	mBarrierStats.Barriers += graphStats.Barriers;
+	mBarrierStats.BarrierCalls += graphStats.BarrierCalls;
+	mBarrierStats.SplitBarriers += graphStats.SplitBarriers;
+
+	cmdsLists.push_back(endList);
+
+	// Add the command lists to the queue for execution, in recording order.
+	// The device orders the uploads of the meshes drawn this frame before them.
+	mDevice.ExecuteCommandLists((std::uint32_t)cmdsLists.size(), cmdsLists.data());
+}
+
+std::uint32_t Renderer::BeginFrame()
+{
+	// Blocks only when the GPU still renders the frame that used this slot
+	mCurrFrameResource = mFrameRing.BeginFrame();
+	return mCurrFrameResource;
+}
+
+void Renderer::EndFrame()
+{
+	// No wait here, the CPU goes on with the next frame while the GPU renders this one
+	mFrameRing.EndFrame();
+}
+
+void Renderer::WaitIdle()
+{
+	mFrameRing.WaitIdle();
+}
+
+void Renderer::Update(Camera& camera, const Float4x4& proj, float width, float height, float totalTime, float deltaTime)
+{
+	if (mStaticWorldDirty)
+		RebuildStaticWorld();
+
+	UpdatePassBC(camera, proj, width, height, totalTime, deltaTime);
+	UpdatePerObjectBC(totalTime, deltaTime);
+	CullRenderItems(proj);
+	BuildDrawQueue(camera);
+	BuildFrameConstants();
+	BuildIndirectArguments();
+}
+
+void Renderer::UpdatePassBC(Camera& camera, const Float4x4& projection, float width, float height, float totalTime, float deltaTime)
+{
+
+	const Float4x4& invView = camera.GetTransform().GetMatrix();
+	Float4x4 view = Maths::Inverse(invView);
+	const Float4x4& proj = projection;
+
+	Float4x4 viewProj = Maths::Multiply(view, proj);
+	Float4x4 invProj = Maths::Inverse(proj);
+	Float4x4 invViewProj = Maths::Inverse(viewProj);
+
+	mMainPassCB.View = Maths::Transpose(view);
+	mMainPassCB.InvView = Maths::Transpose(invView);
+	mMainPassCB.Proj = Maths::Transpose(proj);
+	mMainPassCB.InvProj = Maths::Transpose(invProj);
+	mMainPassCB.ViewProj = Maths::Transpose(viewProj);
+	mMainPassCB.InvViewProj = Maths::Transpose(invViewProj);
+	mMainPassCB.EyePosW = camera.mView.position;
+	mMainPassCB.RenderTargetSize = Float2(width, height);
+	mMainPassCB.InvRenderTargetSize = Float2(1.0f / width, 1.0f / height);
+	mMainPassCB.NearZ = 1.0f;
+	mMainPassCB.FarZ = 1000.0f;
+	mMainPassCB.TotalTime = totalTime;
+	mMainPassCB.DeltaTime = deltaTime;
+}
+
+void Renderer::UpdatePerObjectBC(float totalTime, float deltaTime)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Benchmark motion, moving items bob up and down
+	if (mOptions.MovingEvery != 0)
+	{
+		for (std::uint32_t i = 0; i < (std::uint32_t)mRendersItems.size(); i += mOptions.MovingEvery)
+		{
+			TRANSFORM& transform = mRendersItems[i]->Transform;
+			if (mRendersItems[i]->Static) continue;
+
+			transform.SetPosition(transform.position + Float3(0.0f, cosf(totalTime + (float)i) * deltaTime, 0.0f));
+		}
+	}
+
+	// Only the items whose transform or color changed are encoded again
+	mDirtyStats.ItemsEncoded = 0;
+	for(std::uint32_t i = 0; i < (std::uint32_t)mRendersItems.size(); i++)
+	{
+		if (!mRendersItems[i]->HasChanged()) continue;
+
+		UpdateItemConstants(i);
+		mDirtyStats.ItemsEncoded++;
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	mDirtyStats.EncodeTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void Renderer::UpdateItemConstants(std::uint32_t i)
+{
+	auto& e = mRendersItems[i];
+
+	e->Transform.UpdateMatrix();
+
+	const Float4x4& world = e->Transform.GetMatrix();
+
+	ObjectConstants objConstants;
+
+	objConstants.World = Maths::Transpose(world);
+	objConstants.Color = e->Color;
+
+	mObjectConstants[i] = objConstants;
+
+	// World space bounds for culling
+	BoundingSphere bounds;
+	e->Mesh->Bounds.Transform(bounds, world);
+	mCulling.SetBounds(i, bounds.Center, bounds.Radius, e->MaxDrawDistance, e->IndexCount / 3);
+
+	// Written in the object buffer of every frame slot as they come
+	e->ClearChanged();
+	mDirtyTracker.Mark(i);
+	mDrawKeyDirty[i] = 1;
+}
+
+void Renderer::CullRenderItems(const Float4x4& proj)
+{
+	mCullViews.clear();
+
+	// Main camera
+	Float4x4 viewProj = Maths::Transpose(mMainPassCB.ViewProj);
+	CullingParams params = CullingSystem::MakeParams(mMainPassCB.EyePosW, proj,
+		mMainPassCB.RenderTargetSize, mMinPixelArea);
+	mCullViews.push_back(CullingSystem::MakeView(viewProj, params));
+
+	// Directional shadow view centered on the camera, casters are never dropped for their size
+	Float3 lightPos = mMainPassCB.EyePosW - mLightDirection * (2.0f * mShadowDistance);
+	Float4x4 lightView = Maths::LookToLH(lightPos, mLightDirection, Float3(0.0f, 1.0f, 0.0f));
+	Float4x4 lightProj = Maths::OrthographicLH(2.0f * mShadowDistance, 2.0f * mShadowDistance, 0.1f, 4.0f * mShadowDistance);
+	CullingParams shadowParams = params;
+	shadowParams.MinPixelArea = 0.0f;
+	mCullViews.push_back(CullingSystem::MakeView(Maths::Multiply(lightView, lightProj), shadowParams));
+
+	if (mOptions.CullViewsSeparately)
+		mCulling.CullViewsSeparately(mCullViews.data(), (std::uint32_t)mCullViews.size(), mVisibilityMasks, mVisibleItems, mCullingStats);
+	else
+		mCulling.CullViews(mCullViews.data(), (std::uint32_t)mCullViews.size(), mVisibilityMasks, mVisibleItems, mCullingStats);
+}
+
+void Renderer::BuildDrawQueue(Camera& camera)
+{
+	auto buildStart = std::chrono::high_resolution_clock::now();
+
+	const std::vector<std::uint32_t>& visibleItems = mVisibleItems[0];
+	const std::uint32_t itemCount = (std::uint32_t)mRendersItems.size();
+	const bool retained = mDrawQueue.IsRetained();
+	mDrawQueueStats.Rebuilt = !retained;
+
+	// Front to back inside a mesh, depth is the view distance along the camera forward
+	Float3 eye = mMainPassCB.EyePosW;
+	Float3 forward = camera.GetTransform().forward;
+	float invFar = 1.0f / mMainPassCB.FarZ;
+
+	if (retained)
+	{
+		// Many changes are merged slower than every key sorted again
+		std::uint32_t dirtyKeys = (std::uint32_t)std::count(mDrawKeyDirty.begin(), mDrawKeyDirty.end(), (std::uint8_t)1);
+		if (dirtyKeys > itemCount * RetainedDrawList::RebuildFraction)
+			mDrawQueueRebuild = true;
+
+		float moved = Maths::Length(eye - mSortEye);
+		float turned = Maths::Dot(forward, mSortForward);
+		if (mDrawQueueRebuild || moved > SortRebaseDistance || turned < SortRebaseCosAngle)
+		{
+			mDrawQueue.Clear();
+			mSortEye = eye;
+			mSortForward = forward;
+			mDrawQueueRebuild = false;
+			mDrawQueueStats.Rebuilt = true;
+		}
+
+		eye = mSortEye;
+		forward = mSortForward;
+	}
+	else
+	{
+		mDrawQueue.Clear();
+		mDrawQueue.Reserve((std::uint32_t)visibleItems.size());
+	}
+
+	// Meshes still streaming in are skipped
+	mUploadedTicket = mDevice.GetCompletedUpload();
+	mDrawsWaitingUpload = 0;
+	mVisibleBundles.clear();
+
+	// False when the visible item is not queued
+	auto makeKey = [&](std::uint32_t item, std::uint64_t& key) -> bool
+	{
+		RenderItem* ri = mRendersItems[item];
+
+		// Visible chunks are replayed from their bundle
+		if (mOptions.UseBundles && ri->Static)
+		{
+			auto bundle = mChunkBundles.find(ri);
+			if (bundle != mChunkBundles.end() && mStaticBundles.GetBundle(bundle->second) != nullptr)
+			{
+				mVisibleBundles.push_back(bundle->second);
+				return false;
+			}
+		}
+
+		if (ri->Mesh->UploadTicket > mUploadedTicket)
+		{
+			mDrawsWaitingUpload++;
+			return false;
+		}
+
+		float depth = Maths::Dot(mCulling.GetCenter(item) - eye, forward) * invFar;
+		key = DrawQueue::MakeKey(0, ri->PsoIndex, ri->Mesh->Id, depth, item);
+		return true;
+	};
+
+	std::uint64_t key = 0;
+	mDrawQueueStats.ItemsRekeyed = 0;
+	if (retained)
+	{
+		// Queued items keep their key until they change or leave the view
+		for (std::uint32_t item = 0; item < itemCount; item++)
+		{
+			bool dirty = mDrawKeyDirty[item] != 0;
+			mDrawKeyDirty[item] = 0;
+
+			bool queued = mDrawQueue.Contains(item);
+			if ((mVisibilityMasks[item] & 1) == 0)
+			{
+				if (queued)
+				{
+					mDrawQueue.Remove(item);
+					mDrawQueueStats.ItemsRekeyed++;
+				}
+				continue;
+			}
+			if (queued && !dirty) continue;
+
+			if (makeKey(item, key))
+				mDrawQueue.Set(item, key);
+			else if (queued)
+				mDrawQueue.Remove(item);
+			mDrawQueueStats.ItemsRekeyed++;
+		}
+	}
+	else
+	{
+		for (std::uint32_t item : visibleItems)
+		{
+			if (makeKey(item, key))
+				mDrawQueue.Push(key);
+		}
+	}
+
+	if (!retained)
+		DrawQueue::CountStateChanges(mDrawQueue.Keys().data(), mDrawQueue.Size(),
+			mDrawQueueStats.PsoChangesUnsorted, mDrawQueueStats.MeshChangesUnsorted);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	mDrawQueue.Sort();
+	auto end = std::chrono::high_resolution_clock::now();
+	mDrawQueueStats.SortTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+	mDrawQueueStats.BuildTimeMs = std::chrono::duration<float, std::milli>(end - buildStart).count();
+
+	mDrawQueueStats.Packets = mDrawQueue.Size();
+	DrawQueue::CountStateChanges(mDrawQueue.Keys().data(), mDrawQueue.Size(),
+		mDrawQueueStats.PsoChanges, mDrawQueueStats.MeshChanges);
+
+	// The retained keys are never in submission order before the sort
+	if (retained)
+	{
+		mDrawQueueStats.PsoChangesUnsorted = mDrawQueueStats.PsoChanges;
+		mDrawQueueStats.MeshChangesUnsorted = mDrawQueueStats.MeshChanges;
+	}
+}
+
+void Renderer::BuildFrameConstants()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	mDrawQueue.BuildBatches(mDrawBatches, mOptions.UseInstancing ? UINT_MAX : 1);
+
+	FrameResource& frame = CurrentFrame();
+	std::uint32_t itemCount = (std::uint32_t)mRendersItems.size();
+	std::uint32_t count = mDrawQueue.Size();
+
+	// Object constants of this slot, a new buffer starts empty so every item goes in it.
+	// The GPU is done with the last frame that used this slot.
+	if (frame.Objects == nullptr || itemCount > frame.ObjectCapacity)
+	{
+		delete frame.Objects;
+		frame.ObjectCapacity = std::max(std::max(itemCount, frame.ObjectCapacity * 2), 1024u);
+		frame.Objects = new UploadBuffer<ObjectConstants>(mDevice, frame.ObjectCapacity, true);
+		mDirtyTracker.MarkSlot(mCurrFrameResource);
+	}
+
+	mDirtyTracker.Collect(mCurrFrameResource, mDirtyItems);
+	std::uint32_t dirtyCount = (std::uint32_t)mDirtyItems.size();
+	std::uint32_t rangeCount = std::max(1u, std::min(mThreadPool.GetThreadCount() + 1, dirtyCount / 4096));
+	mThreadPool.ParallelFor(dirtyCount, rangeCount, [&](std::uint32_t, std::uint32_t begin, std::uint32_t end)
+	{
+		// Runs of consecutive items are copied in one call
+		std::uint32_t d = begin;
+		while (d < end)
+		{
+			std::uint32_t first = mDirtyItems[d];
+			std::uint32_t run = 1;
+			while (d + run < end && mDirtyItems[d + run] == first + run)
+				run++;
+
+			frame.Objects->CopyData(first, &mObjectConstants[first], run);
+			d += run;
+		}
+		StreamCopyFence();
+	});
+	mObjectDataAddress = frame.Objects->GetGpuAddress();
+
+	// Everything else this frame writes for the GPU, each allocation starts on a constant buffer boundary
+	auto aligned = [](std::uint64_t size) { return (size + LinearUploadBuffer::ConstantAlignment - 1) & ~(LinearUploadBuffer::ConstantAlignment - 1); };
+	std::uint64_t required = aligned(sizeof(PassConstants)) + aligned(std::max<std::uint64_t>(1, (std::uint64_t)count * sizeof(std::uint32_t)));
+	if (mOptions.UseIndirect)
+		required += aligned(std::max<std::uint64_t>(1, (std::uint64_t)mDrawBatches.size() * sizeof(IndirectDrawArguments)));
+	frame.Constants.Reset(required);
+
+	UploadAllocation passConstants = frame.Constants.AllocateConstants(mMainPassCB);
+	mPassCBAddress = passConstants.Gpu;
+
+	// Object index of every packet, instance k of a batch reads the one of packet FirstPacket + k
+	UploadAllocation instanceItems = frame.Constants.Allocate(std::max<std::uint64_t>(1, (std::uint64_t)count * sizeof(std::uint32_t)));
+	mInstanceItemsAddress = instanceItems.Gpu;
+
+	if (passConstants.Cpu == nullptr || instanceItems.Cpu == nullptr)
+	{
+		// The buffer could not grow, nothing is drawn rather than reading constants never written
+		std::cerr << "Failed to allocate the frame constants !\n";
+		mDrawBatches.clear();
+	}
+	else
+	{
+		const std::vector<std::uint64_t>& keys = mDrawQueue.Keys();
+		std::uint32_t* items = reinterpret_cast<std::uint32_t*>(instanceItems.Cpu);
+		for (std::uint32_t k = 0; k < count; ++k)
+			items[k] = DrawQueue::GetItem(keys[k]);
+	}
+
+	mDirtyStats.ItemsWritten = dirtyCount;
+	mDirtyStats.BytesWritten = (std::uint64_t)dirtyCount * sizeof(ObjectConstants) + frame.Constants.GetUsed();
+
+	auto end = std::chrono::high_resolution_clock::now();
+	mDirtyStats.WriteTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void Renderer::BuildIndirectArguments()
+{
+	if (!mOptions.UseIndirect) return;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::uint32_t count = (std::uint32_t)mDrawBatches.size();
+	mIndirectArguments.resize(count);
+
+	LinearUploadBuffer& constants = CurrentFrame().Constants;
+	UploadAllocation argumentBuffer = constants.Allocate(std::max<std::uint64_t>(1, (std::uint64_t)count * sizeof(IndirectDrawArguments)));
+	if (argumentBuffer.Cpu == nullptr)
+	{
+		std::cerr << "Failed to allocate the indirect arguments !\n";
+		mIndirectArguments.clear();
+		mDrawBatches.clear();
+		return;
+	}
+
+	// ExecuteIndirect reads the arguments from the resource holding the frame constants
+	std::uint64_t bufferOffset = 0;
+	mIndirectArgumentBuffer = mDevice.GetResource(constants.GetBuffer(), bufferOffset);
+	mIndirectArgumentsOffset = bufferOffset + argumentBuffer.Offset;
+
+	// Each range writes its arguments independently, the first instance is the batch first packet
+	const std::vector<std::uint64_t>& keys = mDrawQueue.Keys();
+	std::uint32_t rangeCount = std::max(1u, std::min(mThreadPool.GetThreadCount() + 1, count / 4096));
+	mThreadPool.ParallelFor(count, rangeCount, [&](std::uint32_t, std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t b = begin; b < end; ++b)
+		{
+			const DrawBatch& batch = mDrawBatches[b];
+			const RenderItem* ri = mRendersItems[DrawQueue::GetItem(keys[batch.FirstPacket])];
+
+			// Built in registers and stored whole, the array is written in order
+			IndirectDrawArguments arguments;
+			arguments.VertexBuffer = ri->Mesh->VertexBuffer;
+			arguments.IndexBuffer = ri->Mesh->IndexBuffer;
+			arguments.ObjectIndex = batch.FirstPacket;
+			arguments.IndexCountPerInstance = ri->IndexCount;
+			arguments.InstanceCount = batch.PacketCount;
+			arguments.StartIndexLocation = ri->StartIndexLocation;
+			arguments.BaseVertexLocation = ri->BaseVertexLocation;
+			arguments.StartInstanceLocation = 0;
+			mIndirectArguments[b] = arguments;
+		}
+
+		// One contiguous copy per range into the upload heap, in whole lines
+		if (end > begin)
+			StreamCopy(argumentBuffer.Cpu + (std::uint64_t)begin * sizeof(IndirectDrawArguments), &mIndirectArguments[begin],
+				(end - begin) * sizeof(IndirectDrawArguments));
+		StreamCopyFence();
+	});
+
+#if defined(DEBUG) || defined(_DEBUG)
+	std::string error;
+	if (!ValidateIndirectArguments(&error))
+		std::cerr << error << "\n";
+#endif
+
+	auto end = std::chrono::high_resolution_clock::now();
+	mIndirectBuildTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+bool Renderer::ValidateIndirectArguments(std::string* error) const
+{
+	if (!mOptions.UseIndirect) return true;
+	return ::ValidateIndirectArguments(mIndirectArguments.data(), (std::uint32_t)mIndirectArguments.size(), mDrawQueue.Size(), error);
+}
+
+std::wstring Renderer::GetFrameStats() const
+{
+	const CullingStats& stats = mCullingStats[0];
+	return L"   draws: " + std::to_wstring(stats.DrawsSubmitted) +
+		L"/" + std::to_wstring(stats.ItemsTested) +
+		L"   skipped (frustum/dist/small): " + std::to_wstring(stats.DrawsSkippedFrustum) +
+		L"/" + std::to_wstring(stats.DrawsSkippedDistance) +
+		L"/" + std::to_wstring(stats.DrawsSkippedContribution) +
+		L"   tris skipped: " + std::to_wstring(stats.TrianglesSkipped) +
+		L"   shadow casters: " + std::to_wstring(mCullingStats[1].DrawsSubmitted) +
+		(mOptions.CullViewsSeparately ? L"   cull (separate): " : L"   cull (multi view): ") +
+		std::to_wstring(stats.CullTimeMs) + L" ms" +
+		L"   sort: " + std::to_wstring(mDrawQueueStats.SortTimeMs) + L" ms" +
+		(mDrawQueue.IsRetained() ? L" (retained, " + std::to_wstring(mDrawQueueStats.ItemsRekeyed) + L" rekeyed" +
+			(mDrawQueueStats.Rebuilt ? L", rebuilt" : L"") + L", queue built in " :
+			L" (queue built in ") + std::to_wstring(mDrawQueueStats.BuildTimeMs) + L" ms)" +
+		L"   mesh changes: " + std::to_wstring(mDrawQueueStats.MeshChangesUnsorted) +
+		L" -> " + std::to_wstring(mDrawQueueStats.MeshChanges) +
+		L"   draw calls: " + std::to_wstring(mRecorderStats.Issued[(size_t)CommandType::DrawIndexedInstanced]) +
+		(mOptions.UseInstancing ? L" (instanced)" : L"") +
+		(mOptions.UseIndirect ? L"   indirect: " + std::to_wstring(mIndirectArguments.size()) +
+			L" args in " + std::to_wstring(mIndirectBuildTimeMs) + L" ms" : L"") +
+		L"   calls: " + std::to_wstring(mRecorderStats.TotalIssued()) +
+		L"/" + std::to_wstring(mRecorderStats.TotalRequested()) +
+		L"   barriers: " + std::to_wstring(mBarrierStats.Barriers + mBarrierStats.ResolvedBarriers) +
+		L" in " + std::to_wstring(mBarrierStats.BarrierCalls) + L" calls (" +
+		std::to_wstring(mBarrierStats.ResolvedBarriers) + L" at submit)" +
+		L"   graph: " + std::to_wstring(mRenderGraph.GetStats().Passes - mRenderGraph.GetStats().CulledPasses) +
+		L"/" + std::to_wstring(mRenderGraph.GetStats().Passes) + L" passes, compiled in " +
+		std::to_wstring(mRenderGraph.GetStats().CompileTimeMs) + L" ms" +
+		L"   moving: " + (mOptions.MovingEvery == 0 ? std::wstring(L"0") : std::to_wstring(100 / mOptions.MovingEvery)) + L"%" +
+		L"   constants: " + std::to_wstring(mDirtyStats.ItemsEncoded) + L" encoded, " +
+		std::to_wstring(mDirtyStats.ItemsWritten) + L" written, " +
+		std::to_wstring(mDirtyStats.BytesWritten / 1024) + L" KB in " +
+		std::to_wstring(mDirtyStats.EncodeTimeMs + mDirtyStats.WriteTimeMs) + L" ms" +
+		L"   streaming: " + std::to_wstring(mDrawsWaitingUpload) + L" draws waiting" +
+		L"   static: " + std::to_wstring(mStaticBatcher.GetStats().SourceItems) +
+		L" items in " + std::to_wstring(mStaticBatcher.GetStats().Chunks) + L" chunks" +
+		(mOptions.UseBundles ? L"   bundles: " + std::to_wstring(mVisibleBundles.size()) + L"/" +
+			std::to_wstring(mStaticBundles.GetStats().Bundles) + L" executed, last update recorded " +
+			std::to_wstring(mStaticBundles.GetStats().Recorded) + L" in " +
+			std::to_wstring(mStaticBundles.GetStats().UpdateTimeMs) + L" ms" : L"   bundles: off") +
+		L"   frames in flight: " + std::to_wstring(mFrameRing.GetFrameCount()) +
+		L" (cpu waits: " + std::to_wstring(mFrameRing.GetWaitCount()) + L")" +
+		L"   record (" + std::to_wstring(mRecordWorkersUsed) + L" threads): " +
+		std::to_wstring(mRecordTimeMs) + L" ms";
+}
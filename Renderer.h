@@ -0,0 +1,250 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Camera.h"
+#include "CommandListPool.h"
+#include "CullingSystem.h"
+#include "LinearUploadBuffer.h"
+#include "DrawQueue.h"
+#include "FrameConstants.h"
+#include "RenderObject.h"
+#include "StaticBatcher.h"
+#include "UploadBuffer.h"
+#include "lib/BundleCache.h"
+#include "lib/CommandRecorder.h"
+#include "lib/DirtyTracker.h"
+#include "lib/GeometryFactory.h"
+#include "lib/FrameRing.h"
+#include "lib/IndirectArguments.h"
+#include "lib/Maths.h"
+#include "lib/RenderDevice.h"
+#include "lib/RenderGraph.h"
+#include "lib/ResourceStateTracker.h"
+#include "lib/ThreadPool.h"
+
+// Backend objects the frame binds, opaque handles of the device the renderer draws with
+struct RendererPipeline
+{
+    void* RootSignature = nullptr;
+    void* PipelineState = nullptr; // One draw per item
+    void* InstancedPipelineState = nullptr; // INSTANCED permutation, also drawn by ExecuteIndirect
+    void* CommandSignature = nullptr; // Follows the member order of IndirectDrawArguments
+    void* DescriptorHeap = nullptr; // Shader visible heap bound on every list, none when null
+
+    // Places the transient resources of the compiled graph, the graph is executed when it returns true.
+    // Without it the graph must not have transient resources.
+    std::function<bool(RenderGraph&)> RealizeTransients;
+};
+
+// Where the frame is drawn, given again every frame
+struct FrameTarget
+{
+    void* BackBuffer = nullptr; // Registered in the resource states of the renderer
+    CpuDescriptor BackBufferView = 0;
+    void* DepthBuffer = nullptr; // Stays in DEPTH_WRITE
+    CpuDescriptor DepthView = 0;
+    Viewport ScreenViewport;
+    ScissorRect Scissor;
+};
+
+// Toggles of the frame, each key of the application flips one
+struct RendererOptions
+{
+    bool UseBundles = true; // Visible static chunks are replayed from their bundle
+    bool CullViewsSeparately = false; // One culling pass per view to compare timings
+    bool UseInstancing = true;
+    bool UseIndirect = false; // The batches are drawn with one ExecuteIndirect
+    bool RetainedQueue = true; // Sorted keys kept between frames, only the changed ones merged
+    std::uint32_t RecordWorkers = 4; // Lists recorded in parallel, at most MaxRecordWorkers
+    std::uint32_t MovingEvery = 0; // Every nth draw item moves, 0 for none
+};
+
+// The frame of the application on an IRenderDevice: culling, draw queue, dirty object constants,
+// per frame upload allocations, static bundles, indirect arguments, draws recorded by workers
+// and the render graph barriers, then one submission. The device decides where it runs, a D3D12
+// device draws the window and a recording device runs the same frame without a GPU.
+class Renderer
+{
+public:
+    static const std::uint32_t MaxRecordWorkers = 8;
+    static const std::uint64_t ObjectConstantsStride = 256;
+
+    Renderer(IRenderDevice& device);
+    ~Renderer();
+
+    Renderer(const Renderer& rhs) = delete;
+    Renderer& operator=(const Renderer& rhs) = delete;
+
+    void Initialize(const RendererPipeline& pipeline, std::uint32_t framesInFlight);
+
+    // Blocks only when the queue still runs the frame that used the next slot, return that slot
+    std::uint32_t BeginFrame();
+    // Build everything the frame draws, view is the camera of the main pass
+    void Update(Camera& camera, const Float4x4& proj, float width, float height, float totalTime, float deltaTime);
+    // Record and submit the frame
+    void Draw(const FrameTarget& target);
+    // The frame is submitted, after Present when there is a swap chain
+    void EndFrame();
+    // Wait until the queue is done with every frame
+    void WaitIdle();
+
+    void AddRenderItem(RenderItem* item);
+    void RemoveRenderItem(RenderItem* item); // The item is not deleted
+    void SpawnStressGrid(RenderMesh* mesh, std::uint32_t count, bool isStatic); // Add count items on a grid to measure the renderer
+    void ClearStressGrid();
+
+    const RendererOptions& GetOptions() const;
+    void SetOptions(const RendererOptions& options);
+    // The slots are reassigned, waits for the queue to be idle
+    void SetFramesInFlight(std::uint32_t framesInFlight);
+
+    IRenderDevice& GetDevice();
+    GeometryFactory& GetGeometryFactory(); // Meshes on the device of the renderer
+    ThreadPool& GetThreadPool();
+    ResourceStateRegistry& GetResourceStates(); // The frame targets are registered here
+
+    const CullingStats& GetCullingStats(std::uint32_t view) const;
+    const CommandRecorderStats& GetRecorderStats() const; // Of every worker of the last frame
+    const ResourceStateStats& GetBarrierStats() const;
+    float GetRecordTimeMs() const;
+    std::uint64_t GetBytesWritten() const; // Upload memory written by the last frame
+    std::uint32_t GetObjectsWritten() const; // Object constants copied by the last frame
+    // Check the indirect arguments of the last frame, true when the batches are not drawn indirectly
+    bool ValidateIndirectArguments(std::string* error) const;
+    std::wstring GetFrameStats() const; // Appended to the window caption
+
+private:
+    void UpdatePassBC(Camera& camera, const Float4x4& proj, float width, float height, float totalTime, float deltaTime);
+    void UpdatePerObjectBC(float totalTime, float deltaTime);
+    void CullRenderItems(const Float4x4& proj); // Fill mVisibleItems of every view for this frame
+    void BuildDrawQueue(Camera& camera); // Sort the visible items of the main view
+    void BuildFrameConstants(); // Group the sorted packets in batches and write the pass and object constants of the frame
+    void BuildIndirectArguments(); // One indirect draw per batch for ExecuteIndirect
+
+    void AddDrawItem(RenderItem* item);
+    void RemoveDrawItem(std::uint32_t index); // Swap with the last draw item
+    void UpdateItemConstants(std::uint32_t index); // Write the constants and culling bounds of a draw item
+    void RebuildStaticWorld(); // Merge the static items again after some were added or removed
+    void RebuildStaticBundles(); // Record the bundles of the changed chunks, the GPU must be done with the static constants
+
+    void DrawRenderItems(ICommandList& commandList, std::uint32_t begin, std::uint32_t end); // Draw the batches [begin, end)
+    void RecordDrawRange(std::uint32_t worker, const FrameTarget& target, ICommandList* commandList, std::uint32_t begin, std::uint32_t end);
+    void RecordPassSetup(ICommandList& commandList, const FrameTarget& target); // Every list starts without it
+
+    IRenderDevice& mDevice;
+    RendererPipeline mPipeline;
+    RendererOptions mOptions;
+    GeometryFactory mFactory;
+    std::uint64_t mUploadedTicket = 0; // Device uploads done when the frame was built
+    std::uint32_t mDrawsWaitingUpload = 0;
+
+    // Items drawn every frame, the static items are drawn through the chunks of mStaticBatcher
+    std::vector<RenderItem*> mRendersItems;
+    std::vector<RenderItem*> mStaticItems;
+    std::vector<RenderItem*> mStressItems;
+    StaticBatcher mStaticBatcher;
+    bool mStaticWorldDirty = false;
+
+    // Each chunk is replayed from a bundle recorded when the static world changes, the visible
+    // ones are executed instead of going through the draw queue. Their constants have a fixed
+    // address in mStaticConstants so an unchanged chunk keeps its bundle.
+    BundleCache mStaticBundles;
+    std::vector<BundleDraw> mStaticBundleDraws;
+    std::unordered_map<const RenderItem*, std::uint32_t> mChunkBundles;
+    UploadBuffer<ObjectConstants>* mStaticConstants = nullptr;
+    std::uint32_t mStaticConstantsCapacity = 0;
+    std::vector<std::uint32_t> mVisibleBundles;
+
+    // Culling views, 0 is the main camera and the next ones are shadow views
+    CullingSystem mCulling;
+    std::vector<CullingView> mCullViews;
+    std::vector<std::uint8_t> mVisibilityMasks;
+    std::vector<std::uint32_t> mVisibleItems[CullingSystem::MaxViews];
+    CullingStats mCullingStats[CullingSystem::MaxViews];
+    float mMinPixelArea = 1.0f; // Items smaller than this on screen are not drawn
+
+    DrawQueue mDrawQueue;
+    DrawQueueStats mDrawQueueStats;
+
+    // The retained draw queue keeps the keys of the last frame, only the items marked here or whose
+    // visibility changed get a new key. The depth of the keys is from the view they were sorted
+    // for, every key is made again once the camera moved or turned past the thresholds, or when more
+    // than RetainedDrawList::RebuildFraction of the items are marked.
+    static constexpr float SortRebaseDistance = 1.0f;
+    static constexpr float SortRebaseCosAngle = 0.996f; // About 5 degrees
+    std::vector<std::uint8_t> mDrawKeyDirty;
+    Float3 mSortEye = { 0.0f, 0.0f, 0.0f };
+    Float3 mSortForward = { 0.0f, 0.0f, 0.0f };
+    bool mDrawQueueRebuild = true; // Every key is made again next frame
+
+    // Packets sharing a mesh are drawn with one instanced call reading their
+    // World/Color from the instance buffer, in packet order.
+    std::vector<DrawBatch> mDrawBatches;
+
+    // With indirect drawing the batches are written as arguments and drawn with one ExecuteIndirect
+    std::vector<IndirectDrawArguments> mIndirectArguments;
+    void* mIndirectArgumentBuffer = nullptr; // Resource of the frame constants
+    std::uint64_t mIndirectArgumentsOffset = 0; // In mIndirectArgumentBuffer
+    float mIndirectBuildTimeMs = 0.0f;
+
+    // Draws are recorded in parallel, each worker has its own list and recorder
+    // so redundant state changes are dropped inside its range.
+    static const std::uint32_t MinDrawsPerWorker = 256; // Batches per worker
+    ThreadPool mThreadPool;
+    CommandRecorder mWorkerRecorders[MaxRecordWorkers];
+    CommandRecorderStats mRecorderStats;
+    std::uint32_t mRecordWorkersUsed = 0;
+    float mRecordTimeMs = 0.0f;
+
+    // Barriers come from the state of the resources, the workers lists get theirs at submit time
+    ResourceStateRegistry mResourceStates;
+    ResourceStateTracker mWorkerStates[MaxRecordWorkers];
+    ResourceStateStats mBarrierStats;
+
+    // Passes of the frame, declared again every frame
+    RenderGraph mRenderGraph;
+
+    Float3 mLightDirection = { 0.57735f, -0.57735f, 0.57735f };
+    float mShadowDistance = 50.0f; // Half size of the shadow view around the camera
+
+    // Resources the CPU writes for a frame, reused once the GPU is done with that frame
+    struct FrameResource
+    {
+        CommandListPool CommandLists;
+        LinearUploadBuffer Constants;
+
+        // 256 bytes constants of every draw item, kept between the frames using this slot
+        UploadBuffer<ObjectConstants>* Objects = nullptr;
+        std::uint32_t ObjectCapacity = 0;
+    };
+    FrameResource& CurrentFrame();
+
+    FrameRing mFrameRing;
+    FrameResource mFrameResources[FrameRing::MaxFrames];
+    std::uint32_t mCurrFrameResource = 0;
+
+    // Item constants are written in the Objects of a slot only when they changed since that slot
+    // was last used. The rest of the frame data is allocated in its Constants: pass constants, the
+    // object index of the sorted packets for the instanced draws and the indirect arguments.
+    GpuAddress mPassCBAddress = 0;
+    GpuAddress mObjectDataAddress = 0;
+    GpuAddress mInstanceItemsAddress = 0;
+    std::vector<ObjectConstants> mObjectConstants; // CPU copy of every item constants
+    PassConstants mMainPassCB;
+
+    struct DirtyConstantsStats
+    {
+        std::uint32_t ItemsEncoded = 0; // Items whose transform or color changed
+        std::uint32_t ItemsWritten = 0; // Items copied in the slot of this frame
+        std::uint64_t BytesWritten = 0; // Upload memory written this frame
+        float EncodeTimeMs = 0.0f;
+        float WriteTimeMs = 0.0f;
+    };
+    DirtyTracker mDirtyTracker;
+    std::vector<std::uint32_t> mDirtyItems;
+    DirtyConstantsStats mDirtyStats;
+};
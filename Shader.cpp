@@ -1,22 +1,14 @@
 ﻿#include "Shader.h"
 
-PassConstants::PassConstants()
-{
-    
-    Maths::Identity4X4(&View);
-    Maths::Identity4X4(&InvView);
-    Maths::Identity4X4(&Proj);
-    Maths::Identity4X4(&InvProj);
-    Maths::Identity4X4(&ViewProj);
-    Maths::Identity4X4(&InvViewProj);
-    
-}
+#include <chrono>
+#include <fstream>
+#include <iterator>
 
-Shader::Shader(std::wstring path)
-{
-    mVertexShader = CompileShader(path, nullptr, "VS", "vs_5_1");
-    mPixelShader = CompileShader(path, nullptr, "PS", "ps_5_1");
+#include "lib/Hash.h"
 
+Shader::Shader(std::wstring path, std::string vertexEntry, std::string pixelEntry, std::vector<std::string> keywords)
+    : mPath(path), mVertexEntry(vertexEntry), mPixelEntry(pixelEntry), mKeywords(keywords)
+{
     mInputLayout =
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
@@ -24,14 +16,116 @@ Shader::Shader(std::wstring path)
     };
 }
 
-ID3DBlob* Shader::GetVertexShader()
+Shader::~Shader()
 {
-    return mVertexShader;
+    ReleaseVariants();
 }
 
-ID3DBlob* Shader::GetPixelShader()
+void Shader::ReleaseVariants()
 {
-    return mPixelShader;
+    for (Variant& variant : mVariants)
+    {
+        if (variant.VertexShader) variant.VertexShader->Release();
+        if (variant.PixelShader) variant.PixelShader->Release();
+    }
+    mVariants.clear();
+}
+
+namespace
+{
+    // Null terminated macro array pointing into defines
+    std::vector<D3D_SHADER_MACRO> ToMacros(const std::vector<ShaderDefine>& defines)
+    {
+        std::vector<D3D_SHADER_MACRO> macros;
+        for (const ShaderDefine& define : defines)
+            macros.push_back({ define.Name.c_str(), define.Value.c_str() });
+        macros.push_back({ nullptr, nullptr });
+        return macros;
+    }
+}
+
+bool Shader::PreprocessShader(const std::vector<ShaderDefine>& defines, std::uint64_t& hash)
+{
+    // Same source, includes and defines as a previous run: the preprocessor would give the same text
+    ShaderCache& cache = GetCache();
+    ShaderCacheKey key;
+    bool cacheable = cache.MakeKey(std::string(mPath.begin(), mPath.end()), defines, "", ShaderCache::PreprocessTarget, 0, key);
+    if (cacheable && cache.LoadPreprocessedHash(key, hash))
+        return true;
+
+    std::fstream file;
+    file.open(mPath, std::ios::in | std::ios::binary);
+    if (!file.is_open()) { std::cerr << "Failed to open shader !\n"; return false; }
+
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::string name(mPath.begin(), mPath.end());
+    std::vector<D3D_SHADER_MACRO> macros = ToMacros(defines);
+
+    ID3DBlob* preprocessed = nullptr;
+    ID3DBlob* errors = nullptr;
+    HRESULT hr = D3DPreprocess(source.data(), source.size(), name.c_str(), macros.data(),
+        D3D_COMPILE_STANDARD_FILE_INCLUDE, &preprocessed, &errors);
+
+    if (errors != nullptr)
+    {
+        OutputDebugStringA((char*)errors->GetBufferPointer());
+        errors->Release();
+    }
+
+    if (FAILED(hr)) { std::cerr << "Failed to preprocess shader !\n"; return false; }
+
+    hash = HashBytes(preprocessed->GetBufferPointer(), preprocessed->GetBufferSize());
+    preprocessed->Release();
+
+    if (cacheable)
+        cache.StorePreprocessedHash(key, hash);
+    return true;
+}
+
+bool Shader::Compile(const std::vector<ShaderPermutationMask>& permutations, ThreadPool& pool)
+{
+    // The variants of a previous call are numbered again, they are compiled or loaded again too.
+    // Variants stay below the permutation count, every thread writes its own slot.
+    ReleaseVariants();
+    mVariants.resize(permutations.size());
+
+    return mPermutations.Build(mKeywords, permutations, pool,
+        [&](ShaderPermutationMask permutation, std::uint64_t& hash)
+        {
+            return PreprocessShader(mKeywords.GetDefines(permutation), hash);
+        },
+        [&](std::uint32_t variant, ShaderPermutationMask permutation)
+        {
+            std::vector<ShaderDefine> defines = mKeywords.GetDefines(permutation);
+            std::vector<D3D_SHADER_MACRO> macros = ToMacros(defines);
+
+            Variant& compiled = mVariants[variant];
+            compiled.VertexShader = CompileShader(mPath, macros.data(), mVertexEntry, "vs_5_1");
+            compiled.PixelShader = CompileShader(mPath, macros.data(), mPixelEntry, "ps_5_1");
+            return compiled.VertexShader != nullptr && compiled.PixelShader != nullptr;
+        });
+}
+
+ShaderPermutationMask Shader::GetKeyword(const std::string& name) const
+{
+    return mKeywords.GetMask(name);
+}
+
+ID3DBlob* Shader::GetVertexShader(ShaderPermutationMask permutation)
+{
+    UINT variant = mPermutations.GetVariant(permutation);
+    return variant != ShaderPermutationTable::InvalidVariant ? mVariants[variant].VertexShader : nullptr;
+}
+
+ID3DBlob* Shader::GetPixelShader(ShaderPermutationMask permutation)
+{
+    UINT variant = mPermutations.GetVariant(permutation);
+    return variant != ShaderPermutationTable::InvalidVariant ? mVariants[variant].PixelShader : nullptr;
+}
+
+const ShaderPermutationStats& Shader::GetPermutationStats() const
+{
+    return mPermutations.GetStats();
 }
 
 std::vector<D3D12_INPUT_ELEMENT_DESC>& Shader::GetInputLayout()
@@ -39,6 +133,19 @@ std::vector<D3D12_INPUT_ELEMENT_DESC>& Shader::GetInputLayout()
     return mInputLayout;
 }
 
+ShaderCache& Shader::GetCache()
+{
+    static ShaderCache cache;
+    static std::once_flag initialized;
+    std::call_once(initialized, []()
+    {
+        // Fails when the directory is already there
+        CreateDirectoryW(L"shader\\cache", nullptr);
+        cache.Initialize("shader\\cache");
+    });
+    return cache;
+}
+
 ID3DBlob* Shader::CompileShader(
     const std::wstring& filename,
     const D3D_SHADER_MACRO* defines,
@@ -50,15 +157,43 @@ ID3DBlob* Shader::CompileShader(
     compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
 
+    // Same sources, includes, defines and flags as a previous run: the bytecode is read back
+    std::vector<ShaderDefine> cacheDefines;
+    for (const D3D_SHADER_MACRO* define = defines; define != nullptr && define->Name != nullptr; define++)
+        cacheDefines.push_back({ define->Name, define->Definition != nullptr ? define->Definition : "" });
+
+    ShaderCache& cache = GetCache();
+    ShaderCacheKey key;
+    bool cacheable = cache.MakeKey(std::string(filename.begin(), filename.end()), cacheDefines, entrypoint, target, compileFlags, key);
+
+    std::vector<char> cached;
+    if (cacheable && cache.Load(key, cached))
+    {
+        ID3DBlob* blob = nullptr;
+        if (SUCCEEDED(D3DCreateBlob(cached.size(), &blob)))
+        {
+            memcpy(blob->GetBufferPointer(), cached.data(), cached.size());
+            return blob;
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
     ID3DBlob* byteCode = nullptr;
     ID3DBlob* errors;
     HRESULT hr = D3DCompileFromFile(filename.c_str(), defines, D3D_COMPILE_STANDARD_FILE_INCLUDE,
         entrypoint.c_str(), target.c_str(), compileFlags, 0, &byteCode, &errors);
 
+    auto end = std::chrono::high_resolution_clock::now();
+    cache.AddCompileTime(std::chrono::duration<double, std::milli>(end - start).count());
+
     if(errors != nullptr)
         OutputDebugStringA((char*)errors->GetBufferPointer());
 
     if (FAILED(hr)) { std::cerr << "Failed to compile shader !\n"; return nullptr; }
 
+    if (cacheable)
+        cache.Store(key, byteCode->GetBufferPointer(), byteCode->GetBufferSize());
+
     return byteCode;
 }
@@ -1,52 +1,58 @@
 ﻿#pragma once
 
+#include "FrameConstants.h"
 #include "UploadBuffer.h"
 #include "lib/d3dUtils.h"
 #include "lib/Maths.h"
+#include "lib/ShaderCache.h"
+#include "lib/ShaderPermutations.h"
 
 using namespace DirectX;
 
-// C'est les constantes globales du monde pour chaque frame
-// Y'a tout les parametres du livre mais c'est pas forcement tout utile
-struct PassConstants
-{
-    DirectX::XMFLOAT4X4 View;
-    DirectX::XMFLOAT4X4 InvView;
-    DirectX::XMFLOAT4X4 Proj;
-    DirectX::XMFLOAT4X4 InvProj;
-    DirectX::XMFLOAT4X4 ViewProj;
-    DirectX::XMFLOAT4X4 InvViewProj;
-    DirectX::XMFLOAT3 EyePosW = { 0.0f, 0.0f, 0.0f };
-    float cbPerObjectPad1 = 0.0f;
-    DirectX::XMFLOAT2 RenderTargetSize = { 0.0f, 0.0f };
-    DirectX::XMFLOAT2 InvRenderTargetSize = { 0.0f, 0.0f };
-    float NearZ = 0.0f;
-    float FarZ = 0.0f;
-    float TotalTime = 0.0f;
-    float DeltaTime = 0.0f;
-
-    PassConstants();
-};
-
-// C'est les constante pour chaque objet individuel
-struct ObjectConstants
-{
-    XMFLOAT4X4 World;
-    XMFLOAT4 Color;
-};
-
+// Vertex and pixel shader of one file, compiled for each permutation of its keywords
 class Shader
 {
 public:
-    Shader(std::wstring path);
+    Shader(std::wstring path, std::string vertexEntry = "VS", std::string pixelEntry = "PS",
+           std::vector<std::string> keywords = {});
+    ~Shader();
+
+    // Compile the permutations on the pool, a permutation can be used once compiled.
+    // Permutations with the same preprocessed source are compiled once. A new call releases the
+    // variants of the previous one.
+    bool Compile(const std::vector<ShaderPermutationMask>& permutations, ThreadPool& pool);
 
-    ID3DBlob* GetVertexShader();
-    ID3DBlob* GetPixelShader();
+    ShaderPermutationMask GetKeyword(const std::string& name) const;
+
+    // nullptr when the permutation was not compiled
+    ID3DBlob* GetVertexShader(ShaderPermutationMask permutation = 0);
+    ID3DBlob* GetPixelShader(ShaderPermutationMask permutation = 0);
     std::vector<D3D12_INPUT_ELEMENT_DESC>& GetInputLayout();
+
+    const ShaderPermutationStats& GetPermutationStats() const;
+
+    // Compiled bytecode of every shader, in shader\cache
+    static ShaderCache& GetCache();
 private:
 
-    ID3DBlob* mVertexShader;
-    ID3DBlob* mPixelShader;
+    struct Variant
+    {
+        ID3DBlob* VertexShader = nullptr;
+        ID3DBlob* PixelShader = nullptr;
+    };
+
+    std::wstring mPath;
+    std::string mVertexEntry;
+    std::string mPixelEntry;
+    ShaderKeywords mKeywords;
+    ShaderPermutationTable mPermutations;
+    std::vector<Variant> mVariants;
+
+    void ReleaseVariants();
+
+    // Hash of the file preprocessed with the permutation defines, read from the cache when
+    // the source and its includes did not change
+    bool PreprocessShader(const std::vector<ShaderDefine>& defines, std::uint64_t& hash);
     
     ID3DBlob* CompileShader(
         const std::wstring& filename,
@@ -56,4 +62,4 @@ private:
 
 private:
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
-};
\ No newline at end of file
+};
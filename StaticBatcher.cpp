@@ -0,0 +1,165 @@
+﻿#include "StaticBatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+namespace
+{
+    // Items of a chunk share pipeline, color and grid cell. Only integers are compared, the color
+    // by its bits, so the map order holds whatever the floats are.
+    struct ChunkKey
+    {
+        std::uint32_t PsoIndex;
+        std::uint32_t Color[4];
+        int CellX;
+        int CellY;
+        int CellZ;
+
+        bool operator<(const ChunkKey& other) const
+        {
+            return std::tie(PsoIndex, Color[0], Color[1], Color[2], Color[3], CellX, CellY, CellZ) <
+                std::tie(other.PsoIndex, other.Color[0], other.Color[1], other.Color[2], other.Color[3],
+                    other.CellX, other.CellY, other.CellZ);
+        }
+    };
+
+    // Grid cell of a world coordinate, clamped so a far away item still gets a valid cell
+    int ToCell(float coordinate, float invChunkSize)
+    {
+        float cell = floorf(coordinate * invChunkSize);
+        if (!(cell > (float)INT_MIN)) return INT_MIN;
+        if (cell >= (float)INT_MAX) return INT_MAX;
+        return (int)cell;
+    }
+
+    void AppendItem(MeshData& merged, const RenderItem& item, const Float4x4& world)
+    {
+        const MeshData& source = item.Mesh->MeshData;
+
+        // Normals need the inverse transpose when the scale is not uniform
+        Float4x4 normalWorld = Maths::Transpose(Maths::Inverse(world));
+
+        std::uint32_t baseVertex = (std::uint32_t)merged.Vertices.size();
+        merged.Vertices.reserve(merged.Vertices.size() + source.Vertices.size());
+        for (const Vertex& v : source.Vertices)
+        {
+            Vertex out = v;
+            out.Position = Maths::TransformCoord(v.Position, world);
+            out.Normal = Maths::Normalize(Maths::TransformNormal(v.Normal, normalWorld));
+            out.TangentU = Maths::Normalize(Maths::TransformNormal(v.TangentU, world));
+            merged.Vertices.push_back(out);
+        }
+
+        // Only the range the item draws is kept
+        std::uint32_t first = item.StartIndexLocation;
+        std::uint32_t last = std::min(first + item.IndexCount, (std::uint32_t)source.Indices32.size());
+        for (std::uint32_t i = first; i < last; i++)
+            merged.Indices32.push_back(baseVertex + (std::uint32_t)((int)source.Indices32[i] + item.BaseVertexLocation));
+    }
+}
+
+StaticBatcher::StaticBatcher(float chunkSize) : mChunkSize(chunkSize)
+{
+}
+
+StaticBatcher::~StaticBatcher()
+{
+    // Meshes are owned by the factory used to build them, see Clear
+    for (RenderItem* chunk : mChunks)
+        delete chunk;
+}
+
+void StaticBatcher::Clear(GeometryFactory& factory)
+{
+    for (RenderItem* chunk : mChunks)
+    {
+        factory.ReleaseMesh(chunk->Mesh);
+        delete chunk;
+    }
+    mChunks.clear();
+    mStats = StaticBatchStats();
+}
+
+void StaticBatcher::Build(const std::vector<RenderItem*>& items, GeometryFactory& factory)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    Clear(factory);
+
+    std::map<ChunkKey, std::vector<RenderItem*>> groups;
+    float invChunkSize = 1.0f / mChunkSize;
+    for (RenderItem* item : items)
+    {
+        item->Transform.UpdateMatrix();
+
+        BoundingSphere bounds;
+        item->Mesh->Bounds.Transform(bounds, item->Transform.GetMatrix());
+
+        ChunkKey key;
+        key.PsoIndex = item->PsoIndex;
+        memcpy(key.Color, &item->Color, sizeof(key.Color));
+        key.CellX = ToCell(bounds.Center.x, invChunkSize);
+        key.CellY = ToCell(bounds.Center.y, invChunkSize);
+        key.CellZ = ToCell(bounds.Center.z, invChunkSize);
+        groups[key].push_back(item);
+    }
+
+    for (auto& group : groups)
+    {
+        const std::vector<RenderItem*>& groupItems = group.second;
+
+        size_t next = 0;
+        while (next < groupItems.size())
+        {
+            MeshData merged;
+            float maxDrawDistance = 0.0f;
+            bool unlimited = false;
+
+            while (next < groupItems.size())
+            {
+                const RenderItem* item = groupItems[next];
+                if (!merged.Vertices.empty() && merged.Vertices.size() + item->Mesh->MeshData.Vertices.size() > MaxChunkVertices)
+                    break;
+
+                AppendItem(merged, *item, item->Transform.GetMatrix());
+
+                // The chunk is visible as far as its furthest visible item
+                if (item->MaxDrawDistance <= 0.0f) unlimited = true;
+                maxDrawDistance = std::max(maxDrawDistance, item->MaxDrawDistance);
+                next++;
+            }
+
+            mStats.Vertices += (std::uint32_t)merged.Vertices.size();
+            mStats.Triangles += (std::uint32_t)merged.Indices32.size() / 3;
+
+            RenderItem* chunk = new RenderItem(factory.CreateMesh(std::move(merged)));
+            chunk->Static = true;
+            chunk->SetColor(groupItems.front()->Color);
+            chunk->PsoIndex = group.first.PsoIndex;
+            chunk->ObjCBIndex = 0;
+            chunk->MaxDrawDistance = unlimited ? 0.0f : maxDrawDistance;
+            mChunks.push_back(chunk);
+        }
+    }
+
+    mStats.SourceItems = (std::uint32_t)items.size();
+    mStats.Chunks = (std::uint32_t)mChunks.size();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    mStats.BuildTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+const std::vector<RenderItem*>& StaticBatcher::GetChunks() const
+{
+    return mChunks;
+}
+
+const StaticBatchStats& StaticBatcher::GetStats() const
+{
+    return mStats;
+}
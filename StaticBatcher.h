@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include "RenderObject.h"
+#include "lib/GeometryFactory.h"
+
+// Counters of the last static world build
+struct StaticBatchStats
+{
+    std::uint32_t SourceItems = 0;
+    std::uint32_t Chunks = 0;
+    std::uint32_t Vertices = 0;
+    std::uint32_t Triangles = 0;
+    float BuildTimeMs = 0.0f;
+};
+
+// Merge the render items that never move in a few big meshes.
+// Items sharing pipeline and color are grouped by cell of a world grid, the vertices of every
+// item of a cell are transformed to world space and written in one vertex/index buffer.
+// Each chunk is drawn as a regular item with an identity transform, so it is culled on its
+// own bounds and its constants are written once.
+class StaticBatcher
+{
+public:
+    // chunkSize is the world size of a grid cell
+    StaticBatcher(float chunkSize = 32.0f);
+    ~StaticBatcher();
+
+    // Release the previous chunks and merge items. The uploads are recorded on the factory command list,
+    // it must be executed before the chunks are drawn. The GPU must be done with the previous chunks.
+    void Build(const std::vector<RenderItem*>& items, GeometryFactory& factory);
+    void Clear(GeometryFactory& factory);
+
+    const std::vector<RenderItem*>& GetChunks() const;
+    const StaticBatchStats& GetStats() const;
+
+private:
+    // A chunk is split past this many vertices to keep the buffers reasonable
+    static const std::uint32_t MaxChunkVertices = 1 << 20;
+
+    float mChunkSize;
+    std::vector<RenderItem*> mChunks;
+    StaticBatchStats mStats;
+};
@@ -1,12 +1,15 @@
 ﻿#include "Transform.h"
 
-TRANSFORM::TRANSFORM() : mDirty(true)
+TRANSFORM::TRANSFORM() : mDirty(true), mChanged(true)
 {
     Identity();
 }
 
 void TRANSFORM::Identity()
 {
+    mDirty = true;
+    mChanged = true;
+
     mMatrix._11 = 1.0f;
     mMatrix._12 = 0.0f;
     mMatrix._13 = 0.0f;
@@ -68,9 +71,10 @@ void TRANSFORM::Identity()
     right.z = 0.0f;
 }
 
-void XM_CALLCONV TRANSFORM::FromMatrix(DirectX::FXMMATRIX pMat)
+void TRANSFORM::FromMatrix(const Float4x4& pMat)
 {
-    XMStoreFloat4x4(&mMatrix, pMat);
+    mMatrix = pMat;
+    mChanged = true;
 }
 
 void TRANSFORM::UpdateMatrix()
@@ -79,58 +83,63 @@ void TRANSFORM::UpdateMatrix()
     if (mDirty == false) return;
     mDirty = false;
     
-    DirectX::XMMATRIX scalingMatrix = DirectX::XMMatrixScalingFromVector(DirectX::XMLoadFloat3(&scale));
-    DirectX::XMMATRIX translationMatrix = DirectX::XMMatrixTranslationFromVector(DirectX::XMLoadFloat3(&position));
-    DirectX::XMMATRIX rotation = DirectX::XMLoadFloat4x4(&mRotation);
-
-    DirectX::XMMATRIX matrix = DirectX::XMMatrixIdentity();
-    matrix = DirectX::XMMatrixMultiply(matrix, rotation);
-    matrix = DirectX::XMMatrixMultiply(matrix, scalingMatrix);
-    matrix = DirectX::XMMatrixMultiply(matrix, translationMatrix);
-    
-    DirectX::XMStoreFloat4x4(&mMatrix, matrix);
+    Float4x4 scalingMatrix = Maths::Scaling(scale);
+    Float4x4 translationMatrix = Maths::Translation(position);
+
+    Float4x4 matrix = Maths::Multiply(mRotation, scalingMatrix);
+    mMatrix = Maths::Multiply(matrix, translationMatrix);
     
 }
 
-DirectX::XMMATRIX TRANSFORM::GetMatrix() const
+const Float4x4& TRANSFORM::GetMatrix() const
+{
+    return mMatrix;
+}
+
+bool TRANSFORM::HasChanged() const
+{
+    return mChanged;
+}
+
+void TRANSFORM::ClearChanged()
 {
-    return XMLoadFloat4x4(&mMatrix);
+    mChanged = false;
 }
 
-void XM_CALLCONV TRANSFORM::SetPosition(DirectX::FXMVECTOR pVec)
+void TRANSFORM::SetPosition(const Float3& pVec)
 {
-    XMStoreFloat3(&position, pVec);
+    position = pVec;
     mDirty = true;
+    mChanged = true;
 }
 
 void TRANSFORM::Rotate(float pitch, float yaw, float roll)
 {
     mDirty = true;
+    mChanged = true;
     pitch *= Maths::PI/180;
     yaw *= Maths::PI/180;
     roll *= Maths::PI/180;
-    DirectX::XMVECTOR currentRotation = DirectX::XMQuaternionIdentity();
-    DirectX::XMVECTOR qTemp;
+    Float4 currentRotation = Maths::QuaternionIdentity();
+    Float4 qTemp;
     
     // Pitch
-    qTemp = DirectX::XMQuaternionRotationAxis(DirectX::XMLoadFloat3(&right), pitch);
-    currentRotation = DirectX::XMQuaternionMultiply(currentRotation, qTemp);
+    qTemp = Maths::QuaternionRotationAxis(right, pitch);
+    currentRotation = Maths::QuaternionMultiply(currentRotation, qTemp);
 
     // Yaw
-    qTemp = DirectX::XMQuaternionRotationAxis(DirectX::XMLoadFloat3(&forward), roll);
-    currentRotation = DirectX::XMQuaternionMultiply(currentRotation, qTemp);
+    qTemp = Maths::QuaternionRotationAxis(forward, roll);
+    currentRotation = Maths::QuaternionMultiply(currentRotation, qTemp);
     
     // Roll
-    qTemp = DirectX::XMQuaternionRotationAxis(DirectX::XMLoadFloat3(&up), yaw);
-    currentRotation = DirectX::XMQuaternionMultiply(currentRotation, qTemp);
+    qTemp = Maths::QuaternionRotationAxis(up, yaw);
+    currentRotation = Maths::QuaternionMultiply(currentRotation, qTemp);
 
     // Multiply quaternion with rotation 
-    DirectX::XMVECTOR objectRotation = DirectX::XMLoadFloat4(&rotation);
-    objectRotation = DirectX::XMQuaternionMultiply(objectRotation, currentRotation);
-    DirectX::XMStoreFloat4(&rotation, objectRotation);
+    rotation = Maths::QuaternionMultiply(rotation, currentRotation);
 
     // Rotate matrix
-    DirectX::XMStoreFloat4x4(&mRotation, DirectX::XMMatrixRotationQuaternion(objectRotation));
+    mRotation = Maths::RotationQuaternion(rotation);
 
     right.x = mRotation._11;
     right.y = mRotation._12;
@@ -157,10 +166,10 @@ void TRANSFORM::RotateRoll(float angle)
 {
 }
 
-void XM_CALLCONV TRANSFORM::LookAt(DirectX::FXMVECTOR trg)
+void TRANSFORM::LookAt(const Float3& trg)
 {
-    //DirectX::XMMATRIX view = DirectX::XMMatrixLookAtLH(XMLoadFloat3(&position), trg, XMLoadFloat3(&up));
-    DirectX::XMMATRIX view = DirectX::XMMatrixLookAtLH(DirectX::XMVectorZero(), trg, XMLoadFloat3(&up));
-    XMStoreFloat4x4(&mRotation, view);
+    //mRotation = Maths::LookAtLH(position, trg, up);
+    mRotation = Maths::LookAtLH(Float3(), trg, up);
     mDirty = true;
+    mChanged = true;
 }
@@ -6,34 +6,39 @@ struct TRANSFORM
 {
 private:
     bool mDirty;
+    bool mChanged; // Cleared by ClearChanged, unlike mDirty which UpdateMatrix clears
 
-    DirectX::XMFLOAT4X4 mRotation;
-    DirectX::XMFLOAT4X4 mMatrix;
+    Float4x4 mRotation;
+    Float4x4 mMatrix;
 
 public:
     TRANSFORM();
 
-    DirectX::XMFLOAT3 scale;
+    Float3 scale;
     
-    DirectX::XMFLOAT3 forward;
-    DirectX::XMFLOAT3 right;
-    DirectX::XMFLOAT3 up;
+    Float3 forward;
+    Float3 right;
+    Float3 up;
     
-    DirectX::XMFLOAT4 rotation;
+    Float4 rotation;
 
-    DirectX::XMFLOAT3 position;
+    Float3 position;
 
     void Identity();
-    void XM_CALLCONV FromMatrix(DirectX::FXMMATRIX pMat);
+    void FromMatrix(const Float4x4& pMat);
     void UpdateMatrix();
-    DirectX::XMMATRIX GetMatrix() const;
+    const Float4x4& GetMatrix() const;
 
-    void XM_CALLCONV SetPosition(DirectX::FXMVECTOR pVec);
+    // True when the transform was modified since the last ClearChanged
+    bool HasChanged() const;
+    void ClearChanged();
+
+    void SetPosition(const Float3& pVec);
 
     void Rotate(float pitch, float yaw, float roll);
     void RotatePitch(float angle);
     void RotateYaw(float angle);
     void RotateRoll(float angle);
 
-    void XM_CALLCONV LookAt(DirectX::FXMVECTOR vector);
+    void LookAt(const Float3& vector);
 };
@@ -1,60 +1,72 @@
 ﻿#pragma once
 
-#include "lib/d3dUtils.h"
+#include <cstdint>
+#include <cstring>
+
+#include "lib/RenderDevice.h"
+#include "lib/StreamingCopy.h"
 
 template<typename T>
 class UploadBuffer
 {
 public:
-    UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer) : 
-        mIsConstantBuffer(isConstantBuffer)
+    UploadBuffer(IRenderDevice& device, std::uint32_t elementCount, bool isConstantBuffer) : 
+        mDevice(device), mIsConstantBuffer(isConstantBuffer)
     {
         mElementByteSize = sizeof(T);
 
         // Constant buffer elements need to be multiples of 256 bytes.
         if(isConstantBuffer)
-            mElementByteSize = d3dUtils::CalcConstantBufferByteSize(sizeof(T));
-
-        CD3DX12_HEAP_PROPERTIES heapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        CD3DX12_RESOURCE_DESC buffer = CD3DX12_RESOURCE_DESC::Buffer(mElementByteSize*elementCount);
-        device->CreateCommittedResource(
-            &heapProp,
-            D3D12_HEAP_FLAG_NONE,
-            &buffer,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&mUploadBuffer));
-
-        mUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData));
-
-        // We do not need to unmap until we are done with the resource.  However, we must not write to
-        // the resource while it is in use by the GPU (so we must use synchronization techniques).
+            mElementByteSize = (sizeof(T) + 255) & ~255;
+
+        BufferDesc desc;
+        desc.SizeInBytes = (std::uint64_t)mElementByteSize*elementCount;
+        desc.Heap = BufferHeap::Upload;
+        mUploadBuffer = device.CreateBuffer(desc);
+
+        // Upload buffers stay mapped.  However, we must not write to the buffer
+        // while it is in use by the GPU (so we must use synchronization techniques).
+        mMappedData = static_cast<std::uint8_t*>(device.Map(mUploadBuffer));
     }
 
     UploadBuffer(const UploadBuffer& rhs) = delete;
     UploadBuffer& operator=(const UploadBuffer& rhs) = delete;
     ~UploadBuffer()
     {
-        if(mUploadBuffer != nullptr)
-            mUploadBuffer->Unmap(0, nullptr);
+        if(mUploadBuffer != InvalidBuffer)
+            mDevice.DestroyBuffer(mUploadBuffer);
 
         mMappedData = nullptr;
     }
 
-    ID3D12Resource* Resource()const
+    BufferHandle Buffer()const
     {
         return mUploadBuffer;
     }
 
+    GpuAddress GetGpuAddress()const
+    {
+        return mDevice.GetGpuAddress(mUploadBuffer);
+    }
+
     void CopyData(int elementIndex, const T& data)
     {
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Copy count consecutive elements with whole line streaming stores, the mapped memory
+    // is write-combined. Call StreamCopyFence once every copy of the frame is done.
+    void CopyData(int firstElement, const T* data, std::uint32_t count)
+    {
+        StreamCopyElements(&mMappedData[firstElement*mElementByteSize], mElementByteSize,
+                           data, sizeof(T), sizeof(T), count);
+    }
+
 private:
-    ID3D12Resource* mUploadBuffer;
-    BYTE* mMappedData = nullptr;
+    IRenderDevice& mDevice;
+    BufferHandle mUploadBuffer = InvalidBuffer;
+    std::uint8_t* mMappedData = nullptr;
 
-    UINT mElementByteSize = 0;
+    std::uint32_t mElementByteSize = 0;
     bool mIsConstantBuffer = false;
 };
@@ -0,0 +1,279 @@
+﻿#include "BarrierSimulation.h"
+
+#include <random>
+#include <sstream>
+
+#include "ResourceStateTracker.h"
+
+namespace
+{
+    // D3D12_RESOURCE_STATES values
+    const ResourceState StateCommon = 0;
+    const ResourceState StateVertexBuffer = 0x1;
+    const ResourceState StateRenderTarget = 0x4;
+    const ResourceState StateUnorderedAccess = 0x8;
+    const ResourceState StatePixelShaderResource = 0x80;
+    const ResourceState StateCopyDest = 0x400;
+    const ResourceState StateCopySource = 0x800;
+    const ResourceState StateGenericRead = 0xAC3;
+
+    const ResourceState UsedStates[] = { StateVertexBuffer, StateRenderTarget, StateUnorderedAccess,
+                                         StatePixelShaderResource, StateCopyDest, StateCopySource, StateGenericRead };
+
+    void* ToResource(std::uint32_t index)
+    {
+        return (void*)(uintptr_t)(index + 1);
+    }
+
+    std::string Describe(std::uint32_t list, std::uint32_t command, const char* what, std::uint32_t resource)
+    {
+        std::ostringstream message;
+        message << "List " << list << ", command " << command << ": " << what << " (resource " << resource << ")";
+        return message.str();
+    }
+
+    // One out of order list: transitions, split barriers and marked uses
+    void RecordList(ResourceStateTracker& tracker, RecordingCommandList& list, std::mt19937& random, std::uint32_t resources)
+    {
+        std::vector<std::uint32_t> splits;
+        std::vector<ResourceState> splitStates;
+
+        std::uint32_t steps = 8 + random() % 24;
+        for (std::uint32_t step = 0; step < steps; step++)
+        {
+            // A few transitions batched, then their uses
+            std::uint32_t batch = 1 + random() % 4;
+            std::vector<std::uint32_t> used;
+            std::vector<ResourceState> usedStates;
+            for (std::uint32_t b = 0; b < batch; b++)
+            {
+                std::uint32_t resource = random() % resources;
+                ResourceState state = UsedStates[random() % (sizeof(UsedStates) / sizeof(UsedStates[0]))];
+
+                // Resources in a split transition wait for its end
+                bool splitting = false;
+                for (std::uint32_t s : splits) splitting |= s == resource;
+                if (splitting) continue;
+
+                // A split starts on a resource no command of the batch uses
+                bool inBatch = false;
+                for (std::uint32_t u : used) inBatch |= u == resource;
+
+                if (!inBatch && random() % 8 == 0)
+                {
+                    tracker.BeginTransition(ToResource(resource), state);
+                    splits.push_back(resource);
+                    splitStates.push_back(state);
+                    continue;
+                }
+
+                tracker.Transition(ToResource(resource), state);
+                used.push_back(resource);
+                usedStates.push_back(state);
+            }
+
+            // End some split transitions
+            for (size_t s = 0; s < splits.size(); )
+            {
+                if (random() % 2 == 0) { s++; continue; }
+
+                tracker.Transition(ToResource(splits[s]), splitStates[s]);
+                used.push_back(splits[s]);
+                usedStates.push_back(splitStates[s]);
+                splits.erase(splits.begin() + s);
+                splitStates.erase(splitStates.begin() + s);
+            }
+
+            tracker.FlushBarriers(list);
+
+            // A resource transitioned twice in the batch is used in its last state
+            for (size_t u = 0; u < used.size(); u++)
+            {
+                bool later = false;
+                for (size_t v = u + 1; v < used.size(); v++) later |= used[v] == used[u];
+                if (!later)
+                    list.SetGraphicsRoot32BitConstant(ResourceUseMarkerParameter, (std::uint32_t)(uintptr_t)ToResource(used[u]), usedStates[u]);
+            }
+        }
+
+        // Split barriers end in their list
+        for (size_t s = 0; s < splits.size(); s++)
+            tracker.Transition(ToResource(splits[s]), splitStates[s]);
+        tracker.FlushBarriers(list);
+    }
+}
+
+bool ValidateResourceBarriers(const std::vector<const RecordingCommandList*>& lists,
+                              std::unordered_map<std::uint32_t, ResourceState> states, std::string* error)
+{
+    for (std::uint32_t l = 0; l < (std::uint32_t)lists.size(); l++)
+    {
+        const std::vector<std::uint8_t>& stream = lists[l]->GetStream();
+        std::unordered_map<std::uint32_t, ResourceState> splits;
+
+        size_t offset = 0;
+        CommandType type;
+        const std::uint8_t* payload = nullptr;
+        for (std::uint32_t command = 0; offset < stream.size(); command++)
+        {
+            if (!RecordingCommandList::ReadCommand(stream, offset, type, payload))
+            {
+                if (error) *error = Describe(l, command, "unreadable command", 0);
+                return false;
+            }
+
+            if (type == CommandType::SetGraphicsRoot32BitConstant)
+            {
+                std::uint32_t parameter, resource, state;
+                memcpy(&parameter, payload, 4);
+                memcpy(&resource, payload + 4, 4);
+                memcpy(&state, payload + 8, 4);
+                if (parameter != ResourceUseMarkerParameter) continue;
+
+                auto current = states.find(resource);
+                if (current == states.end() || splits.count(resource) != 0 || !ResourceStateContains(current->second, state))
+                {
+                    if (error) *error = Describe(l, command, "used in the wrong state", resource);
+                    return false;
+                }
+                continue;
+            }
+
+            if (type != CommandType::ResourceBarrier) continue;
+
+            std::uint32_t count = RecordingCommandList::ReadBarrierCount(payload);
+            for (std::uint32_t b = 0; b < count; b++)
+            {
+                ResourceBarrierDesc barrier = RecordingCommandList::ReadBarrier(payload, b);
+                std::uint32_t resource = (std::uint32_t)(uintptr_t)barrier.Resource;
+
+                // Memory only, the resource keeps its state
+                if (barrier.Type == BarrierType::Aliasing)
+                {
+                    if (states.find(resource) == states.end())
+                    {
+                        if (error) *error = Describe(l, command, "aliasing barrier of an unknown resource", resource);
+                        return false;
+                    }
+                    continue;
+                }
+
+                auto current = states.find(resource);
+                if (current == states.end() || current->second != barrier.StateBefore)
+                {
+                    if (error) *error = Describe(l, command, "barrier from a state the resource is not in", resource);
+                    return false;
+                }
+
+                auto split = splits.find(resource);
+                if (barrier.Flags == BarrierFlags::BeginOnly)
+                {
+                    if (split != splits.end())
+                    {
+                        if (error) *error = Describe(l, command, "split barrier started twice", resource);
+                        return false;
+                    }
+                    splits[resource] = barrier.StateAfter;
+                }
+                else if (barrier.Flags == BarrierFlags::EndOnly)
+                {
+                    if (split == splits.end() || split->second != barrier.StateAfter)
+                    {
+                        if (error) *error = Describe(l, command, "split barrier ended without its begin", resource);
+                        return false;
+                    }
+                    splits.erase(split);
+                    current->second = barrier.StateAfter;
+                }
+                else
+                {
+                    if (split != splits.end())
+                    {
+                        if (error) *error = Describe(l, command, "barrier during a split barrier", resource);
+                        return false;
+                    }
+                    current->second = barrier.StateAfter;
+                }
+            }
+        }
+
+        if (!splits.empty())
+        {
+            if (error) *error = Describe(l, (std::uint32_t)-1, "split barrier not ended in its list", splits.begin()->first);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BarrierSimulationResult SimulateResourceBarriers(std::uint32_t frames, std::uint32_t workerLists,
+                                                 std::uint32_t resources, std::uint32_t seed)
+{
+    BarrierSimulationResult result;
+    result.Frames = frames;
+
+    std::mt19937 random(seed);
+    ResourceStateRegistry registry;
+    std::unordered_map<std::uint32_t, ResourceState> initialStates;
+    for (std::uint32_t r = 0; r < resources; r++)
+    {
+        registry.Register(ToResource(r), StateCommon);
+        initialStates[(std::uint32_t)(uintptr_t)ToResource(r)] = StateCommon;
+    }
+
+    // Lists of every frame in submission order: in order list, then resolve list and worker list pairs
+    std::vector<RecordingCommandList> lists((1 + 2 * workerLists) * frames);
+    std::vector<ResourceStateTracker> workers(workerLists);
+    ResourceStateTracker inOrder;
+    std::vector<ResourceBarrierDesc> resolved;
+
+    size_t next = 0;
+    for (std::uint32_t frame = 0; frame < frames; frame++)
+    {
+        // Workers first, like the renderer records them in parallel
+        for (std::uint32_t w = 0; w < workerLists; w++)
+        {
+            workers[w].Reset();
+            RecordList(workers[w], lists[next + 2 + 2 * w], random, resources);
+        }
+
+        // The in order list knows every state, it only updates the registry
+        inOrder.Reset(&registry);
+        RecordList(inOrder, lists[next], random, resources);
+        resolved.clear();
+        inOrder.Resolve(registry, resolved);
+
+        result.Transitions += inOrder.GetStats().Transitions;
+        result.Barriers += inOrder.GetStats().Barriers;
+        result.BarrierCalls += inOrder.GetStats().BarrierCalls;
+        result.SplitBarriers += inOrder.GetStats().SplitBarriers;
+
+        for (std::uint32_t w = 0; w < workerLists; w++)
+        {
+            resolved.clear();
+            workers[w].Resolve(registry, resolved);
+            if (!resolved.empty())
+            {
+                lists[next + 1 + 2 * w].ResourceBarrier((std::uint32_t)resolved.size(), resolved.data());
+                result.BarrierCalls++;
+            }
+
+            const ResourceStateStats& stats = workers[w].GetStats();
+            result.Transitions += stats.Transitions;
+            result.Barriers += stats.Barriers + stats.ResolvedBarriers;
+            result.BarrierCalls += stats.BarrierCalls;
+            result.SplitBarriers += stats.SplitBarriers;
+            result.ResolvedBarriers += stats.ResolvedBarriers;
+        }
+
+        next += 1 + 2 * workerLists;
+    }
+
+    std::vector<const RecordingCommandList*> ordered;
+    for (const RecordingCommandList& list : lists)
+        ordered.push_back(&list);
+
+    result.Valid = ValidateResourceBarriers(ordered, initialStates, &result.Error);
+    return result;
+}
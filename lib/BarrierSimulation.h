@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "RecordingCommandList.h"
+
+// Root parameter no real list uses. In a validated stream, SetGraphicsRoot32BitConstant on it
+// marks a use of resource srcData in state destOffsetIn32BitValues.
+const std::uint32_t ResourceUseMarkerParameter = 0xFFFFFFFF;
+
+// Replay the barriers of lists in submission order from the initial states: every barrier must
+// start from the state the resource is in, split barriers must end in their list, every marked
+// use must find the resource in a state including the one it needs.
+// Resources are named by the uint32 value of their handle.
+bool ValidateResourceBarriers(const std::vector<const RecordingCommandList*>& lists,
+                              std::unordered_map<std::uint32_t, ResourceState> states, std::string* error);
+
+struct BarrierSimulationResult
+{
+    std::uint32_t Frames = 0;
+    std::uint32_t Transitions = 0;
+    std::uint32_t Barriers = 0;
+    std::uint32_t BarrierCalls = 0; // Without batching there would be one call per barrier
+    std::uint32_t SplitBarriers = 0;
+    std::uint32_t ResolvedBarriers = 0;
+    bool Valid = false;
+    std::string Error;
+};
+
+// Frames of one in order list followed by workerLists lists recorded out of order, each moving
+// random resources through render target, shader resource, copy and UAV states with a few split
+// barriers, then resolved and validated.
+BarrierSimulationResult SimulateResourceBarriers(std::uint32_t frames, std::uint32_t workerLists,
+                                                 std::uint32_t resources, std::uint32_t seed);
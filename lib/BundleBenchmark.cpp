@@ -0,0 +1,368 @@
+﻿#include "BundleBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "BundleCache.h"
+#include "CommandRecorder.h"
+#include "RecordingCommandList.h"
+
+namespace
+{
+    const std::uint32_t MeshCount = 64;
+    const std::uint32_t PipelineCount = 4;
+    const std::uint32_t ConstantsParameter = 0;
+    const std::uint32_t PassParameter = 1;
+    const std::uint32_t TriangleList = 4; // D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+    void* const RootSignature = (void*)0x100;
+    const GpuAddress PassConstants = 0x30000000;
+
+    // Bundles recorded in host memory, nothing executes them so a released one is reused at once
+    class RecordingBundleAllocator : public IBundleAllocator
+    {
+    public:
+        ICommandList& BeginBundle(void* initialPipelineState) override
+        {
+            if (mFree.empty())
+            {
+                mLists.emplace_back(new RecordingCommandList());
+                mFree.push_back(mLists.back().get());
+            }
+
+            mCurrent = mFree.back();
+            mFree.pop_back();
+            mCurrent->Reset();
+            InitialStates[mCurrent] = initialPipelineState;
+            return *mCurrent;
+        }
+
+        void* EndBundle() override
+        {
+            return mCurrent;
+        }
+
+        void ReleaseBundle(void* bundle) override
+        {
+            InitialStates.erase(bundle);
+            mFree.push_back(static_cast<RecordingCommandList*>(bundle));
+        }
+
+        // Live bundles and the pipeline they start with
+        std::unordered_map<void*, void*> InitialStates;
+
+    private:
+        std::vector<std::unique_ptr<RecordingCommandList>> mLists;
+        std::vector<RecordingCommandList*> mFree;
+        RecordingCommandList* mCurrent = nullptr;
+    };
+
+    BundleDraw MakeDraw(std::uint32_t mesh, std::uint32_t pipeline, std::uint32_t index)
+    {
+        BundleDraw draw;
+        draw.PipelineState = (void*)(uintptr_t)(0x1000 + pipeline * 0x10);
+        draw.VertexBuffer.BufferLocation = 0x10000000ull + (GpuAddress)mesh * 0x100000;
+        draw.VertexBuffer.SizeInBytes = 0x80000;
+        draw.VertexBuffer.StrideInBytes = 28;
+        draw.IndexBuffer.BufferLocation = draw.VertexBuffer.BufferLocation + 0x80000;
+        draw.IndexBuffer.SizeInBytes = 0x10000;
+        draw.IndexBuffer.Format = 57; // DXGI_FORMAT_R16_UINT
+        draw.Constants = 0x20000000ull + (GpuAddress)index * 256;
+        draw.Topology = TriangleList;
+        draw.IndexCount = 36 + 6 * (mesh % 8);
+        draw.StartIndexLocation = 0;
+        draw.BaseVertexLocation = 0;
+        return draw;
+    }
+
+    void RecordDraws(CommandRecorder& recorder, const std::vector<BundleDraw>& draws, size_t begin, size_t end)
+    {
+        for (size_t d = begin; d < end; d++)
+        {
+            const BundleDraw& draw = draws[d];
+            recorder.SetPipelineState(draw.PipelineState);
+            recorder.IASetPrimitiveTopology(draw.Topology);
+            recorder.IASetVertexBuffers(0, 1, &draw.VertexBuffer);
+            recorder.IASetIndexBuffer(&draw.IndexBuffer);
+            recorder.SetGraphicsRootConstantBufferView(ConstantsParameter, draw.Constants);
+            recorder.DrawIndexedInstanced(draw.IndexCount, 1, draw.StartIndexLocation, draw.BaseVertexLocation, 0);
+        }
+    }
+
+    // State the draws of a replay see
+    struct ReplayState
+    {
+        std::uint64_t PipelineState = 0;
+        std::uint64_t RootSignature = 0;
+        bool TopologyValid = false;
+        std::uint32_t Topology = 0;
+        bool VertexBufferValid = false;
+        VertexBufferBinding VertexBuffer;
+        bool IndexBufferValid = false;
+        IndexBufferBinding IndexBuffer;
+        GpuAddress Constants = 0;
+        GpuAddress Pass = 0;
+    };
+
+    struct ReplayedDraw
+    {
+        BundleDraw Draw;
+        GpuAddress Pass = 0;
+
+        bool operator==(const ReplayedDraw& other) const
+        {
+            return memcmp(&Draw, &other.Draw, sizeof(BundleDraw)) == 0 && Pass == other.Pass;
+        }
+    };
+
+    template<typename T>
+    T Read(const std::uint8_t* data)
+    {
+        T value;
+        memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    // A bundle starts with its initial pipeline and no input assembler state, it inherits the
+    // root arguments and leaves what it binds to the list executing it
+    bool Replay(const std::vector<std::uint8_t>& stream, ReplayState& state, bool isBundle,
+                const RecordingBundleAllocator& bundles, std::vector<ReplayedDraw>& draws, std::string* error)
+    {
+        size_t offset = 0;
+        CommandType type;
+        const std::uint8_t* payload = nullptr;
+        while (offset < stream.size())
+        {
+            if (!RecordingCommandList::ReadCommand(stream, offset, type, payload))
+            {
+                if (error) *error = "unreadable command";
+                return false;
+            }
+
+            switch (type)
+            {
+            case CommandType::SetPipelineState:
+                state.PipelineState = Read<std::uint64_t>(payload);
+                break;
+            case CommandType::SetGraphicsRootSignature:
+            {
+                std::uint64_t rootSignature = Read<std::uint64_t>(payload);
+                if (isBundle && rootSignature != state.RootSignature)
+                {
+                    if (error) *error = "bundle root signature differs from the executing list";
+                    return false;
+                }
+                state.RootSignature = rootSignature;
+                break;
+            }
+            case CommandType::IASetPrimitiveTopology:
+                state.TopologyValid = true;
+                state.Topology = Read<std::uint32_t>(payload);
+                break;
+            case CommandType::IASetVertexBuffers:
+                state.VertexBufferValid = true;
+                state.VertexBuffer = Read<VertexBufferBinding>(payload + 8);
+                break;
+            case CommandType::IASetIndexBuffer:
+                state.IndexBufferValid = true;
+                state.IndexBuffer = Read<IndexBufferBinding>(payload);
+                break;
+            case CommandType::SetGraphicsRootConstantBufferView:
+                if (Read<std::uint32_t>(payload) == ConstantsParameter)
+                    state.Constants = Read<GpuAddress>(payload + 4);
+                else if (Read<std::uint32_t>(payload) == PassParameter)
+                    state.Pass = Read<GpuAddress>(payload + 4);
+                break;
+            case CommandType::DrawIndexedInstanced:
+            {
+                if (!state.TopologyValid || !state.VertexBufferValid || !state.IndexBufferValid || state.RootSignature == 0)
+                {
+                    if (error) *error = "draw with unbound state";
+                    return false;
+                }
+
+                ReplayedDraw replayed;
+                replayed.Draw.PipelineState = (void*)(uintptr_t)state.PipelineState;
+                replayed.Draw.VertexBuffer = state.VertexBuffer;
+                replayed.Draw.IndexBuffer = state.IndexBuffer;
+                replayed.Draw.Constants = state.Constants;
+                replayed.Draw.Topology = state.Topology;
+                replayed.Draw.IndexCount = Read<std::uint32_t>(payload);
+                replayed.Draw.StartIndexLocation = Read<std::uint32_t>(payload + 8);
+                replayed.Draw.BaseVertexLocation = Read<std::int32_t>(payload + 12);
+                replayed.Pass = state.Pass;
+                draws.push_back(replayed);
+                break;
+            }
+            case CommandType::ExecuteBundle:
+            {
+                void* handle = (void*)(uintptr_t)Read<std::uint64_t>(payload);
+                auto bundle = bundles.InitialStates.find(handle);
+                if (isBundle || bundle == bundles.InitialStates.end())
+                {
+                    if (error) *error = isBundle ? "bundle executing a bundle" : "unknown bundle";
+                    return false;
+                }
+
+                state.PipelineState = (std::uint64_t)(uintptr_t)bundle->second;
+                state.TopologyValid = false;
+                state.VertexBufferValid = false;
+                state.IndexBufferValid = false;
+                if (!Replay(static_cast<RecordingCommandList*>(handle)->GetStream(), state, true, bundles, draws, error))
+                    return false;
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        return true;
+    }
+
+    double Elapsed(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+BundleBenchmarkResult RunBundleBenchmark(std::uint32_t drawCount, std::uint32_t staticPercent, std::uint32_t drawsPerBundle,
+                                         std::uint32_t iterations, std::uint32_t seed)
+{
+    BundleBenchmarkResult result;
+    result.Iterations = iterations;
+    result.Draws = drawCount;
+    drawsPerBundle = std::max(1u, drawsPerBundle);
+
+    // Static and dynamic draws are each sorted by pipeline then mesh, as the draw queue would
+    std::mt19937 random(seed);
+    std::vector<BundleDraw> staticDraws;
+    std::vector<BundleDraw> dynamicDraws;
+    for (std::uint32_t i = 0; i < drawCount; i++)
+    {
+        BundleDraw draw = MakeDraw(random() % MeshCount, random() % PipelineCount, i);
+        if (random() % 100 < staticPercent)
+            staticDraws.push_back(draw);
+        else
+            dynamicDraws.push_back(draw);
+    }
+
+    auto byState = [](const BundleDraw& a, const BundleDraw& b)
+    {
+        if (a.PipelineState != b.PipelineState) return a.PipelineState < b.PipelineState;
+        return a.VertexBuffer.BufferLocation < b.VertexBuffer.BufferLocation;
+    };
+    std::stable_sort(staticDraws.begin(), staticDraws.end(), byState);
+    std::stable_sort(dynamicDraws.begin(), dynamicDraws.end(), byState);
+    result.StaticDraws = (std::uint32_t)staticDraws.size();
+
+    std::vector<BundleBatch> batches;
+    for (std::uint32_t first = 0; first < (std::uint32_t)staticDraws.size(); first += drawsPerBundle)
+    {
+        BundleBatch batch;
+        batch.Draws = &staticDraws[first];
+        batch.DrawCount = std::min(drawsPerBundle, (std::uint32_t)staticDraws.size() - first);
+        batches.push_back(batch);
+    }
+
+    RecordingBundleAllocator allocator;
+    BundleCache cache;
+    cache.Initialize(RootSignature, ConstantsParameter);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    cache.Update(batches.data(), (std::uint32_t)batches.size(), allocator);
+    result.BuildMs = Elapsed(start);
+    result.Bundles = cache.GetStats().Bundles;
+
+    // The bundles run between two halves of the dynamic draws, the draws after them must bind their state again
+    size_t split = dynamicDraws.size() / 2;
+    RecordingCommandList allList;
+    RecordingCommandList bundleList;
+    CommandRecorder recorder;
+    for (std::uint32_t i = 0; i < iterations; i++)
+    {
+        // Every draw recorded, as DrawRenderItems does
+        start = std::chrono::high_resolution_clock::now();
+        allList.Reset();
+        recorder.SetTarget(&allList);
+        recorder.Reset();
+        recorder.SetGraphicsRootSignature(RootSignature);
+        recorder.SetGraphicsRootConstantBufferView(PassParameter, PassConstants);
+        RecordDraws(recorder, dynamicDraws, 0, split);
+        RecordDraws(recorder, staticDraws, 0, staticDraws.size());
+        RecordDraws(recorder, dynamicDraws, split, dynamicDraws.size());
+        result.RecordAllMs += Elapsed(start);
+
+        // The static draws replayed from their bundles
+        start = std::chrono::high_resolution_clock::now();
+        bundleList.Reset();
+        recorder.SetTarget(&bundleList);
+        recorder.Reset();
+        recorder.SetGraphicsRootSignature(RootSignature);
+        recorder.SetGraphicsRootConstantBufferView(PassParameter, PassConstants);
+        RecordDraws(recorder, dynamicDraws, 0, split);
+        for (std::uint32_t b = 0; b < cache.GetBundleCount(); b++)
+            recorder.ExecuteBundle(cache.GetBundle(b));
+        RecordDraws(recorder, dynamicDraws, split, dynamicDraws.size());
+        result.RecordBundlesMs += Elapsed(start);
+    }
+
+    if (iterations > 0)
+    {
+        result.RecordAllMs /= iterations;
+        result.RecordBundlesMs /= iterations;
+    }
+    result.CommandsAll = allList.GetCommandCount();
+    result.CommandsBundles = bundleList.GetCommandCount();
+
+    std::vector<ReplayedDraw> expected;
+    std::vector<ReplayedDraw> replayed;
+    ReplayState state;
+    result.Valid = Replay(allList.GetStream(), state, false, allocator, expected, &result.Error);
+    state = ReplayState();
+    result.Valid = result.Valid && Replay(bundleList.GetStream(), state, false, allocator, replayed, &result.Error);
+    if (result.Valid && (expected.size() != drawCount || !(expected == replayed)))
+    {
+        result.Valid = false;
+        result.Error = "bundled frame draws differ from the recorded frame";
+    }
+
+    start = std::chrono::high_resolution_clock::now();
+    cache.Update(batches.data(), (std::uint32_t)batches.size(), allocator);
+    result.UnchangedUpdateMs = Elapsed(start);
+    if (result.Valid && cache.GetStats().Recorded != 0)
+    {
+        result.Valid = false;
+        result.Error = "bundles recorded again without any change";
+    }
+
+    // One static draw moves to another mesh, only its bundle is recorded again
+    if (!staticDraws.empty())
+    {
+        BundleDraw& changed = staticDraws[staticDraws.size() / 2];
+        changed = MakeDraw((std::uint32_t)((changed.VertexBuffer.BufferLocation - 0x10000000ull) / 0x100000 + 1) % MeshCount,
+                           (std::uint32_t)(((uintptr_t)changed.PipelineState - 0x1000) / 0x10),
+                           (std::uint32_t)((changed.Constants - 0x20000000ull) / 256));
+    }
+
+    start = std::chrono::high_resolution_clock::now();
+    cache.Update(batches.data(), (std::uint32_t)batches.size(), allocator);
+    result.ChangedUpdateMs = Elapsed(start);
+    result.ChangedRecorded = cache.GetStats().Recorded;
+    if (result.Valid && !staticDraws.empty() && result.ChangedRecorded != 1)
+    {
+        result.Valid = false;
+        result.Error = "a changed draw did not record exactly its own bundle";
+    }
+
+    cache.Clear(allocator);
+    if (result.Valid && !allocator.InitialStates.empty())
+    {
+        result.Valid = false;
+        result.Error = "bundles left after Clear";
+    }
+    return result;
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct BundleBenchmarkResult
+{
+    std::uint32_t Iterations = 0;
+    std::uint32_t Draws = 0;
+    std::uint32_t StaticDraws = 0;
+    std::uint32_t Bundles = 0;
+
+    // Average recording time of a frame
+    double RecordAllMs = 0.0; // Every draw recorded
+    double RecordBundlesMs = 0.0; // Dynamic draws recorded, one ExecuteBundle per static bundle
+    std::uint32_t CommandsAll = 0; // Commands reaching the list in a frame
+    std::uint32_t CommandsBundles = 0;
+
+    double BuildMs = 0.0; // First Update, every bundle recorded
+    double UnchangedUpdateMs = 0.0; // Update with the same draws, only hashed
+    double ChangedUpdateMs = 0.0; // Update after one static draw changed mesh
+    std::uint32_t ChangedRecorded = 0; // Bundles recorded by that Update
+
+    // Both frames replayed, bundles expanded with their own state, give the same draws
+    bool Valid = false;
+    std::string Error;
+};
+
+// drawCount draws over a few meshes and pipelines, staticPercent of them static and put in bundles
+// of drawsPerBundle draws. Same seed same scene.
+BundleBenchmarkResult RunBundleBenchmark(std::uint32_t drawCount, std::uint32_t staticPercent, std::uint32_t drawsPerBundle,
+                                         std::uint32_t iterations, std::uint32_t seed);
@@ -0,0 +1,115 @@
+﻿#include "BundleCache.h"
+
+#include <chrono>
+
+#include "Hash.h"
+
+static_assert(sizeof(BundleDraw) == 8 + 16 + 16 + 8 + 16, "BundleDraw is hashed as raw bytes, it must not have padding");
+
+BundleCache::BundleCache()
+{
+}
+
+void BundleCache::Initialize(void* rootSignature, std::uint32_t constantsParameter)
+{
+    mRootSignature = rootSignature;
+    mConstantsParameter = constantsParameter;
+}
+
+std::uint64_t BundleCache::HashBatch(const BundleBatch& batch) const
+{
+    // The root signature and parameter are recorded in the bundle too
+    std::uint64_t hash = HashBytes(&mRootSignature, sizeof(mRootSignature));
+    hash = HashBytes(&mConstantsParameter, sizeof(mConstantsParameter), hash);
+    return HashBytes(batch.Draws, (size_t)batch.DrawCount * sizeof(BundleDraw), hash);
+}
+
+void BundleCache::Record(const BundleBatch& batch, IBundleAllocator& allocator, Bundle& bundle)
+{
+    if (bundle.Handle != nullptr)
+        allocator.ReleaseBundle(bundle.Handle);
+    bundle.Handle = nullptr;
+    bundle.DrawCount = batch.DrawCount;
+    if (batch.DrawCount == 0) return;
+
+    ICommandList& commandList = allocator.BeginBundle(batch.Draws[0].PipelineState);
+    mRecorder.SetTarget(&commandList);
+    mRecorder.Reset(batch.Draws[0].PipelineState);
+
+    // A bundle setting root arguments must set the root signature of the list executing it
+    mRecorder.SetGraphicsRootSignature(mRootSignature);
+    for (std::uint32_t d = 0; d < batch.DrawCount; d++)
+    {
+        const BundleDraw& draw = batch.Draws[d];
+        mRecorder.SetPipelineState(draw.PipelineState);
+        mRecorder.IASetPrimitiveTopology(draw.Topology);
+        mRecorder.IASetVertexBuffers(0, 1, &draw.VertexBuffer);
+        mRecorder.IASetIndexBuffer(&draw.IndexBuffer);
+        mRecorder.SetGraphicsRootConstantBufferView(mConstantsParameter, draw.Constants);
+        mRecorder.DrawIndexedInstanced(draw.IndexCount, 1, draw.StartIndexLocation, draw.BaseVertexLocation, 0);
+    }
+
+    bundle.Handle = allocator.EndBundle();
+}
+
+void BundleCache::Update(const BundleBatch* batches, std::uint32_t count, IBundleAllocator& allocator)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (std::uint32_t b = count; b < (std::uint32_t)mBundles.size(); b++)
+    {
+        if (mBundles[b].Handle != nullptr)
+            allocator.ReleaseBundle(mBundles[b].Handle);
+    }
+    mBundles.resize(count);
+
+    mStats.Bundles = 0;
+    mStats.Draws = 0;
+    mStats.Recorded = 0;
+    mStats.Kept = 0;
+    for (std::uint32_t b = 0; b < count; b++)
+    {
+        Bundle& bundle = mBundles[b];
+        std::uint64_t hash = HashBatch(batches[b]);
+        if (bundle.Handle != nullptr && bundle.Hash == hash && bundle.DrawCount == batches[b].DrawCount)
+        {
+            mStats.Kept++;
+        }
+        else
+        {
+            Record(batches[b], allocator, bundle);
+            bundle.Hash = hash;
+            if (bundle.Handle != nullptr)
+                mStats.Recorded++;
+        }
+
+        if (bundle.Handle != nullptr)
+        {
+            mStats.Bundles++;
+            mStats.Draws += bundle.DrawCount;
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    mStats.UpdateTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void BundleCache::Clear(IBundleAllocator& allocator)
+{
+    Update(nullptr, 0, allocator);
+}
+
+std::uint32_t BundleCache::GetBundleCount() const
+{
+    return (std::uint32_t)mBundles.size();
+}
+
+void* BundleCache::GetBundle(std::uint32_t index) const
+{
+    return mBundles[index].Handle;
+}
+
+const BundleCacheStats& BundleCache::GetStats() const
+{
+    return mStats;
+}
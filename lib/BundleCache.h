@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "CommandList.h"
+#include "CommandRecorder.h"
+
+// Everything the commands recorded for a draw depend on.
+// Members are laid out without padding, a batch is hashed as raw bytes.
+struct BundleDraw
+{
+    void* PipelineState = nullptr;
+    VertexBufferBinding VertexBuffer;
+    IndexBufferBinding IndexBuffer;
+    GpuAddress Constants = 0; // Root CBV of the draw
+    std::uint32_t Topology = 0; // D3D_PRIMITIVE_TOPOLOGY
+    std::uint32_t IndexCount = 0;
+    std::uint32_t StartIndexLocation = 0;
+    std::int32_t BaseVertexLocation = 0;
+};
+
+// Draws recorded in one bundle, executed or skipped together
+struct BundleBatch
+{
+    const BundleDraw* Draws = nullptr;
+    std::uint32_t DrawCount = 0;
+};
+
+struct BundleCacheStats
+{
+    std::uint32_t Bundles = 0;
+    std::uint32_t Draws = 0;
+    std::uint32_t Recorded = 0; // Bundles recorded by the last Update
+    std::uint32_t Kept = 0; // Bundles the last Update found unchanged
+    float UpdateTimeMs = 0.0f; // Hashing and recording of the last Update
+};
+
+// Creates the bundles and keeps them alive while submitted work can execute them
+class IBundleAllocator
+{
+public:
+    virtual ~IBundleAllocator() {}
+
+    // List to record the next bundle in, it starts with initialPipelineState bound
+    virtual ICommandList& BeginBundle(void* initialPipelineState) = 0;
+    // Close the bundle, the handle is what ICommandList::ExecuteBundle takes
+    virtual void* EndBundle() = 0;
+    // The bundle may still be used by work already submitted
+    virtual void ReleaseBundle(void* bundle) = 0;
+};
+
+// Bundles of draws that are the same every frame, one per batch.
+// Update hashes the draws of every batch and only records the bundle of a batch again when its
+// hash changed, so a batch whose membership, meshes and pipelines are the same keeps its bundle.
+// A bundle sets the root signature and the constants root CBV of each draw, the other root
+// parameters are inherited from the list executing it.
+class BundleCache
+{
+public:
+    BundleCache();
+
+    BundleCache(const BundleCache& rhs) = delete;
+    BundleCache& operator=(const BundleCache& rhs) = delete;
+
+    void Initialize(void* rootSignature, std::uint32_t constantsParameter);
+
+    // Batch i is bundle i, the bundles past count are released
+    void Update(const BundleBatch* batches, std::uint32_t count, IBundleAllocator& allocator);
+    void Clear(IBundleAllocator& allocator);
+
+    std::uint32_t GetBundleCount() const;
+    void* GetBundle(std::uint32_t index) const; // nullptr for an empty batch
+    const BundleCacheStats& GetStats() const;
+
+private:
+    struct Bundle
+    {
+        std::uint64_t Hash = 0;
+        std::uint32_t DrawCount = 0;
+        void* Handle = nullptr;
+    };
+
+    std::uint64_t HashBatch(const BundleBatch& batch) const;
+    void Record(const BundleBatch& batch, IBundleAllocator& allocator, Bundle& bundle);
+
+    void* mRootSignature = nullptr;
+    std::uint32_t mConstantsParameter = 0;
+    std::vector<Bundle> mBundles;
+    CommandRecorder mRecorder; // Drops the state a draw shares with the previous one in the bundle
+    BundleCacheStats mStats;
+};
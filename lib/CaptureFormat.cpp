@@ -0,0 +1,15 @@
+﻿#include "CaptureFormat.h"
+
+const char* GetCaptureRecordName(CaptureRecordType type)
+{
+    switch (type)
+    {
+    case CaptureRecordType::CreateBuffer: return "CreateBuffer";
+    case CaptureRecordType::DestroyBuffer: return "DestroyBuffer";
+    case CaptureRecordType::UploadBuffer: return "UploadBuffer";
+    case CaptureRecordType::WriteMapped: return "WriteMapped";
+    case CaptureRecordType::ExecuteCommandLists: return "ExecuteCommandLists";
+    case CaptureRecordType::EndFrame: return "EndFrame";
+    default: return "Unknown";
+    }
+}
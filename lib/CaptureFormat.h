@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <cstdint>
+
+// Layout of a capture file, read in place from a mapping.
+// The header is followed by records, each a CaptureRecord then Size bytes of payload padded to
+// 8 bytes, so every record and every payload struct below is 8 bytes aligned in the file.
+// Records before FramesOffset set up the frames and are replayed once, the frames are looped.
+
+const std::uint32_t CaptureMagic = 0x50414358; // "XCAP"
+const std::uint32_t CaptureVersion = 1;
+
+enum class CaptureRecordType : std::uint32_t
+{
+    CreateBuffer, // CaptureBufferRecord
+    DestroyBuffer, // CaptureBufferRecord
+    UploadBuffer, // CaptureWriteRecord then the bytes
+    WriteMapped, // CaptureWriteRecord then the bytes the CPU wrote in an upload buffer
+    ExecuteCommandLists, // CaptureExecuteRecord then for each list a 64 bits size and its padded stream
+    EndFrame, // No payload
+    Count
+};
+
+const char* GetCaptureRecordName(CaptureRecordType type);
+
+struct CaptureHeader
+{
+    std::uint32_t Magic = CaptureMagic;
+    std::uint32_t Version = CaptureVersion;
+    std::uint32_t RecordCount = 0;
+    std::uint32_t FrameCount = 0;
+    std::uint64_t FramesOffset = 0; // First record of the first frame
+    std::uint64_t Size = 0; // Of the whole file
+};
+
+struct CaptureRecord
+{
+    CaptureRecordType Type = CaptureRecordType::Count;
+    std::uint32_t Size = 0;
+};
+
+// Buffers are named by the handle the capturing device gave them
+struct CaptureBufferRecord
+{
+    std::uint32_t Buffer = 0;
+    std::uint32_t Heap = 0; // BufferHeap
+    std::uint64_t SizeInBytes = 0;
+    std::uint64_t Address = 0; // GPU address at capture, streams refer to it
+};
+
+struct CaptureWriteRecord
+{
+    std::uint32_t Buffer = 0;
+    std::uint32_t Padding = 0;
+    std::uint64_t Offset = 0;
+    std::uint64_t Size = 0;
+};
+
+struct CaptureExecuteRecord
+{
+    std::uint32_t Count = 0;
+    std::uint32_t Padding = 0;
+};
+
+inline std::uint64_t AlignCaptureSize(std::uint64_t size)
+{
+    return (size + 7) & ~7ull;
+}
@@ -0,0 +1,398 @@
+﻿#include "CaptureRenderDevice.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "RecordingCommandList.h"
+
+// Records every command in a stream and forwards it to the list of the target device
+class CaptureRenderDevice::CaptureCommandList : public ICommandList
+{
+public:
+    CaptureCommandList(ICommandList* target) : Target(target)
+    {
+    }
+
+    void SetPipelineState(void* pipelineState) override
+    {
+        Stream.SetPipelineState(pipelineState);
+        Target->SetPipelineState(pipelineState);
+    }
+
+    void SetGraphicsRootSignature(void* rootSignature) override
+    {
+        Stream.SetGraphicsRootSignature(rootSignature);
+        Target->SetGraphicsRootSignature(rootSignature);
+    }
+
+    void IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t numViews, const VertexBufferBinding* views) override
+    {
+        Stream.IASetVertexBuffers(startSlot, numViews, views);
+        Target->IASetVertexBuffers(startSlot, numViews, views);
+    }
+
+    void IASetIndexBuffer(const IndexBufferBinding* view) override
+    {
+        Stream.IASetIndexBuffer(view);
+        Target->IASetIndexBuffer(view);
+    }
+
+    void IASetPrimitiveTopology(std::uint32_t topology) override
+    {
+        Stream.IASetPrimitiveTopology(topology);
+        Target->IASetPrimitiveTopology(topology);
+    }
+
+    void SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation) override
+    {
+        Stream.SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+        Target->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+    }
+
+    void SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation) override
+    {
+        Stream.SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+        Target->SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+    }
+
+    void SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) override
+    {
+        Stream.SetGraphicsRoot32BitConstant(rootParameterIndex, srcData, destOffsetIn32BitValues);
+        Target->SetGraphicsRoot32BitConstant(rootParameterIndex, srcData, destOffsetIn32BitValues);
+    }
+
+    void DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+                              std::uint32_t startIndexLocation, std::int32_t baseVertexLocation,
+                              std::uint32_t startInstanceLocation) override
+    {
+        Stream.DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+        Target->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+    }
+
+    void ExecuteIndirect(void* commandSignature, std::uint32_t maxCommandCount,
+                         void* argumentBuffer, std::uint64_t argumentBufferOffset) override
+    {
+        Stream.ExecuteIndirect(commandSignature, maxCommandCount, argumentBuffer, argumentBufferOffset);
+        Target->ExecuteIndirect(commandSignature, maxCommandCount, argumentBuffer, argumentBufferOffset);
+    }
+
+    void ExecuteBundle(void* bundle) override
+    {
+        Stream.ExecuteBundle(bundle);
+        Target->ExecuteBundle(bundle);
+    }
+
+    void ResourceBarrier(std::uint32_t numBarriers, const ResourceBarrierDesc* barriers) override
+    {
+        Stream.ResourceBarrier(numBarriers, barriers);
+        Target->ResourceBarrier(numBarriers, barriers);
+    }
+
+    void RSSetViewports(std::uint32_t numViewports, const Viewport* viewports) override
+    {
+        Stream.RSSetViewports(numViewports, viewports);
+        Target->RSSetViewports(numViewports, viewports);
+    }
+
+    void RSSetScissorRects(std::uint32_t numRects, const ScissorRect* rects) override
+    {
+        Stream.RSSetScissorRects(numRects, rects);
+        Target->RSSetScissorRects(numRects, rects);
+    }
+
+    void OMSetRenderTargets(std::uint32_t numRenderTargets, const CpuDescriptor* renderTargets, CpuDescriptor depthStencil) override
+    {
+        Stream.OMSetRenderTargets(numRenderTargets, renderTargets, depthStencil);
+        Target->OMSetRenderTargets(numRenderTargets, renderTargets, depthStencil);
+    }
+
+    void SetDescriptorHeaps(std::uint32_t numHeaps, void* const* heaps) override
+    {
+        Stream.SetDescriptorHeaps(numHeaps, heaps);
+        Target->SetDescriptorHeaps(numHeaps, heaps);
+    }
+
+    void ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4]) override
+    {
+        Stream.ClearRenderTargetView(renderTarget, color);
+        Target->ClearRenderTargetView(renderTarget, color);
+    }
+
+    void ClearDepthStencilView(CpuDescriptor depthStencil, ClearFlags flags, float depth, std::uint8_t stencil) override
+    {
+        Stream.ClearDepthStencilView(depthStencil, flags, depth, stencil);
+        Target->ClearDepthStencilView(depthStencil, flags, depth, stencil);
+    }
+
+    ICommandList* Target;
+    RecordingCommandList Stream;
+};
+
+const std::uint64_t CaptureRenderDevice::WriteBlockSize;
+
+CaptureRenderDevice::CaptureRenderDevice(IRenderDevice& target) : mTarget(target)
+{
+}
+
+CaptureRenderDevice::~CaptureRenderDevice()
+{
+}
+
+std::uint8_t* CaptureRenderDevice::AddRecord(CaptureRecordType type, std::uint64_t size)
+{
+    CaptureRecord record;
+    record.Type = type;
+    record.Size = (std::uint32_t)size;
+
+    size_t offset = mRecords.size();
+    mRecords.resize(offset + sizeof(CaptureRecord) + (size_t)AlignCaptureSize(size), 0);
+    memcpy(&mRecords[offset], &record, sizeof(record));
+    mHeader.RecordCount++;
+    return &mRecords[offset + sizeof(CaptureRecord)];
+}
+
+void CaptureRenderDevice::AddWrite(CaptureRecordType type, BufferHandle buffer, std::uint64_t offset, const void* data, std::uint64_t size)
+{
+    CaptureWriteRecord write;
+    write.Buffer = buffer;
+    write.Offset = offset;
+    write.Size = size;
+
+    std::uint8_t* payload = AddRecord(type, sizeof(write) + size);
+    memcpy(payload, &write, sizeof(write));
+    memcpy(payload + sizeof(write), data, (size_t)size);
+}
+
+void CaptureRenderDevice::BeginFrames()
+{
+    mHeader.FramesOffset = sizeof(CaptureHeader) + mRecords.size();
+}
+
+void CaptureRenderDevice::EndFrame()
+{
+    if (mStopped) return;
+
+    AddRecord(CaptureRecordType::EndFrame, 0);
+    mHeader.FrameCount++;
+    mFramesEnd = mRecords.size();
+    mFramesEndRecordCount = mHeader.RecordCount;
+}
+
+void CaptureRenderDevice::Stop()
+{
+    mStopped = true;
+    mMappedBuffers.clear();
+}
+
+std::uint32_t CaptureRenderDevice::GetFrameCount() const
+{
+    return mHeader.FrameCount;
+}
+
+std::uint64_t CaptureRenderDevice::GetSize() const
+{
+    return sizeof(CaptureHeader) + (mHeader.FrameCount > 0 ? mFramesEnd : mRecords.size());
+}
+
+bool CaptureRenderDevice::Save(const std::string& path, std::string* error) const
+{
+    CaptureHeader header = mHeader;
+    header.Size = GetSize();
+    if (header.FrameCount > 0)
+        header.RecordCount = mFramesEndRecordCount;
+    if (header.FramesOffset == 0)
+        header.FramesOffset = header.Size; // Setup only
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(mRecords.data()), (std::streamsize)(header.Size - sizeof(header)));
+    if (!file)
+    {
+        if (error != nullptr) *error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+BufferHandle CaptureRenderDevice::CreateBuffer(const BufferDesc& desc)
+{
+    BufferHandle buffer = mTarget.CreateBuffer(desc);
+    if (buffer == InvalidBuffer || mStopped) return buffer;
+
+    if (buffer >= mBufferDescs.size())
+        mBufferDescs.resize(buffer + 1);
+    mBufferDescs[buffer] = desc;
+
+    CaptureBufferRecord record;
+    record.Buffer = buffer;
+    record.Heap = (std::uint32_t)desc.Heap;
+    record.SizeInBytes = desc.SizeInBytes;
+    record.Address = mTarget.GetGpuAddress(buffer);
+    memcpy(AddRecord(CaptureRecordType::CreateBuffer, sizeof(record)), &record, sizeof(record));
+    return buffer;
+}
+
+void CaptureRenderDevice::DestroyBuffer(BufferHandle buffer)
+{
+    if (buffer == InvalidBuffer) return;
+    if (mStopped)
+    {
+        mTarget.DestroyBuffer(buffer);
+        return;
+    }
+
+    for (size_t m = 0; m < mMappedBuffers.size(); m++)
+    {
+        if (mMappedBuffers[m].Buffer == buffer)
+        {
+            mMappedBuffers.erase(mMappedBuffers.begin() + m);
+            break;
+        }
+    }
+
+    CaptureBufferRecord record;
+    record.Buffer = buffer;
+    memcpy(AddRecord(CaptureRecordType::DestroyBuffer, sizeof(record)), &record, sizeof(record));
+    mTarget.DestroyBuffer(buffer);
+}
+
+void* CaptureRenderDevice::Map(BufferHandle buffer)
+{
+    void* memory = mTarget.Map(buffer);
+    if (memory == nullptr || mStopped) return memory;
+
+    for (const MappedBuffer& mapped : mMappedBuffers)
+    {
+        if (mapped.Buffer == buffer) return memory;
+    }
+
+    // A new buffer starts zeroed, the first submission captures whatever was written since
+    MappedBuffer mapped;
+    mapped.Buffer = buffer;
+    mapped.Memory = static_cast<const std::uint8_t*>(memory);
+    mapped.Captured.assign((size_t)mBufferDescs[buffer].SizeInBytes, 0);
+    mMappedBuffers.push_back(std::move(mapped));
+    return memory;
+}
+
+GpuAddress CaptureRenderDevice::GetGpuAddress(BufferHandle buffer) const
+{
+    return mTarget.GetGpuAddress(buffer);
+}
+
+void* CaptureRenderDevice::GetResource(BufferHandle buffer, std::uint64_t& offset) const
+{
+    return mTarget.GetResource(buffer, offset);
+}
+
+std::uint64_t CaptureRenderDevice::UploadBuffer(BufferHandle buffer, std::uint64_t offset, const void* data, std::uint64_t size)
+{
+    if (!mStopped)
+        AddWrite(CaptureRecordType::UploadBuffer, buffer, offset, data, size);
+    return mTarget.UploadBuffer(buffer, offset, data, size);
+}
+
+std::uint64_t CaptureRenderDevice::GetCompletedUpload()
+{
+    return mTarget.GetCompletedUpload();
+}
+
+void CaptureRenderDevice::WaitForUploads()
+{
+    mTarget.WaitForUploads();
+}
+
+ICommandList* CaptureRenderDevice::CreateCommandList()
+{
+    mCommandLists.emplace_back(new CaptureCommandList(mTarget.CreateCommandList()));
+    return mCommandLists.back().get();
+}
+
+void CaptureRenderDevice::ResetCommandList(ICommandList* commandList)
+{
+    CaptureCommandList* list = static_cast<CaptureCommandList*>(commandList);
+    mTarget.ResetCommandList(list->Target);
+    list->Stream.Reset();
+}
+
+void CaptureRenderDevice::CaptureMappedWrites()
+{
+    // Runs of changed blocks go in one record
+    for (MappedBuffer& mapped : mMappedBuffers)
+    {
+        std::uint64_t size = mapped.Captured.size();
+        std::uint64_t offset = 0;
+        while (offset < size)
+        {
+            std::uint64_t block = std::min(WriteBlockSize, size - offset);
+            if (memcmp(mapped.Memory + offset, &mapped.Captured[(size_t)offset], (size_t)block) == 0)
+            {
+                offset += block;
+                continue;
+            }
+
+            std::uint64_t begin = offset;
+            offset += block;
+            while (offset < size)
+            {
+                block = std::min(WriteBlockSize, size - offset);
+                if (memcmp(mapped.Memory + offset, &mapped.Captured[(size_t)offset], (size_t)block) == 0) break;
+                offset += block;
+            }
+
+            memcpy(&mapped.Captured[(size_t)begin], mapped.Memory + begin, (size_t)(offset - begin));
+            AddWrite(CaptureRecordType::WriteMapped, mapped.Buffer, begin, &mapped.Captured[(size_t)begin], offset - begin);
+        }
+    }
+}
+
+void CaptureRenderDevice::ExecuteCommandLists(std::uint32_t count, ICommandList* const* commandLists)
+{
+    mTargetLists.resize(count);
+    if (mStopped)
+    {
+        for (std::uint32_t i = 0; i < count; i++)
+            mTargetLists[i] = static_cast<CaptureCommandList*>(commandLists[i])->Target;
+        mTarget.ExecuteCommandLists(count, mTargetLists.data());
+        return;
+    }
+
+    // What the CPU wrote is visible to the lists submitted after it
+    CaptureMappedWrites();
+
+    std::uint64_t size = sizeof(CaptureExecuteRecord);
+    for (std::uint32_t i = 0; i < count; i++)
+        size += sizeof(std::uint64_t) + AlignCaptureSize(static_cast<CaptureCommandList*>(commandLists[i])->Stream.GetStream().size());
+
+    CaptureExecuteRecord execute;
+    execute.Count = count;
+    std::uint8_t* payload = AddRecord(CaptureRecordType::ExecuteCommandLists, size);
+    memcpy(payload, &execute, sizeof(execute));
+    payload += sizeof(execute);
+
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        CaptureCommandList* list = static_cast<CaptureCommandList*>(commandLists[i]);
+        const std::vector<std::uint8_t>& stream = list->Stream.GetStream();
+        std::uint64_t streamSize = stream.size();
+        memcpy(payload, &streamSize, sizeof(streamSize));
+        if (!stream.empty())
+            memcpy(payload + sizeof(streamSize), stream.data(), stream.size());
+        payload += sizeof(streamSize) + AlignCaptureSize(streamSize);
+
+        mTargetLists[i] = list->Target;
+    }
+
+    mTarget.ExecuteCommandLists(count, mTargetLists.data());
+}
+
+IGpuQueue& CaptureRenderDevice::GetQueue()
+{
+    return mTarget.GetQueue();
+}
+
+IBundleAllocator& CaptureRenderDevice::GetBundleAllocator()
+{
+    return mTarget.GetBundleAllocator();
+}
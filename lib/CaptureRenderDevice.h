@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CaptureFormat.h"
+#include "RenderDevice.h"
+
+// Device in front of another one that forwards every call and writes what it needs to run the
+// frames again in a capture: buffer creations, uploads, command lists and the bytes the CPU wrote
+// in the mapped upload buffers. Those writes are found at each submission by comparing the mapped
+// buffers with a copy of what was captured, 64 bytes blocks at a time.
+// Everything until BeginFrames is the setup, then EndFrame closes each frame until Stop.
+// Bundles are recorded on the target device and only their executions are captured. Pipelines,
+// resources and descriptors are captured as the target gave them, so the frames of a D3D12 device
+// replay on a recording device.
+class CaptureRenderDevice : public IRenderDevice
+{
+public:
+    static const std::uint64_t WriteBlockSize = 64;
+
+    CaptureRenderDevice(IRenderDevice& target);
+    ~CaptureRenderDevice();
+
+    CaptureRenderDevice(const CaptureRenderDevice& rhs) = delete;
+    CaptureRenderDevice& operator=(const CaptureRenderDevice& rhs) = delete;
+
+    void BeginFrames();
+    void EndFrame();
+    // Nothing more is captured, the calls are only forwarded to the target
+    void Stop();
+
+    std::uint32_t GetFrameCount() const;
+    std::uint64_t GetSize() const; // Of the file Save writes
+    // What came after the last EndFrame is left out, it would run again at each loop of the frames
+    bool Save(const std::string& path, std::string* error = nullptr) const;
+
+    BufferHandle CreateBuffer(const BufferDesc& desc) override;
+    void DestroyBuffer(BufferHandle buffer) override;
+    void* Map(BufferHandle buffer) override;
+    GpuAddress GetGpuAddress(BufferHandle buffer) const override;
+    void* GetResource(BufferHandle buffer, std::uint64_t& offset) const override;
+    std::uint64_t UploadBuffer(BufferHandle buffer, std::uint64_t offset, const void* data, std::uint64_t size) override;
+    std::uint64_t GetCompletedUpload() override;
+    void WaitForUploads() override;
+
+    ICommandList* CreateCommandList() override;
+    void ResetCommandList(ICommandList* commandList) override;
+    void ExecuteCommandLists(std::uint32_t count, ICommandList* const* commandLists) override;
+
+    IGpuQueue& GetQueue() override;
+    IBundleAllocator& GetBundleAllocator() override;
+
+private:
+    class CaptureCommandList;
+
+    struct MappedBuffer
+    {
+        BufferHandle Buffer = InvalidBuffer;
+        const std::uint8_t* Memory = nullptr;
+        std::vector<std::uint8_t> Captured; // Content as the capture last wrote it
+    };
+
+    std::uint8_t* AddRecord(CaptureRecordType type, std::uint64_t size);
+    void AddWrite(CaptureRecordType type, BufferHandle buffer, std::uint64_t offset, const void* data, std::uint64_t size);
+    void CaptureMappedWrites();
+
+    IRenderDevice& mTarget;
+    std::vector<std::uint8_t> mRecords;
+    CaptureHeader mHeader;
+    size_t mFramesEnd = 0; // Size of the records at the last EndFrame
+    std::uint32_t mFramesEndRecordCount = 0;
+    std::vector<BufferDesc> mBufferDescs; // Per target handle
+    std::vector<MappedBuffer> mMappedBuffers;
+    std::vector<std::unique_ptr<CaptureCommandList>> mCommandLists;
+    std::vector<ICommandList*> mTargetLists; // ExecuteCommandLists scratch
+    bool mStopped = false;
+};
@@ -0,0 +1,497 @@
+﻿#include "CaptureReplay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "RecordingCommandList.h"
+
+namespace
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    const size_t MaxSubmissionsInFlight = 8;
+
+    double Elapsed(Clock::time_point start, Clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    class Replayer : public GpuAddressTranslator
+    {
+    public:
+        Replayer(IRenderDevice& device, CaptureReplayResult& result) : mDevice(device), mResult(result)
+        {
+        }
+
+        ~Replayer()
+        {
+            WaitIdle();
+            for (const Buffer& buffer : mBuffers)
+            {
+                if (buffer.Target != InvalidBuffer)
+                    mDevice.DestroyBuffer(buffer.Target);
+            }
+        }
+
+        // Walk the record headers once, every record and list must fit in the data
+        bool Load(const std::uint8_t* data, std::uint64_t size)
+        {
+            CaptureHeader header;
+            if (size < sizeof(header))
+                return Fail("the capture is smaller than its header");
+            memcpy(&header, data, sizeof(header));
+            if (header.Magic != CaptureMagic || header.Version != CaptureVersion)
+                return Fail("not a capture of this version");
+            if (header.Size > size)
+                return Fail("the capture is truncated");
+
+            bool framesFound = header.FramesOffset == header.Size;
+            std::uint32_t records = 0;
+            std::uint64_t offset = sizeof(header);
+            while (offset < header.Size)
+            {
+                if (offset == header.FramesOffset) framesFound = true;
+
+                const CaptureRecord* record = reinterpret_cast<const CaptureRecord*>(data + offset);
+                if (header.Size - offset < sizeof(CaptureRecord) ||
+                    header.Size - offset - sizeof(CaptureRecord) < AlignCaptureSize(record->Size))
+                    return Fail("record " + std::to_string(records) + " is truncated");
+
+                const std::uint8_t* payload = data + offset + sizeof(CaptureRecord);
+                if (!CheckPayload(record->Type, payload, record->Size))
+                    return Fail(std::string(GetCaptureRecordName(record->Type)) + " record " + std::to_string(records) + " is invalid");
+
+                offset += sizeof(CaptureRecord) + AlignCaptureSize(record->Size);
+                records++;
+            }
+
+            if (records != header.RecordCount || !framesFound)
+                return Fail("the capture header does not match its records");
+
+            mData = data;
+            mFramesOffset = header.FramesOffset;
+            mSize = header.Size;
+            mResult.Frames = header.FrameCount;
+            mResult.CaptureBytes = header.Size;
+            return true;
+        }
+
+        void ReplaySetup()
+        {
+            auto start = Clock::now();
+            Replay(sizeof(CaptureHeader), mFramesOffset, false);
+            mResult.SetupMs = Elapsed(start, Clock::now());
+        }
+
+        // Time of the pass over the frames. The frame times are measured when nothing is skipped or timed.
+        double ReplayFrames(bool timeRecords, CommandType skippedCommand)
+        {
+            mMeasureFrames = !timeRecords && skippedCommand == CommandType::Count;
+            mCountCommands = timeRecords;
+            mSkippedCommand = skippedCommand;
+
+            auto start = Clock::now();
+            mFrameStart = start;
+            Replay(mFramesOffset, mSize, timeRecords);
+            return Elapsed(start, Clock::now());
+        }
+
+        void CalibrateTimer()
+        {
+            // Cost of the two clock reads around a timed record
+            const int samples = 4096;
+            auto start = Clock::now();
+            for (int i = 0; i < samples; i++)
+            {
+                auto before = Clock::now();
+                auto after = Clock::now();
+                mTimerSink += (after - before).count();
+            }
+            mResult.TimerOverheadNs = Elapsed(start, Clock::now()) * 1e6 / samples;
+        }
+
+        void WaitIdle()
+        {
+            IGpuQueue& queue = mDevice.GetQueue();
+            queue.WaitForValue(queue.Signal());
+            Reclaim();
+        }
+
+        bool HasFailed() const
+        {
+            return !mResult.Error.empty();
+        }
+
+        GpuAddress Translate(GpuAddress address) const override
+        {
+            // Last buffer starting at or before the address
+            auto range = std::upper_bound(mRanges.begin(), mRanges.end(), address,
+                [](GpuAddress value, const Range& r) { return value < r.Begin; });
+            if (range == mRanges.begin()) return address;
+            --range;
+            return address < range->End ? address + range->Delta : address;
+        }
+
+    private:
+        struct Buffer
+        {
+            BufferHandle Target = InvalidBuffer;
+            GpuAddress Captured = 0;
+            std::uint64_t Size = 0;
+            std::uint8_t* Mapped = nullptr;
+        };
+
+        struct Range
+        {
+            GpuAddress Begin = 0;
+            GpuAddress End = 0;
+            std::uint64_t Delta = 0; // Wraps for buffers placed lower than at capture
+        };
+
+        struct Submission
+        {
+            std::uint64_t Fence = 0;
+            std::vector<ICommandList*> Lists;
+        };
+
+        bool Fail(const std::string& error)
+        {
+            if (mResult.Error.empty())
+                mResult.Error = error;
+            return false;
+        }
+
+        static bool CheckPayload(CaptureRecordType type, const std::uint8_t* payload, std::uint64_t size)
+        {
+            switch (type)
+            {
+            case CaptureRecordType::CreateBuffer:
+            case CaptureRecordType::DestroyBuffer:
+                return size == sizeof(CaptureBufferRecord);
+            case CaptureRecordType::UploadBuffer:
+            case CaptureRecordType::WriteMapped:
+                return size >= sizeof(CaptureWriteRecord) &&
+                    reinterpret_cast<const CaptureWriteRecord*>(payload)->Size == size - sizeof(CaptureWriteRecord);
+            case CaptureRecordType::ExecuteCommandLists:
+            {
+                if (size < sizeof(CaptureExecuteRecord)) return false;
+                std::uint32_t count = reinterpret_cast<const CaptureExecuteRecord*>(payload)->Count;
+                std::uint64_t offset = sizeof(CaptureExecuteRecord);
+                for (std::uint32_t i = 0; i < count; i++)
+                {
+                    if (size - offset < sizeof(std::uint64_t)) return false;
+                    std::uint64_t streamSize = *reinterpret_cast<const std::uint64_t*>(payload + offset);
+                    offset += sizeof(std::uint64_t);
+                    if (size - offset < streamSize) return false;
+                    offset += std::min(AlignCaptureSize(streamSize), size - offset);
+                }
+                return offset == size;
+            }
+            case CaptureRecordType::EndFrame:
+                return size == 0;
+            default:
+                return false;
+            }
+        }
+
+        Buffer* FindBuffer(std::uint32_t buffer)
+        {
+            if (buffer >= mBuffers.size() || mBuffers[buffer].Target == InvalidBuffer)
+            {
+                Fail("a record uses buffer " + std::to_string(buffer) + " which does not exist");
+                return nullptr;
+            }
+            return &mBuffers[buffer];
+        }
+
+        void UpdateRanges()
+        {
+            mRanges.clear();
+            mRelocate = false;
+            for (const Buffer& buffer : mBuffers)
+            {
+                if (buffer.Target == InvalidBuffer) continue;
+
+                Range range;
+                range.Begin = buffer.Captured;
+                range.End = buffer.Captured + buffer.Size;
+                range.Delta = mDevice.GetGpuAddress(buffer.Target) - buffer.Captured;
+                mRanges.push_back(range);
+                mRelocate |= range.Delta != 0;
+            }
+            std::sort(mRanges.begin(), mRanges.end(), [](const Range& a, const Range& b) { return a.Begin < b.Begin; });
+            mResult.Relocated |= mRelocate;
+            mRangesDirty = false;
+        }
+
+        void Reclaim()
+        {
+            std::uint64_t completed = mDevice.GetQueue().GetCompletedValue();
+            while (!mInFlight.empty() && mInFlight.front().Fence <= completed)
+            {
+                mFreeLists.insert(mFreeLists.end(), mInFlight.front().Lists.begin(), mInFlight.front().Lists.end());
+                mInFlight.pop_front();
+            }
+        }
+
+        ICommandList* AcquireList()
+        {
+            Reclaim();
+            if (mFreeLists.empty() && mInFlight.size() >= MaxSubmissionsInFlight)
+            {
+                mDevice.GetQueue().WaitForValue(mInFlight.front().Fence);
+                Reclaim();
+            }
+
+            if (mFreeLists.empty())
+                return mDevice.CreateCommandList();
+
+            ICommandList* list = mFreeLists.back();
+            mFreeLists.pop_back();
+            mDevice.ResetCommandList(list);
+            return list;
+        }
+
+        void ReplayStream(const std::uint8_t* stream, std::uint64_t size, ICommandList& list)
+        {
+            const GpuAddressTranslator* translator = mRelocate ? this : nullptr;
+            size_t offset = 0;
+            CommandType type;
+            const std::uint8_t* payload = nullptr;
+            if (mCountCommands)
+            {
+                while (RecordingCommandList::ReadCommand(stream, (size_t)size, offset, type, payload))
+                {
+                    mResult.Commands[(size_t)type].Count++;
+                    RecordingCommandList::ReplayCommand(type, payload, list, translator);
+                }
+            }
+            else
+            {
+                while (RecordingCommandList::ReadCommand(stream, (size_t)size, offset, type, payload))
+                {
+                    if (type != mSkippedCommand)
+                        RecordingCommandList::ReplayCommand(type, payload, list, translator);
+                }
+            }
+
+            if (offset != size)
+                Fail("a command list of the capture is truncated");
+        }
+
+        void ReplayExecute(const std::uint8_t* payload)
+        {
+            if (mRangesDirty)
+                UpdateRanges();
+
+            // The capturing renderer drew with the buffers it uploaded before
+            if (mDevice.GetCompletedUpload() < mUploadTicket)
+                mDevice.WaitForUploads();
+
+            std::uint32_t count = reinterpret_cast<const CaptureExecuteRecord*>(payload)->Count;
+            payload += sizeof(CaptureExecuteRecord);
+
+            Submission submission;
+            for (std::uint32_t i = 0; i < count; i++)
+            {
+                std::uint64_t streamSize = *reinterpret_cast<const std::uint64_t*>(payload);
+                payload += sizeof(std::uint64_t);
+
+                ICommandList* list = AcquireList();
+                ReplayStream(payload, streamSize, *list);
+                submission.Lists.push_back(list);
+                payload += AlignCaptureSize(streamSize);
+            }
+
+            mDevice.ExecuteCommandLists(count, submission.Lists.data());
+            submission.Fence = mDevice.GetQueue().Signal();
+            mInFlight.push_back(std::move(submission));
+        }
+
+        void ReplayRecord(const CaptureRecord& record, const std::uint8_t* payload)
+        {
+            switch (record.Type)
+            {
+            case CaptureRecordType::CreateBuffer:
+            {
+                const CaptureBufferRecord& create = *reinterpret_cast<const CaptureBufferRecord*>(payload);
+                if (create.Buffer >= mBuffers.size())
+                    mBuffers.resize(create.Buffer + 1);
+
+                // Created again by the next iteration of the frames, the queue may still use the last one
+                Buffer& buffer = mBuffers[create.Buffer];
+                if (buffer.Target != InvalidBuffer)
+                {
+                    WaitIdle();
+                    mDevice.DestroyBuffer(buffer.Target);
+                }
+
+                BufferDesc desc;
+                desc.SizeInBytes = create.SizeInBytes;
+                desc.Heap = (BufferHeap)create.Heap;
+                buffer.Target = mDevice.CreateBuffer(desc);
+                buffer.Captured = create.Address;
+                buffer.Size = create.SizeInBytes;
+                buffer.Mapped = nullptr;
+                if (buffer.Target == InvalidBuffer)
+                    Fail("the device is out of memory for a buffer of " + std::to_string(create.SizeInBytes) + " bytes");
+                mRangesDirty = true;
+                break;
+            }
+            case CaptureRecordType::DestroyBuffer:
+            {
+                const CaptureBufferRecord& destroy = *reinterpret_cast<const CaptureBufferRecord*>(payload);
+                Buffer* buffer = FindBuffer(destroy.Buffer);
+                if (buffer == nullptr) break;
+
+                // The capturing renderer knew the queue was done with it
+                mDevice.DestroyBuffer(buffer->Target);
+                *buffer = Buffer();
+                mRangesDirty = true;
+                break;
+            }
+            case CaptureRecordType::UploadBuffer:
+            {
+                const CaptureWriteRecord& write = *reinterpret_cast<const CaptureWriteRecord*>(payload);
+                Buffer* buffer = FindBuffer(write.Buffer);
+                if (buffer != nullptr)
+                    mUploadTicket = mDevice.UploadBuffer(buffer->Target, write.Offset, payload + sizeof(write), write.Size);
+                break;
+            }
+            case CaptureRecordType::WriteMapped:
+            {
+                const CaptureWriteRecord& write = *reinterpret_cast<const CaptureWriteRecord*>(payload);
+                Buffer* buffer = FindBuffer(write.Buffer);
+                if (buffer == nullptr) break;
+
+                if (buffer->Mapped == nullptr)
+                    buffer->Mapped = static_cast<std::uint8_t*>(mDevice.Map(buffer->Target));
+                if (buffer->Mapped == nullptr || write.Offset > buffer->Size || write.Size > buffer->Size - write.Offset)
+                {
+                    Fail("a mapped write does not fit in its buffer");
+                    break;
+                }
+                memcpy(buffer->Mapped + write.Offset, payload + sizeof(write), (size_t)write.Size);
+                break;
+            }
+            case CaptureRecordType::ExecuteCommandLists:
+                ReplayExecute(payload);
+                break;
+            case CaptureRecordType::EndFrame:
+            {
+                auto end = Clock::now();
+                double frameMs = Elapsed(mFrameStart, end);
+                if (mMeasureFrames)
+                {
+                    mResult.FrameMs += frameMs;
+                    mResult.WorstFrameMs = std::max(mResult.WorstFrameMs, frameMs);
+                }
+                mFrameStart = end;
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        void Replay(std::uint64_t begin, std::uint64_t end, bool timed)
+        {
+            std::uint64_t offset = begin;
+            while (offset < end && !HasFailed())
+            {
+                const CaptureRecord& record = *reinterpret_cast<const CaptureRecord*>(mData + offset);
+                const std::uint8_t* payload = mData + offset + sizeof(CaptureRecord);
+
+                if (timed)
+                {
+                    auto start = Clock::now();
+                    ReplayRecord(record, payload);
+                    ReplayCost& cost = mResult.Records[(size_t)record.Type];
+                    cost.Count++;
+                    cost.TotalMs += Elapsed(start, Clock::now());
+                }
+                else
+                {
+                    ReplayRecord(record, payload);
+                }
+
+                offset += sizeof(CaptureRecord) + AlignCaptureSize(record.Size);
+            }
+        }
+
+        IRenderDevice& mDevice;
+        CaptureReplayResult& mResult;
+        const std::uint8_t* mData = nullptr;
+        std::uint64_t mFramesOffset = 0;
+        std::uint64_t mSize = 0;
+
+        std::vector<Buffer> mBuffers; // Per captured handle
+        std::vector<Range> mRanges; // Sorted by captured address
+        bool mRangesDirty = true;
+        bool mRelocate = false;
+        std::uint64_t mUploadTicket = 0; // Of the last upload
+
+        std::vector<ICommandList*> mFreeLists;
+        std::deque<Submission> mInFlight;
+
+        bool mMeasureFrames = false;
+        bool mCountCommands = false;
+        CommandType mSkippedCommand = CommandType::Count;
+        Clock::time_point mFrameStart;
+        std::int64_t mTimerSink = 0;
+    };
+}
+
+CaptureReplayResult ReplayCapture(const std::uint8_t* data, std::uint64_t size, IRenderDevice& device,
+                                  std::uint32_t iterations, bool measureCommands)
+{
+    CaptureReplayResult result;
+    result.Iterations = iterations;
+
+    Replayer replayer(device, result);
+    if (!replayer.Load(data, size))
+        return result;
+
+    replayer.CalibrateTimer();
+    replayer.ReplaySetup();
+
+    // Fastest pass, the one least disturbed by the rest of the machine
+    std::vector<double> passes;
+    for (std::uint32_t i = 0; i < iterations && !replayer.HasFailed(); i++)
+        passes.push_back(replayer.ReplayFrames(false, CommandType::Count));
+    std::sort(passes.begin(), passes.end());
+    double bestPassMs = passes.empty() ? 0.0 : passes.front();
+    if (!passes.empty())
+        result.NoiseMs = passes[passes.size() / 2] - bestPassMs;
+    if (!replayer.HasFailed())
+        replayer.ReplayFrames(true, CommandType::Count);
+
+    // A command type costs what the pass saves without it
+    for (size_t c = 0; c < (size_t)CommandType::Count && measureCommands && iterations > 0; c++)
+    {
+        if (result.Commands[c].Count == 0) continue;
+
+        double skippedMs = 0.0;
+        for (std::uint32_t i = 0; i < iterations && !replayer.HasFailed(); i++)
+        {
+            double passMs = replayer.ReplayFrames(false, (CommandType)c);
+            skippedMs = i == 0 ? passMs : std::min(skippedMs, passMs);
+        }
+        result.Commands[c].TotalMs = std::max(0.0, bestPassMs - skippedMs);
+    }
+    replayer.WaitIdle();
+
+    if (result.Frames > 0 && iterations > 0)
+        result.FrameMs /= (double)result.Frames * iterations;
+
+    // Each timed record paid for two clock reads
+    double overheadMs = result.TimerOverheadNs * 1e-6;
+    for (ReplayCost& cost : result.Records)
+        cost.TotalMs = std::max(0.0, cost.TotalMs - cost.Count * overheadMs);
+
+    result.Valid = result.Error.empty();
+    return result;
+}
@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "CaptureFormat.h"
+#include "CommandList.h"
+#include "RenderDevice.h"
+
+struct ReplayCost
+{
+    std::uint64_t Count = 0;
+    double TotalMs = 0.0; // Without the cost of the timer
+};
+
+struct CaptureReplayResult
+{
+    std::uint32_t Frames = 0; // In the capture
+    std::uint32_t Iterations = 0;
+    std::uint64_t CaptureBytes = 0;
+
+    double SetupMs = 0.0;
+    double FrameMs = 0.0; // Average replay of a frame, nothing timed inside
+    double WorstFrameMs = 0.0;
+
+    // Of one pass over the frames. A command type costs the time the pass saves when it is skipped,
+    // its calls are still read. The records are timed one by one, a list execution includes its commands.
+    ReplayCost Commands[(size_t)CommandType::Count];
+    ReplayCost Records[(size_t)CaptureRecordType::Count];
+    double TimerOverheadNs = 0.0; // Taken out of every timed record
+    double NoiseMs = 0.0; // Median minus fastest pass, a command cost below it is not significant
+
+    bool Relocated = false; // Buffers did not get their captured addresses, the streams were translated
+    bool Valid = false;
+    std::string Error;
+};
+
+// Run the setup of a capture once then its frames iterations times on device, reading the
+// records in place. The data must stay valid during the call, a MappedFile gives it without
+// copying. Pipeline states, root signatures and barrier resources are given as captured,
+// the device must know them. measureCommands replays the frames again without each command type,
+// only for a device that does not run the lists (RecordingRenderDevice).
+CaptureReplayResult ReplayCapture(const std::uint8_t* data, std::uint64_t size, IRenderDevice& device,
+                                  std::uint32_t iterations, bool measureCommands);
@@ -0,0 +1,27 @@
+﻿#include "CommandList.h"
+
+const char* GetCommandName(CommandType type)
+{
+    switch (type)
+    {
+    case CommandType::SetPipelineState: return "SetPipelineState";
+    case CommandType::SetGraphicsRootSignature: return "SetGraphicsRootSignature";
+    case CommandType::IASetVertexBuffers: return "IASetVertexBuffers";
+    case CommandType::IASetIndexBuffer: return "IASetIndexBuffer";
+    case CommandType::IASetPrimitiveTopology: return "IASetPrimitiveTopology";
+    case CommandType::SetGraphicsRootConstantBufferView: return "SetGraphicsRootConstantBufferView";
+    case CommandType::SetGraphicsRootShaderResourceView: return "SetGraphicsRootShaderResourceView";
+    case CommandType::SetGraphicsRoot32BitConstant: return "SetGraphicsRoot32BitConstant";
+    case CommandType::DrawIndexedInstanced: return "DrawIndexedInstanced";
+    case CommandType::ExecuteIndirect: return "ExecuteIndirect";
+    case CommandType::ExecuteBundle: return "ExecuteBundle";
+    case CommandType::ResourceBarrier: return "ResourceBarrier";
+    case CommandType::RSSetViewports: return "RSSetViewports";
+    case CommandType::RSSetScissorRects: return "RSSetScissorRects";
+    case CommandType::OMSetRenderTargets: return "OMSetRenderTargets";
+    case CommandType::SetDescriptorHeaps: return "SetDescriptorHeaps";
+    case CommandType::ClearRenderTargetView: return "ClearRenderTargetView";
+    case CommandType::ClearDepthStencilView: return "ClearDepthStencilView";
+    default: return "Unknown";
+    }
+}
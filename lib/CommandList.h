@@ -0,0 +1,157 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Backend independent view of a graphics command list.
+// Only the commands used by the renderer frame are exposed, with the same names
+// and meaning as ID3D12GraphicsCommandList so a D3D12 list can be wrapped one to one.
+// Pipeline states, root signatures, descriptor heaps and resources are opaque handles,
+// buffers are GPU virtual addresses and views are CPU descriptor handles.
+
+using GpuAddress = std::uint64_t;
+
+struct VertexBufferBinding
+{
+    GpuAddress BufferLocation = 0;
+    std::uint32_t SizeInBytes = 0;
+    std::uint32_t StrideInBytes = 0;
+};
+
+struct IndexBufferBinding
+{
+    GpuAddress BufferLocation = 0;
+    std::uint32_t SizeInBytes = 0;
+    std::uint32_t Format = 0; // DXGI_FORMAT
+};
+
+// DXGI_FORMAT_R16_UINT and DXGI_FORMAT_R32_UINT
+const std::uint32_t IndexFormatR16 = 57;
+const std::uint32_t IndexFormatR32 = 42;
+
+// D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+const std::uint32_t PrimitiveTopologyTriangleList = 4;
+
+// Same layout as D3D12_VIEWPORT
+struct Viewport
+{
+    float TopLeftX = 0.0f;
+    float TopLeftY = 0.0f;
+    float Width = 0.0f;
+    float Height = 0.0f;
+    float MinDepth = 0.0f;
+    float MaxDepth = 1.0f;
+};
+
+// Same layout as D3D12_RECT
+struct ScissorRect
+{
+    std::int32_t Left = 0;
+    std::int32_t Top = 0;
+    std::int32_t Right = 0;
+    std::int32_t Bottom = 0;
+};
+
+// Render target or depth stencil view, the ptr of a D3D12_CPU_DESCRIPTOR_HANDLE
+using CpuDescriptor = std::uint64_t;
+
+// Same values as D3D12_CLEAR_FLAGS
+enum class ClearFlags : std::uint32_t
+{
+    Depth = 1,
+    Stencil = 2,
+    DepthStencil = 3
+};
+
+// Same values as D3D12_RESOURCE_STATES
+using ResourceState = std::uint32_t;
+const ResourceState ResourceStatePresent = 0;
+const ResourceState ResourceStateRenderTarget = 0x4;
+const ResourceState ResourceStateDepthWrite = 0x10;
+
+// Same values as D3D12_RESOURCE_BARRIER_FLAGS, a split barrier is a BeginOnly then an EndOnly
+enum class BarrierFlags : std::uint32_t
+{
+    None = 0,
+    BeginOnly = 1,
+    EndOnly = 2
+};
+
+// Same values as D3D12_RESOURCE_BARRIER_TYPE
+enum class BarrierType : std::uint32_t
+{
+    Transition = 0,
+    Aliasing = 1 // Resource starts using its memory, the resources it overlaps stop
+};
+
+// Transition of every subresource of a resource, the states are ignored by aliasing barriers
+struct ResourceBarrierDesc
+{
+    BarrierType Type = BarrierType::Transition;
+    void* Resource = nullptr;
+    ResourceState StateBefore = 0;
+    ResourceState StateAfter = 0;
+    BarrierFlags Flags = BarrierFlags::None;
+};
+
+enum class CommandType : std::uint8_t
+{
+    SetPipelineState,
+    SetGraphicsRootSignature,
+    IASetVertexBuffers,
+    IASetIndexBuffer,
+    IASetPrimitiveTopology,
+    SetGraphicsRootConstantBufferView,
+    SetGraphicsRootShaderResourceView,
+    SetGraphicsRoot32BitConstant,
+    DrawIndexedInstanced,
+    ExecuteIndirect,
+    ExecuteBundle,
+    ResourceBarrier,
+    RSSetViewports,
+    RSSetScissorRects,
+    OMSetRenderTargets,
+    SetDescriptorHeaps,
+    ClearRenderTargetView,
+    ClearDepthStencilView,
+
+    Count
+};
+
+const char* GetCommandName(CommandType type);
+
+class ICommandList
+{
+public:
+    virtual ~ICommandList() {}
+
+    virtual void SetPipelineState(void* pipelineState) = 0;
+    virtual void SetGraphicsRootSignature(void* rootSignature) = 0;
+    virtual void IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t numViews, const VertexBufferBinding* views) = 0;
+    virtual void IASetIndexBuffer(const IndexBufferBinding* view) = 0;
+    virtual void IASetPrimitiveTopology(std::uint32_t topology) = 0;
+    virtual void SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation) = 0;
+    virtual void SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation) = 0;
+    virtual void SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) = 0;
+    virtual void DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+                                      std::uint32_t startIndexLocation, std::int32_t baseVertexLocation,
+                                      std::uint32_t startInstanceLocation) = 0;
+
+    // The arguments can change the input assembler and root parameters bindings
+    virtual void ExecuteIndirect(void* commandSignature, std::uint32_t maxCommandCount,
+                                 void* argumentBuffer, std::uint64_t argumentBufferOffset) = 0;
+
+    // Replay a pre-recorded list. The pipeline, input assembler and root parameters it sets stay bound after it.
+    virtual void ExecuteBundle(void* bundle) = 0;
+
+    virtual void ResourceBarrier(std::uint32_t numBarriers, const ResourceBarrierDesc* barriers) = 0;
+
+    // Pass setup, a list starts without any of it
+    virtual void RSSetViewports(std::uint32_t numViewports, const Viewport* viewports) = 0;
+    virtual void RSSetScissorRects(std::uint32_t numRects, const ScissorRect* rects) = 0;
+    // One descriptor per render target, depthStencil 0 for none
+    virtual void OMSetRenderTargets(std::uint32_t numRenderTargets, const CpuDescriptor* renderTargets, CpuDescriptor depthStencil) = 0;
+    virtual void SetDescriptorHeaps(std::uint32_t numHeaps, void* const* heaps) = 0;
+    virtual void ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4]) = 0;
+    virtual void ClearDepthStencilView(CpuDescriptor depthStencil, ClearFlags flags, float depth, std::uint8_t stencil) = 0;
+};
@@ -0,0 +1,269 @@
+﻿#include "CommandRecorder.h"
+
+#include <cstring>
+
+std::uint32_t CommandRecorderStats::TotalRequested() const
+{
+    std::uint32_t total = 0;
+    for (std::uint32_t count : Requested)
+        total += count;
+    return total;
+}
+
+std::uint32_t CommandRecorderStats::TotalIssued() const
+{
+    std::uint32_t total = 0;
+    for (std::uint32_t count : Issued)
+        total += count;
+    return total;
+}
+
+CommandRecorder::CommandRecorder()
+{
+    Reset();
+}
+
+CommandRecorder::CommandRecorder(ICommandList* target) : mTarget(target)
+{
+    Reset();
+}
+
+void CommandRecorder::SetTarget(ICommandList* target)
+{
+    mTarget = target;
+    Reset();
+}
+
+void CommandRecorder::Reset(void* initialPipelineState)
+{
+    mPipelineState = initialPipelineState;
+    mRootSignature = nullptr;
+
+    for (std::uint32_t i = 0; i < MaxVertexBufferSlots; i++)
+        mVertexBufferValid[i] = false;
+    mIndexBufferValid = false;
+    mTopologyValid = false;
+
+    InvalidateRootParameters();
+}
+
+const CommandRecorderStats& CommandRecorder::GetStats() const
+{
+    return mStats;
+}
+
+void CommandRecorder::ResetStats()
+{
+    mStats = CommandRecorderStats();
+}
+
+void CommandRecorder::InvalidateRootParameters()
+{
+    for (std::uint32_t i = 0; i < MaxRootParameters; i++)
+    {
+        mRootDescriptorValid[i] = false;
+        for (std::uint32_t c = 0; c < MaxRootConstants; c++)
+            mRootConstantValid[i][c] = false;
+    }
+}
+
+void CommandRecorder::SetPipelineState(void* pipelineState)
+{
+    mStats.Requested[(size_t)CommandType::SetPipelineState]++;
+    if (pipelineState == mPipelineState && pipelineState != nullptr) return;
+
+    mPipelineState = pipelineState;
+    mStats.Issued[(size_t)CommandType::SetPipelineState]++;
+    mTarget->SetPipelineState(pipelineState);
+}
+
+void CommandRecorder::SetGraphicsRootSignature(void* rootSignature)
+{
+    mStats.Requested[(size_t)CommandType::SetGraphicsRootSignature]++;
+    if (rootSignature == mRootSignature && rootSignature != nullptr) return;
+
+    mRootSignature = rootSignature;
+    InvalidateRootParameters();
+    mStats.Issued[(size_t)CommandType::SetGraphicsRootSignature]++;
+    mTarget->SetGraphicsRootSignature(rootSignature);
+}
+
+void CommandRecorder::IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t numViews, const VertexBufferBinding* views)
+{
+    mStats.Requested[(size_t)CommandType::IASetVertexBuffers]++;
+
+    bool redundant = startSlot + numViews <= MaxVertexBufferSlots;
+    for (std::uint32_t i = 0; redundant && i < numViews; i++)
+    {
+        std::uint32_t slot = startSlot + i;
+        redundant = mVertexBufferValid[slot] && memcmp(&mVertexBuffers[slot], &views[i], sizeof(VertexBufferBinding)) == 0;
+    }
+    if (redundant) return;
+
+    for (std::uint32_t i = 0; i < numViews && startSlot + i < MaxVertexBufferSlots; i++)
+    {
+        mVertexBufferValid[startSlot + i] = true;
+        mVertexBuffers[startSlot + i] = views[i];
+    }
+
+    mStats.Issued[(size_t)CommandType::IASetVertexBuffers]++;
+    mTarget->IASetVertexBuffers(startSlot, numViews, views);
+}
+
+void CommandRecorder::IASetIndexBuffer(const IndexBufferBinding* view)
+{
+    mStats.Requested[(size_t)CommandType::IASetIndexBuffer]++;
+    if (mIndexBufferValid && memcmp(&mIndexBuffer, view, sizeof(IndexBufferBinding)) == 0) return;
+
+    mIndexBufferValid = true;
+    mIndexBuffer = *view;
+    mStats.Issued[(size_t)CommandType::IASetIndexBuffer]++;
+    mTarget->IASetIndexBuffer(view);
+}
+
+void CommandRecorder::IASetPrimitiveTopology(std::uint32_t topology)
+{
+    mStats.Requested[(size_t)CommandType::IASetPrimitiveTopology]++;
+    if (mTopologyValid && mTopology == topology) return;
+
+    mTopologyValid = true;
+    mTopology = topology;
+    mStats.Issued[(size_t)CommandType::IASetPrimitiveTopology]++;
+    mTarget->IASetPrimitiveTopology(topology);
+}
+
+void CommandRecorder::SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation)
+{
+    mStats.Requested[(size_t)CommandType::SetGraphicsRootConstantBufferView]++;
+    if (rootParameterIndex < MaxRootParameters)
+    {
+        if (mRootDescriptorValid[rootParameterIndex] && mRootDescriptor[rootParameterIndex] == bufferLocation) return;
+
+        mRootDescriptorValid[rootParameterIndex] = true;
+        mRootDescriptor[rootParameterIndex] = bufferLocation;
+    }
+
+    mStats.Issued[(size_t)CommandType::SetGraphicsRootConstantBufferView]++;
+    mTarget->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+}
+
+void CommandRecorder::SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation)
+{
+    mStats.Requested[(size_t)CommandType::SetGraphicsRootShaderResourceView]++;
+    if (rootParameterIndex < MaxRootParameters)
+    {
+        if (mRootDescriptorValid[rootParameterIndex] && mRootDescriptor[rootParameterIndex] == bufferLocation) return;
+
+        mRootDescriptorValid[rootParameterIndex] = true;
+        mRootDescriptor[rootParameterIndex] = bufferLocation;
+    }
+
+    mStats.Issued[(size_t)CommandType::SetGraphicsRootShaderResourceView]++;
+    mTarget->SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+}
+
+void CommandRecorder::SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues)
+{
+    mStats.Requested[(size_t)CommandType::SetGraphicsRoot32BitConstant]++;
+    if (rootParameterIndex < MaxRootParameters && destOffsetIn32BitValues < MaxRootConstants)
+    {
+        bool& valid = mRootConstantValid[rootParameterIndex][destOffsetIn32BitValues];
+        std::uint32_t& value = mRootConstant[rootParameterIndex][destOffsetIn32BitValues];
+        if (valid && value == srcData) return;
+
+        valid = true;
+        value = srcData;
+    }
+
+    mStats.Issued[(size_t)CommandType::SetGraphicsRoot32BitConstant]++;
+    mTarget->SetGraphicsRoot32BitConstant(rootParameterIndex, srcData, destOffsetIn32BitValues);
+}
+
+void CommandRecorder::DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+                                           std::uint32_t startIndexLocation, std::int32_t baseVertexLocation,
+                                           std::uint32_t startInstanceLocation)
+{
+    mStats.Requested[(size_t)CommandType::DrawIndexedInstanced]++;
+    mStats.Issued[(size_t)CommandType::DrawIndexedInstanced]++;
+    mTarget->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+void CommandRecorder::ExecuteIndirect(void* commandSignature, std::uint32_t maxCommandCount,
+                                      void* argumentBuffer, std::uint64_t argumentBufferOffset)
+{
+    mStats.Requested[(size_t)CommandType::ExecuteIndirect]++;
+    mStats.Issued[(size_t)CommandType::ExecuteIndirect]++;
+    mTarget->ExecuteIndirect(commandSignature, maxCommandCount, argumentBuffer, argumentBufferOffset);
+
+    // The bindings left by the arguments are unknown
+    for (std::uint32_t i = 0; i < MaxVertexBufferSlots; i++)
+        mVertexBufferValid[i] = false;
+    mIndexBufferValid = false;
+    InvalidateRootParameters();
+}
+
+void CommandRecorder::ExecuteBundle(void* bundle)
+{
+    mStats.Requested[(size_t)CommandType::ExecuteBundle]++;
+    mStats.Issued[(size_t)CommandType::ExecuteBundle]++;
+    mTarget->ExecuteBundle(bundle);
+
+    // The bundle leaves its own pipeline and bindings
+    mPipelineState = nullptr;
+    mTopologyValid = false;
+    for (std::uint32_t i = 0; i < MaxVertexBufferSlots; i++)
+        mVertexBufferValid[i] = false;
+    mIndexBufferValid = false;
+    InvalidateRootParameters();
+}
+
+void CommandRecorder::ResourceBarrier(std::uint32_t numBarriers, const ResourceBarrierDesc* barriers)
+{
+    mStats.Requested[(size_t)CommandType::ResourceBarrier]++;
+    if (numBarriers == 0) return;
+
+    mStats.Issued[(size_t)CommandType::ResourceBarrier]++;
+    mTarget->ResourceBarrier(numBarriers, barriers);
+}
+
+void CommandRecorder::RSSetViewports(std::uint32_t numViewports, const Viewport* viewports)
+{
+    mStats.Requested[(size_t)CommandType::RSSetViewports]++;
+    mStats.Issued[(size_t)CommandType::RSSetViewports]++;
+    mTarget->RSSetViewports(numViewports, viewports);
+}
+
+void CommandRecorder::RSSetScissorRects(std::uint32_t numRects, const ScissorRect* rects)
+{
+    mStats.Requested[(size_t)CommandType::RSSetScissorRects]++;
+    mStats.Issued[(size_t)CommandType::RSSetScissorRects]++;
+    mTarget->RSSetScissorRects(numRects, rects);
+}
+
+void CommandRecorder::OMSetRenderTargets(std::uint32_t numRenderTargets, const CpuDescriptor* renderTargets, CpuDescriptor depthStencil)
+{
+    mStats.Requested[(size_t)CommandType::OMSetRenderTargets]++;
+    mStats.Issued[(size_t)CommandType::OMSetRenderTargets]++;
+    mTarget->OMSetRenderTargets(numRenderTargets, renderTargets, depthStencil);
+}
+
+void CommandRecorder::SetDescriptorHeaps(std::uint32_t numHeaps, void* const* heaps)
+{
+    mStats.Requested[(size_t)CommandType::SetDescriptorHeaps]++;
+    mStats.Issued[(size_t)CommandType::SetDescriptorHeaps]++;
+    mTarget->SetDescriptorHeaps(numHeaps, heaps);
+}
+
+void CommandRecorder::ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4])
+{
+    mStats.Requested[(size_t)CommandType::ClearRenderTargetView]++;
+    mStats.Issued[(size_t)CommandType::ClearRenderTargetView]++;
+    mTarget->ClearRenderTargetView(renderTarget, color);
+}
+
+void CommandRecorder::ClearDepthStencilView(CpuDescriptor depthStencil, ClearFlags flags, float depth, std::uint8_t stencil)
+{
+    mStats.Requested[(size_t)CommandType::ClearDepthStencilView]++;
+    mStats.Issued[(size_t)CommandType::ClearDepthStencilView]++;
+    mTarget->ClearDepthStencilView(depthStencil, flags, depth, stencil);
+}
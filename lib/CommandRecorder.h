@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include "CommandList.h"
+
+// Calls requested by the renderer and calls that reached the command list, per command type
+struct CommandRecorderStats
+{
+    std::uint32_t Requested[(size_t)CommandType::Count] = {};
+    std::uint32_t Issued[(size_t)CommandType::Count] = {};
+
+    std::uint32_t TotalRequested() const;
+    std::uint32_t TotalIssued() const;
+};
+
+// Thin layer in front of a command list that shadows the bound state and drops
+// the calls which would set the pipeline, input assembler or a root parameter to its current value.
+class CommandRecorder : public ICommandList
+{
+public:
+    static const std::uint32_t MaxVertexBufferSlots = 4;
+    static const std::uint32_t MaxRootParameters = 16;
+    static const std::uint32_t MaxRootConstants = 4; // Shadowed 32 bits constants per root parameter
+
+    CommandRecorder();
+    CommandRecorder(ICommandList* target);
+
+    void SetTarget(ICommandList* target);
+
+    // Forget the shadowed state, to call after the underlying list is reset.
+    // The pipeline state given to the list Reset is known to be bound.
+    void Reset(void* initialPipelineState = nullptr);
+
+    const CommandRecorderStats& GetStats() const;
+    void ResetStats();
+
+    void SetPipelineState(void* pipelineState) override;
+    void SetGraphicsRootSignature(void* rootSignature) override;
+    void IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t numViews, const VertexBufferBinding* views) override;
+    void IASetIndexBuffer(const IndexBufferBinding* view) override;
+    void IASetPrimitiveTopology(std::uint32_t topology) override;
+    void SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation) override;
+    void SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation) override;
+    void SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) override;
+    void DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+                              std::uint32_t startIndexLocation, std::int32_t baseVertexLocation,
+                              std::uint32_t startInstanceLocation) override;
+    void ExecuteIndirect(void* commandSignature, std::uint32_t maxCommandCount,
+                         void* argumentBuffer, std::uint64_t argumentBufferOffset) override;
+    void ExecuteBundle(void* bundle) override;
+    void ResourceBarrier(std::uint32_t numBarriers, const ResourceBarrierDesc* barriers) override;
+    void RSSetViewports(std::uint32_t numViewports, const Viewport* viewports) override;
+    void RSSetScissorRects(std::uint32_t numRects, const ScissorRect* rects) override;
+    void OMSetRenderTargets(std::uint32_t numRenderTargets, const CpuDescriptor* renderTargets, CpuDescriptor depthStencil) override;
+    void SetDescriptorHeaps(std::uint32_t numHeaps, void* const* heaps) override;
+    void ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4]) override;
+    void ClearDepthStencilView(CpuDescriptor depthStencil, ClearFlags flags, float depth, std::uint8_t stencil) override;
+
+private:
+    // Changing the root signature unbind every root parameter
+    void InvalidateRootParameters();
+
+    ICommandList* mTarget = nullptr;
+    CommandRecorderStats mStats;
+
+    // Shadowed state
+    void* mPipelineState = nullptr;
+    void* mRootSignature = nullptr;
+
+    bool mVertexBufferValid[MaxVertexBufferSlots];
+    VertexBufferBinding mVertexBuffers[MaxVertexBufferSlots];
+
+    bool mIndexBufferValid = false;
+    IndexBufferBinding mIndexBuffer;
+
+    bool mTopologyValid = false;
+    std::uint32_t mTopology = 0;
+
+    // Root CBVs and SRVs, a root parameter index is only ever one of the two
+    bool mRootDescriptorValid[MaxRootParameters];
+    GpuAddress mRootDescriptor[MaxRootParameters];
+
+    bool mRootConstantValid[MaxRootParameters][MaxRootConstants];
+    std::uint32_t mRootConstant[MaxRootParameters][MaxRootConstants];
+};
@@ -0,0 +1,161 @@
+﻿#include "CopyBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <emmintrin.h>
+#include <random>
+
+#include "StreamingCopy.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace
+{
+    const std::size_t DestinationStride = 256;
+    const std::size_t DestinationSize = 64 * 1024 * 1024; // Well past the last level cache
+
+    // Non-temporal stores of the payload only, the end of its last line is never written.
+    // The destination is 16 bytes aligned and every payload size a multiple of 16.
+    void StreamPartialLines(std::uint8_t* destination, const std::uint8_t* source, std::size_t size)
+    {
+        for (std::size_t offset = 0; offset < size; offset += 16)
+            _mm_stream_si128(reinterpret_cast<__m128i*>(destination + offset),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + offset)));
+    }
+
+    // Page aligned write-combined memory, nullptr where applications cannot allocate it
+    void* AllocateWriteCombined(std::size_t size)
+    {
+#ifdef _WIN32
+        return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE | PAGE_WRITECOMBINE);
+#else
+        (void)size;
+        return nullptr;
+#endif
+    }
+
+    void FreeWriteCombined(void* memory)
+    {
+#ifdef _WIN32
+        VirtualFree(memory, 0, MEM_RELEASE);
+#else
+        (void)memory;
+#endif
+    }
+
+    // Time the copy of every element in order, once per repeat
+    template<typename CopyFunction>
+    CopyBenchmarkResult Measure(const char* memory, const char* method, const char* pattern, std::size_t payloadSize,
+                                std::size_t elementCount, std::uint32_t repeats, CopyFunction copy)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (std::uint32_t r = 0; r < repeats; r++)
+            copy();
+        StreamCopyFence();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        double elements = (double)elementCount * repeats;
+
+        CopyBenchmarkResult result;
+        result.Memory = memory;
+        result.Method = method;
+        result.Pattern = pattern;
+        result.PayloadSize = payloadSize;
+        result.GigabytesPerSecond = seconds > 0.0 ? elements * payloadSize / seconds / 1e9 : 0.0;
+        result.NanosecondsPerElement = elements > 0.0 ? seconds * 1e9 / elements : 0.0;
+        return result;
+    }
+}
+
+std::vector<CopyBenchmarkResult> RunCopyBenchmarks(void* destination, std::size_t destinationSize,
+                                                   const char* memory, std::uint32_t repeats)
+{
+    std::vector<CopyBenchmarkResult> results;
+
+    // Elements start on a line boundary, like the constants of an upload buffer
+    std::uint8_t* dst = static_cast<std::uint8_t*>(destination);
+    std::size_t skip = (StreamLineSize - (reinterpret_cast<std::uintptr_t>(dst) & (StreamLineSize - 1))) & (StreamLineSize - 1);
+    if (destinationSize < skip) return results;
+    dst += skip;
+    std::size_t elementCount = (destinationSize - skip) / DestinationStride;
+    if (elementCount == 0) return results;
+
+    // Shuffled element order for the scattered pattern
+    std::vector<std::uint32_t> order(elementCount);
+    for (std::size_t i = 0; i < elementCount; i++)
+        order[i] = (std::uint32_t)i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    // 16 bytes: a vector, 80: ObjectConstants, 128: two lines, 256: a whole constant buffer
+    const std::size_t payloadSizes[] = { 16, 80, 128, 256 };
+    for (std::size_t payloadSize : payloadSizes)
+    {
+        std::vector<std::uint8_t> source(elementCount * payloadSize);
+        for (std::size_t i = 0; i < source.size(); i++)
+            source[i] = (std::uint8_t)i;
+        const std::uint8_t* src = source.data();
+
+        results.push_back(Measure(memory, "memcpy", "sequential", payloadSize, elementCount, repeats, [&]
+        {
+            for (std::size_t i = 0; i < elementCount; i++)
+                memcpy(dst + i * DestinationStride, src + i * payloadSize, payloadSize);
+        }));
+
+        results.push_back(Measure(memory, "stream", "sequential", payloadSize, elementCount, repeats, [&]
+        {
+            for (std::size_t i = 0; i < elementCount; i++)
+                StreamCopyElements(dst + i * DestinationStride, DestinationStride, src + i * payloadSize, payloadSize, payloadSize, 1);
+        }));
+
+        results.push_back(Measure(memory, "stream batch", "sequential", payloadSize, elementCount, repeats, [&]
+        {
+            StreamCopyElements(dst, DestinationStride, src, payloadSize, payloadSize, elementCount);
+        }));
+
+        results.push_back(Measure(memory, "partial lines", "sequential", payloadSize, elementCount, repeats, [&]
+        {
+            for (std::size_t i = 0; i < elementCount; i++)
+                StreamPartialLines(dst + i * DestinationStride, src + i * payloadSize, payloadSize);
+        }));
+
+        results.push_back(Measure(memory, "memcpy", "scattered", payloadSize, elementCount, repeats, [&]
+        {
+            for (std::uint32_t i : order)
+                memcpy(dst + i * DestinationStride, src + i * payloadSize, payloadSize);
+        }));
+
+        results.push_back(Measure(memory, "stream", "scattered", payloadSize, elementCount, repeats, [&]
+        {
+            for (std::uint32_t i : order)
+                StreamCopyElements(dst + i * DestinationStride, DestinationStride, src + i * payloadSize, payloadSize, payloadSize, 1);
+        }));
+
+        results.push_back(Measure(memory, "partial lines", "scattered", payloadSize, elementCount, repeats, [&]
+        {
+            for (std::uint32_t i : order)
+                StreamPartialLines(dst + i * DestinationStride, src + i * payloadSize, payloadSize);
+        }));
+    }
+
+    return results;
+}
+
+std::vector<CopyBenchmarkResult> RunCopyBenchmarks(std::uint32_t repeats)
+{
+    // With room to align the start
+    std::vector<std::uint8_t> memory(DestinationSize + StreamLineSize);
+    std::vector<CopyBenchmarkResult> results = RunCopyBenchmarks(memory.data(), memory.size(), "cached", repeats);
+
+    void* writeCombined = AllocateWriteCombined(DestinationSize);
+    if (writeCombined != nullptr)
+    {
+        std::vector<CopyBenchmarkResult> combined = RunCopyBenchmarks(writeCombined, DestinationSize, "write-combined", repeats);
+        results.insert(results.end(), combined.begin(), combined.end());
+        FreeWriteCombined(writeCombined);
+    }
+    return results;
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct CopyBenchmarkResult
+{
+    const char* Memory = ""; // "cached" or "write-combined"
+    const char* Method = "";
+    const char* Pattern = "";
+    std::size_t PayloadSize = 0;
+    double GigabytesPerSecond = 0.0; // Payload bytes, the padding is not counted
+    double NanosecondsPerElement = 0.0;
+};
+
+// Copy elements of constant size into a 256 bytes stride destination, like the object
+// constants into an upload buffer, with memcpy and with the streaming copies.
+// "sequential" writes the elements in order, "scattered" in a shuffled order like dirty items.
+// "partial lines" writes only the payload with non-temporal stores, which go through the
+// write-combining buffers whatever the memory type: the lines it does not fill are flushed in
+// pieces, as memcpy does into write-combined memory. On ordinary memory it is the simulated
+// write-combined access to compare the streaming copies with.
+std::vector<CopyBenchmarkResult> RunCopyBenchmarks(void* destination, std::size_t destinationSize,
+                                                   const char* memory, std::uint32_t repeats);
+
+// Same on 64 MB of ordinary memory, then on 64 MB of write-combined pages when the system
+// gives them to applications (Windows)
+std::vector<CopyBenchmarkResult> RunCopyBenchmarks(std::uint32_t repeats);
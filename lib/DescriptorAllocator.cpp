@@ -0,0 +1,124 @@
+﻿#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+void DescriptorFreeList::Initialize(std::uint32_t first, std::uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mFirst = first;
+    mCount = count;
+    mUsed = 0;
+    mPeakUsed = 0;
+    mFailed = 0;
+
+    mFreeIndices.resize(count);
+    for (std::uint32_t i = 0; i < count; i++)
+        mFreeIndices[i] = first + count - 1 - i;
+}
+
+std::uint32_t DescriptorFreeList::Allocate()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mFreeIndices.empty())
+    {
+        mFailed++;
+        return InvalidDescriptorIndex;
+    }
+
+    std::uint32_t index = mFreeIndices.back();
+    mFreeIndices.pop_back();
+
+    mUsed++;
+    mPeakUsed = std::max(mPeakUsed, mUsed);
+    return index;
+}
+
+void DescriptorFreeList::Free(std::uint32_t index)
+{
+    if (index == InvalidDescriptorIndex) return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    assert(index >= mFirst && index < mFirst + mCount && mUsed > 0);
+
+    mFreeIndices.push_back(index);
+    mUsed--;
+}
+
+std::uint32_t DescriptorFreeList::GetCapacity() const
+{
+    return mCount;
+}
+
+std::uint32_t DescriptorFreeList::GetUsed() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mUsed;
+}
+
+std::uint32_t DescriptorFreeList::GetPeakUsed() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPeakUsed;
+}
+
+std::uint32_t DescriptorFreeList::GetFailedCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFailed;
+}
+
+void DescriptorFrameRing::Initialize(std::uint32_t first, std::uint32_t count, std::uint32_t frameCount)
+{
+    assert(frameCount > 0 && frameCount <= MaxFrames);
+
+    mFirst = first;
+    mSliceSize = count / frameCount;
+    mSliceFirst = first;
+    mCursor = 0;
+    mFailed = 0;
+    mPeakUsed = 0;
+}
+
+void DescriptorFrameRing::BeginFrame(std::uint32_t slot)
+{
+    mPeakUsed = std::max(mPeakUsed, GetUsed());
+
+    mSliceFirst = mFirst + slot * mSliceSize;
+    mCursor = 0;
+}
+
+std::uint32_t DescriptorFrameRing::Allocate(std::uint32_t count)
+{
+    std::uint32_t offset = mCursor.fetch_add(count);
+    if (offset + count > mSliceSize)
+    {
+        // The cursor stays past the end, the next allocations of the frame fail too
+        mFailed++;
+        return InvalidDescriptorIndex;
+    }
+
+    return mSliceFirst + offset;
+}
+
+std::uint32_t DescriptorFrameRing::GetFrameCapacity() const
+{
+    return mSliceSize;
+}
+
+std::uint32_t DescriptorFrameRing::GetUsed() const
+{
+    return std::min(mCursor.load(), mSliceSize);
+}
+
+std::uint32_t DescriptorFrameRing::GetPeakUsed() const
+{
+    return std::max(mPeakUsed, GetUsed());
+}
+
+std::uint32_t DescriptorFrameRing::GetFailedCount() const
+{
+    return mFailed;
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Descriptor index allocators, backend independent. The indices are slots of a descriptor heap.
+
+const std::uint32_t InvalidDescriptorIndex = ~0u;
+
+// Descriptors living until they are freed (views of meshes, textures...).
+// A stack of the free indices gives O(1) allocation and free, guarded by a mutex.
+class DescriptorFreeList
+{
+public:
+    // Serve the indices [first, first + count)
+    void Initialize(std::uint32_t first, std::uint32_t count);
+
+    // Return InvalidDescriptorIndex when every index is used
+    std::uint32_t Allocate();
+    void Free(std::uint32_t index);
+
+    std::uint32_t GetCapacity() const;
+    std::uint32_t GetUsed() const;
+    std::uint32_t GetPeakUsed() const;
+    std::uint32_t GetFailedCount() const;
+
+private:
+    mutable std::mutex mMutex;
+    std::vector<std::uint32_t> mFreeIndices; // Lowest index on top so the heap start is used first
+    std::uint32_t mFirst = 0;
+    std::uint32_t mCount = 0;
+    std::uint32_t mUsed = 0;
+    std::uint32_t mPeakUsed = 0;
+    std::uint32_t mFailed = 0;
+};
+
+// Descriptors written for one frame only (tables copied before a draw).
+// The range is split in one slice per frame slot, a slice is reset when the frame ring hands
+// its slot out again. Allocation is an atomic add so the recording threads can share it.
+class DescriptorFrameRing
+{
+public:
+    static const std::uint32_t MaxFrames = 4;
+
+    // Serve the indices [first, first + count) split in frameCount slices
+    void Initialize(std::uint32_t first, std::uint32_t count, std::uint32_t frameCount);
+
+    // Start allocating in the slice of slot, the GPU must be done with its previous frame.
+    // Not thread safe with Allocate.
+    void BeginFrame(std::uint32_t slot);
+
+    // First index of count contiguous descriptors, InvalidDescriptorIndex when the slice is full
+    std::uint32_t Allocate(std::uint32_t count);
+
+    std::uint32_t GetFrameCapacity() const;
+    std::uint32_t GetUsed() const; // In the current slice
+    std::uint32_t GetPeakUsed() const; // Most used in a frame
+    std::uint32_t GetFailedCount() const;
+
+private:
+    std::uint32_t mFirst = 0;
+    std::uint32_t mSliceSize = 0;
+    std::uint32_t mSliceFirst = 0;
+    std::atomic<std::uint32_t> mCursor{ 0 };
+    std::atomic<std::uint32_t> mFailed{ 0 };
+    std::uint32_t mPeakUsed = 0;
+};
@@ -0,0 +1,139 @@
+﻿#include "DescriptorBenchmark.h"
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "DescriptorAllocator.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    const std::uint32_t PersistentCount = 16384;
+    const std::uint32_t TransientCount = 4 * 16384;
+    const std::uint32_t FrameCount = DescriptorFrameRing::MaxFrames;
+
+    struct Run
+    {
+        DescriptorFreeList Persistent;
+        DescriptorFrameRing Transient;
+
+        // Checked run only: owner count of the persistent indices, frame stamp of the transient ones
+        std::unique_ptr<std::atomic<std::uint32_t>[]> Owners;
+        std::unique_ptr<std::atomic<std::uint32_t>[]> Stamps;
+        std::atomic<std::uint32_t> Errors{ 0 };
+    };
+
+    void RunWorker(Run& run, bool check, std::uint32_t frame, std::uint32_t operations,
+                   std::mt19937& random, std::vector<std::uint32_t>& live)
+    {
+        const std::uint32_t sliceSize = TransientCount / FrameCount;
+        const std::uint32_t sliceFirst = PersistentCount + (frame % FrameCount) * sliceSize;
+
+        for (std::uint32_t i = 0; i < operations; i++)
+        {
+            std::uint32_t pick = random() % 100;
+            if (pick < 30)
+            {
+                std::uint32_t index = run.Persistent.Allocate();
+                if (index == InvalidDescriptorIndex) continue;
+
+                if (check && (index >= PersistentCount || run.Owners[index].fetch_add(1) != 0))
+                    run.Errors++;
+                live.push_back(index);
+            }
+            else if (pick < 60 && !live.empty())
+            {
+                std::uint32_t victim = random() % (std::uint32_t)live.size();
+                std::uint32_t index = live[victim];
+                live[victim] = live.back();
+                live.pop_back();
+
+                if (check) run.Owners[index].fetch_sub(1);
+                run.Persistent.Free(index);
+            }
+            else
+            {
+                std::uint32_t count = 1 + random() % 8;
+                std::uint32_t first = run.Transient.Allocate(count);
+                if (first == InvalidDescriptorIndex || !check) continue;
+
+                if (first < sliceFirst || first + count > sliceFirst + sliceSize)
+                {
+                    run.Errors++;
+                    continue;
+                }
+
+                for (std::uint32_t d = first - PersistentCount; d < first - PersistentCount + count; d++)
+                {
+                    if (run.Stamps[d].exchange(frame + 1) == frame + 1)
+                        run.Errors++;
+                }
+            }
+        }
+    }
+
+    double RunFrames(Run& run, bool check, ThreadPool& pool, std::uint32_t threadCount, std::uint32_t frames,
+                     std::uint32_t operationsPerFrame, std::uint32_t seed)
+    {
+        run.Persistent.Initialize(0, PersistentCount);
+        run.Transient.Initialize(PersistentCount, TransientCount, FrameCount);
+
+        std::vector<std::mt19937> randoms;
+        std::vector<std::vector<std::uint32_t>> live(threadCount);
+        for (std::uint32_t t = 0; t < threadCount; t++)
+            randoms.emplace_back(seed + t);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (std::uint32_t frame = 0; frame < frames; frame++)
+        {
+            run.Transient.BeginFrame(frame % FrameCount);
+            pool.ParallelFor(threadCount, threadCount, [&](std::uint32_t t, std::uint32_t, std::uint32_t)
+            {
+                RunWorker(run, check, frame, operationsPerFrame / threadCount, randoms[t], live[t]);
+            });
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        // Everything freed, the free list must be whole again
+        for (std::vector<std::uint32_t>& indices : live)
+        {
+            for (std::uint32_t index : indices)
+                run.Persistent.Free(index);
+        }
+        if (run.Persistent.GetUsed() != 0)
+            run.Errors++;
+
+        return std::chrono::duration<double, std::nano>(end - start).count();
+    }
+}
+
+DescriptorBenchmarkResult RunDescriptorBenchmark(std::uint32_t threadCount, std::uint32_t frames,
+                                                 std::uint32_t operationsPerFrame, std::uint32_t seed)
+{
+    DescriptorBenchmarkResult result;
+    result.Threads = threadCount;
+    result.Operations = frames * (operationsPerFrame / threadCount) * threadCount;
+
+    // The calling thread runs one of the ranges
+    ThreadPool pool(threadCount - 1);
+
+    Run timed;
+    double ns = RunFrames(timed, false, pool, threadCount, frames, operationsPerFrame, seed);
+    result.OperationNs = result.Operations != 0 ? ns / result.Operations : 0.0;
+    result.FailedAllocations = timed.Persistent.GetFailedCount() + timed.Transient.GetFailedCount();
+    result.PersistentPeak = timed.Persistent.GetPeakUsed();
+    result.TransientPeak = timed.Transient.GetPeakUsed();
+
+    Run checked;
+    checked.Owners.reset(new std::atomic<std::uint32_t>[PersistentCount]);
+    checked.Stamps.reset(new std::atomic<std::uint32_t>[TransientCount]);
+    for (std::uint32_t i = 0; i < PersistentCount; i++) checked.Owners[i] = 0;
+    for (std::uint32_t i = 0; i < TransientCount; i++) checked.Stamps[i] = 0;
+
+    RunFrames(checked, true, pool, threadCount, frames, operationsPerFrame, seed);
+    result.Errors = checked.Errors;
+
+    return result;
+}
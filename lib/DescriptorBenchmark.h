@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#include <cstdint>
+
+struct DescriptorBenchmarkResult
+{
+    std::uint32_t Threads = 0;
+    std::uint32_t Operations = 0;
+    double OperationNs = 0.0; // Wall time of the run divided by the operations of every thread
+
+    std::uint32_t FailedAllocations = 0;
+
+    // Indices handed to two owners at once or outside their region, checked on a second run
+    std::uint32_t Errors = 0;
+
+    std::uint32_t PersistentPeak = 0;
+    std::uint32_t TransientPeak = 0; // Most descriptors used in a frame
+};
+
+// Threads allocating and freeing persistent descriptors and allocating transient tables of 1 to 8
+// descriptors in frames cycling over frameCount slots. Same seed, same operations for every thread.
+DescriptorBenchmarkResult RunDescriptorBenchmark(std::uint32_t threadCount, std::uint32_t frames,
+                                                 std::uint32_t operationsPerFrame, std::uint32_t seed);
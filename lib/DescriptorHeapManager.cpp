@@ -0,0 +1,160 @@
+﻿#include "DescriptorHeapManager.h"
+
+#include "d3dUtils.h"
+
+DescriptorHeapManager::DescriptorHeapManager()
+{
+}
+
+DescriptorHeapManager::~DescriptorHeapManager()
+{
+    Release();
+}
+
+bool DescriptorHeapManager::Initialize(ID3D12Device* device, UINT persistentCount, UINT transientCount, UINT frameCount)
+{
+    mDevice = device;
+    mDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
+    heapDesc.NumDescriptors = persistentCount + transientCount;
+    heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    heapDesc.NodeMask = 0;
+    HRESULT result = device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mShaderVisibleHeap));
+    if (FAILED(result))
+    {
+        std::cerr << "Failed to create shader visible descriptor heap !\n";
+        return false;
+    }
+
+    heapDesc.NumDescriptors = persistentCount;
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    result = device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mStagingHeap));
+    if (FAILED(result))
+    {
+        std::cerr << "Failed to create staging descriptor heap !\n";
+        Release();
+        return false;
+    }
+
+    mVisibleCpuStart = mShaderVisibleHeap->GetCPUDescriptorHandleForHeapStart();
+    mVisibleGpuStart = mShaderVisibleHeap->GetGPUDescriptorHandleForHeapStart();
+    mStagingCpuStart = mStagingHeap->GetCPUDescriptorHandleForHeapStart();
+
+    mPersistent.Initialize(0, persistentCount);
+    mTransient.Initialize(persistentCount, transientCount, frameCount);
+    return true;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeapManager::GetVisibleCpu(UINT index) const
+{
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(mVisibleCpuStart, (INT)index, mDescriptorSize);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeapManager::GetVisibleGpu(UINT index) const
+{
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(mVisibleGpuStart, (INT)index, mDescriptorSize);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeapManager::GetStagingCpu(UINT index) const
+{
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(mStagingCpuStart, (INT)index, mDescriptorSize);
+}
+
+DescriptorHandle DescriptorHeapManager::AllocatePersistent()
+{
+    DescriptorHandle handle;
+    UINT index = mPersistent.Allocate();
+    if (index == InvalidDescriptorIndex) return handle;
+
+    // Same index in the staging heap and in the persistent region of the visible heap
+    handle.Index = index;
+    handle.Count = 1;
+    handle.Cpu = GetStagingCpu(index);
+    handle.Gpu = GetVisibleGpu(index);
+    return handle;
+}
+
+void DescriptorHeapManager::FreePersistent(DescriptorHandle& handle)
+{
+    if (!handle.IsValid()) return;
+
+    mPersistent.Free(handle.Index);
+    handle = DescriptorHandle();
+}
+
+void DescriptorHeapManager::Update(const DescriptorHandle& handle)
+{
+    if (!handle.IsValid()) return;
+
+    mDevice->CopyDescriptorsSimple(handle.Count, GetVisibleCpu(handle.Index), handle.Cpu,
+                                   D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+void DescriptorHeapManager::BeginFrame(UINT slot)
+{
+    mTransient.BeginFrame(slot);
+}
+
+DescriptorHandle DescriptorHeapManager::AllocateTransient(UINT count)
+{
+    DescriptorHandle handle;
+    UINT index = mTransient.Allocate(count);
+    if (index == InvalidDescriptorIndex) return handle;
+
+    handle.Index = index;
+    handle.Count = count;
+    handle.Cpu = GetVisibleCpu(index);
+    handle.Gpu = GetVisibleGpu(index);
+    return handle;
+}
+
+DescriptorHandle DescriptorHeapManager::CopyToTransient(const D3D12_CPU_DESCRIPTOR_HANDLE* sources, UINT count)
+{
+    DescriptorHandle handle = AllocateTransient(count);
+    if (!handle.IsValid()) return handle;
+
+    // Sources are scattered, each one is a range of one descriptor
+    mDevice->CopyDescriptors(1, &handle.Cpu, &count, count, sources, nullptr,
+                             D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    return handle;
+}
+
+ID3D12DescriptorHeap* DescriptorHeapManager::GetShaderVisibleHeap() const
+{
+    return mShaderVisibleHeap;
+}
+
+UINT DescriptorHeapManager::GetDescriptorSize() const
+{
+    return mDescriptorSize;
+}
+
+DescriptorStats DescriptorHeapManager::GetStats() const
+{
+    DescriptorStats stats;
+    stats.PersistentCapacity = mPersistent.GetCapacity();
+    stats.PersistentUsed = mPersistent.GetUsed();
+    stats.PersistentPeak = mPersistent.GetPeakUsed();
+    stats.TransientCapacity = mTransient.GetFrameCapacity();
+    stats.TransientUsed = mTransient.GetUsed();
+    stats.TransientPeak = mTransient.GetPeakUsed();
+    stats.FailedAllocations = mPersistent.GetFailedCount() + mTransient.GetFailedCount();
+    return stats;
+}
+
+void DescriptorHeapManager::Release()
+{
+    if (mShaderVisibleHeap)
+    {
+        mShaderVisibleHeap->Release();
+        mShaderVisibleHeap = nullptr;
+    }
+
+    if (mStagingHeap)
+    {
+        mStagingHeap->Release();
+        mStagingHeap = nullptr;
+    }
+}
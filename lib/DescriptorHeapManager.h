@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include <d3d12.h>
+
+#include "DescriptorAllocator.h"
+
+// Descriptors of the shader visible heap. Cpu is the handle the views are written to,
+// for a persistent descriptor it is in the staging heap and Update copies it to the visible heap.
+struct DescriptorHandle
+{
+    UINT Index = InvalidDescriptorIndex; // In the shader visible heap
+    UINT Count = 0;
+    D3D12_CPU_DESCRIPTOR_HANDLE Cpu = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE Gpu = {};
+
+    bool IsValid() const { return Index != InvalidDescriptorIndex; }
+};
+
+struct DescriptorStats
+{
+    UINT PersistentCapacity = 0;
+    UINT PersistentUsed = 0;
+    UINT PersistentPeak = 0;
+    UINT TransientCapacity = 0; // Per frame
+    UINT TransientUsed = 0; // This frame
+    UINT TransientPeak = 0;
+    UINT FailedAllocations = 0;
+};
+
+// One big shader visible CBV/SRV/UAV heap, bound once per command list and never recreated.
+//   [0, persistentCount)  persistent descriptors, from a free list
+//   [persistentCount, persistentCount + transientCount)  one slice per frame slot, bump allocated
+// Views are created in a CPU only staging heap mirroring the persistent region: the visible heap
+// is write combined memory and can not be the source of a copy.
+// Allocations are O(1) and can be made from any thread.
+class DescriptorHeapManager
+{
+public:
+    static const UINT DefaultPersistentCount = 16384;
+    static const UINT DefaultTransientCount = 4 * 4096;
+
+    DescriptorHeapManager();
+    ~DescriptorHeapManager();
+
+    DescriptorHeapManager(const DescriptorHeapManager& rhs) = delete;
+    DescriptorHeapManager& operator=(const DescriptorHeapManager& rhs) = delete;
+
+    // transientCount is split between frameCount slots
+    bool Initialize(ID3D12Device* device, UINT persistentCount = DefaultPersistentCount,
+                    UINT transientCount = DefaultTransientCount, UINT frameCount = DescriptorFrameRing::MaxFrames);
+
+    // Cpu is in the staging heap, call Update once the view is written
+    DescriptorHandle AllocatePersistent();
+    void FreePersistent(DescriptorHandle& handle); // The GPU must be done with the frames using it
+
+    // Copy the staging descriptor to the visible heap
+    void Update(const DescriptorHandle& handle);
+
+    // The GPU must be done with the previous frame of slot
+    void BeginFrame(UINT slot);
+
+    // count contiguous descriptors valid for this frame, Cpu is in the visible heap
+    DescriptorHandle AllocateTransient(UINT count);
+
+    // Gather staging descriptors in a transient table
+    DescriptorHandle CopyToTransient(const D3D12_CPU_DESCRIPTOR_HANDLE* sources, UINT count);
+
+    ID3D12DescriptorHeap* GetShaderVisibleHeap() const;
+    UINT GetDescriptorSize() const;
+    DescriptorStats GetStats() const;
+
+    void Release();
+
+private:
+    D3D12_CPU_DESCRIPTOR_HANDLE GetVisibleCpu(UINT index) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetVisibleGpu(UINT index) const;
+    D3D12_CPU_DESCRIPTOR_HANDLE GetStagingCpu(UINT index) const;
+
+    ID3D12Device* mDevice = nullptr;
+    ID3D12DescriptorHeap* mShaderVisibleHeap = nullptr;
+    ID3D12DescriptorHeap* mStagingHeap = nullptr;
+    UINT mDescriptorSize = 0;
+
+    D3D12_CPU_DESCRIPTOR_HANDLE mVisibleCpuStart = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE mVisibleGpuStart = {};
+    D3D12_CPU_DESCRIPTOR_HANDLE mStagingCpuStart = {};
+
+    DescriptorFreeList mPersistent;
+    DescriptorFrameRing mTransient;
+};
@@ -0,0 +1,99 @@
+﻿#include "DirtyTracker.h"
+
+#include <cassert>
+
+void DirtyTracker::Initialize(std::uint32_t slotCount)
+{
+    assert(slotCount > 0 && slotCount <= MaxSlots);
+
+    mSlotCount = slotCount;
+    mAllSlots = (std::uint8_t)((1u << slotCount) - 1);
+    mPending.clear();
+    mPendingSlots.assign(mPendingSlots.size(), 0);
+    mWholeSlots = mAllSlots;
+}
+
+void DirtyTracker::Resize(std::uint32_t itemCount)
+{
+    if (itemCount < mPendingSlots.size())
+    {
+        size_t kept = 0;
+        for (size_t p = 0; p < mPending.size(); p++)
+        {
+            if (mPending[p] < itemCount)
+                mPending[kept++] = mPending[p];
+        }
+        mPending.resize(kept);
+    }
+
+    mPendingSlots.resize(itemCount, 0);
+}
+
+void DirtyTracker::Mark(std::uint32_t item)
+{
+    assert(item < mPendingSlots.size());
+
+    if (mPendingSlots[item] == 0)
+        mPending.push_back(item);
+    mPendingSlots[item] = mAllSlots;
+}
+
+void DirtyTracker::MarkAll()
+{
+    mWholeSlots = mAllSlots;
+}
+
+void DirtyTracker::MarkSlot(std::uint32_t slot)
+{
+    assert(slot < mSlotCount);
+    mWholeSlots |= (std::uint8_t)(1u << slot);
+}
+
+void DirtyTracker::Collect(std::uint32_t slot, std::vector<std::uint32_t>& items)
+{
+    assert(slot < mSlotCount);
+
+    items.clear();
+    const std::uint8_t bit = (std::uint8_t)(1u << slot);
+    const bool wholeSlot = (mWholeSlots & bit) != 0;
+
+    if (wholeSlot)
+    {
+        mWholeSlots &= (std::uint8_t)~bit;
+        items.resize(mPendingSlots.size());
+        for (std::uint32_t i = 0; i < (std::uint32_t)items.size(); i++)
+            items[i] = i;
+    }
+
+    // Pending items leave the list once every slot got them
+    size_t p = 0;
+    while (p < mPending.size())
+    {
+        std::uint32_t item = mPending[p];
+        if ((mPendingSlots[item] & bit) != 0)
+        {
+            if (!wholeSlot) items.push_back(item);
+            mPendingSlots[item] &= (std::uint8_t)~bit;
+        }
+
+        if (mPendingSlots[item] == 0)
+        {
+            mPending[p] = mPending.back();
+            mPending.pop_back();
+        }
+        else
+        {
+            p++;
+        }
+    }
+}
+
+std::uint32_t DirtyTracker::GetItemCount() const
+{
+    return (std::uint32_t)mPendingSlots.size();
+}
+
+std::uint32_t DirtyTracker::GetPendingCount() const
+{
+    return (std::uint32_t)mPending.size();
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Items whose GPU copy must be written again. Each frame slot has its own copy of the
+// item data, so a changed item stays pending until it was collected once for every slot.
+class DirtyTracker
+{
+public:
+    static const std::uint32_t MaxSlots = 8;
+
+    // Every item is pending for every slot after it
+    void Initialize(std::uint32_t slotCount);
+
+    // Items past the new size are forgotten, new items are not pending until marked
+    void Resize(std::uint32_t itemCount);
+
+    void Mark(std::uint32_t item);
+
+    // Every item is pending for every slot, or for one slot when its copy was recreated
+    void MarkAll();
+    void MarkSlot(std::uint32_t slot);
+
+    // Fill items with what must be written in slot and forget them for that slot
+    void Collect(std::uint32_t slot, std::vector<std::uint32_t>& items);
+
+    std::uint32_t GetItemCount() const;
+    std::uint32_t GetPendingCount() const;
+
+private:
+    std::uint32_t mSlotCount = 1;
+    std::uint8_t mAllSlots = 1;
+    std::uint8_t mWholeSlots = 0; // Slots where every item is pending
+
+    std::vector<std::uint8_t> mPendingSlots; // Per item, bit per slot still to write
+    std::vector<std::uint32_t> mPending; // Items with at least one slot bit
+};
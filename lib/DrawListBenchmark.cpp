@@ -0,0 +1,103 @@
+﻿#include "DrawListBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "RadixSort.h"
+#include "RetainedDrawList.h"
+
+namespace
+{
+    // Layout of the DrawQueue keys: pass (3) | pso (9) | mesh (14) | depth bucket (14) | item (24)
+    std::uint64_t MakeKey(std::uint32_t pso, std::uint32_t mesh, std::uint32_t depth, std::uint32_t item)
+    {
+        return ((std::uint64_t)(pso & 0x1FF) << 52) | ((std::uint64_t)(mesh & 0x3FFF) << 38) |
+            ((std::uint64_t)(depth & 0x3FFF) << 24) | (item & 0xFFFFFF);
+    }
+
+    double Elapsed(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+DrawListBenchmarkResult RunDrawListBenchmark(std::uint32_t itemCount, float churnPercent, std::uint32_t frames, std::uint32_t seed)
+{
+    DrawListBenchmarkResult result;
+    result.Items = itemCount;
+    result.Frames = frames;
+    result.ChangesPerFrame = (std::uint32_t)((double)itemCount * churnPercent / 100.0);
+    result.Valid = true;
+
+    std::mt19937 random(seed);
+    std::vector<std::uint32_t> meshes(itemCount);
+    std::vector<std::uint32_t> pipelines(itemCount);
+    std::vector<std::uint64_t> itemKeys(itemCount, RetainedDrawList::InvalidKey);
+
+    RetainedDrawList list;
+    list.Resize(itemCount);
+    for (std::uint32_t i = 0; i < itemCount; i++)
+    {
+        meshes[i] = random() % 2048;
+        pipelines[i] = random() % 8;
+        if (random() % 10 == 0) continue;
+
+        itemKeys[i] = MakeKey(pipelines[i], meshes[i], random() % 0x4000, i);
+        list.Set(i, itemKeys[i]);
+    }
+    list.Apply();
+
+    std::vector<std::uint32_t> changed(result.ChangesPerFrame);
+    std::vector<std::uint64_t> rebuilt;
+    std::vector<std::uint64_t> scratch;
+    for (std::uint32_t frame = 0; frame < frames; frame++)
+    {
+        // What changes this frame, drawn before the timing
+        for (std::uint32_t& item : changed)
+            item = random() % itemCount;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (std::uint32_t item : changed)
+        {
+            if (itemKeys[item] != RetainedDrawList::InvalidKey && random() % 8 == 0)
+            {
+                itemKeys[item] = RetainedDrawList::InvalidKey;
+                list.Remove(item);
+                continue;
+            }
+
+            itemKeys[item] = MakeKey(pipelines[item], meshes[item], random() % 0x4000, item);
+            list.Set(item, itemKeys[item]);
+        }
+        list.Apply();
+        double retainedMs = Elapsed(start);
+        result.RetainedMs += retainedMs;
+        result.WorstRetainedMs = std::max(result.WorstRetainedMs, retainedMs);
+
+        // What the draw queue does every frame
+        start = std::chrono::high_resolution_clock::now();
+        rebuilt.clear();
+        for (std::uint32_t i = 0; i < itemCount; i++)
+        {
+            if (itemKeys[i] != RetainedDrawList::InvalidKey)
+                rebuilt.push_back(itemKeys[i]);
+        }
+        RadixSortKeys(rebuilt, scratch);
+        result.RebuildMs += Elapsed(start);
+
+        if (result.Valid && rebuilt != list.GetKeys())
+        {
+            result.Valid = false;
+            result.Error = "retained keys differ from the rebuilt ones at frame " + std::to_string(frame);
+        }
+    }
+
+    if (frames > 0)
+    {
+        result.RebuildMs /= frames;
+        result.RetainedMs /= frames;
+    }
+    return result;
+}
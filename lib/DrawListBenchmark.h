@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct DrawListBenchmarkResult
+{
+    std::uint32_t Items = 0;
+    std::uint32_t Frames = 0;
+    std::uint32_t ChangesPerFrame = 0; // Items given a new key, leaving or entering the list
+
+    // Average of a frame
+    double RebuildMs = 0.0; // Key of every listed item pushed and radix sorted
+    double RetainedMs = 0.0; // Changes given to the retained list and merged
+    double WorstRetainedMs = 0.0;
+
+    // The retained keys are the rebuilt ones every frame
+    bool Valid = false;
+    std::string Error;
+};
+
+// itemCount items with draw queue keys, 90% of them listed at the start. Every frame churnPercent of
+// the items change: most listed ones get a new depth, some leave, unlisted ones enter. Same seed
+// same frames.
+DrawListBenchmarkResult RunDrawListBenchmark(std::uint32_t itemCount, float churnPercent, std::uint32_t frames, std::uint32_t seed);
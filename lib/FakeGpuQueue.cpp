@@ -0,0 +1,92 @@
+﻿#include "FakeGpuQueue.h"
+
+#include <chrono>
+
+FakeGpuQueue::FakeGpuQueue(double latencyMs) : mLatencyMs(latencyMs)
+{
+    mThread = std::thread(&FakeGpuQueue::GpuLoop, this);
+}
+
+FakeGpuQueue::~FakeGpuQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWorkAvailable.notify_all();
+    mThread.join();
+}
+
+void FakeGpuQueue::SetLatency(double latencyMs)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLatencyMs = latencyMs;
+}
+
+void FakeGpuQueue::Submit(std::function<void()> work)
+{
+    Entry entry;
+    entry.Work = std::move(work);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries.push_back(std::move(entry));
+    }
+    mWorkAvailable.notify_one();
+}
+
+std::uint64_t FakeGpuQueue::Signal()
+{
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        entry.FenceValue = ++mNextFence;
+        mEntries.push_back(entry);
+    }
+    mWorkAvailable.notify_one();
+    return entry.FenceValue;
+}
+
+std::uint64_t FakeGpuQueue::GetCompletedValue()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCompleted;
+}
+
+void FakeGpuQueue::WaitForValue(std::uint64_t value)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFenceReached.wait(lock, [&] { return mCompleted >= value; });
+}
+
+void FakeGpuQueue::GpuLoop()
+{
+    for (;;)
+    {
+        Entry entry;
+        double latencyMs;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWorkAvailable.wait(lock, [&] { return mStop || !mEntries.empty(); });
+            if (mEntries.empty()) return; // Stopping with nothing left to run
+
+            entry = std::move(mEntries.front());
+            mEntries.pop_front();
+            latencyMs = mLatencyMs;
+        }
+
+        if (entry.FenceValue != 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mCompleted = entry.FenceValue;
+            }
+            mFenceReached.notify_all();
+            continue;
+        }
+
+        // Time spent by the GPU on the submission, the work itself run at the end
+        // as it would read the frame resources while rendering
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(latencyMs));
+        if (entry.Work) entry.Work();
+    }
+}
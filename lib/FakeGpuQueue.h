@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "GpuQueue.h"
+
+// Headless stand-in for a GPU queue. Submitted work runs in order on a thread playing the GPU,
+// each submission takes at least the configured latency, so the frame loop and the reuse of
+// frame resources can be checked without a device.
+class FakeGpuQueue : public IGpuQueue
+{
+public:
+    FakeGpuQueue(double latencyMs = 0.0);
+    ~FakeGpuQueue();
+
+    FakeGpuQueue(const FakeGpuQueue& rhs) = delete;
+    FakeGpuQueue& operator=(const FakeGpuQueue& rhs) = delete;
+
+    void SetLatency(double latencyMs);
+
+    // work is called on the GPU thread when the queue reaches it
+    void Submit(std::function<void()> work);
+
+    std::uint64_t Signal() override;
+    std::uint64_t GetCompletedValue() override;
+    void WaitForValue(std::uint64_t value) override;
+
+private:
+    struct Entry
+    {
+        std::function<void()> Work;
+        std::uint64_t FenceValue = 0; // Fence marker when not 0
+    };
+
+    void GpuLoop();
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mFenceReached;
+    std::deque<Entry> mEntries;
+    double mLatencyMs;
+    std::uint64_t mNextFence = 0;
+    std::uint64_t mCompleted = 0;
+    bool mStop = false;
+};
@@ -0,0 +1,58 @@
+﻿#include "FrameLoopSimulation.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "FakeGpuQueue.h"
+#include "FrameRing.h"
+
+FrameLoopSimulationResult SimulateFrameLoop(std::uint32_t framesInFlight, std::uint32_t frames,
+                                            double cpuMs, double gpuMs)
+{
+    FrameLoopSimulationResult result;
+    result.FramesInFlight = framesInFlight;
+    result.Frames = frames;
+
+    FakeGpuQueue queue(gpuMs);
+    FrameRing ring;
+    ring.Initialize(&queue, framesInFlight);
+    bool flushEveryFrame = framesInFlight < FrameRing::MinFrames;
+
+    // Stand-in for the constant memory of each slot
+    std::atomic<std::uint32_t> slotData[FrameRing::MaxFrames];
+    for (std::uint32_t i = 0; i < FrameRing::MaxFrames; i++)
+        slotData[i] = ~0u;
+    std::atomic<std::uint32_t> reuseErrors(0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (std::uint32_t frame = 0; frame < frames; frame++)
+    {
+        std::uint32_t slot = ring.BeginFrame();
+
+        // Recording, the slot memory is written at the start and read by the GPU later
+        slotData[slot] = frame;
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(cpuMs));
+
+        queue.Submit([&slotData, &reuseErrors, slot, frame]
+        {
+            if (slotData[slot] != frame)
+                reuseErrors++;
+        });
+        ring.EndFrame();
+
+        if (flushEveryFrame)
+            ring.WaitIdle();
+    }
+
+    ring.WaitIdle();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    result.TotalMs = std::chrono::duration<double, std::milli>(end - start).count();
+    result.FramesPerSecond = result.TotalMs > 0.0 ? frames * 1000.0 / result.TotalMs : 0.0;
+    result.Waits = ring.GetWaitCount();
+    result.WaitTimeMs = ring.GetWaitTimeMs();
+    result.ReuseErrors = reuseErrors;
+    return result;
+}
@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#include <cstdint>
+
+struct FrameLoopSimulationResult
+{
+    std::uint32_t FramesInFlight = 0;
+    std::uint32_t Frames = 0;
+    double TotalMs = 0.0;
+    double FramesPerSecond = 0.0;
+    std::uint64_t Waits = 0;
+    double WaitTimeMs = 0.0;
+
+    // Frames whose resources were overwritten by the CPU before the fake GPU read them
+    std::uint32_t ReuseErrors = 0;
+};
+
+// Run frames of cpuMs of recording against a FakeGpuQueue taking gpuMs per frame.
+// framesInFlight 1 flushes the queue after every frame like the renderer used to,
+// 2 to 4 go through a FrameRing. Every frame writes its number in the memory of its slot
+// and the fake GPU checks it is still there when it renders the frame.
+FrameLoopSimulationResult SimulateFrameLoop(std::uint32_t framesInFlight, std::uint32_t frames,
+                                            double cpuMs, double gpuMs);
@@ -0,0 +1,82 @@
+﻿#include "FrameRing.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+// Taken by reference by std::min and std::max
+const std::uint32_t FrameRing::MinFrames;
+const std::uint32_t FrameRing::MaxFrames;
+
+FrameRing::FrameRing()
+{
+}
+
+void FrameRing::Initialize(IGpuQueue* queue, std::uint32_t frameCount)
+{
+    mQueue = queue;
+    mFrameCount = std::min(std::max(frameCount, MinFrames), MaxFrames);
+
+    // Start on the last slot so the first BeginFrame use slot 0
+    mCurrentIndex = mFrameCount - 1;
+    for (std::uint32_t i = 0; i < MaxFrames; i++)
+        mFences[i] = 0;
+}
+
+std::uint32_t FrameRing::BeginFrame()
+{
+    assert(mQueue != nullptr);
+
+    mCurrentIndex = (mCurrentIndex + 1) % mFrameCount;
+
+    std::uint64_t fence = mFences[mCurrentIndex];
+    if (fence != 0 && mQueue->GetCompletedValue() < fence)
+    {
+        // The CPU lapped the GPU
+        auto start = std::chrono::high_resolution_clock::now();
+        mQueue->WaitForValue(fence);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        mWaitCount++;
+        mWaitTimeMs += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    return mCurrentIndex;
+}
+
+void FrameRing::EndFrame()
+{
+    mFences[mCurrentIndex] = mQueue->Signal();
+}
+
+void FrameRing::WaitIdle()
+{
+    if (mQueue == nullptr) return;
+
+    std::uint64_t last = 0;
+    for (std::uint32_t i = 0; i < mFrameCount; i++)
+        last = std::max(last, mFences[i]);
+
+    if (last != 0)
+        mQueue->WaitForValue(last);
+}
+
+std::uint32_t FrameRing::GetFrameCount() const
+{
+    return mFrameCount;
+}
+
+std::uint32_t FrameRing::GetCurrentIndex() const
+{
+    return mCurrentIndex;
+}
+
+std::uint64_t FrameRing::GetWaitCount() const
+{
+    return mWaitCount;
+}
+
+double FrameRing::GetWaitTimeMs() const
+{
+    return mWaitTimeMs;
+}
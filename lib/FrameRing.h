@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include "GpuQueue.h"
+
+// Ring of per frame resources (command allocators, constant memory...) so the CPU records
+// a frame while the GPU renders the previous ones. Each slot remembers the fence of the frame
+// that last used it, the CPU only waits when it comes back to a slot the GPU still reads.
+class FrameRing
+{
+public:
+    static const std::uint32_t MinFrames = 2;
+    static const std::uint32_t MaxFrames = 4;
+
+    FrameRing();
+
+    // Wait for the queue to be idle when changing the frame count of a running ring
+    void Initialize(IGpuQueue* queue, std::uint32_t frameCount);
+
+    // Move to the next slot and return its index, the resources of the slot are free to reuse
+    std::uint32_t BeginFrame();
+
+    // The commands of the current frame are submitted, tag the slot with a new fence
+    void EndFrame();
+
+    // Wait until the GPU is done with every slot
+    void WaitIdle();
+
+    std::uint32_t GetFrameCount() const;
+    std::uint32_t GetCurrentIndex() const;
+
+    // Frames where BeginFrame had to block, and how long it did in total
+    std::uint64_t GetWaitCount() const;
+    double GetWaitTimeMs() const;
+
+private:
+    IGpuQueue* mQueue = nullptr;
+    std::uint32_t mFrameCount = 0;
+    std::uint32_t mCurrentIndex = 0;
+    std::uint64_t mFences[MaxFrames] = {};
+    std::uint64_t mWaitCount = 0;
+    double mWaitTimeMs = 0.0;
+};
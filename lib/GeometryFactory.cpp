@@ -4,14 +4,14 @@
 
 #include "GeometryFactory.h"
 #include <algorithm>
-#include "d3dUtils.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
 
-using namespace DirectX;
-
-GeometryFactory::GeometryFactory(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList)
+GeometryFactory::GeometryFactory(IRenderDevice* pDevice)
 {
 	mpDevice = pDevice;
-	mpCommandList = pCommandList;
 }
 
 RenderMesh* GeometryFactory::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
@@ -127,8 +127,8 @@ RenderMesh* GeometryFactory::CreateSphere(float radius, uint32 sliceCount, uint3
 
 	meshData.Vertices.push_back( topVertex );
 
-	float phiStep   = XM_PI/stackCount;
-	float thetaStep = 2.0f*XM_PI/sliceCount;
+	float phiStep   = Maths::PI/stackCount;
+	float thetaStep = 2.0f*Maths::PI/sliceCount;
 
 	// Compute vertices for each stack ring (do not count the poles as rings).
 	for(uint32 i = 1; i <= stackCount-1; ++i)
@@ -152,14 +152,11 @@ RenderMesh* GeometryFactory::CreateSphere(float radius, uint32 sliceCount, uint3
 			v.TangentU.y = 0.0f;
 			v.TangentU.z = +radius*sinf(phi)*cosf(theta);
 
-			XMVECTOR T = XMLoadFloat3(&v.TangentU);
-			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
-
-			XMVECTOR p = XMLoadFloat3(&v.Position);
-			XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
+			v.TangentU = Maths::Normalize(v.TangentU);
+			v.Normal = Maths::Normalize(v.Position);
 
-			v.TexC.x = theta / XM_2PI;
-			v.TexC.y = phi / XM_PI;
+			v.TexC.x = theta / (2.0f*Maths::PI);
+			v.TexC.y = phi / Maths::PI;
 
 			meshData.Vertices.push_back( v );
 		}
@@ -238,14 +235,14 @@ RenderMesh* GeometryFactory::CreateGeosphere(float radius, uint32 numSubdivision
 	const float X = 0.525731f; 
 	const float Z = 0.850651f;
 
-	XMFLOAT3 pos[12] = 
+	Float3 pos[12] = 
 	{
-		XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),  
-		XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),    
-		XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X), 
-		XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),    
-		XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f), 
-		XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
+		Float3(-X, 0.0f, Z),  Float3(X, 0.0f, Z),  
+		Float3(-X, 0.0f, -Z), Float3(X, 0.0f, -Z),    
+		Float3(0.0f, Z, X),   Float3(0.0f, Z, -X), 
+		Float3(0.0f, -Z, X),  Float3(0.0f, -Z, -X),    
+		Float3(Z, X, 0.0f),   Float3(-Z, X, 0.0f), 
+		Float3(Z, -X, 0.0f),  Float3(-Z, -X, 0.0f)
 	};
 
     uint32 k[60] =
@@ -269,33 +266,32 @@ RenderMesh* GeometryFactory::CreateGeosphere(float radius, uint32 numSubdivision
 	for(uint32 i = 0; i < meshData.Vertices.size(); ++i)
 	{
 		// Project onto unit sphere.
-		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.Vertices[i].Position));
+		Float3 n = Maths::Normalize(meshData.Vertices[i].Position);
 
 		// Project onto sphere.
-		XMVECTOR p = radius*n;
+		Float3 p = radius*n;
 
-		XMStoreFloat3(&meshData.Vertices[i].Position, p);
-		XMStoreFloat3(&meshData.Vertices[i].Normal, n);
+		meshData.Vertices[i].Position = p;
+		meshData.Vertices[i].Normal = n;
 
 		// Derive texture coordinates from spherical coordinates.
         float theta = atan2f(meshData.Vertices[i].Position.z, meshData.Vertices[i].Position.x);
 
         // Put in [0, 2pi].
         if(theta < 0.0f)
-            theta += XM_2PI;
+            theta += 2.0f*Maths::PI;
 
 		float phi = acosf(meshData.Vertices[i].Position.y / radius);
 
-		meshData.Vertices[i].TexC.x = theta/XM_2PI;
-		meshData.Vertices[i].TexC.y = phi/XM_PI;
+		meshData.Vertices[i].TexC.x = theta/(2.0f*Maths::PI);
+		meshData.Vertices[i].TexC.y = phi/Maths::PI;
 
 		// Partial derivative of P with respect to theta
 		meshData.Vertices[i].TangentU.x = -radius*sinf(phi)*sinf(theta);
 		meshData.Vertices[i].TangentU.y = 0.0f;
 		meshData.Vertices[i].TangentU.z = +radius*sinf(phi)*cosf(theta);
 
-		XMVECTOR T = XMLoadFloat3(&meshData.Vertices[i].TangentU);
-		XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
+		meshData.Vertices[i].TangentU = Maths::Normalize(meshData.Vertices[i].TangentU);
 	}
 
 	RenderMesh* geometry = new RenderMesh();
@@ -333,9 +329,9 @@ RenderMesh* GeometryFactory::CreateGrid(float width, float depth, uint32 m, uint
 		{
 			float x = -halfWidth + j*dx;
 
-			meshData.Vertices[i*n+j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i*n+j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i*n+j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+			meshData.Vertices[i*n+j].Position = Float3(x, 0.0f, z);
+			meshData.Vertices[i*n+j].Normal   = Float3(0.0f, 1.0f, 0.0f);
+			meshData.Vertices[i*n+j].TangentU = Float3(1.0f, 0.0f, 0.0f);
 
 			// Stretch texture over grid.
 			meshData.Vertices[i*n+j].TexC.x = j*du;
@@ -561,30 +557,13 @@ void GeometryFactory::Subdivide(MeshData& meshData)
 
 Vertex GeometryFactory::MidPoint(const Vertex& v0, const Vertex& v1)
 {
-    XMVECTOR p0 = XMLoadFloat3(&v0.Position);
-    XMVECTOR p1 = XMLoadFloat3(&v1.Position);
-
-    XMVECTOR n0 = XMLoadFloat3(&v0.Normal);
-    XMVECTOR n1 = XMLoadFloat3(&v1.Normal);
-
-    XMVECTOR tan0 = XMLoadFloat3(&v0.TangentU);
-    XMVECTOR tan1 = XMLoadFloat3(&v1.TangentU);
-
-    XMVECTOR tex0 = XMLoadFloat2(&v0.TexC);
-    XMVECTOR tex1 = XMLoadFloat2(&v1.TexC);
-
     // Compute the midpoints of all the attributes.  Vectors need to be normalized
     // since linear interpolating can make them not unit length.  
-    XMVECTOR pos = 0.5f*(p0 + p1);
-    XMVECTOR normal = XMVector3Normalize(0.5f*(n0 + n1));
-    XMVECTOR tangent = XMVector3Normalize(0.5f*(tan0+tan1));
-    XMVECTOR tex = 0.5f*(tex0 + tex1);
-
     Vertex v;
-    XMStoreFloat3(&v.Position, pos);
-    XMStoreFloat3(&v.Normal, normal);
-    XMStoreFloat3(&v.TangentU, tangent);
-    XMStoreFloat2(&v.TexC, tex);
+    v.Position = 0.5f*(v0.Position + v1.Position);
+    v.Normal = Maths::Normalize(0.5f*(v0.Normal + v1.Normal));
+    v.TangentU = Maths::Normalize(0.5f*(v0.TangentU + v1.TangentU));
+    v.TexC = Float2(0.5f*(v0.TexC.x + v1.TexC.x), 0.5f*(v0.TexC.y + v1.TexC.y));
 
     return v;
 }
@@ -592,30 +571,95 @@ Vertex GeometryFactory::MidPoint(const Vertex& v0, const Vertex& v1)
 void GeometryFactory::GenerateGeometryBuffer(RenderMesh* geo)
 {
 
-	std::vector<Vertex>* vertex = &geo->MeshData.Vertices;
-	std::vector<uint16> index = geo->MeshData.GetIndices16();
-
-	const UINT vbByteSize = (UINT)vertex->size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)index.size() * sizeof(std::uint16_t);
+	if (mFreeMeshIds.empty())
+	{
+		geo->Id = mNextMeshId++;
+	}
+	else
+	{
+		geo->Id = mFreeMeshIds.back();
+		mFreeMeshIds.pop_back();
+	}
 
-	// Emplacement memoir CPU
-	D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU);
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertex->data(), vbByteSize);
+	std::vector<Vertex>* vertex = &geo->MeshData.Vertices;
 
-	D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU);
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), index.data(), ibByteSize);
+	// 16 bits indices can not address merged or big meshes
+	bool use32BitIndices = vertex->size() > 0xFFFF;
+	const void* indexData;
+	std::uint32_t ibByteSize;
+	if (use32BitIndices)
+	{
+		indexData = geo->MeshData.Indices32.data();
+		ibByteSize = (std::uint32_t)geo->MeshData.Indices32.size() * sizeof(std::uint32_t);
+	}
+	else
+	{
+		std::vector<uint16>& index = geo->MeshData.GetIndices16();
+		indexData = index.data();
+		ibByteSize = (std::uint32_t)index.size() * sizeof(std::uint16_t);
+	}
 
-	// Copy the triangle data to the vertex buffer.
-	geo->VertexBufferGPU = d3dUtils::CreateBuffer(mpDevice, mpCommandList, vertex->data(), vbByteSize, geo->VertexBufferUploader);
+	const std::uint32_t vbByteSize = (std::uint32_t)vertex->size() * sizeof(Vertex);
 
-	// Copy the triangle data to the indices buffer.
-	geo->IndexBufferGPU = d3dUtils::CreateBuffer(mpDevice, mpCommandList, index.data(), ibByteSize, geo->IndexBufferUploader);
+	// Both copies are done once the last ticket is
+	std::uint64_t vertexTicket = 0;
+	std::uint64_t indexTicket = 0;
+	geo->VertexBufferGPU = UploadBuffer(vertex->data(), vbByteSize, vertexTicket);
+	geo->IndexBufferGPU = UploadBuffer(indexData, ibByteSize, indexTicket);
+	geo->UploadTicket = std::max(vertexTicket, indexTicket);
 
 	// Initialize the vertex buffer view.
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
+	geo->VertexBuffer.BufferLocation = mpDevice->GetGpuAddress(geo->VertexBufferGPU);
+	geo->VertexBuffer.SizeInBytes = vbByteSize;
+	geo->VertexBuffer.StrideInBytes = sizeof(Vertex);
 
 	// Initialize the indices buffer view.
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = use32BitIndices ? IndexFormatR32 : IndexFormatR16;
 	geo->IndexBufferByteSize = ibByteSize;
-}
\ No newline at end of file
+	geo->IndexBuffer.BufferLocation = mpDevice->GetGpuAddress(geo->IndexBufferGPU);
+	geo->IndexBuffer.SizeInBytes = ibByteSize;
+	geo->IndexBuffer.Format = geo->IndexFormat;
+
+	// Local bounds for culling
+	if (!vertex->empty())
+		BoundingSphere::CreateFromPoints(geo->Bounds, vertex->size(), &vertex->data()->Position, sizeof(Vertex));
+}
+
+BufferHandle GeometryFactory::UploadBuffer(const void* data, std::uint64_t byteSize, std::uint64_t& ticket)
+{
+	BufferDesc desc;
+	desc.SizeInBytes = byteSize;
+	desc.Heap = BufferHeap::Default;
+	BufferHandle destination = mpDevice->CreateBuffer(desc);
+	if (destination == InvalidBuffer)
+	{
+		std::cerr << "Failed to allocate mesh buffer memory !\n";
+		return destination;
+	}
+
+	ticket = mpDevice->UploadBuffer(destination, 0, data, byteSize);
+	return destination;
+}
+
+RenderMesh* GeometryFactory::CreateMesh(MeshData meshData)
+{
+	RenderMesh* geometry = new RenderMesh();
+	geometry->MeshData = std::move(meshData);
+
+	GenerateGeometryBuffer(geometry);
+
+	return geometry;
+}
+
+void GeometryFactory::ReleaseMesh(RenderMesh* mesh)
+{
+	if (mesh == nullptr) return;
+
+	if (mesh->VertexBufferGPU != InvalidBuffer) mpDevice->DestroyBuffer(mesh->VertexBufferGPU);
+	if (mesh->IndexBufferGPU != InvalidBuffer) mpDevice->DestroyBuffer(mesh->IndexBufferGPU);
+
+	mFreeMeshIds.push_back(mesh->Id);
+	delete mesh;
+}
@@ -14,12 +14,19 @@
 
 #pragma once
 
-#include "d3dUtils.h"
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
 
 class GeometryFactory
 {
 public:
-	GeometryFactory(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList);
+	///<summary>
+	/// Mesh buffers are default buffers of pDevice filled with uploads,
+	/// a mesh can be drawn once the device completed its UploadTicket.
+	///</summary>
+	GeometryFactory(IRenderDevice* pDevice);
 	
 	///<summary>
 	/// Creates a box centered at the origin with the given dimensions, where each
@@ -52,12 +59,24 @@ public:
 
 	RenderMesh* LoadGeometryFromFile(std::string path);
 
+	///<summary>
+	/// Creates the GPU buffers of already built geometry, 32 bits indices are used past 65535 vertices.
+	///</summary>
+	RenderMesh* CreateMesh(MeshData meshData);
+
+	///<summary>
+	/// Releases the buffers of a mesh and deletes it, the GPU must be done with them.
+	///</summary>
+	void ReleaseMesh(RenderMesh* mesh);
+
 private:
-	ID3D12Device* mpDevice;
-	ID3D12GraphicsCommandList* mpCommandList;
+	IRenderDevice* mpDevice;
+	std::uint32_t mNextMeshId = 0;
+	std::vector<std::uint32_t> mFreeMeshIds; // Ids of released meshes, reused so they stay small
 	
 	void Subdivide(MeshData& meshData);
 	Vertex MidPoint(const Vertex& v0, const Vertex& v1);
 	void GenerateGeometryBuffer(RenderMesh* geo);
+	BufferHandle UploadBuffer(const void* data, std::uint64_t byteSize, std::uint64_t& ticket); // Default buffer filled by a device upload
 };
 
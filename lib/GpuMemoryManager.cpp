@@ -0,0 +1,146 @@
+﻿#include "GpuMemoryManager.h"
+
+#include "d3dUtils.h"
+
+GpuMemoryManager::GpuMemoryManager()
+{
+}
+
+GpuMemoryManager::~GpuMemoryManager()
+{
+    Release();
+}
+
+void GpuMemoryManager::Initialize(ID3D12Device* device, UINT64 pageSize)
+{
+    mDevice = device;
+    mPageSize = pageSize;
+}
+
+GpuMemoryManager::Page* GpuMemoryManager::CreatePage(GpuMemoryType type, UINT64 size)
+{
+    // Heaps are made of 64 KB pages
+    size = (size + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~(UINT64)(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1);
+
+    bool upload = type == GpuMemoryType::Upload;
+    CD3DX12_HEAP_DESC heapDesc(size, upload ? D3D12_HEAP_TYPE_UPLOAD : D3D12_HEAP_TYPE_DEFAULT, 0, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS);
+
+    ID3D12Heap* heap = nullptr;
+    HRESULT result = mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap));
+    if (FAILED(result))
+    {
+        std::cerr << "Failed to create GPU memory heap !\n";
+        return nullptr;
+    }
+
+    ID3D12Resource* buffer = nullptr;
+    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+    result = mDevice->CreatePlacedResource(
+        heap,
+        0,
+        &bufferDesc,
+        upload ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_COMMON,
+        nullptr,
+        IID_PPV_ARGS(&buffer));
+
+    if (FAILED(result))
+    {
+        std::cerr << "Failed to create GPU memory page buffer !\n";
+        heap->Release();
+        return nullptr;
+    }
+
+    Page* page = new Page();
+    page->Heap = heap;
+    page->Buffer = buffer;
+    page->Gpu = buffer->GetGPUVirtualAddress();
+    page->Allocator.Reset(size);
+
+    // Stay mapped for the page lifetime, upload heaps allow it
+    if (upload)
+        buffer->Map(0, nullptr, reinterpret_cast<void**>(&page->Cpu));
+
+    return page;
+}
+
+GpuBufferAllocation GpuMemoryManager::Allocate(GpuMemoryType type, UINT64 size, UINT64 alignment)
+{
+    GpuBufferAllocation allocation;
+    std::vector<Page*>& pages = mPages[(size_t)type];
+
+    TlsfAllocation block;
+    UINT pageIndex = 0;
+    for (; pageIndex < (UINT)pages.size(); pageIndex++)
+    {
+        block = pages[pageIndex]->Allocator.Allocate(size, alignment);
+        if (block.IsValid()) break;
+    }
+
+    if (!block.IsValid())
+    {
+        Page* page = CreatePage(type, std::max(mPageSize, size + alignment));
+        if (page == nullptr) return allocation;
+
+        block = page->Allocator.Allocate(size, alignment);
+        pageIndex = (UINT)pages.size();
+        pages.push_back(page);
+    }
+
+    Page* page = pages[pageIndex];
+    allocation.Resource = page->Buffer;
+    allocation.Offset = block.Offset;
+    allocation.Size = size;
+    allocation.Gpu = page->Gpu + block.Offset;
+    allocation.Cpu = page->Cpu != nullptr ? page->Cpu + block.Offset : nullptr;
+    allocation.Type = type;
+    allocation.Page = pageIndex;
+    allocation.Block = block;
+    return allocation;
+}
+
+void GpuMemoryManager::Free(GpuBufferAllocation& allocation)
+{
+    if (!allocation.IsValid()) return;
+
+    Page* page = mPages[(size_t)allocation.Type][allocation.Page];
+    page->Allocator.Free(allocation.Block);
+    allocation = GpuBufferAllocation();
+}
+
+GpuMemoryStats GpuMemoryManager::GetStats(GpuMemoryType type) const
+{
+    GpuMemoryStats stats;
+    UINT64 freeBytes = 0;
+
+    for (const Page* page : mPages[(size_t)type])
+    {
+        TlsfStats pageStats = page->Allocator.GetStats();
+        stats.Pages++;
+        stats.HeapBytes += pageStats.Capacity;
+        stats.UsedBytes += pageStats.UsedBytes;
+        stats.Allocations += pageStats.AllocationCount;
+        stats.FreeBlocks += pageStats.FreeBlockCount;
+        stats.LargestFreeBlock = std::max(stats.LargestFreeBlock, pageStats.LargestFreeBlock);
+        freeBytes += pageStats.FreeBytes;
+    }
+
+    if (freeBytes != 0)
+        stats.Fragmentation = 1.0f - (float)((double)stats.LargestFreeBlock / (double)freeBytes);
+    return stats;
+}
+
+void GpuMemoryManager::Release()
+{
+    for (std::vector<Page*>& pages : mPages)
+    {
+        for (Page* page : pages)
+        {
+            if (page->Cpu != nullptr)
+                page->Buffer->Unmap(0, nullptr);
+            page->Buffer->Release();
+            page->Heap->Release();
+            delete page;
+        }
+        pages.clear();
+    }
+}
@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <vector>
+
+#include "TlsfAllocator.h"
+
+enum class GpuMemoryType
+{
+    Default, // GPU only, filled with copies
+    Upload,  // CPU writable, persistently mapped
+
+    Count
+};
+
+// Range of a page buffer. Resource is shared with the other allocations of the page.
+struct GpuBufferAllocation
+{
+    ID3D12Resource* Resource = nullptr;
+    UINT64 Offset = 0; // In Resource
+    UINT64 Size = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS Gpu = 0;
+    BYTE* Cpu = nullptr; // Upload memory only
+
+    GpuMemoryType Type = GpuMemoryType::Default;
+    UINT Page = 0;
+    TlsfAllocation Block;
+
+    bool IsValid() const { return Resource != nullptr; }
+};
+
+struct GpuMemoryStats
+{
+    UINT Pages = 0;
+    UINT64 HeapBytes = 0;
+    UINT64 UsedBytes = 0;
+    UINT Allocations = 0;
+    UINT FreeBlocks = 0;
+    UINT64 LargestFreeBlock = 0;
+    float Fragmentation = 0.0f; // Of the free bytes of all the pages, see TlsfStats
+};
+
+// Vertex, index and constant buffers sub-allocated in a few big heaps instead of
+// one committed resource each. Every page is an ID3D12Heap covered by one placed buffer,
+// its ranges are handed out by a TlsfAllocator.
+// Default pages stay in the COMMON state: buffers are promoted to the copy and read states
+// they are used in and decay back to COMMON once the command lists using them are done.
+class GpuMemoryManager
+{
+public:
+    static const UINT64 DefaultPageSize = 64ull * 1024 * 1024;
+
+    GpuMemoryManager();
+    ~GpuMemoryManager();
+
+    GpuMemoryManager(const GpuMemoryManager& rhs) = delete;
+    GpuMemoryManager& operator=(const GpuMemoryManager& rhs) = delete;
+
+    void Initialize(ID3D12Device* device, UINT64 pageSize = DefaultPageSize);
+
+    // A new page is created when none has room, bigger than pageSize for big requests.
+    // Return an invalid allocation when the page can not be created.
+    GpuBufferAllocation Allocate(GpuMemoryType type, UINT64 size, UINT64 alignment = TlsfAllocator::Granularity);
+
+    // The GPU must be done with the range
+    void Free(GpuBufferAllocation& allocation);
+
+    GpuMemoryStats GetStats(GpuMemoryType type) const;
+
+    // Release every page, the GPU must be done with all of them
+    void Release();
+
+private:
+    struct Page
+    {
+        ID3D12Heap* Heap = nullptr;
+        ID3D12Resource* Buffer = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS Gpu = 0;
+        BYTE* Cpu = nullptr;
+        TlsfAllocator Allocator;
+    };
+
+    Page* CreatePage(GpuMemoryType type, UINT64 size);
+
+    ID3D12Device* mDevice = nullptr;
+    UINT64 mPageSize = DefaultPageSize;
+    std::vector<Page*> mPages[(size_t)GpuMemoryType::Count];
+};
@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include <cstdint>
+
+// Timeline of a GPU queue as seen by the CPU. Work submitted to the queue completes in order,
+// Signal tags everything submitted so far with a fence value the queue reaches once it is done.
+class IGpuQueue
+{
+public:
+    virtual ~IGpuQueue() {}
+
+    virtual std::uint64_t Signal() = 0;
+    virtual std::uint64_t GetCompletedValue() = 0;
+
+    // Block the calling thread until the queue reached value
+    virtual void WaitForValue(std::uint64_t value) = 0;
+};
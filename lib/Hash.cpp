@@ -0,0 +1,13 @@
+﻿#include "Hash.h"
+
+std::uint64_t HashBytes(const void* data, std::size_t size, std::uint64_t seed)
+{
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    std::uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
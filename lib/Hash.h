@@ -0,0 +1,7 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64 bits FNV-1a, chain calls by passing the previous hash as seed
+std::uint64_t HashBytes(const void* data, std::size_t size, std::uint64_t seed = 14695981039346656037ull);
@@ -0,0 +1,43 @@
+﻿#include "IndirectArguments.h"
+
+namespace
+{
+    bool Fail(std::string* error, std::uint32_t draw, const char* reason)
+    {
+        if (error != nullptr)
+            *error = "Indirect draw " + std::to_string(draw) + ": " + reason;
+        return false;
+    }
+}
+
+bool ValidateIndirectArguments(const IndirectDrawArguments* arguments, std::uint32_t count,
+                               std::uint32_t instanceCount, std::string* error)
+{
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        const IndirectDrawArguments& draw = arguments[i];
+
+        if (draw.VertexBuffer.BufferLocation == 0 || draw.VertexBuffer.StrideInBytes == 0)
+            return Fail(error, i, "no vertex buffer bound");
+
+        if (draw.IndexBuffer.BufferLocation == 0)
+            return Fail(error, i, "no index buffer bound");
+
+        std::uint64_t indexSize;
+        if (draw.IndexBuffer.Format == IndexFormatR16) indexSize = 2;
+        else if (draw.IndexBuffer.Format == IndexFormatR32) indexSize = 4;
+        else return Fail(error, i, "unknown index format");
+
+        std::uint64_t lastIndex = (std::uint64_t)draw.StartIndexLocation + draw.IndexCountPerInstance;
+        if (lastIndex * indexSize > draw.IndexBuffer.SizeInBytes)
+            return Fail(error, i, "indices past the end of the index buffer");
+
+        if (draw.InstanceCount == 0)
+            return Fail(error, i, "zero instances");
+
+        if ((std::uint64_t)draw.ObjectIndex + draw.InstanceCount > instanceCount)
+            return Fail(error, i, "instances past the end of the instance buffer");
+    }
+
+    return true;
+}
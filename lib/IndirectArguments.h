@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include <string>
+
+#include "CommandList.h"
+
+// One ExecuteIndirect command, laid out as the renderer command signature expects it:
+// vertex buffer view, index buffer view, the object index root constant then the indexed draw.
+// The views have the exact layout of D3D12_VERTEX_BUFFER_VIEW and D3D12_INDEX_BUFFER_VIEW.
+struct IndirectDrawArguments
+{
+    VertexBufferBinding VertexBuffer;
+    IndexBufferBinding IndexBuffer;
+
+    std::uint32_t ObjectIndex = 0; // First instance of the draw in the instance buffer
+
+    // D3D12_DRAW_INDEXED_ARGUMENTS
+    std::uint32_t IndexCountPerInstance = 0;
+    std::uint32_t InstanceCount = 0;
+    std::uint32_t StartIndexLocation = 0;
+    std::int32_t BaseVertexLocation = 0;
+    std::uint32_t StartInstanceLocation = 0;
+};
+
+static_assert(sizeof(IndirectDrawArguments) == 56, "Indirect arguments must be tightly packed");
+
+// Check a produced argument stream before the GPU consume it: every draw must stay inside
+// its index buffer and read existing instances. Return false and fill error on the first bad draw.
+bool ValidateIndirectArguments(const IndirectDrawArguments* arguments, std::uint32_t count,
+                               std::uint32_t instanceCount, std::string* error);
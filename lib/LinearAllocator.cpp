@@ -0,0 +1,53 @@
+﻿#include "LinearAllocator.h"
+
+#include <cassert>
+
+LinearAllocator::LinearAllocator(std::uint64_t capacity) : mCapacity(capacity)
+{
+}
+
+void LinearAllocator::Reset(std::uint64_t capacity)
+{
+    mCapacity = capacity;
+    Reset();
+}
+
+void LinearAllocator::Reset()
+{
+    mUsed = 0;
+    mAllocationCount = 0;
+}
+
+std::uint64_t LinearAllocator::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    std::uint64_t offset = (mUsed + alignment - 1) & ~(alignment - 1);
+    if (offset + size > mCapacity)
+        return InvalidOffset;
+
+    mUsed = offset + size;
+    if (mUsed > mPeakUsed) mPeakUsed = mUsed;
+    mAllocationCount++;
+    return offset;
+}
+
+std::uint64_t LinearAllocator::GetCapacity() const
+{
+    return mCapacity;
+}
+
+std::uint64_t LinearAllocator::GetUsed() const
+{
+    return mUsed;
+}
+
+std::uint64_t LinearAllocator::GetAllocationCount() const
+{
+    return mAllocationCount;
+}
+
+std::uint64_t LinearAllocator::GetPeakUsed() const
+{
+    return mPeakUsed;
+}
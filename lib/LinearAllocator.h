@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include <cstdint>
+
+// Bump allocator handing out aligned offsets in a fixed range of bytes.
+// Nothing is freed individually, Reset gives the whole range back at once.
+// Not thread safe, allocate on one thread and let workers fill the returned ranges.
+class LinearAllocator
+{
+public:
+    static const std::uint64_t InvalidOffset = ~0ull;
+
+    LinearAllocator(std::uint64_t capacity = 0);
+
+    // Forget every allocation, the capacity can change
+    void Reset(std::uint64_t capacity);
+    void Reset();
+
+    // alignment must be a power of two, return InvalidOffset when the range is full
+    std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment);
+
+    std::uint64_t GetCapacity() const;
+    std::uint64_t GetUsed() const;
+    std::uint64_t GetAllocationCount() const;
+
+    // Highest GetUsed since the allocator was created
+    std::uint64_t GetPeakUsed() const;
+
+private:
+    std::uint64_t mCapacity = 0;
+    std::uint64_t mUsed = 0;
+    std::uint64_t mPeakUsed = 0;
+    std::uint64_t mAllocationCount = 0;
+};
@@ -0,0 +1,110 @@
+﻿#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path, std::string* error)
+{
+    Close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size = {};
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        if (error != nullptr) *error = "cannot open " + path;
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* data = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (data == nullptr)
+    {
+        if (mapping != nullptr) CloseHandle(mapping);
+        CloseHandle(file);
+        if (error != nullptr) *error = "cannot map " + path;
+        return false;
+    }
+
+    mFile = file;
+    mMapping = mapping;
+    mData = static_cast<const std::uint8_t*>(data);
+    mSize = (std::uint64_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr) UnmapViewOfFile(mData);
+    if (mMapping != nullptr) CloseHandle(mMapping);
+    if (mFile != nullptr) CloseHandle(mFile);
+    mData = nullptr;
+    mMapping = nullptr;
+    mFile = nullptr;
+    mSize = 0;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, std::string* error)
+{
+    Close();
+
+    int file = open(path.c_str(), O_RDONLY);
+    struct stat status = {};
+    if (file < 0 || fstat(file, &status) != 0 || status.st_size == 0)
+    {
+        if (file >= 0) close(file);
+        if (error != nullptr) *error = "cannot open " + path;
+        return false;
+    }
+
+    // The mapping stays valid once the descriptor is closed
+    void* data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        if (error != nullptr) *error = "cannot map " + path;
+        return false;
+    }
+
+    mData = static_cast<const std::uint8_t*>(data);
+    mSize = (std::uint64_t)status.st_size;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr) munmap((void*)mData, (size_t)mSize);
+    mData = nullptr;
+    mSize = 0;
+}
+
+#endif
+
+const std::uint8_t* MappedFile::GetData() const
+{
+    return mData;
+}
+
+std::uint64_t MappedFile::GetSize() const
+{
+    return mSize;
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Read only mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile& rhs) = delete;
+    MappedFile& operator=(const MappedFile& rhs) = delete;
+
+    bool Open(const std::string& path, std::string* error = nullptr);
+    void Close();
+
+    const std::uint8_t* GetData() const;
+    std::uint64_t GetSize() const;
+
+private:
+    const std::uint8_t* mData = nullptr;
+    std::uint64_t mSize = 0;
+#ifdef _WIN32
+    void* mFile = nullptr;
+    void* mMapping = nullptr;
+#endif
+};
@@ -1,21 +1,298 @@
 ﻿#include "Maths.h"
 
-void Maths::Identity4X4(DirectX::XMFLOAT4X4* matrix)
-{
-    matrix->_11 = 1.0f;
-    matrix->_12 = 0.0f;
-    matrix->_13 = 0.0f;
-    matrix->_14 = 0.0f;
-    matrix->_21 = 0.0f;
-    matrix->_22 = 1.0f;
-    matrix->_23 = 0.0f;
-    matrix->_24 = 0.0f;
-    matrix->_31 = 0.0f;
-    matrix->_32 = 0.0f;
-    matrix->_33 = 1.0f;
-    matrix->_34 = 0.0f;
-    matrix->_41 = 0.0f;
-    matrix->_42 = 0.0f;
-    matrix->_43 = 0.0f;
-    matrix->_44 = 1.0f;
-}
\ No newline at end of file
+#include <algorithm>
+#include <cmath>
+
+Float4x4::Float4x4(float m11, float m12, float m13, float m14,
+                   float m21, float m22, float m23, float m24,
+                   float m31, float m32, float m33, float m34,
+                   float m41, float m42, float m43, float m44)
+    : _11(m11), _12(m12), _13(m13), _14(m14),
+      _21(m21), _22(m22), _23(m23), _24(m24),
+      _31(m31), _32(m32), _33(m33), _34(m34),
+      _41(m41), _42(m42), _43(m43), _44(m44)
+{
+}
+
+void BoundingSphere::CreateFromPoints(BoundingSphere& out, std::size_t count, const Float3* points, std::size_t stride)
+{
+    auto point = [&](std::size_t i) -> const Float3&
+    {
+        return *reinterpret_cast<const Float3*>(reinterpret_cast<const char*>(points) + i * stride);
+    };
+
+    out = BoundingSphere();
+    if (count == 0) return;
+
+    // Points of smallest and largest coordinate on each axis
+    Float3 minX = point(0), maxX = point(0), minY = point(0), maxY = point(0), minZ = point(0), maxZ = point(0);
+    for (std::size_t i = 1; i < count; i++)
+    {
+        const Float3& p = point(i);
+        if (p.x < minX.x) minX = p;
+        if (p.x > maxX.x) maxX = p;
+        if (p.y < minY.y) minY = p;
+        if (p.y > maxY.y) maxY = p;
+        if (p.z < minZ.z) minZ = p;
+        if (p.z > maxZ.z) maxZ = p;
+    }
+
+    // Start from the pair furthest apart
+    float spanX = Maths::Length(maxX - minX);
+    float spanY = Maths::Length(maxY - minY);
+    float spanZ = Maths::Length(maxZ - minZ);
+    Float3 first = minX, second = maxX;
+    float span = spanX;
+    if (spanY > span) { first = minY; second = maxY; span = spanY; }
+    if (spanZ > span) { first = minZ; second = maxZ; span = spanZ; }
+
+    Float3 center = (first + second) * 0.5f;
+    float radius = span * 0.5f;
+
+    // Each point outside moves the sphere toward it just enough to hold it
+    for (std::size_t i = 0; i < count; i++)
+    {
+        Float3 offset = point(i) - center;
+        float distance = Maths::Length(offset);
+        if (distance <= radius) continue;
+
+        float grown = (radius + distance) * 0.5f;
+        center = center + offset * ((grown - radius) / distance);
+        radius = grown;
+    }
+
+    out.Center = center;
+    out.Radius = radius;
+}
+
+void BoundingSphere::Transform(BoundingSphere& out, const Float4x4& matrix) const
+{
+    float scaleX = matrix._11 * matrix._11 + matrix._12 * matrix._12 + matrix._13 * matrix._13;
+    float scaleY = matrix._21 * matrix._21 + matrix._22 * matrix._22 + matrix._23 * matrix._23;
+    float scaleZ = matrix._31 * matrix._31 + matrix._32 * matrix._32 + matrix._33 * matrix._33;
+
+    out.Center = Maths::TransformCoord(Center, matrix);
+    out.Radius = Radius * sqrtf(std::max(scaleX, std::max(scaleY, scaleZ)));
+}
+
+void Maths::Identity4X4(Float4x4* matrix)
+{
+    *matrix = Identity();
+}
+
+Float4x4 Maths::Identity()
+{
+    return Float4x4(
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+float Maths::Dot(const Float3& a, const Float3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Float3 Maths::Cross(const Float3& a, const Float3& b)
+{
+    return Float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+float Maths::Length(const Float3& v)
+{
+    return sqrtf(Dot(v, v));
+}
+
+Float3 Maths::Normalize(const Float3& v)
+{
+    float length = Length(v);
+    return length > 0.0f ? v * (1.0f / length) : v;
+}
+
+Float3 Maths::TransformCoord(const Float3& p, const Float4x4& m)
+{
+    float x = p.x * m._11 + p.y * m._21 + p.z * m._31 + m._41;
+    float y = p.x * m._12 + p.y * m._22 + p.z * m._32 + m._42;
+    float z = p.x * m._13 + p.y * m._23 + p.z * m._33 + m._43;
+    float w = p.x * m._14 + p.y * m._24 + p.z * m._34 + m._44;
+    return Float3(x / w, y / w, z / w);
+}
+
+Float3 Maths::TransformNormal(const Float3& n, const Float4x4& m)
+{
+    return Float3(
+        n.x * m._11 + n.y * m._21 + n.z * m._31,
+        n.x * m._12 + n.y * m._22 + n.z * m._32,
+        n.x * m._13 + n.y * m._23 + n.z * m._33);
+}
+
+Float4x4 Maths::Multiply(const Float4x4& a, const Float4x4& b)
+{
+    Float4x4 result;
+    for (int row = 0; row < 4; row++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            result.m[row][column] = a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column] +
+                a.m[row][2] * b.m[2][column] + a.m[row][3] * b.m[3][column];
+        }
+    }
+    return result;
+}
+
+Float4x4 Maths::Transpose(const Float4x4& matrix)
+{
+    Float4x4 result;
+    for (int row = 0; row < 4; row++)
+    {
+        for (int column = 0; column < 4; column++)
+            result.m[row][column] = matrix.m[column][row];
+    }
+    return result;
+}
+
+Float4x4 Maths::Inverse(const Float4x4& a)
+{
+    // Adjugate over the determinant, the 2x2 minors of the two upper and two lower rows are shared
+    float s0 = a._11 * a._22 - a._21 * a._12;
+    float s1 = a._11 * a._23 - a._21 * a._13;
+    float s2 = a._11 * a._24 - a._21 * a._14;
+    float s3 = a._12 * a._23 - a._22 * a._13;
+    float s4 = a._12 * a._24 - a._22 * a._14;
+    float s5 = a._13 * a._24 - a._23 * a._14;
+
+    float c5 = a._33 * a._44 - a._43 * a._34;
+    float c4 = a._32 * a._44 - a._42 * a._34;
+    float c3 = a._32 * a._43 - a._42 * a._33;
+    float c2 = a._31 * a._44 - a._41 * a._34;
+    float c1 = a._31 * a._43 - a._41 * a._33;
+    float c0 = a._31 * a._42 - a._41 * a._32;
+
+    float determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (determinant == 0.0f) return Identity();
+    float inv = 1.0f / determinant;
+
+    return Float4x4(
+        ( a._22 * c5 - a._23 * c4 + a._24 * c3) * inv,
+        (-a._12 * c5 + a._13 * c4 - a._14 * c3) * inv,
+        ( a._42 * s5 - a._43 * s4 + a._44 * s3) * inv,
+        (-a._32 * s5 + a._33 * s4 - a._34 * s3) * inv,
+
+        (-a._21 * c5 + a._23 * c2 - a._24 * c1) * inv,
+        ( a._11 * c5 - a._13 * c2 + a._14 * c1) * inv,
+        (-a._41 * s5 + a._43 * s2 - a._44 * s1) * inv,
+        ( a._31 * s5 - a._33 * s2 + a._34 * s1) * inv,
+
+        ( a._21 * c4 - a._22 * c2 + a._24 * c0) * inv,
+        (-a._11 * c4 + a._12 * c2 - a._14 * c0) * inv,
+        ( a._41 * s4 - a._42 * s2 + a._44 * s0) * inv,
+        (-a._31 * s4 + a._32 * s2 - a._34 * s0) * inv,
+
+        (-a._21 * c3 + a._22 * c1 - a._23 * c0) * inv,
+        ( a._11 * c3 - a._12 * c1 + a._13 * c0) * inv,
+        (-a._41 * s3 + a._42 * s1 - a._43 * s0) * inv,
+        ( a._31 * s3 - a._32 * s1 + a._33 * s0) * inv);
+}
+
+Float4x4 Maths::Scaling(const Float3& scale)
+{
+    Float4x4 result = Identity();
+    result._11 = scale.x;
+    result._22 = scale.y;
+    result._33 = scale.z;
+    return result;
+}
+
+Float4x4 Maths::Translation(const Float3& offset)
+{
+    Float4x4 result = Identity();
+    result._41 = offset.x;
+    result._42 = offset.y;
+    result._43 = offset.z;
+    return result;
+}
+
+Float4x4 Maths::RotationQuaternion(const Float4& q)
+{
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    return Float4x4(
+        1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f,
+        2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f,
+        2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Float4x4 Maths::LookToLH(const Float3& eye, const Float3& direction, const Float3& up)
+{
+    Float3 zAxis = Normalize(direction);
+    Float3 xAxis = Normalize(Cross(up, zAxis));
+    Float3 yAxis = Cross(zAxis, xAxis);
+
+    return Float4x4(
+        xAxis.x, yAxis.x, zAxis.x, 0.0f,
+        xAxis.y, yAxis.y, zAxis.y, 0.0f,
+        xAxis.z, yAxis.z, zAxis.z, 0.0f,
+        -Dot(xAxis, eye), -Dot(yAxis, eye), -Dot(zAxis, eye), 1.0f);
+}
+
+Float4x4 Maths::LookAtLH(const Float3& eye, const Float3& target, const Float3& up)
+{
+    return LookToLH(eye, target - eye, up);
+}
+
+Float4x4 Maths::PerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+{
+    float height = 1.0f / tanf(0.5f * fovAngleY);
+    float width = height / aspectRatio;
+    float range = farZ / (farZ - nearZ);
+
+    return Float4x4(
+        width, 0.0f, 0.0f, 0.0f,
+        0.0f, height, 0.0f, 0.0f,
+        0.0f, 0.0f, range, 1.0f,
+        0.0f, 0.0f, -range * nearZ, 0.0f);
+}
+
+Float4x4 Maths::OrthographicLH(float width, float height, float nearZ, float farZ)
+{
+    float range = 1.0f / (farZ - nearZ);
+
+    return Float4x4(
+        2.0f / width, 0.0f, 0.0f, 0.0f,
+        0.0f, 2.0f / height, 0.0f, 0.0f,
+        0.0f, 0.0f, range, 0.0f,
+        0.0f, 0.0f, -range * nearZ, 1.0f);
+}
+
+Float4 Maths::QuaternionIdentity()
+{
+    return Float4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Float4 Maths::QuaternionRotationAxis(const Float3& axis, float angle)
+{
+    Float3 n = Normalize(axis) * sinf(0.5f * angle);
+    return Float4(n.x, n.y, n.z, cosf(0.5f * angle));
+}
+
+Float4 Maths::QuaternionMultiply(const Float4& q1, const Float4& q2)
+{
+    // q2 * q1, rotating by the result rotates by q1 then q2
+    return Float4(
+        q2.w * q1.x + q2.x * q1.w + q2.y * q1.z - q2.z * q1.y,
+        q2.w * q1.y - q2.x * q1.z + q2.y * q1.w + q2.z * q1.x,
+        q2.w * q1.z + q2.x * q1.y - q2.y * q1.x + q2.z * q1.w,
+        q2.w * q1.w - q2.x * q1.x - q2.y * q1.y - q2.z * q1.z);
+}
+
+Float4 Maths::PlaneNormalize(const Float4& plane)
+{
+    float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if (length == 0.0f) return plane;
+    float inv = 1.0f / length;
+    return Float4(plane.x * inv, plane.y * inv, plane.z * inv, plane.w * inv);
+}
@@ -1,10 +1,112 @@
 ﻿#pragma once
-#include <DirectXMath.h>
+
+#include <cstddef>
+
+// Vectors and matrices of the renderer, laid out like the DirectXMath storage types they replace so
+// the constants go to the shaders as they are. Same conventions: row vectors transformed as v * M,
+// left handed views and projections with z in [0, 1], quaternions as (x, y, z, w).
+struct Float2
+{
+    float x = 0.0f;
+    float y = 0.0f;
+
+    Float2() {}
+    Float2(float x, float y) : x(x), y(y) {}
+};
+
+struct Float3
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+
+    Float3() {}
+    Float3(float x, float y, float z) : x(x), y(y), z(z) {}
+};
+
+struct Float4
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float w = 0.0f;
+
+    Float4() {}
+    Float4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+};
+
+// Row major, _32 is row 3 column 2
+struct Float4x4
+{
+    union
+    {
+        struct
+        {
+            float _11, _12, _13, _14;
+            float _21, _22, _23, _24;
+            float _31, _32, _33, _34;
+            float _41, _42, _43, _44;
+        };
+        float m[4][4];
+    };
+
+    Float4x4() : m() {}
+    Float4x4(float m11, float m12, float m13, float m14,
+             float m21, float m22, float m23, float m24,
+             float m31, float m32, float m33, float m34,
+             float m41, float m42, float m43, float m44);
+};
+
+inline Float3 operator+(const Float3& a, const Float3& b) { return Float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Float3 operator-(const Float3& a, const Float3& b) { return Float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Float3 operator*(const Float3& v, float s) { return Float3(v.x * s, v.y * s, v.z * s); }
+inline Float3 operator*(float s, const Float3& v) { return v * s; }
+
+// Sphere bounding a mesh, for culling
+struct BoundingSphere
+{
+    Float3 Center;
+    float Radius = 0.0f;
+
+    // Grown from the two furthest apart extreme points, not the smallest sphere but close to it
+    static void CreateFromPoints(BoundingSphere& out, std::size_t count, const Float3* points, std::size_t stride);
+
+    // Center transformed, radius scaled by the largest scale of the matrix
+    void Transform(BoundingSphere& out, const Float4x4& matrix) const;
+};
 
 class Maths
 {
 public:
     static constexpr float PI = 3.1415926535f;
-    static void Identity4X4(DirectX::XMFLOAT4X4* matrix);
-    
+    static void Identity4X4(Float4x4* matrix);
+    static Float4x4 Identity();
+
+    static float Dot(const Float3& a, const Float3& b);
+    static Float3 Cross(const Float3& a, const Float3& b);
+    static float Length(const Float3& v);
+    static Float3 Normalize(const Float3& v); // Zero stays zero
+
+    static Float3 TransformCoord(const Float3& point, const Float4x4& matrix); // w = 1, divided by the result w
+    static Float3 TransformNormal(const Float3& normal, const Float4x4& matrix); // w = 0
+
+    static Float4x4 Multiply(const Float4x4& a, const Float4x4& b); // a then b
+    static Float4x4 Transpose(const Float4x4& matrix);
+    static Float4x4 Inverse(const Float4x4& matrix); // Identity when the matrix is singular
+
+    static Float4x4 Scaling(const Float3& scale);
+    static Float4x4 Translation(const Float3& offset);
+    static Float4x4 RotationQuaternion(const Float4& quaternion);
+
+    static Float4x4 LookToLH(const Float3& eye, const Float3& direction, const Float3& up);
+    static Float4x4 LookAtLH(const Float3& eye, const Float3& target, const Float3& up);
+    static Float4x4 PerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ);
+    static Float4x4 OrthographicLH(float width, float height, float nearZ, float farZ);
+
+    static Float4 QuaternionIdentity();
+    static Float4 QuaternionRotationAxis(const Float3& axis, float angle);
+    static Float4 QuaternionMultiply(const Float4& first, const Float4& second); // first then second
+
+    // Scaled so the normal (x, y, z) has unit length
+    static Float4 PlaneNormalize(const Float4& plane);
 };
@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CommandList.h"
+#include "Maths.h"
+#include "RenderDevice.h"
+
+using uint16 = std::uint16_t;
+using uint32 = std::uint32_t;
+
+struct Vertex
+{
+    Vertex(){}
+    Vertex(
+        const Float3& p, 
+        const Float3& n, 
+        const Float3& t, 
+        const Float2& uv) :
+        Position(p), 
+        Normal(n), 
+        TangentU(t), 
+        TexC(uv){}
+    Vertex(
+        float px, float py, float pz, 
+        float nx, float ny, float nz,
+        float tx, float ty, float tz,
+        float u, float v) : 
+        Position(px,py,pz), 
+        Normal(nx,ny,nz),
+        TangentU(tx, ty, tz), 
+        TexC(u,v){}
+
+    Float3 Position;
+    Float3 Normal;
+    Float3 TangentU;
+    Float2 TexC;
+};
+
+struct MeshData
+{
+    std::vector<Vertex> Vertices;
+    std::vector<uint32> Indices32;
+
+    std::vector<uint16>& GetIndices16()
+    {
+        if(mIndices16.empty())
+        {
+            mIndices16.resize(Indices32.size());
+            for(size_t i = 0; i < Indices32.size(); ++i)
+                mIndices16[i] = static_cast<uint16>(Indices32[i]);
+        }
+
+        return mIndices16;
+    }
+
+private:
+    std::vector<uint16> mIndices16;
+};
+
+struct RenderMesh
+{
+    // Unique id given by the GeometryFactory, used to sort the draws
+    std::uint32_t Id = 0;
+
+    // Device upload carrying the buffers data, the mesh can be drawn once it is complete
+    std::uint64_t UploadTicket = 0;
+
+    // LE buffer dans le GPU, created on the device of the GeometryFactory
+    BufferHandle VertexBufferGPU = InvalidBuffer;
+    BufferHandle IndexBufferGPU = InvalidBuffer;
+
+    // Bindings of the buffers to draw the mesh
+    VertexBufferBinding VertexBuffer;
+    IndexBufferBinding IndexBuffer;
+
+    // Les donnes pour dessiner a l'eran
+    std::uint32_t VertexByteStride = 0;
+    std::uint32_t VertexBufferByteSize = 0;
+    std::uint32_t IndexFormat = IndexFormatR16; // DXGI_FORMAT
+    std::uint32_t IndexBufferByteSize = 0;
+
+    // Toutes les geometrie qui sont dans le vectex buffer, the CPU copy of the buffers
+    ::MeshData MeshData;
+
+    // Bounding sphere of the mesh in local space, used for culling
+    BoundingSphere Bounds;
+};
@@ -0,0 +1,156 @@
+﻿#include "PipelineCacheBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "PipelineStateKey.h"
+
+namespace
+{
+    // DXGI formats and D3D12 enum values of a forward pipeline
+    const std::uint32_t FormatR32G32B32Float = 6;
+    const std::uint32_t FormatR32G32Float = 16;
+    const std::uint32_t FormatR8G8B8A8Unorm = 28;
+    const std::uint32_t FormatD24UnormS8Uint = 45;
+
+    PipelineInputElement MakeElement(const char* semantic, std::uint32_t format, std::uint32_t offset)
+    {
+        PipelineInputElement element;
+        element.SemanticName = semantic;
+        element.Format = format;
+        element.AlignedByteOffset = offset;
+        return element;
+    }
+
+    PipelineStateDescription MakeDescription(std::mt19937& random)
+    {
+        PipelineStateDescription description;
+        description.RootSignature = 0x5157;
+        description.Shaders[(size_t)PipelineShaderStage::Vertex] = ((std::uint64_t)random() << 32) | random();
+        description.Shaders[(size_t)PipelineShaderStage::Pixel] = ((std::uint64_t)random() << 32) | random();
+        description.Blend[0].RenderTargetWriteMask = 0xF;
+        description.SampleMask = 0xFFFFFFFF;
+        description.FillMode = 3;
+        description.CullMode = 1 + random() % 3;
+        description.DepthClipEnable = true;
+        description.DepthEnable = random() % 4 != 0;
+        description.DepthWriteMask = 1;
+        description.DepthFunc = 2;
+        description.InputLayout = { MakeElement("POSITION", FormatR32G32B32Float, 0), MakeElement("NORMAL", FormatR32G32B32Float, 12),
+                                    MakeElement("TEXCOORD", FormatR32G32Float, 24) };
+        description.PrimitiveTopologyType = 3;
+        description.NumRenderTargets = 1;
+        description.RTVFormats[0] = FormatR8G8B8A8Unorm;
+        description.DSVFormat = FormatD24UnormS8Uint;
+        return description;
+    }
+
+    // Same pipeline written differently in what MakePipelineStateKey normalizes
+    PipelineStateDescription Rewrite(const PipelineStateDescription& description, std::mt19937& random)
+    {
+        PipelineStateDescription rewritten = description;
+
+        for (PipelineInputElement& element : rewritten.InputLayout)
+        {
+            if (random() % 2 == 0)
+                std::transform(element.SemanticName.begin(), element.SemanticName.end(), element.SemanticName.begin(),
+                    [](char c) { return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c; });
+            if (element.InputSlotClass == 0)
+                element.InstanceDataStepRate = random() % 4;
+        }
+
+        if (rewritten.DepthBiasClamp == 0.0f && random() % 2 == 0)
+            rewritten.DepthBiasClamp = -0.0f;
+        if (rewritten.SlopeScaledDepthBias == 0.0f && random() % 2 == 0)
+            rewritten.SlopeScaledDepthBias = -0.0f;
+
+        for (std::uint32_t i = 0; i < PipelineMaxRenderTargets; i++)
+        {
+            PipelineRenderTargetBlend& blend = rewritten.Blend[i];
+            if (i > 0 && !rewritten.IndependentBlendEnable)
+            {
+                blend.BlendEnable = random() % 2 == 0;
+                blend.RenderTargetWriteMask = (std::uint8_t)random();
+            }
+            if (!blend.BlendEnable)
+            {
+                blend.SrcBlend = random() % 19;
+                blend.DestBlend = random() % 19;
+            }
+            if (i >= rewritten.NumRenderTargets)
+                rewritten.RTVFormats[i] = random() % 100;
+        }
+
+        if (!rewritten.DepthEnable)
+            rewritten.DepthFunc = 1 + random() % 8;
+        if (!rewritten.StencilEnable)
+        {
+            rewritten.StencilReadMask = (std::uint8_t)random();
+            rewritten.FrontFace.Func = 1 + random() % 8;
+        }
+        return rewritten;
+    }
+}
+
+PipelineCacheBenchmarkResult RunPipelineCacheBenchmark(std::uint32_t pipelineCount, std::uint32_t requestsPerPipeline, std::uint32_t seed)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    PipelineCacheBenchmarkResult result;
+    result.Pipelines = pipelineCount;
+
+    std::mt19937 random(seed);
+    std::vector<PipelineStateDescription> pipelines;
+    for (std::uint32_t i = 0; i < pipelineCount; i++)
+        pipelines.push_back(MakeDescription(random));
+
+    // Every pipeline requested requestsPerPipeline times, written differently every time
+    std::vector<std::uint32_t> order;
+    for (std::uint32_t i = 0; i < pipelineCount; i++)
+        order.insert(order.end(), requestsPerPipeline, i);
+    std::shuffle(order.begin(), order.end(), random);
+
+    std::vector<PipelineStateDescription> requests;
+    requests.reserve(order.size());
+    for (std::uint32_t pipeline : order)
+        requests.push_back(Rewrite(pipelines[pipeline], random));
+
+    // The value stands for the pipeline object, the first description of the key created it
+    std::unordered_map<PipelineStateKey, std::uint32_t, PipelineStateKeyHasher> cache;
+    double keyNs = 0.0;
+    double lookupNs = 0.0;
+    for (size_t r = 0; r < requests.size(); r++)
+    {
+        auto start = Clock::now();
+        PipelineStateKey key = MakePipelineStateKey(requests[r]);
+        auto keyed = Clock::now();
+        auto inserted = cache.emplace(std::move(key), order[r]);
+        auto end = Clock::now();
+
+        keyNs += std::chrono::duration<double, std::nano>(keyed - start).count();
+        lookupNs += std::chrono::duration<double, std::nano>(end - keyed).count();
+
+        if (inserted.second)
+            result.Misses++;
+        else
+            result.Hits++;
+
+        if (inserted.first->second != order[r] && result.Error.empty())
+            result.Error = "request " + std::to_string(r) + " gave the pipeline of another description";
+    }
+
+    result.Requests = (std::uint32_t)requests.size();
+    if (result.Requests > 0)
+    {
+        result.KeyNs = keyNs / result.Requests;
+        result.LookupNs = lookupNs / result.Requests;
+    }
+
+    if (result.Error.empty() && result.Misses != pipelineCount)
+        result.Error = std::to_string(result.Misses) + " misses for " + std::to_string(pipelineCount) + " pipelines";
+    result.Valid = result.Error.empty();
+    return result;
+}
@@ -0,0 +1,26 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct PipelineCacheBenchmarkResult
+{
+    std::uint32_t Pipelines = 0; // Distinct pipelines described
+    std::uint32_t Requests = 0;
+    std::uint32_t Hits = 0; // Key already in the cache
+    std::uint32_t Misses = 0; // New key, the cache would load or compile a pipeline
+
+    double KeyNs = 0.0; // MakePipelineStateKey of a request
+    double LookupNs = 0.0; // Cache lookup of a key, hit or miss
+
+    // One miss per distinct pipeline: every equivalent description gave the key of the first one
+    bool Valid = false;
+    std::string Error;
+};
+
+// The in memory lookup of PipelineStateCache without the device. pipelineCount distinct
+// descriptions are requested requestsPerPipeline times each in a random order, every request
+// written differently in the states the key ignores (disabled blend and depth stencil states,
+// semantic case, step rate of per vertex elements, -0 biases, render targets past the count).
+// Same seed same requests.
+PipelineCacheBenchmarkResult RunPipelineCacheBenchmark(std::uint32_t pipelineCount, std::uint32_t requestsPerPipeline, std::uint32_t seed);
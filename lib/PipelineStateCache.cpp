@@ -0,0 +1,325 @@
+﻿#include "PipelineStateCache.h"
+
+#include <chrono>
+#include <fstream>
+
+#include "d3dUtils.h"
+
+namespace
+{
+    std::uint64_t HashBytecode(const D3D12_SHADER_BYTECODE& bytecode)
+    {
+        return HashShaderBytecode(bytecode.pShaderBytecode, bytecode.BytecodeLength);
+    }
+
+    PipelineRenderTargetBlend ToBlend(const D3D12_RENDER_TARGET_BLEND_DESC& desc)
+    {
+        PipelineRenderTargetBlend blend;
+        blend.BlendEnable = desc.BlendEnable != FALSE;
+        blend.LogicOpEnable = desc.LogicOpEnable != FALSE;
+        blend.SrcBlend = desc.SrcBlend;
+        blend.DestBlend = desc.DestBlend;
+        blend.BlendOp = desc.BlendOp;
+        blend.SrcBlendAlpha = desc.SrcBlendAlpha;
+        blend.DestBlendAlpha = desc.DestBlendAlpha;
+        blend.BlendOpAlpha = desc.BlendOpAlpha;
+        blend.LogicOp = desc.LogicOp;
+        blend.RenderTargetWriteMask = desc.RenderTargetWriteMask;
+        return blend;
+    }
+
+    PipelineStencilOp ToStencilOp(const D3D12_DEPTH_STENCILOP_DESC& desc)
+    {
+        PipelineStencilOp op;
+        op.FailOp = desc.StencilFailOp;
+        op.DepthFailOp = desc.StencilDepthFailOp;
+        op.PassOp = desc.StencilPassOp;
+        op.Func = desc.StencilFunc;
+        return op;
+    }
+
+    float ElapsedMs(std::chrono::high_resolution_clock::time_point start)
+    {
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<float, std::milli>(end - start).count();
+    }
+}
+
+PipelineStateCache::PipelineStateCache()
+{
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+    Release();
+}
+
+void PipelineStateCache::Initialize(ID3D12Device* device, const std::wstring& path)
+{
+    mDevice = device;
+    mPath = path;
+
+    D3D12_FEATURE_DATA_SHADER_CACHE shaderCache = {};
+    if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_SHADER_CACHE, &shaderCache, sizeof(shaderCache))) ||
+        (shaderCache.SupportFlags & D3D12_SHADER_CACHE_SUPPORT_LIBRARY) == 0)
+    {
+        return;
+    }
+
+    ID3D12Device1* device1 = nullptr;
+    if (FAILED(device->QueryInterface(IID_PPV_ARGS(&device1))))
+        return;
+
+    std::fstream file;
+    file.open(path, std::ios::in | std::ios::binary);
+    if (file.is_open())
+    {
+        file.seekg(0, std::ios::end);
+        mLibraryBlob.resize((size_t)file.tellg());
+        file.seekg(0, std::ios::beg);
+        file.read(mLibraryBlob.data(), mLibraryBlob.size());
+        file.close();
+    }
+
+    HRESULT result = E_FAIL;
+    if (!mLibraryBlob.empty())
+        result = device1->CreatePipelineLibrary(mLibraryBlob.data(), mLibraryBlob.size(), IID_PPV_ARGS(&mLibrary));
+
+    // Written by another driver or adapter, or damaged: start again from nothing
+    if (FAILED(result))
+    {
+        mLibraryBlob.clear();
+        result = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&mLibrary));
+        if (FAILED(result)) { std::cerr << "Failed to create pipeline library !\n"; }
+    }
+
+    device1->Release();
+}
+
+void PipelineStateCache::RegisterRootSignature(ID3D12RootSignature* rootSignature, const void* serialized, size_t size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRootSignatures[rootSignature] = HashBytes(serialized, size);
+}
+
+PipelineStateKey PipelineStateCache::MakeKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) const
+{
+    PipelineStateDescription description;
+
+    // An unregistered root signature is only known by its address, the key holds for this run
+    auto rootSignature = mRootSignatures.find(desc.pRootSignature);
+    description.RootSignature = rootSignature != mRootSignatures.end() ? rootSignature->second : (std::uint64_t)(uintptr_t)desc.pRootSignature;
+
+    description.Shaders[(size_t)PipelineShaderStage::Vertex] = HashBytecode(desc.VS);
+    description.Shaders[(size_t)PipelineShaderStage::Pixel] = HashBytecode(desc.PS);
+    description.Shaders[(size_t)PipelineShaderStage::Domain] = HashBytecode(desc.DS);
+    description.Shaders[(size_t)PipelineShaderStage::Hull] = HashBytecode(desc.HS);
+    description.Shaders[(size_t)PipelineShaderStage::Geometry] = HashBytecode(desc.GS);
+
+    for (UINT i = 0; i < desc.StreamOutput.NumEntries; i++)
+    {
+        const D3D12_SO_DECLARATION_ENTRY& source = desc.StreamOutput.pSODeclaration[i];
+        PipelineStreamOutputEntry entry;
+        entry.Stream = source.Stream;
+        entry.SemanticName = source.SemanticName != nullptr ? source.SemanticName : "";
+        entry.SemanticIndex = source.SemanticIndex;
+        entry.StartComponent = source.StartComponent;
+        entry.ComponentCount = source.ComponentCount;
+        entry.OutputSlot = source.OutputSlot;
+        description.StreamOutput.push_back(entry);
+    }
+    description.StreamOutputStrides.assign(desc.StreamOutput.pBufferStrides, desc.StreamOutput.pBufferStrides + desc.StreamOutput.NumStrides);
+    description.RasterizedStream = desc.StreamOutput.RasterizedStream;
+
+    description.AlphaToCoverageEnable = desc.BlendState.AlphaToCoverageEnable != FALSE;
+    description.IndependentBlendEnable = desc.BlendState.IndependentBlendEnable != FALSE;
+    for (UINT i = 0; i < PipelineMaxRenderTargets; i++)
+        description.Blend[i] = ToBlend(desc.BlendState.RenderTarget[i]);
+    description.SampleMask = desc.SampleMask;
+
+    const D3D12_RASTERIZER_DESC& rasterizer = desc.RasterizerState;
+    description.FillMode = rasterizer.FillMode;
+    description.CullMode = rasterizer.CullMode;
+    description.FrontCounterClockwise = rasterizer.FrontCounterClockwise != FALSE;
+    description.DepthBias = rasterizer.DepthBias;
+    description.DepthBiasClamp = rasterizer.DepthBiasClamp;
+    description.SlopeScaledDepthBias = rasterizer.SlopeScaledDepthBias;
+    description.DepthClipEnable = rasterizer.DepthClipEnable != FALSE;
+    description.MultisampleEnable = rasterizer.MultisampleEnable != FALSE;
+    description.AntialiasedLineEnable = rasterizer.AntialiasedLineEnable != FALSE;
+    description.ForcedSampleCount = rasterizer.ForcedSampleCount;
+    description.ConservativeRaster = rasterizer.ConservativeRaster;
+
+    const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+    description.DepthEnable = depthStencil.DepthEnable != FALSE;
+    description.DepthWriteMask = depthStencil.DepthWriteMask;
+    description.DepthFunc = depthStencil.DepthFunc;
+    description.StencilEnable = depthStencil.StencilEnable != FALSE;
+    description.StencilReadMask = depthStencil.StencilReadMask;
+    description.StencilWriteMask = depthStencil.StencilWriteMask;
+    description.FrontFace = ToStencilOp(depthStencil.FrontFace);
+    description.BackFace = ToStencilOp(depthStencil.BackFace);
+
+    for (UINT i = 0; i < desc.InputLayout.NumElements; i++)
+    {
+        const D3D12_INPUT_ELEMENT_DESC& source = desc.InputLayout.pInputElementDescs[i];
+        PipelineInputElement element;
+        element.SemanticName = source.SemanticName;
+        element.SemanticIndex = source.SemanticIndex;
+        element.Format = source.Format;
+        element.InputSlot = source.InputSlot;
+        element.AlignedByteOffset = source.AlignedByteOffset;
+        element.InputSlotClass = source.InputSlotClass;
+        element.InstanceDataStepRate = source.InstanceDataStepRate;
+        description.InputLayout.push_back(element);
+    }
+
+    description.IBStripCutValue = desc.IBStripCutValue;
+    description.PrimitiveTopologyType = desc.PrimitiveTopologyType;
+    description.NumRenderTargets = desc.NumRenderTargets;
+    for (UINT i = 0; i < PipelineMaxRenderTargets; i++)
+        description.RTVFormats[i] = desc.RTVFormats[i];
+    description.DSVFormat = desc.DSVFormat;
+    description.SampleCount = desc.SampleDesc.Count;
+    description.SampleQuality = desc.SampleDesc.Quality;
+    description.NodeMask = desc.NodeMask;
+    description.Flags = desc.Flags;
+
+    return MakePipelineStateKey(description);
+}
+
+ID3D12PipelineState* PipelineStateCache::GetGraphics(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    PipelineStateKey key;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        key = MakeKey(desc);
+
+        mStats.Requests++;
+        auto found = mPipelines.find(key);
+        if (found != mPipelines.end())
+        {
+            mStats.MemoryHits++;
+            return found->second;
+        }
+    }
+
+    std::string name = GetPipelineStateName(key);
+    std::wstring wideName(name.begin(), name.end());
+
+    ID3D12PipelineState* pso = nullptr;
+    bool loaded = false;
+    float loadTimeMs = 0.0f;
+    float createTimeMs = 0.0f;
+
+    if (mLibrary)
+    {
+        // Loading the same pipeline from two threads is not allowed, the loads are short
+        std::lock_guard<std::mutex> lock(mLibraryMutex);
+        auto start = std::chrono::high_resolution_clock::now();
+        loaded = SUCCEEDED(mLibrary->LoadGraphicsPipeline(wideName.c_str(), &desc, IID_PPV_ARGS(&pso)));
+        loadTimeMs = ElapsedMs(start);
+    }
+
+    if (!loaded)
+    {
+        // Compiled outside of any lock, the other threads keep going
+        auto start = std::chrono::high_resolution_clock::now();
+        HRESULT result = mDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso));
+        createTimeMs = ElapsedMs(start);
+
+        if (FAILED(result))
+        {
+            std::cerr << "Failed to create render pipeline !\n";
+            return nullptr;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.LoadTimeMs += loadTimeMs;
+    mStats.CreateTimeMs += createTimeMs;
+
+    // Another thread made the same pipeline meanwhile
+    auto found = mPipelines.find(key);
+    if (found != mPipelines.end())
+    {
+        pso->Release();
+        mStats.MemoryHits++;
+        return found->second;
+    }
+
+    if (loaded)
+    {
+        mStats.LibraryHits++;
+    }
+    else
+    {
+        mStats.Created++;
+        if (mLibrary)
+        {
+            std::lock_guard<std::mutex> libraryLock(mLibraryMutex);
+            if (SUCCEEDED(mLibrary->StorePipeline(wideName.c_str(), pso)))
+                mLibraryDirty = true;
+        }
+    }
+
+    mPipelines[key] = pso;
+    mStats.Pipelines = (UINT)mPipelines.size();
+    return pso;
+}
+
+void PipelineStateCache::Prewarm(const std::vector<D3D12_GRAPHICS_PIPELINE_STATE_DESC>& descs, ThreadPool& pool)
+{
+    UINT count = (UINT)descs.size();
+    pool.ParallelFor(count, std::min(count, pool.GetThreadCount() + 1), [&](UINT, UINT begin, UINT end)
+    {
+        for (UINT i = begin; i < end; i++)
+            GetGraphics(descs[i]);
+    });
+}
+
+bool PipelineStateCache::Save()
+{
+    std::lock_guard<std::mutex> lock(mLibraryMutex);
+    if (!mLibrary || !mLibraryDirty) return true;
+
+    std::vector<char> blob(mLibrary->GetSerializedSize());
+    HRESULT result = mLibrary->Serialize(blob.data(), blob.size());
+    if (FAILED(result))
+    {
+        std::cerr << "Failed to serialize pipeline library !\n";
+        return false;
+    }
+
+    std::fstream file;
+    file.open(mPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to write pipeline library !\n";
+        return false;
+    }
+    file.write(blob.data(), blob.size());
+
+    mLibraryDirty = false;
+    return true;
+}
+
+PipelineCacheStats PipelineStateCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void PipelineStateCache::Release()
+{
+    for (auto& pipeline : mPipelines)
+        pipeline.second->Release();
+    mPipelines.clear();
+
+    if (mLibrary)
+    {
+        mLibrary->Release();
+        mLibrary = nullptr;
+    }
+    mLibraryBlob.clear();
+}
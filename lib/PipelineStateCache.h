@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "PipelineStateKey.h"
+#include "ThreadPool.h"
+
+struct PipelineCacheStats
+{
+    UINT Requests = 0;
+    UINT MemoryHits = 0;
+    UINT LibraryHits = 0; // Loaded from the pipeline library file
+    UINT Created = 0; // Compiled by the driver
+    UINT Pipelines = 0;
+    float LoadTimeMs = 0.0f; // Summed over the threads
+    float CreateTimeMs = 0.0f;
+};
+
+// Graphics pipelines keyed by MakePipelineStateKey of their description.
+// A description already seen gives back the same pipeline. A new one is looked up in an
+// ID3D12PipelineLibrary read from disk at Initialize and written back by Save, so only the
+// pipelines missing from the file are compiled at startup.
+// Root signatures must be registered with their serialized blob to have a stable key.
+class PipelineStateCache
+{
+public:
+    PipelineStateCache();
+    ~PipelineStateCache();
+
+    PipelineStateCache(const PipelineStateCache& rhs) = delete;
+    PipelineStateCache& operator=(const PipelineStateCache& rhs) = delete;
+
+    // A missing or outdated file (new driver, other adapter) starts an empty library.
+    // Without pipeline library support the pipelines are only cached in memory.
+    void Initialize(ID3D12Device* device, const std::wstring& path);
+
+    void RegisterRootSignature(ID3D12RootSignature* rootSignature, const void* serialized, size_t size);
+
+    // Thread safe. Return nullptr when the pipeline can not be created.
+    ID3D12PipelineState* GetGraphics(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+    // Create the pipelines on the pool threads and the calling one. The descriptions and
+    // what they point to must live until the call returns.
+    void Prewarm(const std::vector<D3D12_GRAPHICS_PIPELINE_STATE_DESC>& descs, ThreadPool& pool);
+
+    // Write the library when pipelines were added to it
+    bool Save();
+
+    PipelineCacheStats GetStats() const;
+
+    void Release();
+
+private:
+    PipelineStateKey MakeKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) const;
+
+    ID3D12Device* mDevice = nullptr;
+    ID3D12PipelineLibrary* mLibrary = nullptr;
+    std::vector<char> mLibraryBlob; // Must outlive the library created from it
+    std::wstring mPath;
+    bool mLibraryDirty = false;
+
+    std::unordered_map<ID3D12RootSignature*, std::uint64_t> mRootSignatures;
+    std::unordered_map<PipelineStateKey, ID3D12PipelineState*, PipelineStateKeyHasher> mPipelines;
+
+    mutable std::mutex mMutex;
+    std::mutex mLibraryMutex;
+    PipelineCacheStats mStats;
+};
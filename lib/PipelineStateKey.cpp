@@ -0,0 +1,192 @@
+﻿#include "PipelineStateKey.h"
+
+#include <cstring>
+
+namespace
+{
+    // Fields are written one by one in little endian so the bytes do not depend on struct padding
+    class KeyWriter
+    {
+    public:
+        explicit KeyWriter(std::vector<std::uint8_t>& bytes) : mBytes(bytes) {}
+
+        void Write(std::uint64_t value, std::size_t size)
+        {
+            for (std::size_t i = 0; i < size; i++)
+                mBytes.push_back((std::uint8_t)(value >> (i * 8)));
+        }
+
+        void U8(std::uint8_t value) { Write(value, 1); }
+        void U32(std::uint32_t value) { Write(value, 4); }
+        void U64(std::uint64_t value) { Write(value, 8); }
+        void Bool(bool value) { Write(value ? 1 : 0, 1); }
+
+        void Float(float value)
+        {
+            // -0 and 0 are the same state
+            if (value == 0.0f) value = 0.0f;
+            std::uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            U32(bits);
+        }
+
+        // Semantics are case insensitive
+        void Semantic(const std::string& name)
+        {
+            U32((std::uint32_t)name.size());
+            for (char c : name)
+                U8((std::uint8_t)(c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c));
+        }
+
+    private:
+        std::vector<std::uint8_t>& mBytes;
+    };
+
+    void WriteBlend(KeyWriter& writer, const PipelineRenderTargetBlend& blend)
+    {
+        writer.Bool(blend.BlendEnable);
+        if (blend.BlendEnable)
+        {
+            writer.U32(blend.SrcBlend);
+            writer.U32(blend.DestBlend);
+            writer.U32(blend.BlendOp);
+            writer.U32(blend.SrcBlendAlpha);
+            writer.U32(blend.DestBlendAlpha);
+            writer.U32(blend.BlendOpAlpha);
+        }
+
+        writer.Bool(blend.LogicOpEnable);
+        if (blend.LogicOpEnable)
+            writer.U32(blend.LogicOp);
+
+        writer.U8(blend.RenderTargetWriteMask);
+    }
+
+    void WriteStencilOp(KeyWriter& writer, const PipelineStencilOp& op)
+    {
+        writer.U32(op.FailOp);
+        writer.U32(op.DepthFailOp);
+        writer.U32(op.PassOp);
+        writer.U32(op.Func);
+    }
+}
+
+std::uint64_t HashShaderBytecode(const void* bytecode, std::size_t size)
+{
+    if (bytecode == nullptr || size == 0) return 0;
+
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(bytecode);
+    std::uint64_t hash;
+    if (size >= 20 && std::memcmp(bytes, "DXBC", 4) == 0)
+        hash = HashBytes(bytes + 4, 16);
+    else
+        hash = HashBytes(bytes, size);
+
+    std::uint64_t size64 = size;
+    hash = HashBytes(&size64, sizeof(size64), hash);
+
+    // 0 is kept for the missing stages
+    return hash != 0 ? hash : 1;
+}
+
+PipelineStateKey MakePipelineStateKey(const PipelineStateDescription& description)
+{
+    PipelineStateKey key;
+    key.Bytes.reserve(256);
+    KeyWriter writer(key.Bytes);
+
+    writer.U64(description.RootSignature);
+    for (std::uint64_t shader : description.Shaders)
+        writer.U64(shader);
+
+    // Stream output
+    writer.U32((std::uint32_t)description.StreamOutput.size());
+    for (const PipelineStreamOutputEntry& entry : description.StreamOutput)
+    {
+        writer.U32(entry.Stream);
+        writer.Semantic(entry.SemanticName);
+        writer.U32(entry.SemanticIndex);
+        writer.U8(entry.StartComponent);
+        writer.U8(entry.ComponentCount);
+        writer.U8(entry.OutputSlot);
+    }
+    writer.U32((std::uint32_t)description.StreamOutputStrides.size());
+    for (std::uint32_t stride : description.StreamOutputStrides)
+        writer.U32(stride);
+    if (!description.StreamOutput.empty())
+        writer.U32(description.RasterizedStream);
+
+    // Blend, without independent blend the first render target state is used for all of them
+    std::uint32_t renderTargets = description.NumRenderTargets < PipelineMaxRenderTargets ? description.NumRenderTargets : PipelineMaxRenderTargets;
+    writer.Bool(description.AlphaToCoverageEnable);
+    writer.Bool(description.IndependentBlendEnable);
+    std::uint32_t blendCount = description.IndependentBlendEnable ? renderTargets : 1;
+    for (std::uint32_t i = 0; i < blendCount; i++)
+        WriteBlend(writer, description.Blend[i]);
+    writer.U32(description.SampleMask);
+
+    // Rasterizer
+    writer.U32(description.FillMode);
+    writer.U32(description.CullMode);
+    writer.Bool(description.FrontCounterClockwise);
+    writer.U32((std::uint32_t)description.DepthBias);
+    writer.Float(description.DepthBiasClamp);
+    writer.Float(description.SlopeScaledDepthBias);
+    writer.Bool(description.DepthClipEnable);
+    writer.Bool(description.MultisampleEnable);
+    writer.Bool(description.AntialiasedLineEnable);
+    writer.U32(description.ForcedSampleCount);
+    writer.U32(description.ConservativeRaster);
+
+    // Depth stencil
+    writer.Bool(description.DepthEnable);
+    if (description.DepthEnable)
+    {
+        writer.U32(description.DepthWriteMask);
+        writer.U32(description.DepthFunc);
+    }
+    writer.Bool(description.StencilEnable);
+    if (description.StencilEnable)
+    {
+        writer.U8(description.StencilReadMask);
+        writer.U8(description.StencilWriteMask);
+        WriteStencilOp(writer, description.FrontFace);
+        WriteStencilOp(writer, description.BackFace);
+    }
+
+    // Input layout, the step rate only means something for per instance data
+    writer.U32((std::uint32_t)description.InputLayout.size());
+    for (const PipelineInputElement& element : description.InputLayout)
+    {
+        writer.Semantic(element.SemanticName);
+        writer.U32(element.SemanticIndex);
+        writer.U32(element.Format);
+        writer.U32(element.InputSlot);
+        writer.U32(element.AlignedByteOffset);
+        writer.U32(element.InputSlotClass);
+        writer.U32(element.InputSlotClass != 0 ? element.InstanceDataStepRate : 0);
+    }
+
+    writer.U32(description.IBStripCutValue);
+    writer.U32(description.PrimitiveTopologyType);
+    writer.U32(renderTargets);
+    for (std::uint32_t i = 0; i < renderTargets; i++)
+        writer.U32(description.RTVFormats[i]);
+    writer.U32(description.DSVFormat);
+    writer.U32(description.SampleCount);
+    writer.U32(description.SampleQuality);
+    writer.U32(description.NodeMask);
+    writer.U32(description.Flags);
+
+    key.Hash = HashBytes(key.Bytes.data(), key.Bytes.size());
+    return key;
+}
+
+std::string GetPipelineStateName(const PipelineStateKey& key)
+{
+    const char digits[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 0; i < 16; i++)
+        name[15 - i] = digits[(key.Hash >> (i * 4)) & 0xF];
+    return name;
+}
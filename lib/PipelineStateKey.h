@@ -0,0 +1,139 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Hash.h"
+
+// Backend independent copy of D3D12_GRAPHICS_PIPELINE_STATE_DESC. Enums are stored as their
+// values, pointers as hashes of what they point to so the key is the same from one run to the next.
+
+const std::uint32_t PipelineMaxRenderTargets = 8;
+
+enum class PipelineShaderStage
+{
+    Vertex,
+    Pixel,
+    Domain,
+    Hull,
+    Geometry,
+
+    Count
+};
+
+struct PipelineInputElement
+{
+    std::string SemanticName;
+    std::uint32_t SemanticIndex = 0;
+    std::uint32_t Format = 0;
+    std::uint32_t InputSlot = 0;
+    std::uint32_t AlignedByteOffset = 0;
+    std::uint32_t InputSlotClass = 0; // 0 per vertex, 1 per instance
+    std::uint32_t InstanceDataStepRate = 0;
+};
+
+struct PipelineStreamOutputEntry
+{
+    std::uint32_t Stream = 0;
+    std::string SemanticName;
+    std::uint32_t SemanticIndex = 0;
+    std::uint8_t StartComponent = 0;
+    std::uint8_t ComponentCount = 0;
+    std::uint8_t OutputSlot = 0;
+};
+
+struct PipelineRenderTargetBlend
+{
+    bool BlendEnable = false;
+    bool LogicOpEnable = false;
+    std::uint32_t SrcBlend = 0;
+    std::uint32_t DestBlend = 0;
+    std::uint32_t BlendOp = 0;
+    std::uint32_t SrcBlendAlpha = 0;
+    std::uint32_t DestBlendAlpha = 0;
+    std::uint32_t BlendOpAlpha = 0;
+    std::uint32_t LogicOp = 0;
+    std::uint8_t RenderTargetWriteMask = 0;
+};
+
+struct PipelineStencilOp
+{
+    std::uint32_t FailOp = 0;
+    std::uint32_t DepthFailOp = 0;
+    std::uint32_t PassOp = 0;
+    std::uint32_t Func = 0;
+};
+
+struct PipelineStateDescription
+{
+    std::uint64_t RootSignature = 0; // Hash of the serialized root signature
+    std::uint64_t Shaders[(size_t)PipelineShaderStage::Count] = {}; // HashShaderBytecode, 0 for no shader
+
+    std::vector<PipelineStreamOutputEntry> StreamOutput;
+    std::vector<std::uint32_t> StreamOutputStrides;
+    std::uint32_t RasterizedStream = 0;
+
+    bool AlphaToCoverageEnable = false;
+    bool IndependentBlendEnable = false;
+    PipelineRenderTargetBlend Blend[PipelineMaxRenderTargets];
+    std::uint32_t SampleMask = 0;
+
+    std::uint32_t FillMode = 0;
+    std::uint32_t CullMode = 0;
+    bool FrontCounterClockwise = false;
+    std::int32_t DepthBias = 0;
+    float DepthBiasClamp = 0.0f;
+    float SlopeScaledDepthBias = 0.0f;
+    bool DepthClipEnable = false;
+    bool MultisampleEnable = false;
+    bool AntialiasedLineEnable = false;
+    std::uint32_t ForcedSampleCount = 0;
+    std::uint32_t ConservativeRaster = 0;
+
+    bool DepthEnable = false;
+    std::uint32_t DepthWriteMask = 0;
+    std::uint32_t DepthFunc = 0;
+    bool StencilEnable = false;
+    std::uint8_t StencilReadMask = 0;
+    std::uint8_t StencilWriteMask = 0;
+    PipelineStencilOp FrontFace;
+    PipelineStencilOp BackFace;
+
+    std::vector<PipelineInputElement> InputLayout;
+    std::uint32_t IBStripCutValue = 0;
+    std::uint32_t PrimitiveTopologyType = 0;
+    std::uint32_t NumRenderTargets = 0;
+    std::uint32_t RTVFormats[PipelineMaxRenderTargets] = {};
+    std::uint32_t DSVFormat = 0;
+    std::uint32_t SampleCount = 1;
+    std::uint32_t SampleQuality = 0;
+    std::uint32_t NodeMask = 0;
+    std::uint32_t Flags = 0;
+};
+
+// Normalized description and its hash. Two descriptions creating the same pipeline give the same
+// key: the states a disabled feature ignores are cleared, semantic names are upper case, the render
+// targets past NumRenderTargets are dropped. The hash picks the bucket, the bytes settle collisions.
+struct PipelineStateKey
+{
+    std::uint64_t Hash = 0;
+    std::vector<std::uint8_t> Bytes;
+
+    bool operator==(const PipelineStateKey& rhs) const { return Hash == rhs.Hash && Bytes == rhs.Bytes; }
+    bool operator!=(const PipelineStateKey& rhs) const { return !(*this == rhs); }
+};
+
+struct PipelineStateKeyHasher
+{
+    std::size_t operator()(const PipelineStateKey& key) const { return (std::size_t)key.Hash; }
+};
+
+// A DXBC container starts with the MD5 of its content, it is hashed instead of the whole bytecode
+std::uint64_t HashShaderBytecode(const void* bytecode, std::size_t size);
+
+PipelineStateKey MakePipelineStateKey(const PipelineStateDescription& description);
+
+// 16 hexadecimal digits of the hash, the name of the pipeline in a pipeline library
+std::string GetPipelineStateName(const PipelineStateKey& key);
@@ -0,0 +1,52 @@
+﻿#include "RadixSort.h"
+
+#include <utility>
+
+void RadixSortKeys(std::vector<std::uint64_t>& keys, std::vector<std::uint64_t>& scratch)
+{
+    const size_t count = keys.size();
+    if (count < 2) return;
+
+    // Histogram of the 8 bytes in a single read of the keys
+    std::uint32_t histograms[8][256] = {};
+    for (size_t i = 0; i < count; i++)
+    {
+        std::uint64_t key = keys[i];
+        for (int b = 0; b < 8; b++)
+            histograms[b][(key >> (b * 8)) & 0xFF]++;
+    }
+
+    scratch.resize(count);
+    std::uint64_t* src = keys.data();
+    std::uint64_t* dst = scratch.data();
+
+    for (int b = 0; b < 8; b++)
+    {
+        std::uint32_t* histogram = histograms[b];
+
+        // Every key has the same byte here, the pass would not move anything
+        if (histogram[(src[0] >> (b * 8)) & 0xFF] == count)
+            continue;
+
+        // Prefix sum gives the first slot of each bucket
+        std::uint32_t offsets[256];
+        std::uint32_t sum = 0;
+        for (int d = 0; d < 256; d++)
+        {
+            offsets[d] = sum;
+            sum += histogram[d];
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            std::uint64_t key = src[i];
+            dst[offsets[(key >> (b * 8)) & 0xFF]++] = key;
+        }
+
+        std::swap(src, dst);
+    }
+
+    // Odd number of passes, the result is in the scratch buffer
+    if (src != keys.data())
+        keys.swap(scratch);
+}
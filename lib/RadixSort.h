@@ -0,0 +1,9 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LSD radix sort on bytes, the passes on bytes every key share are skipped.
+// scratch is resized to the key count and kept by the caller to not allocate every sort.
+void RadixSortKeys(std::vector<std::uint64_t>& keys, std::vector<std::uint64_t>& scratch);
@@ -0,0 +1,142 @@
+﻿#include "RecordBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "CommandRecorder.h"
+#include "RecordingCommandList.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    struct BenchmarkDraw
+    {
+        std::uint32_t Pipeline;
+        std::uint32_t Mesh;
+        GpuAddress Constants;
+    };
+
+    // The recording lists only store the handles, fixed values keep the streams the same from run to run
+    void* MakeFakeHandle(std::uintptr_t value)
+    {
+        return (void*)value;
+    }
+
+    const GpuAddress PassConstants = 0x10000000;
+    const GpuAddress ObjectConstants = 0x20000000;
+    const GpuAddress MeshBuffers = 0x40000000;
+    const std::uint32_t ObjectConstantsStride = 256;
+
+    void RecordPassSetup(ICommandList& list)
+    {
+        list.SetGraphicsRootSignature(MakeFakeHandle(1));
+        list.IASetPrimitiveTopology(4); // D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+        list.SetGraphicsRootConstantBufferView(1, PassConstants);
+    }
+
+    void RecordDraw(ICommandList& list, const BenchmarkDraw& draw)
+    {
+        VertexBufferBinding vertices;
+        vertices.BufferLocation = MeshBuffers + (GpuAddress)draw.Mesh * 0x10000;
+        vertices.SizeInBytes = 0x8000;
+        vertices.StrideInBytes = 32;
+
+        IndexBufferBinding indices;
+        indices.BufferLocation = vertices.BufferLocation + 0x8000;
+        indices.SizeInBytes = 0x8000;
+        indices.Format = 42; // DXGI_FORMAT_R32_UINT
+
+        list.SetPipelineState(MakeFakeHandle(0x100 + draw.Pipeline));
+        list.IASetVertexBuffers(0, 1, &vertices);
+        list.IASetIndexBuffer(&indices);
+        list.SetGraphicsRootConstantBufferView(0, draw.Constants);
+        list.DrawIndexedInstanced(36, 1, 0, 0, 0);
+    }
+}
+
+RecordBenchmarkResult RunRecordBenchmark(std::uint32_t drawCount, std::uint32_t workers, std::uint32_t frames, std::uint32_t seed)
+{
+    RecordBenchmarkResult result;
+    result.Draws = drawCount;
+    result.Workers = workers = std::max(1u, workers);
+    result.Frames = frames;
+    result.Valid = true;
+
+    std::mt19937 random(seed);
+    std::vector<BenchmarkDraw> draws(drawCount);
+    for (std::uint32_t i = 0; i < drawCount; i++)
+        draws[i] = { (std::uint32_t)(random() % 8), (std::uint32_t)(random() % 64), ObjectConstants + (GpuAddress)i * ObjectConstantsStride };
+    std::sort(draws.begin(), draws.end(), [](const BenchmarkDraw& a, const BenchmarkDraw& b)
+    {
+        return a.Pipeline != b.Pipeline ? a.Pipeline < b.Pipeline : a.Mesh < b.Mesh;
+    });
+
+    // The calling thread records the first range
+    ThreadPool pool(std::max(1u, workers - 1));
+    std::vector<std::unique_ptr<RecordingCommandList>> lists;
+    std::vector<std::unique_ptr<CommandRecorder>> recorders;
+    std::vector<std::uint32_t> rangeDraws(workers);
+    for (std::uint32_t w = 0; w < workers; w++)
+    {
+        lists.emplace_back(new RecordingCommandList());
+        recorders.emplace_back(new CommandRecorder(lists.back().get()));
+    }
+
+    for (std::uint32_t frame = 0; frame <= frames; frame++)
+    {
+        for (std::uint32_t w = 0; w < workers; w++)
+        {
+            lists[w]->Reset();
+            recorders[w]->Reset();
+            rangeDraws[w] = 0;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        pool.ParallelFor(drawCount, workers, [&](std::uint32_t range, std::uint32_t begin, std::uint32_t end)
+        {
+            CommandRecorder& recorder = *recorders[range];
+            RecordPassSetup(recorder);
+            for (std::uint32_t d = begin; d < end; d++)
+                RecordDraw(recorder, draws[d]);
+            rangeDraws[range] = end - begin;
+        });
+        double recordMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        // The first frame grows the streams
+        if (frame == 0) continue;
+
+        result.RecordMs += recordMs;
+        result.WorstRecordMs = std::max(result.WorstRecordMs, recordMs);
+
+        std::uint32_t recorded = 0;
+        for (std::uint32_t w = 0; w < workers; w++)
+        {
+            std::uint32_t listDraws = lists[w]->GetCommandCount(CommandType::DrawIndexedInstanced);
+            if (result.Valid && listDraws != rangeDraws[w])
+            {
+                result.Valid = false;
+                result.Error = "list " + std::to_string(w) + " has " + std::to_string(listDraws) + " draws for a range of " +
+                    std::to_string(rangeDraws[w]);
+            }
+            recorded += listDraws;
+            result.Commands += lists[w]->GetCommandCount();
+            result.StreamBytes += lists[w]->GetStream().size();
+        }
+        if (result.Valid && recorded != drawCount)
+        {
+            result.Valid = false;
+            result.Error = std::to_string(recorded) + " draws recorded for " + std::to_string(drawCount);
+        }
+    }
+
+    if (frames > 0)
+    {
+        result.RecordMs /= frames;
+        result.Commands /= frames;
+        result.StreamBytes /= frames;
+    }
+    return result;
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct RecordBenchmarkResult
+{
+    std::uint32_t Draws = 0;
+    std::uint32_t Workers = 0;
+    std::uint32_t Frames = 0;
+
+    // Average of a frame
+    double RecordMs = 0.0; // From the first range started to the last one done
+    double WorstRecordMs = 0.0;
+    std::uint32_t Commands = 0; // Reached the lists, once the recorders dropped the redundant ones
+    std::uint64_t StreamBytes = 0;
+
+    // Every draw was recorded once, in the list of its range
+    bool Valid = false;
+    std::string Error;
+};
+
+// drawCount draws sorted by pipeline then mesh like the draw queue gives them, split in workers
+// contiguous ranges recorded in parallel. Each range has its own RecordingCommandList and
+// CommandRecorder and starts with the pass setup, like the pooled lists of the renderer.
+// Same seed same draws, the first frame is not measured.
+RecordBenchmarkResult RunRecordBenchmark(std::uint32_t drawCount, std::uint32_t workers, std::uint32_t frames, std::uint32_t seed);
@@ -0,0 +1,410 @@
+﻿#include "RecordingCommandList.h"
+
+#include <algorithm>
+
+RecordingCommandList::RecordingCommandList()
+{
+    Reset();
+}
+
+void RecordingCommandList::Reset()
+{
+    mStream.clear();
+    memset(mCommandCounts, 0, sizeof(mCommandCounts));
+}
+
+const std::vector<std::uint8_t>& RecordingCommandList::GetStream() const
+{
+    return mStream;
+}
+
+std::uint32_t RecordingCommandList::GetCommandCount() const
+{
+    std::uint32_t total = 0;
+    for (std::uint32_t count : mCommandCounts)
+        total += count;
+    return total;
+}
+
+std::uint32_t RecordingCommandList::GetCommandCount(CommandType type) const
+{
+    return mCommandCounts[(size_t)type];
+}
+
+void RecordingCommandList::Begin(CommandType type)
+{
+    mCommandCounts[(size_t)type]++;
+    mStream.push_back((std::uint8_t)type);
+}
+
+void RecordingCommandList::SetPipelineState(void* pipelineState)
+{
+    Begin(CommandType::SetPipelineState);
+    Write((std::uint64_t)(uintptr_t)pipelineState);
+}
+
+void RecordingCommandList::SetGraphicsRootSignature(void* rootSignature)
+{
+    Begin(CommandType::SetGraphicsRootSignature);
+    Write((std::uint64_t)(uintptr_t)rootSignature);
+}
+
+void RecordingCommandList::IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t numViews, const VertexBufferBinding* views)
+{
+    Begin(CommandType::IASetVertexBuffers);
+    Write(startSlot);
+    Write(numViews);
+    for (std::uint32_t i = 0; i < numViews; i++)
+        Write(views[i]);
+}
+
+void RecordingCommandList::IASetIndexBuffer(const IndexBufferBinding* view)
+{
+    Begin(CommandType::IASetIndexBuffer);
+    Write(*view);
+}
+
+void RecordingCommandList::IASetPrimitiveTopology(std::uint32_t topology)
+{
+    Begin(CommandType::IASetPrimitiveTopology);
+    Write(topology);
+}
+
+void RecordingCommandList::SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation)
+{
+    Begin(CommandType::SetGraphicsRootConstantBufferView);
+    Write(rootParameterIndex);
+    Write(bufferLocation);
+}
+
+void RecordingCommandList::SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation)
+{
+    Begin(CommandType::SetGraphicsRootShaderResourceView);
+    Write(rootParameterIndex);
+    Write(bufferLocation);
+}
+
+void RecordingCommandList::SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues)
+{
+    Begin(CommandType::SetGraphicsRoot32BitConstant);
+    Write(rootParameterIndex);
+    Write(srcData);
+    Write(destOffsetIn32BitValues);
+}
+
+void RecordingCommandList::DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+                                                std::uint32_t startIndexLocation, std::int32_t baseVertexLocation,
+                                                std::uint32_t startInstanceLocation)
+{
+    Begin(CommandType::DrawIndexedInstanced);
+    Write(indexCountPerInstance);
+    Write(instanceCount);
+    Write(startIndexLocation);
+    Write(baseVertexLocation);
+    Write(startInstanceLocation);
+}
+
+void RecordingCommandList::ExecuteIndirect(void* commandSignature, std::uint32_t maxCommandCount,
+                                           void* argumentBuffer, std::uint64_t argumentBufferOffset)
+{
+    Begin(CommandType::ExecuteIndirect);
+    Write((std::uint64_t)(uintptr_t)commandSignature);
+    Write(maxCommandCount);
+    Write((std::uint64_t)(uintptr_t)argumentBuffer);
+    Write(argumentBufferOffset);
+}
+
+void RecordingCommandList::ExecuteBundle(void* bundle)
+{
+    Begin(CommandType::ExecuteBundle);
+    Write((std::uint64_t)(uintptr_t)bundle);
+}
+
+void RecordingCommandList::ResourceBarrier(std::uint32_t numBarriers, const ResourceBarrierDesc* barriers)
+{
+    Begin(CommandType::ResourceBarrier);
+    Write(numBarriers);
+    for (std::uint32_t i = 0; i < numBarriers; i++)
+    {
+        Write((std::uint32_t)barriers[i].Type);
+        Write((std::uint64_t)(uintptr_t)barriers[i].Resource);
+        Write(barriers[i].StateBefore);
+        Write(barriers[i].StateAfter);
+        Write((std::uint32_t)barriers[i].Flags);
+    }
+}
+
+void RecordingCommandList::RSSetViewports(std::uint32_t numViewports, const Viewport* viewports)
+{
+    Begin(CommandType::RSSetViewports);
+    Write(numViewports);
+    for (std::uint32_t i = 0; i < numViewports; i++)
+        Write(viewports[i]);
+}
+
+void RecordingCommandList::RSSetScissorRects(std::uint32_t numRects, const ScissorRect* rects)
+{
+    Begin(CommandType::RSSetScissorRects);
+    Write(numRects);
+    for (std::uint32_t i = 0; i < numRects; i++)
+        Write(rects[i]);
+}
+
+void RecordingCommandList::OMSetRenderTargets(std::uint32_t numRenderTargets, const CpuDescriptor* renderTargets, CpuDescriptor depthStencil)
+{
+    Begin(CommandType::OMSetRenderTargets);
+    Write(numRenderTargets);
+    Write(depthStencil);
+    for (std::uint32_t i = 0; i < numRenderTargets; i++)
+        Write(renderTargets[i]);
+}
+
+void RecordingCommandList::SetDescriptorHeaps(std::uint32_t numHeaps, void* const* heaps)
+{
+    Begin(CommandType::SetDescriptorHeaps);
+    Write(numHeaps);
+    for (std::uint32_t i = 0; i < numHeaps; i++)
+        Write((std::uint64_t)(uintptr_t)heaps[i]);
+}
+
+void RecordingCommandList::ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4])
+{
+    Begin(CommandType::ClearRenderTargetView);
+    Write(renderTarget);
+    for (int i = 0; i < 4; i++)
+        Write(color[i]);
+}
+
+void RecordingCommandList::ClearDepthStencilView(CpuDescriptor depthStencil, ClearFlags flags, float depth, std::uint8_t stencil)
+{
+    Begin(CommandType::ClearDepthStencilView);
+    Write(depthStencil);
+    Write((std::uint32_t)flags);
+    Write(depth);
+    Write((std::uint32_t)stencil);
+}
+
+namespace
+{
+    const size_t BarrierSize = 4 + 8 + 4 + 4 + 4;
+
+    template<typename T>
+    T ReadValue(const std::uint8_t* data)
+    {
+        T value;
+        memcpy(&value, data, sizeof(T));
+        return value;
+    }
+}
+
+bool RecordingCommandList::ReadCommand(const std::vector<std::uint8_t>& stream, size_t& offset, CommandType& type, const std::uint8_t*& payload)
+{
+    return ReadCommand(stream.data(), stream.size(), offset, type, payload);
+}
+
+bool RecordingCommandList::ReadCommand(const std::uint8_t* stream, size_t streamSize, size_t& offset, CommandType& type, const std::uint8_t*& payload)
+{
+    if (offset >= streamSize) return false;
+
+    type = (CommandType)stream[offset];
+    payload = stream + offset + 1;
+    size_t available = streamSize - offset - 1;
+
+    // Argument sizes of the writers above
+    size_t size = 0;
+    switch (type)
+    {
+    case CommandType::SetPipelineState: size = 8; break;
+    case CommandType::SetGraphicsRootSignature: size = 8; break;
+    case CommandType::IASetVertexBuffers:
+        if (available < 8) return false;
+        size = 8 + ReadValue<std::uint32_t>(payload + 4) * sizeof(VertexBufferBinding);
+        break;
+    case CommandType::IASetIndexBuffer: size = sizeof(IndexBufferBinding); break;
+    case CommandType::IASetPrimitiveTopology: size = 4; break;
+    case CommandType::SetGraphicsRootConstantBufferView: size = 4 + 8; break;
+    case CommandType::SetGraphicsRootShaderResourceView: size = 4 + 8; break;
+    case CommandType::SetGraphicsRoot32BitConstant: size = 4 + 4 + 4; break;
+    case CommandType::DrawIndexedInstanced: size = 5 * 4; break;
+    case CommandType::ExecuteIndirect: size = 8 + 4 + 8 + 8; break;
+    case CommandType::ExecuteBundle: size = 8; break;
+    case CommandType::ResourceBarrier:
+        if (available < 4) return false;
+        size = 4 + ReadValue<std::uint32_t>(payload) * BarrierSize;
+        break;
+    case CommandType::RSSetViewports:
+        if (available < 4) return false;
+        size = 4 + ReadValue<std::uint32_t>(payload) * sizeof(Viewport);
+        break;
+    case CommandType::RSSetScissorRects:
+        if (available < 4) return false;
+        size = 4 + ReadValue<std::uint32_t>(payload) * sizeof(ScissorRect);
+        break;
+    case CommandType::OMSetRenderTargets:
+        if (available < 4) return false;
+        size = 4 + 8 + ReadValue<std::uint32_t>(payload) * 8;
+        break;
+    case CommandType::SetDescriptorHeaps:
+        if (available < 4) return false;
+        size = 4 + ReadValue<std::uint32_t>(payload) * 8;
+        break;
+    case CommandType::ClearRenderTargetView: size = 8 + 4 * 4; break;
+    case CommandType::ClearDepthStencilView: size = 8 + 4 + 4 + 4; break;
+    default: return false;
+    }
+
+    if (available < size) return false;
+    offset += 1 + size;
+    return true;
+}
+
+std::uint32_t RecordingCommandList::ReadBarrierCount(const std::uint8_t* payload)
+{
+    return ReadValue<std::uint32_t>(payload);
+}
+
+ResourceBarrierDesc RecordingCommandList::ReadBarrier(const std::uint8_t* payload, std::uint32_t index)
+{
+    const std::uint8_t* data = payload + 4 + index * BarrierSize;
+
+    ResourceBarrierDesc barrier;
+    barrier.Type = (BarrierType)ReadValue<std::uint32_t>(data);
+    barrier.Resource = (void*)(uintptr_t)ReadValue<std::uint64_t>(data + 4);
+    barrier.StateBefore = ReadValue<std::uint32_t>(data + 12);
+    barrier.StateAfter = ReadValue<std::uint32_t>(data + 16);
+    barrier.Flags = (BarrierFlags)ReadValue<std::uint32_t>(data + 20);
+    return barrier;
+}
+
+void RecordingCommandList::ReplayCommand(CommandType type, const std::uint8_t* payload, ICommandList& target,
+                                         const GpuAddressTranslator* translator)
+{
+    auto translate = [translator](GpuAddress address)
+    {
+        return translator != nullptr ? translator->Translate(address) : address;
+    };
+
+    switch (type)
+    {
+    case CommandType::SetPipelineState:
+        target.SetPipelineState((void*)(uintptr_t)ReadValue<std::uint64_t>(payload));
+        break;
+    case CommandType::SetGraphicsRootSignature:
+        target.SetGraphicsRootSignature((void*)(uintptr_t)ReadValue<std::uint64_t>(payload));
+        break;
+    case CommandType::IASetVertexBuffers:
+    {
+        // D3D12 has 32 input slots
+        VertexBufferBinding views[32];
+        std::uint32_t count = std::min(ReadValue<std::uint32_t>(payload + 4), 32u);
+        for (std::uint32_t i = 0; i < count; i++)
+        {
+            views[i] = ReadValue<VertexBufferBinding>(payload + 8 + i * sizeof(VertexBufferBinding));
+            views[i].BufferLocation = translate(views[i].BufferLocation);
+        }
+        target.IASetVertexBuffers(ReadValue<std::uint32_t>(payload), count, views);
+        break;
+    }
+    case CommandType::IASetIndexBuffer:
+    {
+        IndexBufferBinding view = ReadValue<IndexBufferBinding>(payload);
+        view.BufferLocation = translate(view.BufferLocation);
+        target.IASetIndexBuffer(&view);
+        break;
+    }
+    case CommandType::IASetPrimitiveTopology:
+        target.IASetPrimitiveTopology(ReadValue<std::uint32_t>(payload));
+        break;
+    case CommandType::SetGraphicsRootConstantBufferView:
+        target.SetGraphicsRootConstantBufferView(ReadValue<std::uint32_t>(payload), translate(ReadValue<GpuAddress>(payload + 4)));
+        break;
+    case CommandType::SetGraphicsRootShaderResourceView:
+        target.SetGraphicsRootShaderResourceView(ReadValue<std::uint32_t>(payload), translate(ReadValue<GpuAddress>(payload + 4)));
+        break;
+    case CommandType::SetGraphicsRoot32BitConstant:
+        target.SetGraphicsRoot32BitConstant(ReadValue<std::uint32_t>(payload), ReadValue<std::uint32_t>(payload + 4),
+                                            ReadValue<std::uint32_t>(payload + 8));
+        break;
+    case CommandType::DrawIndexedInstanced:
+        target.DrawIndexedInstanced(ReadValue<std::uint32_t>(payload), ReadValue<std::uint32_t>(payload + 4),
+                                    ReadValue<std::uint32_t>(payload + 8), ReadValue<std::int32_t>(payload + 12),
+                                    ReadValue<std::uint32_t>(payload + 16));
+        break;
+    case CommandType::ExecuteIndirect:
+        target.ExecuteIndirect((void*)(uintptr_t)ReadValue<std::uint64_t>(payload), ReadValue<std::uint32_t>(payload + 8),
+                               (void*)(uintptr_t)ReadValue<std::uint64_t>(payload + 12), ReadValue<std::uint64_t>(payload + 20));
+        break;
+    case CommandType::ExecuteBundle:
+        target.ExecuteBundle((void*)(uintptr_t)ReadValue<std::uint64_t>(payload));
+        break;
+    case CommandType::ResourceBarrier:
+    {
+        std::uint32_t count = ReadBarrierCount(payload);
+        ResourceBarrierDesc local[16];
+        std::vector<ResourceBarrierDesc> heap;
+        ResourceBarrierDesc* barriers = local;
+        if (count > 16)
+        {
+            heap.resize(count);
+            barriers = heap.data();
+        }
+        for (std::uint32_t i = 0; i < count; i++)
+            barriers[i] = ReadBarrier(payload, i);
+        target.ResourceBarrier(count, barriers);
+        break;
+    }
+    case CommandType::RSSetViewports:
+    {
+        // D3D12 has 16 viewports and scissor rectangles
+        Viewport viewports[16];
+        std::uint32_t count = std::min(ReadValue<std::uint32_t>(payload), 16u);
+        for (std::uint32_t i = 0; i < count; i++)
+            viewports[i] = ReadValue<Viewport>(payload + 4 + i * sizeof(Viewport));
+        target.RSSetViewports(count, viewports);
+        break;
+    }
+    case CommandType::RSSetScissorRects:
+    {
+        ScissorRect rects[16];
+        std::uint32_t count = std::min(ReadValue<std::uint32_t>(payload), 16u);
+        for (std::uint32_t i = 0; i < count; i++)
+            rects[i] = ReadValue<ScissorRect>(payload + 4 + i * sizeof(ScissorRect));
+        target.RSSetScissorRects(count, rects);
+        break;
+    }
+    case CommandType::OMSetRenderTargets:
+    {
+        // D3D12 has 8 simultaneous render targets
+        CpuDescriptor renderTargets[8];
+        std::uint32_t count = std::min(ReadValue<std::uint32_t>(payload), 8u);
+        for (std::uint32_t i = 0; i < count; i++)
+            renderTargets[i] = ReadValue<CpuDescriptor>(payload + 12 + i * 8);
+        target.OMSetRenderTargets(count, renderTargets, ReadValue<CpuDescriptor>(payload + 4));
+        break;
+    }
+    case CommandType::SetDescriptorHeaps:
+    {
+        // One CBV/SRV/UAV heap and one sampler heap at most
+        void* heaps[2];
+        std::uint32_t count = std::min(ReadValue<std::uint32_t>(payload), 2u);
+        for (std::uint32_t i = 0; i < count; i++)
+            heaps[i] = (void*)(uintptr_t)ReadValue<std::uint64_t>(payload + 4 + i * 8);
+        target.SetDescriptorHeaps(count, heaps);
+        break;
+    }
+    case CommandType::ClearRenderTargetView:
+    {
+        float color[4];
+        for (int i = 0; i < 4; i++)
+            color[i] = ReadValue<float>(payload + 8 + i * 4);
+        target.ClearRenderTargetView(ReadValue<CpuDescriptor>(payload), color);
+        break;
+    }
+    case CommandType::ClearDepthStencilView:
+        target.ClearDepthStencilView(ReadValue<CpuDescriptor>(payload), (ClearFlags)ReadValue<std::uint32_t>(payload + 8),
+                                     ReadValue<float>(payload + 12), (std::uint8_t)ReadValue<std::uint32_t>(payload + 16));
+        break;
+    default:
+        break;
+    }
+}
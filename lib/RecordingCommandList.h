@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "CommandList.h"
+
+// Maps the buffer addresses of a recorded stream to the ones of the device replaying it
+class GpuAddressTranslator
+{
+public:
+    virtual ~GpuAddressTranslator() {}
+
+    virtual GpuAddress Translate(GpuAddress address) const = 0;
+};
+
+// Command list recording into host memory, used to run the renderer without a GPU.
+// Every command is stored as its CommandType byte followed by its packed arguments.
+class RecordingCommandList : public ICommandList
+{
+public:
+    RecordingCommandList();
+
+    void Reset();
+
+    const std::vector<std::uint8_t>& GetStream() const;
+    std::uint32_t GetCommandCount() const;
+    std::uint32_t GetCommandCount(CommandType type) const;
+
+    // Walk a stream: read the command at offset, point payload at its arguments and move offset
+    // to the next command. Return false at the end of the stream or on a truncated command.
+    static bool ReadCommand(const std::vector<std::uint8_t>& stream, size_t& offset, CommandType& type, const std::uint8_t*& payload);
+    static bool ReadCommand(const std::uint8_t* stream, size_t size, size_t& offset, CommandType& type, const std::uint8_t*& payload);
+
+    // Barriers of a ResourceBarrier payload
+    static std::uint32_t ReadBarrierCount(const std::uint8_t* payload);
+    static ResourceBarrierDesc ReadBarrier(const std::uint8_t* payload, std::uint32_t index);
+
+    // Call the command read by ReadCommand on target. The buffer addresses go through translator
+    // when there is one, the opaque handles are given as recorded.
+    static void ReplayCommand(CommandType type, const std::uint8_t* payload, ICommandList& target,
+                              const GpuAddressTranslator* translator = nullptr);
+
+    void SetPipelineState(void* pipelineState) override;
+    void SetGraphicsRootSignature(void* rootSignature) override;
+    void IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t numViews, const VertexBufferBinding* views) override;
+    void IASetIndexBuffer(const IndexBufferBinding* view) override;
+    void IASetPrimitiveTopology(std::uint32_t topology) override;
+    void SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation) override;
+    void SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, GpuAddress bufferLocation) override;
+    void SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) override;
+    void DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+                              std::uint32_t startIndexLocation, std::int32_t baseVertexLocation,
+                              std::uint32_t startInstanceLocation) override;
+    void ExecuteIndirect(void* commandSignature, std::uint32_t maxCommandCount,
+                         void* argumentBuffer, std::uint64_t argumentBufferOffset) override;
+    void ExecuteBundle(void* bundle) override;
+    void ResourceBarrier(std::uint32_t numBarriers, const ResourceBarrierDesc* barriers) override;
+    void RSSetViewports(std::uint32_t numViewports, const Viewport* viewports) override;
+    void RSSetScissorRects(std::uint32_t numRects, const ScissorRect* rects) override;
+    void OMSetRenderTargets(std::uint32_t numRenderTargets, const CpuDescriptor* renderTargets, CpuDescriptor depthStencil) override;
+    void SetDescriptorHeaps(std::uint32_t numHeaps, void* const* heaps) override;
+    void ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4]) override;
+    void ClearDepthStencilView(CpuDescriptor depthStencil, ClearFlags flags, float depth, std::uint8_t stencil) override;
+
+private:
+    void Begin(CommandType type);
+
+    template<typename T>
+    void Write(const T& value)
+    {
+        size_t offset = mStream.size();
+        mStream.resize(offset + sizeof(T));
+        memcpy(&mStream[offset], &value, sizeof(T));
+    }
+
+    std::vector<std::uint8_t> mStream;
+    std::uint32_t mCommandCounts[(size_t)CommandType::Count];
+};
@@ -0,0 +1,272 @@
+﻿#include "RecordingRenderDevice.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Hash.h"
+
+void SubmissionStats::Add(const SubmissionStats& other)
+{
+    Submissions += other.Submissions;
+    CommandLists += other.CommandLists;
+    Commands += other.Commands;
+    StreamBytes += other.StreamBytes;
+    Draws += other.Draws;
+    Instances += other.Instances;
+    Indices += other.Indices;
+    IndirectCalls += other.IndirectCalls;
+    BundleCalls += other.BundleCalls;
+    Barriers += other.Barriers;
+    InvalidLists += other.InvalidLists;
+    EarlyResets += other.EarlyResets;
+    StreamHash = HashBytes(&other.StreamHash, sizeof(other.StreamHash), StreamHash);
+}
+
+RecordingRenderDevice::BundleAllocator::BundleAllocator(RecordingDeviceStats& stats) : mStats(stats)
+{
+}
+
+ICommandList& RecordingRenderDevice::BundleAllocator::BeginBundle(void* initialPipelineState)
+{
+    if (!mFree.empty())
+    {
+        mCurrent = mFree.back();
+        mFree.pop_back();
+    }
+    else
+    {
+        mCurrent = (std::uint32_t)mBundles.size();
+        mBundles.emplace_back(new RecordingCommandList());
+    }
+
+    RecordingCommandList& bundle = *mBundles[mCurrent];
+    bundle.Reset();
+    if (initialPipelineState != nullptr)
+        bundle.SetPipelineState(initialPipelineState);
+    return bundle;
+}
+
+void* RecordingRenderDevice::BundleAllocator::EndBundle()
+{
+    mStats.Bundles++;
+    return (void*)(uintptr_t)(mCurrent + 1);
+}
+
+void RecordingRenderDevice::BundleAllocator::ReleaseBundle(void* bundle)
+{
+    std::uint32_t index = (std::uint32_t)(uintptr_t)bundle - 1;
+    if (bundle == nullptr || index >= mBundles.size()) return;
+
+    mStats.Bundles--;
+    mFree.push_back(index);
+}
+
+RecordingRenderDevice::RecordingRenderDevice(std::uint64_t capacity, double gpuLatencyMs)
+    : mCapacity(capacity), mBundleAllocator(mStats), mQueue(gpuLatencyMs)
+{
+}
+
+RecordingRenderDevice::~RecordingRenderDevice()
+{
+    WaitIdle();
+}
+
+BufferHandle RecordingRenderDevice::CreateBuffer(const BufferDesc& desc)
+{
+    if (desc.SizeInBytes == 0) return InvalidBuffer;
+    if (mCapacity != 0 && mStats.BufferBytes + desc.SizeInBytes > mCapacity) return InvalidBuffer;
+
+    BufferHandle handle;
+    if (!mFreeHandles.empty())
+    {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    }
+    else
+    {
+        handle = (BufferHandle)mBuffers.size();
+        mBuffers.emplace_back();
+    }
+
+    // Addresses are never given twice, a stale address in a stream points to nothing
+    Buffer& buffer = mBuffers[handle];
+    buffer.Memory.assign((size_t)desc.SizeInBytes, 0);
+    buffer.Address = mNextAddress;
+    buffer.Heap = desc.Heap;
+    buffer.Alive = true;
+    mNextAddress += (desc.SizeInBytes + AddressAlignment - 1) & ~(AddressAlignment - 1);
+
+    mStats.Buffers++;
+    mStats.BufferBytes += desc.SizeInBytes;
+    mStats.PeakBufferBytes = std::max(mStats.PeakBufferBytes, mStats.BufferBytes);
+    return handle;
+}
+
+void RecordingRenderDevice::DestroyBuffer(BufferHandle buffer)
+{
+    if (buffer >= mBuffers.size() || !mBuffers[buffer].Alive) return;
+
+    Buffer& entry = mBuffers[buffer];
+    mStats.Buffers--;
+    mStats.BufferBytes -= entry.Memory.size();
+    entry.Memory = std::vector<std::uint8_t>();
+    entry.Alive = false;
+    mFreeHandles.push_back(buffer);
+}
+
+void* RecordingRenderDevice::Map(BufferHandle buffer)
+{
+    if (buffer >= mBuffers.size() || !mBuffers[buffer].Alive || mBuffers[buffer].Heap != BufferHeap::Upload)
+        return nullptr;
+    return mBuffers[buffer].Memory.data();
+}
+
+GpuAddress RecordingRenderDevice::GetGpuAddress(BufferHandle buffer) const
+{
+    if (buffer >= mBuffers.size() || !mBuffers[buffer].Alive) return 0;
+    return mBuffers[buffer].Address;
+}
+
+void* RecordingRenderDevice::GetResource(BufferHandle buffer, std::uint64_t& offset) const
+{
+    offset = 0;
+    return (void*)(uintptr_t)GetGpuAddress(buffer);
+}
+
+std::uint64_t RecordingRenderDevice::UploadBuffer(BufferHandle buffer, std::uint64_t offset, const void* data, std::uint64_t size)
+{
+    if (buffer >= mBuffers.size() || !mBuffers[buffer].Alive) return mUploadTicket;
+
+    Buffer& entry = mBuffers[buffer];
+    if (offset > entry.Memory.size() || size > entry.Memory.size() - offset) return mUploadTicket;
+
+    memcpy(entry.Memory.data() + offset, data, (size_t)size);
+    mStats.UploadedBytes += size;
+    return ++mUploadTicket;
+}
+
+std::uint64_t RecordingRenderDevice::GetCompletedUpload()
+{
+    return mUploadTicket;
+}
+
+void RecordingRenderDevice::WaitForUploads()
+{
+}
+
+ICommandList* RecordingRenderDevice::CreateCommandList()
+{
+    mCommandLists.emplace_back(new CommandList());
+    return mCommandLists.back().get();
+}
+
+void RecordingRenderDevice::ResetCommandList(ICommandList* commandList)
+{
+    CommandList* list = static_cast<CommandList*>(commandList);
+    {
+        // The queue would read a stream being rewritten, let it finish first
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (list->Pending)
+        {
+            mSubmitted.EarlyResets++;
+            mListRead.wait(lock, [&] { return !list->Pending; });
+        }
+    }
+    list->Reset();
+}
+
+void RecordingRenderDevice::ExecuteCommandLists(std::uint32_t count, ICommandList* const* commandLists)
+{
+    std::vector<CommandList*> lists(count);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (std::uint32_t i = 0; i < count; i++)
+        {
+            lists[i] = static_cast<CommandList*>(commandLists[i]);
+            lists[i]->Pending = true;
+        }
+    }
+
+    // The streams are read on the queue thread, like the GPU front end would
+    mQueue.Submit([this, lists]()
+    {
+        SubmissionStats stats;
+        stats.Submissions = 1;
+        for (CommandList* list : lists)
+            Read(*list, stats);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSubmitted.Add(stats);
+        for (CommandList* list : lists)
+            list->Pending = false;
+        mListRead.notify_all();
+    });
+}
+
+void RecordingRenderDevice::Read(const RecordingCommandList& list, SubmissionStats& stats) const
+{
+    const std::vector<std::uint8_t>& stream = list.GetStream();
+    stats.CommandLists++;
+    stats.StreamBytes += stream.size();
+    stats.StreamHash = HashBytes(stream.data(), stream.size(), stats.StreamHash);
+
+    size_t offset = 0;
+    CommandType type;
+    const std::uint8_t* payload = nullptr;
+    while (RecordingCommandList::ReadCommand(stream, offset, type, payload))
+    {
+        stats.Commands++;
+        switch (type)
+        {
+        case CommandType::DrawIndexedInstanced:
+        {
+            std::uint32_t indexCount, instanceCount;
+            memcpy(&indexCount, payload, 4);
+            memcpy(&instanceCount, payload + 4, 4);
+            stats.Draws++;
+            stats.Instances += instanceCount;
+            stats.Indices += (std::uint64_t)indexCount * instanceCount;
+            break;
+        }
+        case CommandType::ExecuteIndirect: stats.IndirectCalls++; break;
+        case CommandType::ExecuteBundle: stats.BundleCalls++; break;
+        case CommandType::ResourceBarrier: stats.Barriers += RecordingCommandList::ReadBarrierCount(payload); break;
+        default: break;
+        }
+    }
+
+    if (offset != stream.size())
+        stats.InvalidLists++;
+}
+
+IGpuQueue& RecordingRenderDevice::GetQueue()
+{
+    return mQueue;
+}
+
+IBundleAllocator& RecordingRenderDevice::GetBundleAllocator()
+{
+    return mBundleAllocator;
+}
+
+void RecordingRenderDevice::WaitIdle()
+{
+    mQueue.WaitForValue(mQueue.Signal());
+}
+
+const RecordingDeviceStats& RecordingRenderDevice::GetStats() const
+{
+    return mStats;
+}
+
+SubmissionStats RecordingRenderDevice::GetSubmissionStats()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSubmitted;
+}
+
+void RecordingRenderDevice::ResetSubmissionStats()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSubmitted = SubmissionStats();
+}
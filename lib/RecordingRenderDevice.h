@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "BundleCache.h"
+#include "FakeGpuQueue.h"
+#include "RecordingCommandList.h"
+#include "RenderDevice.h"
+
+struct RecordingDeviceStats
+{
+    std::uint32_t Buffers = 0; // Alive
+    std::uint64_t BufferBytes = 0;
+    std::uint64_t PeakBufferBytes = 0;
+    std::uint64_t UploadedBytes = 0; // Given to UploadBuffer
+    std::uint32_t Bundles = 0; // Recorded, not released
+};
+
+// What the queue ran, counted when it reaches the lists
+struct SubmissionStats
+{
+    std::uint32_t Submissions = 0; // ExecuteCommandLists calls
+    std::uint32_t CommandLists = 0;
+    std::uint64_t Commands = 0;
+    std::uint64_t StreamBytes = 0;
+    std::uint64_t Draws = 0;
+    std::uint64_t Instances = 0;
+    std::uint64_t Indices = 0; // Index count times instance count of the draws
+    std::uint64_t IndirectCalls = 0;
+    std::uint64_t BundleCalls = 0;
+    std::uint64_t Barriers = 0;
+    std::uint32_t InvalidLists = 0; // Truncated or unknown command in the stream
+    std::uint32_t EarlyResets = 0; // Lists reset before the queue was done with them
+    std::uint64_t StreamHash = 0; // Of every stream in submission order, same frames same hash
+
+    void Add(const SubmissionStats& other);
+};
+
+// Device without a GPU. Buffers are host memory at made up GPU addresses, command lists record
+// into RecordingCommandList streams and the queue is a FakeGpuQueue reading the submitted
+// streams, so the CPU side of a frame runs and can be measured anywhere.
+// The GPU addresses only depend on the order of the buffer creations, the resource of a buffer
+// is its address and a bundle is named by its index so the streams are the same from run to run.
+// Uploads are done when UploadBuffer returns, bundles are recorded but the queue does not read them.
+class RecordingRenderDevice : public IRenderDevice
+{
+public:
+    // Alignment of the made up GPU addresses, the D3D12 buffer placement alignment
+    static const std::uint64_t AddressAlignment = 64 * 1024;
+
+    // capacity 0 is unbounded, each submission takes at least gpuLatencyMs on the queue
+    RecordingRenderDevice(std::uint64_t capacity = 0, double gpuLatencyMs = 0.0);
+    ~RecordingRenderDevice();
+
+    RecordingRenderDevice(const RecordingRenderDevice& rhs) = delete;
+    RecordingRenderDevice& operator=(const RecordingRenderDevice& rhs) = delete;
+
+    BufferHandle CreateBuffer(const BufferDesc& desc) override;
+    void DestroyBuffer(BufferHandle buffer) override;
+    void* Map(BufferHandle buffer) override;
+    GpuAddress GetGpuAddress(BufferHandle buffer) const override;
+    void* GetResource(BufferHandle buffer, std::uint64_t& offset) const override;
+    std::uint64_t UploadBuffer(BufferHandle buffer, std::uint64_t offset, const void* data, std::uint64_t size) override;
+    std::uint64_t GetCompletedUpload() override;
+    void WaitForUploads() override;
+
+    ICommandList* CreateCommandList() override;
+    void ResetCommandList(ICommandList* commandList) override;
+    void ExecuteCommandLists(std::uint32_t count, ICommandList* const* commandLists) override;
+
+    IGpuQueue& GetQueue() override;
+    IBundleAllocator& GetBundleAllocator() override;
+
+    // Block until the queue ran everything submitted
+    void WaitIdle();
+
+    const RecordingDeviceStats& GetStats() const;
+    SubmissionStats GetSubmissionStats();
+    void ResetSubmissionStats();
+
+private:
+    struct Buffer
+    {
+        std::vector<std::uint8_t> Memory;
+        GpuAddress Address = 0;
+        BufferHeap Heap = BufferHeap::Default;
+        bool Alive = false;
+    };
+
+    struct CommandList : RecordingCommandList
+    {
+        bool Pending = false; // Submitted and not yet read by the queue
+    };
+
+    class BundleAllocator : public IBundleAllocator
+    {
+    public:
+        BundleAllocator(RecordingDeviceStats& stats);
+
+        ICommandList& BeginBundle(void* initialPipelineState) override;
+        void* EndBundle() override;
+        void ReleaseBundle(void* bundle) override;
+
+    private:
+        RecordingDeviceStats& mStats;
+        std::vector<std::unique_ptr<RecordingCommandList>> mBundles;
+        std::vector<std::uint32_t> mFree; // Never read by the queue, reused right away
+        std::uint32_t mCurrent = 0;
+    };
+
+    void Read(const RecordingCommandList& list, SubmissionStats& stats) const;
+
+    std::uint64_t mCapacity;
+    std::vector<Buffer> mBuffers;
+    std::vector<BufferHandle> mFreeHandles;
+    GpuAddress mNextAddress = AddressAlignment; // 0 stays an invalid address
+    RecordingDeviceStats mStats;
+    std::uint64_t mUploadTicket = 0;
+
+    std::vector<std::unique_ptr<CommandList>> mCommandLists;
+    BundleAllocator mBundleAllocator;
+
+    std::mutex mMutex; // Guards the submission stats and the Pending flags
+    std::condition_variable mListRead;
+    SubmissionStats mSubmitted;
+
+    FakeGpuQueue mQueue; // Last member, its thread stops before the rest is destroyed
+};
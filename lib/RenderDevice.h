@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <cstdint>
+
+#include "CommandList.h"
+#include "GpuQueue.h"
+
+class IBundleAllocator;
+
+// Backend independent view of the device: buffers, command lists and the queue they are submitted to.
+// Only what the renderer frame needs is exposed, with the same meaning as the D3D12 calls.
+
+enum class BufferHeap : std::uint32_t
+{
+    Default, // GPU only, written with UploadBuffer
+    Upload // CPU visible, stays mapped
+};
+
+struct BufferDesc
+{
+    std::uint64_t SizeInBytes = 0;
+    BufferHeap Heap = BufferHeap::Default;
+};
+
+using BufferHandle = std::uint32_t;
+const BufferHandle InvalidBuffer = ~0u;
+
+class IRenderDevice
+{
+public:
+    virtual ~IRenderDevice() {}
+
+    // InvalidBuffer when the memory is exhausted
+    virtual BufferHandle CreateBuffer(const BufferDesc& desc) = 0;
+    // The queue must be done with the buffer
+    virtual void DestroyBuffer(BufferHandle buffer) = 0;
+    // CPU address of an upload buffer, valid until it is destroyed
+    virtual void* Map(BufferHandle buffer) = 0;
+    virtual GpuAddress GetGpuAddress(BufferHandle buffer) const = 0;
+    // Backend resource holding the buffer at offset, what ICommandList::ExecuteIndirect reads the arguments from
+    virtual void* GetResource(BufferHandle buffer, std::uint64_t& offset) const = 0;
+
+    // Copy into a default buffer and return its upload ticket, tickets are numbered from 1.
+    // Lists submitted once GetCompletedUpload reached the ticket read the new data.
+    virtual std::uint64_t UploadBuffer(BufferHandle buffer, std::uint64_t offset, const void* data, std::uint64_t size) = 0;
+    // Highest ticket whose copy is done, the copies of lower tickets are done too
+    virtual std::uint64_t GetCompletedUpload() = 0;
+    // Block until every upload is done
+    virtual void WaitForUploads() = 0;
+
+    // Lists are created closed and belong to the device
+    virtual ICommandList* CreateCommandList() = 0;
+    // The queue must be done with the commands of the list
+    virtual void ResetCommandList(ICommandList* commandList) = 0;
+    // Run the lists in order on the queue, Signal after it to know when they are done
+    virtual void ExecuteCommandLists(std::uint32_t count, ICommandList* const* commandLists) = 0;
+
+    virtual IGpuQueue& GetQueue() = 0;
+
+    // Bundles executed by the lists of this device
+    virtual IBundleAllocator& GetBundleAllocator() = 0;
+};
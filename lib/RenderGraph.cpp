@@ -0,0 +1,532 @@
+﻿#include "RenderGraph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace
+{
+    const std::uint32_t NoPass = 0xFFFFFFFF;
+
+    std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+    {
+        return alignment == 0 ? value : (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Read states combine with other read states, COMMON does not
+    bool IsReadState(ResourceState state)
+    {
+        return state != 0 && (state & ~ResourceStateReadMask) == 0;
+    }
+}
+
+void RenderGraph::Reset()
+{
+    mResources.clear();
+    mPasses.clear();
+    mAccesses.clear();
+    mBarriers.clear();
+    mFirstEndBarrier = 0;
+    mHeapSize = 0;
+    mCompiled = false;
+    mStats = RenderGraphStats();
+}
+
+RenderGraphResource RenderGraph::Import(const char* name, void* resource, ResourceState state, ResourceState finalState)
+{
+    Resource imported;
+    imported.Name = name;
+    imported.Imported = true;
+    imported.Physical = resource;
+    imported.InitialState = state;
+    imported.FinalState = finalState;
+    mResources.push_back(imported);
+    return (RenderGraphResource)mResources.size() - 1;
+}
+
+RenderGraphResource RenderGraph::CreateTexture(const char* name, const RenderGraphTextureDesc& desc)
+{
+    Resource texture;
+    texture.Name = name;
+    texture.Desc = desc;
+    mResources.push_back(texture);
+    return (RenderGraphResource)mResources.size() - 1;
+}
+
+RenderGraphPass RenderGraph::AddPass(const char* name, ExecuteFunc execute)
+{
+    Pass pass;
+    pass.Name = name;
+    pass.Execute = std::move(execute);
+    pass.FirstAccess = (std::uint32_t)mAccesses.size();
+    mPasses.push_back(std::move(pass));
+    return (RenderGraphPass)mPasses.size() - 1;
+}
+
+void RenderGraph::Read(RenderGraphPass pass, RenderGraphResource resource, ResourceState state)
+{
+    AddAccess(pass, resource, state, false);
+}
+
+void RenderGraph::Write(RenderGraphPass pass, RenderGraphResource resource, ResourceState state)
+{
+    AddAccess(pass, resource, state, true);
+}
+
+void RenderGraph::AddAccess(RenderGraphPass pass, RenderGraphResource resource, ResourceState state, bool write)
+{
+    assert(pass + 1 == mPasses.size());
+    assert(resource < mResources.size());
+
+    Pass& owner = mPasses[pass];
+    for (std::uint32_t a = owner.FirstAccess; a < owner.FirstAccess + owner.AccessCount; a++)
+    {
+        Access& access = mAccesses[a];
+        if (access.Resource != resource) continue;
+
+        if (write)
+            access.State = state;
+        else if (!access.Write)
+            access.State |= state;
+        access.Read |= !write;
+        access.Write |= write;
+        return;
+    }
+
+    Access access;
+    access.Resource = resource;
+    access.State = state;
+    access.Read = !write;
+    access.Write = write;
+    mAccesses.push_back(access);
+    owner.AccessCount++;
+}
+
+void RenderGraph::SetSideEffect(RenderGraphPass pass)
+{
+    mPasses[pass].SideEffect = true;
+}
+
+bool RenderGraph::Compile(std::string* error)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    mStats = RenderGraphStats();
+    mStats.Passes = (std::uint32_t)mPasses.size();
+    mStats.Resources = (std::uint32_t)mResources.size();
+
+    if (!CullPasses(error))
+        return false;
+
+    AllocateTransients();
+    BuildBarriers();
+    mCompiled = true;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    mStats.CompileTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+    return true;
+}
+
+bool RenderGraph::CullPasses(std::string* error)
+{
+    // From the last pass to the first, a pass is kept when a kept pass after it reads what it writes.
+    // A write satisfies the later reads, the writers before it are only needed if this pass reads too.
+    for (Resource& resource : mResources)
+        resource.Needed = false;
+
+    for (std::uint32_t p = (std::uint32_t)mPasses.size(); p-- > 0; )
+    {
+        Pass& pass = mPasses[p];
+        const Access* accesses = mAccesses.data() + pass.FirstAccess;
+
+        bool kept = pass.SideEffect;
+        for (std::uint32_t a = 0; a < pass.AccessCount && !kept; a++)
+        {
+            const Resource& resource = mResources[accesses[a].Resource];
+            kept = accesses[a].Write && (resource.Imported || resource.Needed);
+        }
+
+        pass.Culled = !kept;
+        if (!kept)
+        {
+            mStats.CulledPasses++;
+            continue;
+        }
+
+        for (std::uint32_t a = 0; a < pass.AccessCount; a++)
+            mResources[accesses[a].Resource].Needed = accesses[a].Read;
+    }
+
+    for (std::uint32_t r = 0; r < (std::uint32_t)mResources.size(); r++)
+    {
+        if (mResources[r].Imported || !mResources[r].Needed) continue;
+
+        if (error != nullptr)
+            *error = "Render graph: texture " + mResources[r].Name + " is read before any pass writes it";
+        return false;
+    }
+
+    return true;
+}
+
+void RenderGraph::AllocateTransients()
+{
+    // Lifetimes over the kept passes
+    for (Resource& resource : mResources)
+    {
+        resource.FirstPass = NoPass;
+        resource.Allocated = false;
+        resource.Aliased = false;
+    }
+
+    for (std::uint32_t p = 0; p < (std::uint32_t)mPasses.size(); p++)
+    {
+        const Pass& pass = mPasses[p];
+        if (pass.Culled) continue;
+
+        for (std::uint32_t a = pass.FirstAccess; a < pass.FirstAccess + pass.AccessCount; a++)
+        {
+            Resource& resource = mResources[mAccesses[a].Resource];
+            if (resource.FirstPass == NoPass) resource.FirstPass = p;
+            resource.LastPass = p;
+        }
+    }
+
+    mOrder.clear();
+    for (std::uint32_t r = 0; r < (std::uint32_t)mResources.size(); r++)
+    {
+        const Resource& resource = mResources[r];
+        if (!resource.Imported && resource.FirstPass != NoPass)
+        {
+            mOrder.push_back(r);
+            mStats.TransientBytes += resource.Desc.SizeInBytes;
+        }
+    }
+    mStats.TransientResources = (std::uint32_t)mOrder.size();
+
+    // Biggest first, each at the lowest offset free during its whole lifetime
+    std::sort(mOrder.begin(), mOrder.end(), [this](RenderGraphResource a, RenderGraphResource b)
+    {
+        if (mResources[a].Desc.SizeInBytes != mResources[b].Desc.SizeInBytes)
+            return mResources[a].Desc.SizeInBytes > mResources[b].Desc.SizeInBytes;
+        return a < b;
+    });
+
+    mPlaced.clear();
+    mHeapSize = 0;
+    for (RenderGraphResource r : mOrder)
+    {
+        Resource& resource = mResources[r];
+
+        mIntervals.clear();
+        for (RenderGraphResource other : mPlaced)
+        {
+            const Resource& placed = mResources[other];
+            if (placed.FirstPass <= resource.LastPass && resource.FirstPass <= placed.LastPass)
+                mIntervals.push_back(std::make_pair(placed.Offset, placed.Offset + placed.Desc.SizeInBytes));
+        }
+        std::sort(mIntervals.begin(), mIntervals.end());
+
+        std::uint64_t offset = 0;
+        for (const auto& interval : mIntervals)
+        {
+            if (interval.second <= offset) continue;
+            if (offset + resource.Desc.SizeInBytes <= interval.first) break;
+            offset = AlignUp(interval.second, resource.Desc.Alignment);
+        }
+
+        resource.Offset = offset;
+        resource.Allocated = true;
+        mHeapSize = std::max(mHeapSize, offset + resource.Desc.SizeInBytes);
+        mPlaced.push_back(r);
+    }
+    mStats.HeapBytes = mHeapSize;
+
+    // A texture whose memory held an other texture earlier in the frame needs an aliasing barrier
+    for (RenderGraphResource r : mPlaced)
+    {
+        Resource& resource = mResources[r];
+        for (RenderGraphResource other : mPlaced)
+        {
+            const Resource& placed = mResources[other];
+            if (placed.LastPass < resource.FirstPass &&
+                placed.Offset < resource.Offset + resource.Desc.SizeInBytes &&
+                resource.Offset < placed.Offset + placed.Desc.SizeInBytes)
+            {
+                resource.Aliased = true;
+                break;
+            }
+        }
+    }
+}
+
+void RenderGraph::BuildBarriers()
+{
+    const std::uint32_t passCount = (std::uint32_t)mPasses.size();
+    const std::uint32_t resourceCount = (std::uint32_t)mResources.size();
+
+    // Consecutive reads of a resource take the union of their states, computed backward
+    mTargets.resize(mAccesses.size());
+    mReadRuns.assign(resourceCount, 0);
+    for (std::uint32_t p = passCount; p-- > 0; )
+    {
+        const Pass& pass = mPasses[p];
+        if (pass.Culled) continue;
+
+        for (std::uint32_t a = pass.FirstAccess; a < pass.FirstAccess + pass.AccessCount; a++)
+        {
+            const Access& access = mAccesses[a];
+            ResourceState& run = mReadRuns[access.Resource];
+            if (access.Write || !IsReadState(access.State))
+            {
+                run = 0;
+                mTargets[a] = access.State;
+                continue;
+            }
+
+            run |= access.State;
+            mTargets[a] = run;
+        }
+    }
+
+    if (mPassBarriers.size() < passCount + 1)
+        mPassBarriers.resize(passCount + 1);
+    for (std::uint32_t p = 0; p <= passCount; p++)
+        mPassBarriers[p].clear();
+
+    mStates.resize(resourceCount);
+    mLastUse.assign(resourceCount, NoPass);
+    for (std::uint32_t r = 0; r < resourceCount; r++)
+        mStates[r] = mResources[r].InitialState;
+
+    // Kept pass following each pass, the begin of a split goes right after the last use
+    std::uint32_t firstKept = NoPass;
+    mOrder.assign(passCount + 1, NoPass);
+    for (std::uint32_t p = passCount; p-- > 0; )
+    {
+        mOrder[p] = firstKept;
+        if (!mPasses[p].Culled) firstKept = p;
+    }
+
+    for (std::uint32_t p = 0; p < passCount; p++)
+    {
+        const Pass& pass = mPasses[p];
+        if (pass.Culled) continue;
+
+        for (std::uint32_t a = pass.FirstAccess; a < pass.FirstAccess + pass.AccessCount; a++)
+        {
+            RenderGraphResource r = mAccesses[a].Resource;
+            Resource& resource = mResources[r];
+            ResourceState target = mTargets[a];
+
+            // Transient textures start in the state of their first pass
+            if (!resource.Imported && mLastUse[r] == NoPass)
+            {
+                resource.InitialState = target;
+                mStates[r] = target;
+                if (resource.Aliased)
+                {
+                    Barrier aliasing;
+                    aliasing.Resource = r;
+                    aliasing.Type = BarrierType::Aliasing;
+                    mPassBarriers[p].push_back(aliasing);
+                    mStats.AliasingBarriers++;
+                }
+            }
+
+            ResourceState current = mStates[r];
+            std::uint32_t lastUse = mLastUse[r];
+            mLastUse[r] = p;
+            if (current == target || (!mAccesses[a].Write && ResourceStateContains(current, target)))
+                continue;
+
+            mStates[r] = target;
+            mStats.Barriers++;
+
+            Barrier barrier;
+            barrier.Resource = r;
+            barrier.StateBefore = current;
+            barrier.StateAfter = target;
+
+            std::uint32_t beginPass = lastUse == NoPass ? firstKept : mOrder[lastUse];
+            if (beginPass != p)
+            {
+                barrier.Flags = BarrierFlags::BeginOnly;
+                barrier.OtherPass = p;
+                mPassBarriers[beginPass].push_back(barrier);
+
+                barrier.Flags = BarrierFlags::EndOnly;
+                barrier.OtherPass = beginPass;
+                mStats.SplitBarriers++;
+            }
+            mPassBarriers[p].push_back(barrier);
+        }
+    }
+
+    // Imported resources go to their final state, transient textures back to their initial state
+    for (std::uint32_t r = 0; r < resourceCount; r++)
+    {
+        const Resource& resource = mResources[r];
+        if (!resource.Imported && mLastUse[r] == NoPass) continue;
+
+        ResourceState wanted = resource.Imported ? resource.FinalState : resource.InitialState;
+        if (mStates[r] == wanted) continue;
+
+        Barrier barrier;
+        barrier.Resource = r;
+        barrier.StateBefore = mStates[r];
+        barrier.StateAfter = wanted;
+        mPassBarriers[passCount].push_back(barrier);
+        mStats.Barriers++;
+    }
+
+    mBarriers.clear();
+    for (std::uint32_t p = 0; p < passCount; p++)
+    {
+        Pass& pass = mPasses[p];
+        pass.FirstBarrier = (std::uint32_t)mBarriers.size();
+        pass.BarrierCount = (std::uint32_t)mPassBarriers[p].size();
+        mBarriers.insert(mBarriers.end(), mPassBarriers[p].begin(), mPassBarriers[p].end());
+    }
+    mFirstEndBarrier = (std::uint32_t)mBarriers.size();
+    mBarriers.insert(mBarriers.end(), mPassBarriers[passCount].begin(), mPassBarriers[passCount].end());
+}
+
+bool RenderGraph::IsCulled(RenderGraphPass pass) const
+{
+    return mPasses[pass].Culled;
+}
+
+bool RenderGraph::IsAllocated(RenderGraphResource resource) const
+{
+    return mResources[resource].Allocated;
+}
+
+std::uint64_t RenderGraph::GetHeapOffset(RenderGraphResource resource) const
+{
+    return mResources[resource].Offset;
+}
+
+std::uint64_t RenderGraph::GetHeapSize() const
+{
+    return mHeapSize;
+}
+
+ResourceState RenderGraph::GetInitialState(RenderGraphResource resource) const
+{
+    return mResources[resource].InitialState;
+}
+
+const RenderGraphTextureDesc& RenderGraph::GetTextureDesc(RenderGraphResource resource) const
+{
+    return mResources[resource].Desc;
+}
+
+void RenderGraph::SetPhysical(RenderGraphResource resource, void* physical)
+{
+    mResources[resource].Physical = physical;
+}
+
+void RenderGraph::Execute(const CommandListFunc& getCommandList, ResourceStateRegistry* registry)
+{
+    assert(mCompiled);
+
+    mStats.BarrierCalls = 0;
+    mSplitOpen.assign(mResources.size(), false);
+
+    ICommandList* lastList = nullptr;
+    for (std::uint32_t p = 0; p < (std::uint32_t)mPasses.size(); p++)
+    {
+        Pass& pass = mPasses[p];
+        if (pass.Culled) continue;
+
+        ICommandList& commandList = getCommandList(p);
+        lastList = &commandList;
+
+        mRecorded.clear();
+        for (std::uint32_t b = pass.FirstBarrier; b < pass.FirstBarrier + pass.BarrierCount; b++)
+        {
+            const Barrier& barrier = mBarriers[b];
+            const Resource& resource = mResources[barrier.Resource];
+            assert(resource.Physical != nullptr);
+
+            ResourceBarrierDesc desc;
+            desc.Type = barrier.Type;
+            desc.Resource = resource.Physical;
+            desc.StateBefore = barrier.StateBefore;
+            desc.StateAfter = barrier.StateAfter;
+            desc.Flags = barrier.Flags;
+
+            // Both halves of a split go in the same list, otherwise the end is a whole transition
+            if (barrier.Flags == BarrierFlags::BeginOnly)
+            {
+                if (&getCommandList(barrier.OtherPass) != &commandList) continue;
+                mSplitOpen[barrier.Resource] = true;
+            }
+            else if (barrier.Flags == BarrierFlags::EndOnly)
+            {
+                if (!mSplitOpen[barrier.Resource]) desc.Flags = BarrierFlags::None;
+                mSplitOpen[barrier.Resource] = false;
+            }
+
+            mRecorded.push_back(desc);
+            if (registry != nullptr && resource.Imported && desc.Type == BarrierType::Transition &&
+                desc.Flags != BarrierFlags::BeginOnly)
+            {
+                registry->Set(resource.Physical, desc.StateAfter);
+            }
+        }
+
+        if (!mRecorded.empty())
+        {
+            commandList.ResourceBarrier((std::uint32_t)mRecorded.size(), mRecorded.data());
+            mStats.BarrierCalls++;
+        }
+
+        if (pass.Execute)
+            pass.Execute(commandList);
+    }
+
+    // End barriers after the last kept pass, in its list
+    mRecorded.clear();
+    for (std::uint32_t b = mFirstEndBarrier; b < (std::uint32_t)mBarriers.size(); b++)
+    {
+        const Barrier& barrier = mBarriers[b];
+        const Resource& resource = mResources[barrier.Resource];
+
+        ResourceBarrierDesc desc;
+        desc.Resource = resource.Physical;
+        desc.StateBefore = barrier.StateBefore;
+        desc.StateAfter = barrier.StateAfter;
+        mRecorded.push_back(desc);
+
+        if (registry != nullptr && resource.Imported)
+            registry->Set(resource.Physical, desc.StateAfter);
+    }
+
+    if (!mRecorded.empty() && lastList != nullptr)
+    {
+        lastList->ResourceBarrier((std::uint32_t)mRecorded.size(), mRecorded.data());
+        mStats.BarrierCalls++;
+    }
+}
+
+const RenderGraphStats& RenderGraph::GetStats() const
+{
+    return mStats;
+}
+
+std::uint32_t RenderGraph::GetPassCount() const
+{
+    return (std::uint32_t)mPasses.size();
+}
+
+std::uint32_t RenderGraph::GetResourceCount() const
+{
+    return (std::uint32_t)mResources.size();
+}
+
+const char* RenderGraph::GetPassName(RenderGraphPass pass) const
+{
+    return mPasses[pass].Name.c_str();
+}
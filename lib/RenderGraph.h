@@ -0,0 +1,173 @@
+﻿#pragma once
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CommandList.h"
+#include "ResourceStateTracker.h"
+
+using RenderGraphResource = std::uint32_t;
+using RenderGraphPass = std::uint32_t;
+
+const RenderGraphResource InvalidRenderGraphResource = 0xFFFFFFFF;
+
+// 2D texture owned by the graph, its memory is only reserved between its first and last pass.
+// SizeInBytes and Alignment come from the device (RenderGraphHeap::FillAllocationInfo).
+struct RenderGraphTextureDesc
+{
+    std::uint32_t Width = 0;
+    std::uint32_t Height = 0;
+    std::uint32_t Format = 0; // DXGI_FORMAT
+    std::uint32_t Flags = 0; // D3D12_RESOURCE_FLAGS
+    std::uint64_t SizeInBytes = 0;
+    std::uint64_t Alignment = 0;
+};
+
+struct RenderGraphStats
+{
+    std::uint32_t Passes = 0;
+    std::uint32_t CulledPasses = 0;
+    std::uint32_t Resources = 0;
+    std::uint32_t TransientResources = 0; // Used by a pass left after culling
+    std::uint32_t Barriers = 0;
+    std::uint32_t SplitBarriers = 0;
+    std::uint32_t AliasingBarriers = 0;
+    std::uint64_t TransientBytes = 0; // Sum of the transient sizes, the heap size without aliasing
+    std::uint64_t HeapBytes = 0;
+    float CompileTimeMs = 0.0f;
+    std::uint32_t BarrierCalls = 0; // Recorded by Execute
+};
+
+// Frame described as passes reading and writing virtual resources.
+// Every frame the passes and resources are declared again, in execution order, then Compile
+//   - culls the passes whose writes nothing reads, passes writing an imported resource or marked
+//     with a side effect are the roots,
+//   - gives the transient textures an offset in one heap, textures whose lifetimes do not overlap
+//     share memory,
+//   - computes the barriers before each pass: consecutive reads are merged in one read state and
+//     a transition is split when passes run between the last use of a resource and the next one.
+// Compile does not need a device, the physical resources are only needed by Execute.
+class RenderGraph
+{
+public:
+    using ExecuteFunc = std::function<void(ICommandList& commandList)>;
+    using CommandListFunc = std::function<ICommandList&(RenderGraphPass pass)>;
+
+    // Forget the passes and resources, the memory is kept for the next frame
+    void Reset();
+
+    // Resource living outside the graph, in state before the first pass and left in finalState
+    RenderGraphResource Import(const char* name, void* resource, ResourceState state, ResourceState finalState);
+    // The content is undefined before the first pass using the texture, that pass writes all of it
+    RenderGraphResource CreateTexture(const char* name, const RenderGraphTextureDesc& desc);
+
+    RenderGraphPass AddPass(const char* name, ExecuteFunc execute);
+
+    // Accesses are declared right after AddPass. A resource read and written by a pass is in the
+    // write state, the read states of a pass combine.
+    void Read(RenderGraphPass pass, RenderGraphResource resource, ResourceState state);
+    void Write(RenderGraphPass pass, RenderGraphResource resource, ResourceState state);
+
+    // The pass is kept even if nothing reads what it writes (present, readback...)
+    void SetSideEffect(RenderGraphPass pass);
+
+    // False when a pass reads a texture no pass wrote before
+    bool Compile(std::string* error = nullptr);
+
+    // After Compile, for the textures still used. They must be in GetInitialState before the first
+    // pass, Execute leaves them in it.
+    bool IsCulled(RenderGraphPass pass) const;
+    bool IsAllocated(RenderGraphResource resource) const;
+    std::uint64_t GetHeapOffset(RenderGraphResource resource) const;
+    std::uint64_t GetHeapSize() const;
+    ResourceState GetInitialState(RenderGraphResource resource) const;
+    const RenderGraphTextureDesc& GetTextureDesc(RenderGraphResource resource) const;
+    void SetPhysical(RenderGraphResource resource, void* physical);
+
+    // Record the barriers and the pass in the list given for the pass, in pass order. A split barrier
+    // is only split when its begin and end passes get the same list. With a registry, the state of
+    // the imported resources is updated before each pass runs.
+    void Execute(const CommandListFunc& getCommandList, ResourceStateRegistry* registry = nullptr);
+
+    const RenderGraphStats& GetStats() const;
+    std::uint32_t GetPassCount() const;
+    std::uint32_t GetResourceCount() const;
+    const char* GetPassName(RenderGraphPass pass) const;
+
+private:
+    struct Resource
+    {
+        std::string Name;
+        bool Imported = false;
+        void* Physical = nullptr;
+        ResourceState InitialState = 0;
+        ResourceState FinalState = 0;
+        RenderGraphTextureDesc Desc;
+
+        // Compile results
+        bool Needed = false;
+        std::uint32_t FirstPass = 0; // Lifetime in passes, culled passes included
+        std::uint32_t LastPass = 0;
+        bool Allocated = false;
+        bool Aliased = false; // Its memory was used by a texture before its first pass
+        std::uint64_t Offset = 0;
+    };
+
+    struct Access
+    {
+        RenderGraphResource Resource = 0;
+        ResourceState State = 0;
+        bool Read = false;
+        bool Write = false;
+    };
+
+    struct Pass
+    {
+        std::string Name;
+        ExecuteFunc Execute;
+        std::uint32_t FirstAccess = 0; // In mAccesses, the accesses of a pass are contiguous
+        std::uint32_t AccessCount = 0;
+        bool SideEffect = false;
+        bool Culled = false;
+        std::uint32_t FirstBarrier = 0; // In mBarriers
+        std::uint32_t BarrierCount = 0;
+    };
+
+    struct Barrier
+    {
+        RenderGraphResource Resource = 0;
+        BarrierType Type = BarrierType::Transition;
+        ResourceState StateBefore = 0;
+        ResourceState StateAfter = 0;
+        BarrierFlags Flags = BarrierFlags::None;
+        RenderGraphPass OtherPass = 0; // End pass of a BeginOnly, begin pass of an EndOnly
+    };
+
+    void AddAccess(RenderGraphPass pass, RenderGraphResource resource, ResourceState state, bool write);
+    bool CullPasses(std::string* error);
+    void AllocateTransients();
+    void BuildBarriers();
+
+    std::vector<Resource> mResources;
+    std::vector<Pass> mPasses;
+    std::vector<Access> mAccesses;
+    std::vector<Barrier> mBarriers; // Grouped by pass, the end barriers last
+    std::uint32_t mFirstEndBarrier = 0;
+    std::uint64_t mHeapSize = 0;
+    bool mCompiled = false;
+    RenderGraphStats mStats;
+
+    // Compile scratch, kept to not allocate every frame
+    std::vector<std::vector<Barrier>> mPassBarriers;
+    std::vector<RenderGraphResource> mOrder;
+    std::vector<RenderGraphResource> mPlaced;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> mIntervals;
+    std::vector<ResourceState> mTargets; // State of each access once consecutive reads are merged
+    std::vector<ResourceState> mReadRuns;
+    std::vector<ResourceState> mStates;
+    std::vector<std::uint32_t> mLastUse;
+    std::vector<bool> mSplitOpen;
+    std::vector<ResourceBarrierDesc> mRecorded;
+};
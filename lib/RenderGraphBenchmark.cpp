@@ -0,0 +1,267 @@
+﻿#include "RenderGraphBenchmark.h"
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "BarrierSimulation.h"
+#include "RecordingCommandList.h"
+
+namespace
+{
+    // D3D12_RESOURCE_STATES values
+    const ResourceState StatePresent = 0;
+    const ResourceState StateRenderTarget = 0x4;
+    const ResourceState StateUnorderedAccess = 0x8;
+    const ResourceState StateDepthWrite = 0x10;
+    const ResourceState StateDepthRead = 0x20;
+    const ResourceState StateNonPixelShaderResource = 0x40;
+    const ResourceState StatePixelShaderResource = 0x80;
+
+    const std::uint64_t TextureAlignment = 64 * 1024;
+
+    struct DeclaredAccess
+    {
+        RenderGraphResource Resource;
+        ResourceState State;
+    };
+
+    // Declarations of one frame, kept to check the compiled graph against them
+    struct Frame
+    {
+        RenderGraph* Graph = nullptr;
+        std::mt19937 Random;
+        std::vector<std::vector<DeclaredAccess>> Accesses;
+
+        RenderGraphResource Texture(const char* name)
+        {
+            RenderGraphTextureDesc desc;
+            desc.Width = 256u << (Random() % 4);
+            desc.Height = desc.Width;
+            desc.Format = 10; // DXGI_FORMAT_R16G16B16A16_FLOAT
+            desc.SizeInBytes = (std::uint64_t)desc.Width * desc.Height * 8;
+            desc.Alignment = TextureAlignment;
+            return Graph->CreateTexture(name, desc);
+        }
+
+        RenderGraphPass Pass(const char* name)
+        {
+            RenderGraphPass pass = (RenderGraphPass)Accesses.size();
+            Accesses.emplace_back();
+            return Graph->AddPass(name, [this, pass](ICommandList& commandList)
+            {
+                // The validation checks every resource is usable as declared when the pass runs
+                for (const DeclaredAccess& access : Accesses[pass])
+                {
+                    std::uint32_t id = access.Resource + 1;
+                    commandList.SetGraphicsRoot32BitConstant(ResourceUseMarkerParameter, id, access.State);
+                }
+            });
+        }
+
+        void Read(RenderGraphPass pass, RenderGraphResource resource, ResourceState state)
+        {
+            Graph->Read(pass, resource, state);
+            Accesses[pass].push_back({ resource, state });
+        }
+
+        void Write(RenderGraphPass pass, RenderGraphResource resource, ResourceState state)
+        {
+            Graph->Write(pass, resource, state);
+            Accesses[pass].push_back({ resource, state });
+        }
+    };
+
+    void DeclareFrame(Frame& frame, std::uint32_t passCount, RenderGraphResource& backBuffer)
+    {
+        backBuffer = frame.Graph->Import("BackBuffer", (void*)1, StatePresent, StatePresent);
+
+        // 4 shadow cascades, prepass, gbuffer, occlusion, lighting, tonemap and present
+        const std::uint32_t fixedPasses = 10;
+        std::uint32_t postPasses = passCount > fixedPasses ? passCount - fixedPasses : 0;
+
+        RenderGraphResource shadows[4];
+        for (std::uint32_t c = 0; c < 4; c++)
+        {
+            shadows[c] = frame.Texture("Shadow");
+            RenderGraphPass pass = frame.Pass("Shadow");
+            frame.Write(pass, shadows[c], StateDepthWrite);
+        }
+
+        RenderGraphResource depth = frame.Texture("Depth");
+        RenderGraphPass prepass = frame.Pass("DepthPrepass");
+        frame.Write(prepass, depth, StateDepthWrite);
+
+        RenderGraphResource gbuffer[3] = { frame.Texture("Albedo"), frame.Texture("Normal"), frame.Texture("Material") };
+        RenderGraphPass geometry = frame.Pass("GBuffer");
+        frame.Read(geometry, depth, StateDepthWrite);
+        frame.Write(geometry, depth, StateDepthWrite);
+        for (RenderGraphResource target : gbuffer)
+            frame.Write(geometry, target, StateRenderTarget);
+
+        RenderGraphResource occlusion = frame.Texture("Occlusion");
+        RenderGraphPass ambient = frame.Pass("AmbientOcclusion");
+        frame.Read(ambient, depth, StateNonPixelShaderResource);
+        frame.Read(ambient, gbuffer[1], StateNonPixelShaderResource);
+        frame.Write(ambient, occlusion, StateUnorderedAccess);
+
+        RenderGraphResource color = frame.Texture("Lit");
+        RenderGraphPass lighting = frame.Pass("Lighting");
+        for (RenderGraphResource shadow : shadows)
+            frame.Read(lighting, shadow, StatePixelShaderResource);
+        for (RenderGraphResource target : gbuffer)
+            frame.Read(lighting, target, StatePixelShaderResource);
+        frame.Read(lighting, occlusion, StatePixelShaderResource);
+        frame.Read(lighting, depth, StateDepthRead);
+        frame.Write(lighting, color, StateRenderTarget);
+
+        // Post chain, every 5th pass is a debug view nothing reads
+        std::vector<RenderGraphResource> written = { depth, gbuffer[0], gbuffer[1], gbuffer[2], occlusion, color };
+        for (std::uint32_t p = 0; p < postPasses; p++)
+        {
+            bool debug = p % 5 == 4;
+            RenderGraphResource output = frame.Texture(debug ? "Debug" : "Post");
+            RenderGraphPass pass = frame.Pass(debug ? "DebugView" : "PostProcess");
+            frame.Read(pass, color, StatePixelShaderResource);
+
+            RenderGraphResource extra = written[frame.Random() % written.size()];
+            if (extra != color)
+                frame.Read(pass, extra, frame.Random() % 2 ? StatePixelShaderResource : StateNonPixelShaderResource);
+
+            frame.Write(pass, output, frame.Random() % 3 ? StateRenderTarget : StateUnorderedAccess);
+            if (!debug)
+            {
+                color = output;
+                written.push_back(output);
+            }
+        }
+
+        RenderGraphPass tonemap = frame.Pass("Tonemap");
+        frame.Read(tonemap, color, StatePixelShaderResource);
+        frame.Write(tonemap, backBuffer, StateRenderTarget);
+
+        RenderGraphPass present = frame.Pass("Present");
+        frame.Read(present, backBuffer, StatePresent);
+        frame.Graph->SetSideEffect(present);
+    }
+
+    bool Fail(RenderGraphBenchmarkResult& result, const std::string& error)
+    {
+        result.Valid = false;
+        result.Error = error;
+        return false;
+    }
+
+    bool ValidateFrame(RenderGraph& graph, Frame& frame, RenderGraphResource backBuffer, bool listPerPass,
+                       RenderGraphBenchmarkResult& result)
+    {
+        const std::uint32_t resourceCount = graph.GetResourceCount();
+        const std::uint32_t passCount = graph.GetPassCount();
+
+        // Textures sharing memory must never be used by the same kept pass range
+        std::vector<std::uint32_t> first(resourceCount, 0xFFFFFFFF);
+        std::vector<std::uint32_t> last(resourceCount, 0);
+        for (std::uint32_t p = 0; p < passCount; p++)
+        {
+            if (graph.IsCulled(p)) continue;
+            for (const DeclaredAccess& access : frame.Accesses[p])
+            {
+                first[access.Resource] = std::min(first[access.Resource], p);
+                last[access.Resource] = p;
+            }
+        }
+
+        for (std::uint32_t a = 0; a < resourceCount; a++)
+        {
+            if (a == backBuffer || !graph.IsAllocated(a)) continue;
+            for (std::uint32_t b = a + 1; b < resourceCount; b++)
+            {
+                if (b == backBuffer || !graph.IsAllocated(b)) continue;
+
+                std::uint64_t aBegin = graph.GetHeapOffset(a), aEnd = aBegin + graph.GetTextureDesc(a).SizeInBytes;
+                std::uint64_t bBegin = graph.GetHeapOffset(b), bEnd = bBegin + graph.GetTextureDesc(b).SizeInBytes;
+                bool memory = aBegin < bEnd && bBegin < aEnd;
+                bool alive = first[a] <= last[b] && first[b] <= last[a];
+                if (memory && alive)
+                    return Fail(result, "Textures " + std::to_string(a) + " and " + std::to_string(b) + " alias while both alive");
+                if (aEnd > graph.GetHeapSize() || bEnd > graph.GetHeapSize())
+                    return Fail(result, "Texture outside of the heap");
+            }
+        }
+
+        // Every resource is named by its index + 1
+        std::unordered_map<std::uint32_t, ResourceState> states;
+        for (std::uint32_t r = 0; r < resourceCount; r++)
+        {
+            if (r != backBuffer) graph.SetPhysical(r, (void*)(uintptr_t)(r + 1));
+            states[r + 1] = graph.GetInitialState(r);
+        }
+
+        std::vector<RecordingCommandList> lists(listPerPass ? passCount : 1);
+        graph.Execute([&](RenderGraphPass pass) -> ICommandList&
+        {
+            return lists[listPerPass ? pass : 0];
+        });
+
+        // Resources are back in the state the next frame starts with
+        RecordingCommandList& end = lists.back();
+        for (std::uint32_t r = 0; r < resourceCount; r++)
+        {
+            if (r == backBuffer || graph.IsAllocated(r))
+                end.SetGraphicsRoot32BitConstant(ResourceUseMarkerParameter, r + 1, graph.GetInitialState(r));
+        }
+
+        std::vector<const RecordingCommandList*> ordered;
+        for (const RecordingCommandList& list : lists)
+            ordered.push_back(&list);
+
+        std::string error;
+        if (!ValidateResourceBarriers(ordered, states, &error))
+            return Fail(result, error);
+
+        return true;
+    }
+}
+
+RenderGraphBenchmarkResult RunRenderGraphBenchmark(std::uint32_t passCount, std::uint32_t iterations, std::uint32_t seed)
+{
+    RenderGraphBenchmarkResult result;
+    result.Iterations = iterations;
+
+    RenderGraph graph;
+    Frame frame;
+    frame.Graph = &graph;
+
+    double totalMs = 0.0;
+    for (std::uint32_t i = 0; i < iterations; i++)
+    {
+        graph.Reset();
+        frame.Accesses.clear();
+        frame.Random.seed(seed);
+
+        RenderGraphResource backBuffer;
+        DeclareFrame(frame, passCount, backBuffer);
+
+        std::string error;
+        if (!graph.Compile(&error))
+        {
+            Fail(result, error);
+            return result;
+        }
+
+        double compileMs = graph.GetStats().CompileTimeMs;
+        totalMs += compileMs;
+        result.WorstCompileMs = std::max(result.WorstCompileMs, compileMs);
+    }
+
+    result.CompileMs = iterations > 0 ? totalMs / iterations : 0.0;
+
+    if (!ValidateFrame(graph, frame, 0, true, result))
+        return result;
+
+    // The single list last so the stats count its barrier calls
+    result.Valid = ValidateFrame(graph, frame, 0, false, result);
+    result.Stats = graph.GetStats();
+    return result;
+}
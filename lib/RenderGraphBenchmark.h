@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "RenderGraph.h"
+
+struct RenderGraphBenchmarkResult
+{
+    std::uint32_t Iterations = 0;
+    double CompileMs = 0.0; // Average of Compile alone, the declarations are not counted
+    double WorstCompileMs = 0.0;
+    RenderGraphStats Stats; // Of the last iteration
+
+    // Barriers replayed with one list for the frame and with one list per pass, use of every
+    // declared access checked, aliased textures checked to never be alive together
+    bool Valid = false;
+    std::string Error;
+};
+
+// Frame of passCount passes (at least 16): shadow cascades, depth prepass, gbuffer, ambient
+// occlusion, lighting, a post process chain with random extra reads and debug passes nothing
+// reads, presented to an imported back buffer. Texture sizes are random, same seed same frame.
+RenderGraphBenchmarkResult RunRenderGraphBenchmark(std::uint32_t passCount, std::uint32_t iterations, std::uint32_t seed);
@@ -0,0 +1,202 @@
+﻿#include "RenderGraphHeap.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "d3dUtils.h"
+
+RenderGraphHeap::RenderGraphHeap()
+{
+}
+
+RenderGraphHeap::~RenderGraphHeap()
+{
+    Release();
+}
+
+void RenderGraphHeap::Initialize(ID3D12Device* device, IGpuQueue* queue)
+{
+    mDevice = device;
+    mQueue = queue;
+
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+    if (SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))))
+        mAllowAllTextures = options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2;
+}
+
+D3D12_RESOURCE_DESC RenderGraphHeap::ToResourceDesc(const RenderGraphTextureDesc& desc)
+{
+    return CD3DX12_RESOURCE_DESC::Tex2D((DXGI_FORMAT)desc.Format, desc.Width, desc.Height, 1, 1, 1, 0,
+        (D3D12_RESOURCE_FLAGS)desc.Flags);
+}
+
+void RenderGraphHeap::FillAllocationInfo(RenderGraphTextureDesc& desc) const
+{
+    D3D12_RESOURCE_DESC resourceDesc = ToResourceDesc(desc);
+    D3D12_RESOURCE_ALLOCATION_INFO info = mDevice->GetResourceAllocationInfo(0, 1, &resourceDesc);
+    desc.SizeInBytes = info.SizeInBytes;
+    desc.Alignment = info.Alignment;
+}
+
+bool RenderGraphHeap::Realize(RenderGraph& graph)
+{
+    ReleaseRetired(false);
+    mCreated = 0;
+
+    size_t retiredBefore = mRetired.size();
+
+    // Growing the heap moves every texture to the new one, heaps are made of 64 KB pages
+    UINT64 size = graph.GetHeapSize();
+    size = (size + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~(UINT64)(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1);
+    if (size > mHeapSize)
+    {
+        for (Placed& placed : mPlaced)
+            Retire(nullptr, placed.Resource);
+        mPlaced.clear();
+        Retire(mHeap, nullptr);
+        mHeap = nullptr;
+
+        CD3DX12_HEAP_DESC heapDesc(size, D3D12_HEAP_TYPE_DEFAULT, 0,
+            mAllowAllTextures ? D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES);
+
+        HRESULT result = mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&mHeap));
+        if (FAILED(result))
+        {
+            std::cerr << "Failed to create render graph heap !\n";
+            mHeapSize = 0;
+            return false;
+        }
+        mHeapSize = size;
+    }
+
+    for (Placed& placed : mPlaced)
+        placed.Used = false;
+
+    bool succeeded = true;
+    for (RenderGraphResource r = 0; r < graph.GetResourceCount(); r++)
+    {
+        if (!graph.IsAllocated(r)) continue;
+
+        const RenderGraphTextureDesc& desc = graph.GetTextureDesc(r);
+        UINT64 offset = graph.GetHeapOffset(r);
+        ResourceState state = graph.GetInitialState(r);
+
+        Placed* found = nullptr;
+        for (Placed& placed : mPlaced)
+        {
+            if (!placed.Used && placed.Offset == offset && placed.State == state &&
+                memcmp(&placed.Desc, &desc, sizeof(desc)) == 0)
+            {
+                found = &placed;
+                break;
+            }
+        }
+
+        if (found == nullptr)
+        {
+            if (!mAllowAllTextures && (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) == 0)
+            {
+                std::cerr << "Failed to place render graph texture, the device only allows render targets and depth in a heap !\n";
+                succeeded = false;
+                continue;
+            }
+
+            Placed placed;
+            placed.Offset = offset;
+            placed.Desc = desc;
+            placed.State = state;
+
+            D3D12_RESOURCE_DESC resourceDesc = ToResourceDesc(desc);
+            HRESULT result = mDevice->CreatePlacedResource(mHeap, offset, &resourceDesc,
+                (D3D12_RESOURCE_STATES)state, nullptr, IID_PPV_ARGS(&placed.Resource));
+            if (FAILED(result))
+            {
+                std::cerr << "Failed to create render graph texture !\n";
+                succeeded = false;
+                continue;
+            }
+
+            mPlaced.push_back(placed);
+            found = &mPlaced.back();
+            mCreated++;
+        }
+
+        found->Used = true;
+        graph.SetPhysical(r, found->Resource);
+    }
+
+    // Textures of the previous frames the graph does not use anymore
+    size_t kept = 0;
+    for (size_t i = 0; i < mPlaced.size(); i++)
+    {
+        if (mPlaced[i].Used)
+            mPlaced[kept++] = mPlaced[i];
+        else
+            Retire(nullptr, mPlaced[i].Resource);
+    }
+    mPlaced.resize(kept);
+
+    // Everything retired now was last used by work submitted so far
+    if (mRetired.size() > retiredBefore)
+    {
+        mRetireFence = mQueue->Signal();
+        for (size_t i = retiredBefore; i < mRetired.size(); i++)
+            mRetired[i].Fence = mRetireFence;
+    }
+
+    return succeeded;
+}
+
+void RenderGraphHeap::Retire(ID3D12Heap* heap, ID3D12Resource* resource)
+{
+    if (heap == nullptr && resource == nullptr) return;
+
+    Retired retired;
+    retired.Heap = heap;
+    retired.Resource = resource;
+    mRetired.push_back(retired);
+}
+
+void RenderGraphHeap::ReleaseRetired(bool all)
+{
+    UINT64 completed = all ? UINT64_MAX : mQueue->GetCompletedValue();
+
+    size_t kept = 0;
+    for (size_t i = 0; i < mRetired.size(); i++)
+    {
+        Retired& retired = mRetired[i];
+        if (retired.Fence > completed)
+        {
+            mRetired[kept++] = retired;
+            continue;
+        }
+
+        if (retired.Resource != nullptr) retired.Resource->Release();
+        if (retired.Heap != nullptr) retired.Heap->Release();
+    }
+    mRetired.resize(kept);
+}
+
+RenderGraphHeapStats RenderGraphHeap::GetStats() const
+{
+    RenderGraphHeapStats stats;
+    stats.HeapBytes = mHeapSize;
+    stats.Textures = (UINT)mPlaced.size();
+    stats.Created = mCreated;
+    return stats;
+}
+
+void RenderGraphHeap::Release()
+{
+    for (Placed& placed : mPlaced)
+        placed.Resource->Release();
+    mPlaced.clear();
+
+    // Placed textures are released before the heap they live in
+    ReleaseRetired(true);
+
+    if (mHeap != nullptr)
+        mHeap->Release();
+    mHeap = nullptr;
+    mHeapSize = 0;
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <vector>
+
+#include "GpuQueue.h"
+#include "RenderGraph.h"
+
+struct RenderGraphHeapStats
+{
+    UINT64 HeapBytes = 0;
+    UINT Textures = 0; // Placed textures alive
+    UINT Created = 0; // Placed textures created by the last Realize
+};
+
+// Memory of the transient textures of a render graph. One heap sized for the compiled graph,
+// a texture is placed at the offset the graph gave it. Placed textures are kept from a frame to
+// the next while their offset, description and initial state do not change, the frames use them
+// one after the other on the same queue. Textures and heaps no longer used are released once
+// the queue is done with the frames submitted before.
+class RenderGraphHeap
+{
+public:
+    RenderGraphHeap();
+    ~RenderGraphHeap();
+
+    RenderGraphHeap(const RenderGraphHeap& rhs) = delete;
+    RenderGraphHeap& operator=(const RenderGraphHeap& rhs) = delete;
+
+    // queue is the timeline of the queue the graph executes on
+    void Initialize(ID3D12Device* device, IGpuQueue* queue);
+
+    // Size and alignment of the texture on this device, call before RenderGraph::CreateTexture
+    void FillAllocationInfo(RenderGraphTextureDesc& desc) const;
+
+    // Give every allocated texture of the compiled graph its placed resource
+    bool Realize(RenderGraph& graph);
+
+    RenderGraphHeapStats GetStats() const;
+
+    // Release everything, the GPU must be done with it
+    void Release();
+
+private:
+    struct Placed
+    {
+        UINT64 Offset = 0;
+        RenderGraphTextureDesc Desc;
+        ResourceState State = 0;
+        ID3D12Resource* Resource = nullptr;
+        bool Used = false;
+    };
+
+    struct Retired
+    {
+        UINT64 Fence = 0;
+        ID3D12Heap* Heap = nullptr;
+        ID3D12Resource* Resource = nullptr;
+    };
+
+    static D3D12_RESOURCE_DESC ToResourceDesc(const RenderGraphTextureDesc& desc);
+    void Retire(ID3D12Heap* heap, ID3D12Resource* resource);
+    void ReleaseRetired(bool all);
+
+    ID3D12Device* mDevice = nullptr;
+    IGpuQueue* mQueue = nullptr;
+    bool mAllowAllTextures = false; // Resource heap tier 2, otherwise render targets and depth only
+    ID3D12Heap* mHeap = nullptr;
+    UINT64 mHeapSize = 0;
+    std::vector<Placed> mPlaced;
+    std::vector<Retired> mRetired;
+    UINT64 mRetireFence = 0; // Signaled once per Realize retiring something
+    UINT mCreated = 0;
+};
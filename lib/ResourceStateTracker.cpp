@@ -0,0 +1,206 @@
+﻿#include "ResourceStateTracker.h"
+
+#include <cassert>
+
+bool ResourceStateContains(ResourceState current, ResourceState wanted)
+{
+    if (current == wanted) return true;
+
+    // Read states combine, COMMON (0) is not one of them
+    return wanted != 0 && (current & ~ResourceStateReadMask) == 0 && (current & wanted) == wanted;
+}
+
+void ResourceStateRegistry::Register(void* resource, ResourceState state)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStates[resource] = state;
+}
+
+void ResourceStateRegistry::Unregister(void* resource)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStates.erase(resource);
+}
+
+bool ResourceStateRegistry::Get(void* resource, ResourceState& state) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto found = mStates.find(resource);
+    if (found == mStates.end()) return false;
+
+    state = found->second;
+    return true;
+}
+
+void ResourceStateRegistry::Set(void* resource, ResourceState state)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStates[resource] = state;
+}
+
+void ResourceStateStats::Add(const ResourceStateStats& other)
+{
+    Transitions += other.Transitions;
+    Barriers += other.Barriers;
+    BarrierCalls += other.BarrierCalls;
+    SplitBarriers += other.SplitBarriers;
+    ResolvedBarriers += other.ResolvedBarriers;
+}
+
+void ResourceStateTracker::Reset(ResourceStateRegistry* registry)
+{
+    assert(mPending.empty());
+
+    mRegistry = registry;
+    mEntries.clear();
+    mOrder.clear();
+    mPending.clear();
+    mBatch++;
+    mStats = ResourceStateStats();
+}
+
+ResourceStateTracker::Entry* ResourceStateTracker::Find(void* resource, ResourceState firstState)
+{
+    auto found = mEntries.find(resource);
+    if (found != mEntries.end()) return &found->second;
+
+    Entry& entry = mEntries[resource];
+    mOrder.push_back(resource);
+
+    ResourceState known;
+    if (mRegistry != nullptr && mRegistry->Get(resource, known))
+    {
+        entry.Initial = known;
+        entry.Current = known;
+        return &entry;
+    }
+
+    // Resolve brings it there before the list starts
+    entry.Initial = firstState;
+    entry.Current = firstState;
+    return nullptr;
+}
+
+void ResourceStateTracker::Push(void* resource, Entry& entry, ResourceState state, BarrierFlags flags)
+{
+    ResourceBarrierDesc barrier;
+    barrier.Resource = resource;
+    barrier.StateBefore = entry.Current;
+    barrier.StateAfter = state;
+    barrier.Flags = flags;
+
+    entry.Recorded = true;
+    entry.Pending = (std::uint32_t)mPending.size();
+    entry.PendingBatch = flags == BarrierFlags::None ? mBatch : 0;
+    mPending.push_back(barrier);
+}
+
+void ResourceStateTracker::Transition(void* resource, ResourceState state)
+{
+    mStats.Transitions++;
+
+    Entry* entry = Find(resource, state);
+    if (entry == nullptr) return;
+
+    if (entry->Splitting)
+    {
+        Push(resource, *entry, entry->SplitState, BarrierFlags::EndOnly);
+        entry->Current = entry->SplitState;
+        entry->Splitting = false;
+    }
+
+    if (ResourceStateContains(entry->Current, state)) return;
+
+    // Nothing used the resource since its last pending barrier, that barrier goes straight to state
+    if (entry->PendingBatch == mBatch)
+    {
+        mPending[entry->Pending].StateAfter = state;
+        entry->Current = state;
+        return;
+    }
+
+    Push(resource, *entry, state, BarrierFlags::None);
+    entry->Current = state;
+}
+
+void ResourceStateTracker::BeginTransition(void* resource, ResourceState state)
+{
+    Entry* entry = Find(resource, state);
+    if (entry == nullptr)
+    {
+        // The state before is only known at Resolve, nothing to split
+        mStats.Transitions++;
+        return;
+    }
+
+    if (entry->Splitting)
+    {
+        if (entry->SplitState == state) return;
+        Transition(resource, entry->SplitState);
+    }
+
+    if (ResourceStateContains(entry->Current, state)) return;
+
+    Push(resource, *entry, state, BarrierFlags::BeginOnly);
+    entry->Splitting = true;
+    entry->SplitState = state;
+    mStats.SplitBarriers++;
+}
+
+void ResourceStateTracker::FlushBarriers(ICommandList& commandList)
+{
+    // Merged transitions can come back to where they started
+    size_t count = 0;
+    for (const ResourceBarrierDesc& barrier : mPending)
+    {
+        if (barrier.Flags == BarrierFlags::None && barrier.StateBefore == barrier.StateAfter) continue;
+        mPending[count++] = barrier;
+    }
+    mPending.resize(count);
+
+    if (!mPending.empty())
+    {
+        commandList.ResourceBarrier((std::uint32_t)mPending.size(), mPending.data());
+        mStats.Barriers += (std::uint32_t)mPending.size();
+        mStats.BarrierCalls++;
+    }
+
+    mPending.clear();
+    mBatch++;
+}
+
+void ResourceStateTracker::Resolve(ResourceStateRegistry& registry, std::vector<ResourceBarrierDesc>& barriers)
+{
+    assert(mPending.empty());
+
+    for (void* resource : mOrder)
+    {
+        const Entry& entry = mEntries[resource];
+        assert(!entry.Splitting);
+
+        ResourceState state;
+        bool known = registry.Get(resource, state);
+
+        // Only used in a state the resource already includes, it keeps its state
+        if (known && !entry.Recorded && ResourceStateContains(state, entry.Initial))
+            continue;
+
+        // The barriers of the list were recorded from Initial, it must be the exact state
+        if (known && state != entry.Initial)
+        {
+            ResourceBarrierDesc barrier;
+            barrier.Resource = resource;
+            barrier.StateBefore = state;
+            barrier.StateAfter = entry.Initial;
+            barriers.push_back(barrier);
+            mStats.ResolvedBarriers++;
+        }
+
+        registry.Set(resource, entry.Current);
+    }
+}
+
+const ResourceStateStats& ResourceStateTracker::GetStats() const
+{
+    return mStats;
+}
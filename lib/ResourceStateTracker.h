@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "CommandList.h"
+
+// States only read by the GPU (GENERIC_READ and DEPTH_READ), a resource in several of them
+// can be used in any one without a barrier
+const ResourceState ResourceStateReadMask = 0xAE3;
+
+// True when a resource in state current can be used as wanted
+bool ResourceStateContains(ResourceState current, ResourceState wanted);
+
+// State of every resource once the command lists submitted so far are done.
+// Thread safe.
+class ResourceStateRegistry
+{
+public:
+    void Register(void* resource, ResourceState state);
+    void Unregister(void* resource);
+
+    // False for a resource never registered nor used by a resolved list
+    bool Get(void* resource, ResourceState& state) const;
+    void Set(void* resource, ResourceState state);
+
+private:
+    mutable std::mutex mMutex;
+    std::unordered_map<void*, ResourceState> mStates;
+};
+
+struct ResourceStateStats
+{
+    std::uint32_t Transitions = 0; // Requested
+    std::uint32_t Barriers = 0; // Recorded in the list
+    std::uint32_t BarrierCalls = 0;
+    std::uint32_t SplitBarriers = 0;
+    std::uint32_t ResolvedBarriers = 0; // Given by Resolve, recorded before the list
+
+    void Add(const ResourceStateStats& other);
+};
+
+// States of the resources used by one command list.
+// Transitions are kept pending and merged until FlushBarriers records them in one ResourceBarrier
+// call, it must be called before the commands using the resources.
+// A list recorded in submission order gets the registry: the state of a resource before its
+// first use is known and its barrier goes in the list. A list recorded out of order, by a worker,
+// only knows the state a resource must be in when it starts; Resolve gives the barriers to
+// record before it once the lists submitted before it are known.
+class ResourceStateTracker
+{
+public:
+    void Reset(ResourceStateRegistry* registry = nullptr);
+
+    void Transition(void* resource, ResourceState state);
+
+    // Start the transition to a state needed later, the GPU can run it meanwhile.
+    // The resource can not be used until Transition to the same state ends it, in the same list.
+    void BeginTransition(void* resource, ResourceState state);
+
+    void FlushBarriers(ICommandList& commandList);
+
+    // Call in submission order once the list is recorded. Fill barriers with the transitions from
+    // the registry states to the states the list starts with, the registry takes the final states.
+    void Resolve(ResourceStateRegistry& registry, std::vector<ResourceBarrierDesc>& barriers);
+
+    const ResourceStateStats& GetStats() const;
+
+private:
+    struct Entry
+    {
+        ResourceState Initial = 0; // State the list expects before its first command
+        ResourceState Current = 0;
+        std::uint32_t PendingBatch = 0; // Pending holds the last barrier when it matches mBatch
+        std::uint32_t Pending = 0;
+        bool Splitting = false;
+        ResourceState SplitState = 0;
+        bool Recorded = false; // A barrier of the resource is in the list
+    };
+
+    // nullptr when the resource is used for the first time and its state is unknown
+    Entry* Find(void* resource, ResourceState firstState);
+    void Push(void* resource, Entry& entry, ResourceState state, BarrierFlags flags);
+
+    ResourceStateRegistry* mRegistry = nullptr;
+    std::unordered_map<void*, Entry> mEntries;
+    std::vector<void*> mOrder; // First use order, Resolve is deterministic
+    std::vector<ResourceBarrierDesc> mPending;
+    std::uint32_t mBatch = 1;
+    ResourceStateStats mStats;
+};
@@ -0,0 +1,168 @@
+﻿#include "RetainedDrawList.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "RadixSort.h"
+
+const std::uint64_t RetainedDrawList::InvalidKey;
+
+namespace
+{
+    // Drop the keys found in both sorted lists, they were inserted then removed before the merge
+    std::uint32_t CancelCommon(std::vector<std::uint64_t>& a, std::vector<std::uint64_t>& b)
+    {
+        size_t i = 0, j = 0, keptA = 0, keptB = 0;
+        while (i < a.size() && j < b.size())
+        {
+            if (a[i] < b[j]) a[keptA++] = a[i++];
+            else if (b[j] < a[i]) b[keptB++] = b[j++];
+            else { i++; j++; }
+        }
+        while (i < a.size()) a[keptA++] = a[i++];
+        while (j < b.size()) b[keptB++] = b[j++];
+
+        std::uint32_t cancelled = (std::uint32_t)(a.size() - keptA);
+        a.resize(keptA);
+        b.resize(keptB);
+        return cancelled;
+    }
+
+    // Lower bound searched from the start of the range by doubling steps, the touched keys are
+    // sorted so the next one is usually close when many changed
+    const std::uint64_t* GallopLowerBound(const std::uint64_t* first, const std::uint64_t* last, std::uint64_t key)
+    {
+        size_t size = (size_t)(last - first);
+        size_t step = 1;
+        while (step < size && first[step] < key)
+            step *= 2;
+        return std::lower_bound(first + step / 2, first + std::min(step, size), key);
+    }
+}
+
+void RetainedDrawList::Resize(std::uint32_t itemCount)
+{
+    for (std::uint32_t item = itemCount; item < (std::uint32_t)mItemKeys.size(); item++)
+        Remove(item);
+    mItemKeys.resize(itemCount, InvalidKey);
+}
+
+void RetainedDrawList::Clear()
+{
+    std::fill(mItemKeys.begin(), mItemKeys.end(), InvalidKey);
+    mInserted.clear();
+    mRemoved.clear();
+    mCleared = true;
+}
+
+void RetainedDrawList::Set(std::uint32_t item, std::uint64_t key)
+{
+    if (item >= mItemKeys.size())
+        mItemKeys.resize(item + 1, InvalidKey);
+
+    std::uint64_t& current = mItemKeys[item];
+    if (current == key) return;
+
+    if (current != InvalidKey)
+        mRemoved.push_back(current);
+    mInserted.push_back(key);
+    current = key;
+}
+
+void RetainedDrawList::Remove(std::uint32_t item)
+{
+    if (item >= mItemKeys.size() || mItemKeys[item] == InvalidKey) return;
+
+    mRemoved.push_back(mItemKeys[item]);
+    mItemKeys[item] = InvalidKey;
+}
+
+bool RetainedDrawList::Contains(std::uint32_t item) const
+{
+    return item < mItemKeys.size() && mItemKeys[item] != InvalidKey;
+}
+
+std::uint64_t RetainedDrawList::GetKey(std::uint32_t item) const
+{
+    return item < mItemKeys.size() ? mItemKeys[item] : InvalidKey;
+}
+
+void RetainedDrawList::Apply()
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (mCleared)
+    {
+        mKeys.clear();
+        mCleared = false;
+    }
+
+    RadixSortKeys(mInserted, mScratch);
+    RadixSortKeys(mRemoved, mScratch);
+    mStats.Cancelled = CancelCommon(mInserted, mRemoved);
+    mStats.Inserted = (std::uint32_t)mInserted.size();
+    mStats.Removed = (std::uint32_t)mRemoved.size();
+    mStats.MovedRuns = 0;
+
+    if (mKeys.empty())
+    {
+        // Nothing to merge with, the list is the sorted inserted keys
+        mKeys.swap(mInserted);
+    }
+    else if (!mInserted.empty() || !mRemoved.empty())
+    {
+        mScratch.resize(mKeys.size() + mInserted.size());
+        std::uint64_t* out = mScratch.data();
+
+        const std::uint64_t* keys = mKeys.data();
+        const std::uint64_t* keysEnd = keys + mKeys.size();
+        size_t inserted = 0, removed = 0;
+        while (inserted < mInserted.size() || removed < mRemoved.size())
+        {
+            // Next touched position, a removed key is in the list and never equal to an inserted one
+            bool remove = removed < mRemoved.size() && (inserted == mInserted.size() || mRemoved[removed] < mInserted[inserted]);
+            std::uint64_t touched = remove ? mRemoved[removed] : mInserted[inserted];
+
+            // Keys before it are untouched, moved as one block
+            const std::uint64_t* runEnd = GallopLowerBound(keys, keysEnd, touched);
+            if (runEnd != keys)
+            {
+                out = std::copy(keys, runEnd, out);
+                keys = runEnd;
+                mStats.MovedRuns++;
+            }
+
+            if (remove)
+            {
+                if (keys != keysEnd && *keys == touched) keys++;
+                removed++;
+            }
+            else
+            {
+                *out++ = touched;
+                inserted++;
+            }
+        }
+        out = std::copy(keys, keysEnd, out);
+
+        mScratch.resize(out - mScratch.data());
+        mKeys.swap(mScratch);
+    }
+
+    mInserted.clear();
+    mRemoved.clear();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    mStats.Keys = (std::uint32_t)mKeys.size();
+    mStats.ApplyTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+const std::vector<std::uint64_t>& RetainedDrawList::GetKeys() const
+{
+    return mKeys;
+}
+
+const RetainedDrawListStats& RetainedDrawList::GetStats() const
+{
+    return mStats;
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct RetainedDrawListStats
+{
+    std::uint32_t Keys = 0;
+    std::uint32_t Inserted = 0; // Keys merged by the last Apply, a changed key is removed then inserted
+    std::uint32_t Removed = 0;
+    std::uint32_t Cancelled = 0; // Keys set then replaced before the Apply
+    std::uint32_t MovedRuns = 0; // Runs of untouched keys moved as one block
+    float ApplyTimeMs = 0.0f;
+};
+
+// Sorted draw keys kept from a frame to the next, an item has at most one key.
+// The changes of a frame are given per item and Apply merges them: the removed and inserted keys
+// are sorted, then the keys between two touched positions are moved as one block, so only the
+// changed keys are sorted. Keys must be unique, the item index is usually their low bits, and
+// UINT64_MAX is reserved.
+class RetainedDrawList
+{
+public:
+    static const std::uint64_t InvalidKey = ~0ull;
+
+    // Past this fraction of the items changed in a frame, a Clear and a sort from scratch are faster
+    // than merging the changes (-bench-draw-list, 200k items: 5% merges faster, 20% sorts faster)
+    static constexpr float RebuildFraction = 0.1f;
+
+    // Items past the count leave the list
+    void Resize(std::uint32_t itemCount);
+
+    // Every item leaves the list, Apply sorts the keys set after from scratch
+    void Clear();
+
+    void Set(std::uint32_t item, std::uint64_t key);
+    void Remove(std::uint32_t item);
+    bool Contains(std::uint32_t item) const;
+    std::uint64_t GetKey(std::uint32_t item) const; // InvalidKey when not in the list
+
+    // Merge the changes since the last Apply in the sorted keys
+    void Apply();
+
+    const std::vector<std::uint64_t>& GetKeys() const;
+    const RetainedDrawListStats& GetStats() const;
+
+private:
+    std::vector<std::uint64_t> mItemKeys; // Key of every item, as of the last Set or Remove
+    std::vector<std::uint64_t> mKeys; // Sorted, as of the last Apply
+    std::vector<std::uint64_t> mInserted;
+    std::vector<std::uint64_t> mRemoved;
+    bool mCleared = false; // mKeys is dropped by the next Apply
+    std::vector<std::uint64_t> mScratch;
+    RetainedDrawListStats mStats;
+};
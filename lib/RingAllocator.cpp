@@ -0,0 +1,112 @@
+﻿#include "RingAllocator.h"
+
+#include <cassert>
+
+RingAllocator::RingAllocator(std::uint64_t capacity)
+{
+    Reset(capacity);
+}
+
+void RingAllocator::Reset(std::uint64_t capacity)
+{
+    mCapacity = capacity;
+    mHead = 0;
+    mTail = 0;
+    mUsed = 0;
+    mOpenBytes = 0;
+    mBatches.clear();
+}
+
+std::uint64_t RingAllocator::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    if (size == 0 || size > mCapacity || mUsed == mCapacity) return InvalidOffset;
+
+    if (mUsed == 0)
+    {
+        // Empty, start over at the beginning so the whole range is contiguous
+        mHead = 0;
+        mTail = 0;
+    }
+
+    std::uint64_t offset = (mTail + alignment - 1) & ~(alignment - 1);
+    std::uint64_t consumed = 0;
+
+    if (mTail >= mHead)
+    {
+        // Free space is [tail, capacity) then [0, head)
+        if (offset + size <= mCapacity)
+        {
+            consumed = offset + size - mTail;
+        }
+        else if (size <= mHead)
+        {
+            offset = 0;
+            consumed = mCapacity - mTail + size;
+        }
+        else
+        {
+            return InvalidOffset;
+        }
+    }
+    else
+    {
+        // Free space is [tail, head)
+        if (offset + size > mHead) return InvalidOffset;
+        consumed = offset + size - mTail;
+    }
+
+    mTail = offset + size;
+    mUsed += consumed;
+    mOpenBytes += consumed;
+    if (mUsed > mPeakUsed) mPeakUsed = mUsed;
+    return offset;
+}
+
+void RingAllocator::Close(std::uint64_t fence)
+{
+    if (mOpenBytes == 0) return;
+
+    Batch batch;
+    batch.End = mTail;
+    batch.Bytes = mOpenBytes;
+    batch.Fence = fence;
+    mBatches.push_back(batch);
+    mOpenBytes = 0;
+}
+
+void RingAllocator::Reclaim(std::uint64_t completedFence)
+{
+    while (!mBatches.empty() && mBatches.front().Fence <= completedFence)
+    {
+        mHead = mBatches.front().End;
+        mUsed -= mBatches.front().Bytes;
+        mBatches.pop_front();
+    }
+}
+
+std::uint64_t RingAllocator::GetOldestFence() const
+{
+    return mBatches.empty() ? 0 : mBatches.front().Fence;
+}
+
+std::uint64_t RingAllocator::GetCapacity() const
+{
+    return mCapacity;
+}
+
+std::uint64_t RingAllocator::GetUsed() const
+{
+    return mUsed;
+}
+
+std::uint64_t RingAllocator::GetOpenBytes() const
+{
+    return mOpenBytes;
+}
+
+std::uint64_t RingAllocator::GetPeakUsed() const
+{
+    return mPeakUsed;
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// First in first out sub-allocator in a fixed range of bytes, for memory the GPU reads once.
+// Allocations are grouped in batches closed with the fence value of their submission,
+// a batch is given back whole once the GPU reached its fence. An allocation never wraps,
+// the end of the range is skipped when it is too small.
+class RingAllocator
+{
+public:
+    static const std::uint64_t InvalidOffset = ~0ull;
+
+    RingAllocator(std::uint64_t capacity = 0);
+
+    // Forget every allocation and batch
+    void Reset(std::uint64_t capacity);
+
+    // alignment must be a power of two, return InvalidOffset when the free space is too small
+    std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment);
+
+    // Tag the allocations made since the last Close with fence
+    void Close(std::uint64_t fence);
+
+    // Give back the batches whose fence is at most completedFence
+    void Reclaim(std::uint64_t completedFence);
+
+    // Fence of the oldest closed batch, 0 when none
+    std::uint64_t GetOldestFence() const;
+
+    std::uint64_t GetCapacity() const;
+    std::uint64_t GetUsed() const;
+    std::uint64_t GetOpenBytes() const; // Allocated since the last Close
+    std::uint64_t GetPeakUsed() const; // High water mark since the allocator was created
+
+private:
+    struct Batch
+    {
+        std::uint64_t End = 0;
+        std::uint64_t Bytes = 0;
+        std::uint64_t Fence = 0;
+    };
+
+    std::uint64_t mCapacity = 0;
+    std::uint64_t mHead = 0; // Start of the oldest live allocation
+    std::uint64_t mTail = 0; // Where the next allocation starts
+    std::uint64_t mUsed = 0; // Live bytes with alignment and skipped ends
+    std::uint64_t mOpenBytes = 0;
+    std::uint64_t mPeakUsed = 0;
+    std::deque<Batch> mBatches;
+};
@@ -0,0 +1,249 @@
+﻿#include "ShaderCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "Hash.h"
+
+namespace
+{
+    const std::uint32_t CacheMagic = 0x31434853; // "SHC1"
+    const std::uint32_t CacheVersion = 1;
+
+    void AppendU32(std::vector<std::uint8_t>& bytes, std::uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            bytes.push_back((std::uint8_t)(value >> (i * 8)));
+    }
+
+    void AppendU64(std::vector<std::uint8_t>& bytes, std::uint64_t value)
+    {
+        AppendU32(bytes, (std::uint32_t)value);
+        AppendU32(bytes, (std::uint32_t)(value >> 32));
+    }
+
+    void AppendString(std::vector<std::uint8_t>& bytes, const std::string& text)
+    {
+        AppendU32(bytes, (std::uint32_t)text.size());
+        bytes.insert(bytes.end(), text.begin(), text.end());
+    }
+
+    bool ReadFile(const std::string& path, std::vector<char>& content)
+    {
+        std::fstream file;
+        file.open(path, std::ios::in | std::ios::binary);
+        if (!file.is_open()) return false;
+
+        file.seekg(0, std::ios::end);
+        content.resize((size_t)file.tellg());
+        file.seekg(0, std::ios::beg);
+        file.read(content.data(), content.size());
+        return !file.fail();
+    }
+
+    std::string GetDirectory(const std::string& path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+    // Names of the #include "file" and #include <file> lines
+    std::vector<std::string> FindIncludes(const std::vector<char>& source)
+    {
+        std::vector<std::string> includes;
+        std::istringstream in(std::string(source.begin(), source.end()));
+        for (std::string line; std::getline(in, line); )
+        {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line[start] != '#') continue;
+
+            size_t directive = line.find_first_not_of(" \t", start + 1);
+            if (directive == std::string::npos || line.compare(directive, 7, "include") != 0) continue;
+
+            size_t open = line.find_first_of("\"<", directive + 7);
+            if (open == std::string::npos) continue;
+
+            size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+            if (close == std::string::npos) continue;
+
+            includes.push_back(line.substr(open + 1, close - open - 1));
+        }
+        return includes;
+    }
+
+    double ElapsedMs(std::chrono::high_resolution_clock::time_point start)
+    {
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+}
+
+void ShaderCache::Initialize(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDirectory = directory;
+}
+
+bool ShaderCache::HashFile(const std::string& path, std::vector<std::string>& visited, std::vector<std::uint8_t>& bytes)
+{
+    // Include guards make files included twice legal, they are hashed once
+    if (std::find(visited.begin(), visited.end(), path) != visited.end()) return true;
+    visited.push_back(path);
+
+    AppendString(bytes, path);
+
+    std::vector<char> content;
+    if (!ReadFile(path, content))
+    {
+        // The key changes when the file shows up
+        AppendU64(bytes, 0);
+        return false;
+    }
+    AppendU64(bytes, HashBytes(content.data(), content.size()) | 1);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.FilesHashed++;
+    }
+
+    std::string directory = GetDirectory(path);
+    for (const std::string& include : FindIncludes(content))
+        HashFile(directory + include, visited, bytes);
+    return true;
+}
+
+bool ShaderCache::MakeKey(const std::string& sourcePath, const std::vector<ShaderDefine>& defines,
+                          const std::string& entryPoint, const std::string& target, std::uint32_t flags, ShaderCacheKey& key)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    key = ShaderCacheKey();
+    AppendU32(key.Bytes, CacheVersion);
+    AppendString(key.Bytes, entryPoint);
+    AppendString(key.Bytes, target);
+    AppendU32(key.Bytes, flags);
+
+    // In declaration order, a later define can change the meaning of an earlier one
+    AppendU32(key.Bytes, (std::uint32_t)defines.size());
+    for (const ShaderDefine& define : defines)
+    {
+        AppendString(key.Bytes, define.Name);
+        AppendString(key.Bytes, define.Value);
+    }
+
+    std::vector<std::string> visited;
+    bool found = HashFile(sourcePath, visited, key.Bytes);
+
+    key.Hash = HashBytes(key.Bytes.data(), key.Bytes.size());
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.KeyTimeMs += ElapsedMs(start);
+    return found;
+}
+
+std::string ShaderCache::GetPath(const ShaderCacheKey& key) const
+{
+    const char digits[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 0; i < 16; i++)
+        name[15 - i] = digits[(key.Hash >> (i * 4)) & 0xF];
+    return mDirectory + "/" + name + ".cso";
+}
+
+bool ShaderCache::ReadEntry(const ShaderCacheKey& key, std::vector<char>& content) const
+{
+    // magic | version | key size | content size | key | content
+    std::vector<char> file;
+    if (!ReadFile(GetPath(key), file) || file.size() < 16) return false;
+
+    std::uint32_t header[4];
+    std::memcpy(header, file.data(), sizeof(header));
+    size_t keySize = header[2];
+    size_t contentSize = header[3];
+
+    bool match = header[0] == CacheMagic && header[1] == CacheVersion &&
+        keySize == key.Bytes.size() && file.size() == 16 + keySize + contentSize &&
+        std::memcmp(file.data() + 16, key.Bytes.data(), keySize) == 0;
+
+    if (match)
+        content.assign(file.begin() + 16 + keySize, file.end());
+    return match;
+}
+
+bool ShaderCache::WriteEntry(const ShaderCacheKey& key, const void* content, std::size_t size) const
+{
+    std::vector<std::uint8_t> header;
+    AppendU32(header, CacheMagic);
+    AppendU32(header, CacheVersion);
+    AppendU32(header, (std::uint32_t)key.Bytes.size());
+    AppendU32(header, (std::uint32_t)size);
+
+    std::fstream file;
+    file.open(GetPath(key), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    file.write(reinterpret_cast<const char*>(key.Bytes.data()), key.Bytes.size());
+    file.write(static_cast<const char*>(content), size);
+    return !file.fail();
+}
+
+bool ShaderCache::Load(const ShaderCacheKey& key, std::vector<char>& bytecode)
+{
+    bytecode.clear();
+    if (mDirectory.empty()) return false;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    bool hit = ReadEntry(key, bytecode);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.LoadTimeMs += ElapsedMs(start);
+    if (hit) mStats.Hits++;
+    else mStats.Misses++;
+    return hit;
+}
+
+bool ShaderCache::Store(const ShaderCacheKey& key, const void* bytecode, std::size_t size)
+{
+    if (mDirectory.empty()) return false;
+    return WriteEntry(key, bytecode, size);
+}
+
+const char* const ShaderCache::PreprocessTarget = "preprocess";
+
+bool ShaderCache::LoadPreprocessedHash(const ShaderCacheKey& key, std::uint64_t& hash)
+{
+    if (mDirectory.empty()) return false;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<char> content;
+    bool hit = ReadEntry(key, content) && content.size() == sizeof(hash);
+    if (hit)
+        std::memcpy(&hash, content.data(), sizeof(hash));
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.LoadTimeMs += ElapsedMs(start);
+    if (hit) mStats.PreprocessHits++;
+    return hit;
+}
+
+bool ShaderCache::StorePreprocessedHash(const ShaderCacheKey& key, std::uint64_t hash)
+{
+    if (mDirectory.empty()) return false;
+    return WriteEntry(key, &hash, sizeof(hash));
+}
+
+void ShaderCache::AddCompileTime(double ms)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.CompileTimeMs += ms;
+}
+
+ShaderCacheStats ShaderCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+    std::string Name;
+    std::string Value;
+};
+
+// Everything the bytecode depends on. Bytes is kept in the cache file and compared on load,
+// a hash collision or a stale file can not give the wrong bytecode.
+struct ShaderCacheKey
+{
+    std::uint64_t Hash = 0;
+    std::vector<std::uint8_t> Bytes;
+};
+
+struct ShaderCacheStats
+{
+    std::uint32_t Hits = 0;
+    std::uint32_t Misses = 0; // Compiled, then stored
+    std::uint32_t FilesHashed = 0; // Sources and includes read to make the keys
+    std::uint32_t PreprocessHits = 0; // Preprocessed source hashes read back, the preprocessor did not run
+    double KeyTimeMs = 0.0;
+    double LoadTimeMs = 0.0;
+    double CompileTimeMs = 0.0; // Reported by the compiler side with AddCompileTime
+};
+
+// Compiled shaders stored on disk, one file per key, backend independent.
+// A key is made of the content of the source and of every file it includes, followed recursively,
+// the defines, the entry point, the target profile and the compile flags. Editing any of them
+// gives a new key, the old file is simply not used anymore.
+// Thread safe.
+class ShaderCache
+{
+public:
+    // directory must exist, an empty directory disables the cache
+    void Initialize(const std::string& directory);
+
+    // Return false when the source can not be read. Includes of both "" and <> forms are looked up
+    // next to the including file, the include under a false #if are hashed too.
+    bool MakeKey(const std::string& sourcePath, const std::vector<ShaderDefine>& defines,
+                 const std::string& entryPoint, const std::string& target, std::uint32_t flags, ShaderCacheKey& key);
+
+    // The file is read at once, bytecode is left empty on a miss
+    bool Load(const ShaderCacheKey& key, std::vector<char>& bytecode);
+    bool Store(const ShaderCacheKey& key, const void* bytecode, std::size_t size);
+
+    // Hash of the preprocessed source, stored under a key made with PreprocessTarget. The key has the
+    // content of the source and of its includes, a match means the preprocessor would give the same text.
+    static const char* const PreprocessTarget;
+    bool LoadPreprocessedHash(const ShaderCacheKey& key, std::uint64_t& hash);
+    bool StorePreprocessedHash(const ShaderCacheKey& key, std::uint64_t hash);
+
+    void AddCompileTime(double ms);
+
+    std::string GetPath(const ShaderCacheKey& key) const;
+    ShaderCacheStats GetStats() const;
+
+private:
+    // Content stored after the key in the file of key, false when it is missing or for another key
+    bool ReadEntry(const ShaderCacheKey& key, std::vector<char>& content) const;
+    bool WriteEntry(const ShaderCacheKey& key, const void* content, std::size_t size) const;
+
+    // Return false when the file can not be read
+    bool HashFile(const std::string& path, std::vector<std::string>& visited, std::vector<std::uint8_t>& bytes);
+
+    std::string mDirectory;
+
+    mutable std::mutex mMutex;
+    ShaderCacheStats mStats;
+};
@@ -0,0 +1,143 @@
+﻿#include "ShaderPermutations.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+const std::uint32_t ShaderPermutationTable::InvalidVariant;
+
+ShaderKeywords::ShaderKeywords()
+{
+}
+
+ShaderKeywords::ShaderKeywords(const std::vector<std::string>& names)
+{
+    for (const std::string& name : names)
+        Add(name);
+}
+
+ShaderPermutationMask ShaderKeywords::Add(const std::string& name)
+{
+    ShaderPermutationMask mask = GetMask(name);
+    if (mask != 0) return mask;
+
+    assert(mNames.size() < MaxKeywords);
+    mNames.push_back(name);
+    return 1u << (mNames.size() - 1);
+}
+
+ShaderPermutationMask ShaderKeywords::GetMask(const std::string& name) const
+{
+    for (size_t i = 0; i < mNames.size(); i++)
+    {
+        if (mNames[i] == name) return 1u << i;
+    }
+    return 0;
+}
+
+std::uint32_t ShaderKeywords::GetCount() const
+{
+    return (std::uint32_t)mNames.size();
+}
+
+std::vector<ShaderDefine> ShaderKeywords::GetDefines(ShaderPermutationMask permutation) const
+{
+    std::vector<ShaderDefine> defines;
+    for (size_t i = 0; i < mNames.size(); i++)
+    {
+        if (permutation & (1u << i))
+            defines.push_back({ mNames[i], "1" });
+    }
+    return defines;
+}
+
+std::vector<ShaderPermutationMask> ShaderKeywords::GetAllPermutations() const
+{
+    std::vector<ShaderPermutationMask> permutations(1u << mNames.size());
+    for (std::uint32_t i = 0; i < (std::uint32_t)permutations.size(); i++)
+        permutations[i] = i;
+    return permutations;
+}
+
+bool ShaderPermutationTable::Build(const ShaderKeywords& keywords, const std::vector<ShaderPermutationMask>& permutations, ThreadPool& pool,
+                                   const std::function<bool(ShaderPermutationMask, std::uint64_t&)>& preprocess,
+                                   const std::function<bool(std::uint32_t, ShaderPermutationMask)>& compile)
+{
+    mStats = ShaderPermutationStats();
+    mVariants.assign(1u << keywords.GetCount(), InvalidVariant);
+
+    // Duplicates in the request are built once
+    std::vector<ShaderPermutationMask> unique = permutations;
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    mStats.Requested = (std::uint32_t)unique.size();
+
+    // Bits past the keywords are not permutations of this shader
+    auto outside = std::remove_if(unique.begin(), unique.end(),
+        [&](ShaderPermutationMask permutation) { return permutation >= mVariants.size(); });
+    mStats.Failed += (std::uint32_t)(unique.end() - outside);
+    unique.erase(outside, unique.end());
+
+    const std::uint32_t count = (std::uint32_t)unique.size();
+    const std::uint32_t rangeCount = std::max(1u, std::min(count, pool.GetThreadCount() + 1));
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::uint64_t> hashes(count);
+    std::vector<std::uint8_t> preprocessed(count, 0);
+    pool.ParallelFor(count, rangeCount, [&](std::uint32_t, std::uint32_t begin, std::uint32_t end)
+    {
+        for (std::uint32_t i = begin; i < end; i++)
+            preprocessed[i] = preprocess(unique[i], hashes[i]) ? 1 : 0;
+    });
+
+    auto preprocessEnd = std::chrono::high_resolution_clock::now();
+    mStats.PreprocessTimeMs = std::chrono::duration<float, std::milli>(preprocessEnd - start).count();
+
+    // Same preprocessed source, same bytecode: the first permutation of each hash is compiled
+    std::vector<std::uint32_t> order;
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        if (preprocessed[i]) order.push_back(i);
+        else mStats.Failed++;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return hashes[a] < hashes[b]; });
+
+    std::vector<std::uint32_t> variantOf(count, InvalidVariant);
+    std::vector<ShaderPermutationMask> variantPermutations;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        if (i == 0 || hashes[order[i]] != hashes[order[i - 1]])
+            variantPermutations.push_back(unique[order[i]]);
+        variantOf[order[i]] = (std::uint32_t)variantPermutations.size() - 1;
+    }
+    mStats.Variants = (std::uint32_t)variantPermutations.size();
+
+    const std::uint32_t variantCount = mStats.Variants;
+    std::vector<std::uint8_t> compiled(variantCount, 0);
+    pool.ParallelFor(variantCount, std::max(1u, std::min(variantCount, pool.GetThreadCount() + 1)),
+        [&](std::uint32_t, std::uint32_t begin, std::uint32_t end)
+    {
+        for (std::uint32_t v = begin; v < end; v++)
+            compiled[v] = compile(v, variantPermutations[v]) ? 1 : 0;
+    });
+
+    auto compileEnd = std::chrono::high_resolution_clock::now();
+    mStats.CompileTimeMs = std::chrono::duration<float, std::milli>(compileEnd - preprocessEnd).count();
+
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        std::uint32_t variant = variantOf[i];
+        if (variant == InvalidVariant) continue;
+
+        if (compiled[variant]) mVariants[unique[i]] = variant;
+        else mStats.Failed++;
+    }
+
+    return mStats.Failed == 0;
+}
+
+const ShaderPermutationStats& ShaderPermutationTable::GetStats() const
+{
+    return mStats;
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ShaderCache.h"
+#include "ThreadPool.h"
+
+// Bit i set when keyword i is enabled
+using ShaderPermutationMask = std::uint32_t;
+
+// Boolean keywords of a shader. An enabled keyword is a define set to 1, a disabled one is not
+// defined at all, the shader tests them with #if.
+class ShaderKeywords
+{
+public:
+    // The permutation table has 2^count entries
+    static const std::uint32_t MaxKeywords = 12;
+
+    ShaderKeywords();
+    explicit ShaderKeywords(const std::vector<std::string>& names);
+
+    // Return the mask of the keyword, the existing one when it was already added
+    ShaderPermutationMask Add(const std::string& name);
+
+    // 0 for an unknown keyword
+    ShaderPermutationMask GetMask(const std::string& name) const;
+    std::uint32_t GetCount() const;
+
+    std::vector<ShaderDefine> GetDefines(ShaderPermutationMask permutation) const;
+
+    // Every combination, the number of keywords should stay small
+    std::vector<ShaderPermutationMask> GetAllPermutations() const;
+
+private:
+    std::vector<std::string> mNames;
+};
+
+struct ShaderPermutationStats
+{
+    std::uint32_t Requested = 0;
+    std::uint32_t Variants = 0; // Compiled, the permutations with the same preprocessed source share one
+    std::uint32_t Failed = 0;
+    float PreprocessTimeMs = 0.0f; // Wall time of the phase
+    float CompileTimeMs = 0.0f;
+};
+
+// Permutation mask to compiled variant, an array lookup.
+class ShaderPermutationTable
+{
+public:
+    static const std::uint32_t InvalidVariant = ~0u;
+
+    // Run preprocess on every permutation, then compile once per distinct preprocessed source,
+    // both phases spread over the pool. preprocess gives the hash of the preprocessed source,
+    // compile(variant, permutation) builds the variant from one of its permutations. Variants
+    // are numbered from 0 and stay below the number of permutations.
+    // Return false when a permutation failed, the others are usable.
+    bool Build(const ShaderKeywords& keywords, const std::vector<ShaderPermutationMask>& permutations, ThreadPool& pool,
+               const std::function<bool(ShaderPermutationMask, std::uint64_t&)>& preprocess,
+               const std::function<bool(std::uint32_t, ShaderPermutationMask)>& compile);
+
+    // InvalidVariant for a permutation that was not built
+    std::uint32_t GetVariant(ShaderPermutationMask permutation) const
+    {
+        return permutation < mVariants.size() ? mVariants[permutation] : InvalidVariant;
+    }
+
+    const ShaderPermutationStats& GetStats() const;
+
+private:
+    std::vector<std::uint32_t> mVariants;
+    ShaderPermutationStats mStats;
+};
@@ -0,0 +1,74 @@
+﻿#include "SortBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "RadixSort.h"
+
+namespace
+{
+    // Layout of the DrawQueue keys: pass (3) | pso (9) | mesh (14) | depth bucket (14) | item (24)
+    std::uint64_t MakeKey(std::uint32_t pso, std::uint32_t mesh, std::uint32_t depth, std::uint32_t item)
+    {
+        return ((std::uint64_t)(pso & 0x1FF) << 52) | ((std::uint64_t)(mesh & 0x3FFF) << 38) |
+            ((std::uint64_t)(depth & 0x3FFF) << 24) | (item & 0xFFFFFF);
+    }
+
+    double Elapsed(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+SortBenchmarkResult RunSortBenchmark(std::uint32_t keyCount, std::uint32_t frames, std::uint32_t seed)
+{
+    SortBenchmarkResult result;
+    result.Keys = keyCount;
+    result.Frames = frames;
+    result.Valid = true;
+
+    std::mt19937 random(seed);
+    std::vector<std::uint32_t> meshes(keyCount);
+    std::vector<std::uint32_t> pipelines(keyCount);
+    for (std::uint32_t i = 0; i < keyCount; i++)
+    {
+        meshes[i] = random() % 2048;
+        pipelines[i] = random() % 8;
+    }
+
+    std::vector<std::uint64_t> keys(keyCount);
+    std::vector<std::uint64_t> sorted;
+    std::vector<std::uint64_t> scratch;
+    for (std::uint32_t frame = 0; frame < frames; frame++)
+    {
+        // Visible items in item order, like the culling gives them
+        for (std::uint32_t i = 0; i < keyCount; i++)
+            keys[i] = MakeKey(pipelines[i], meshes[i], random() % 0x4000, i);
+
+        sorted = keys;
+        auto start = std::chrono::high_resolution_clock::now();
+        RadixSortKeys(sorted, scratch);
+        double radixMs = Elapsed(start);
+        result.RadixMs += radixMs;
+        result.WorstRadixMs = std::max(result.WorstRadixMs, radixMs);
+
+        start = std::chrono::high_resolution_clock::now();
+        std::sort(keys.begin(), keys.end());
+        result.StdSortMs += Elapsed(start);
+
+        if (result.Valid && sorted != keys)
+        {
+            result.Valid = false;
+            result.Error = "radix and std::sort orders differ at frame " + std::to_string(frame);
+        }
+    }
+
+    if (frames > 0)
+    {
+        result.RadixMs /= frames;
+        result.StdSortMs /= frames;
+    }
+    return result;
+}
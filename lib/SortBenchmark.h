@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct SortBenchmarkResult
+{
+    std::uint32_t Keys = 0;
+    std::uint32_t Frames = 0;
+
+    // Average of a frame
+    double RadixMs = 0.0; // RadixSortKeys with a scratch kept between frames
+    double WorstRadixMs = 0.0;
+    double StdSortMs = 0.0; // std::sort of the same keys
+
+    // Both sorts give the same keys every frame
+    bool Valid = false;
+    std::string Error;
+};
+
+// keyCount draw queue keys (pass, pipeline, mesh, depth bucket, item) sorted every frame, with new
+// depths like a moving camera gives. Same seed same keys.
+SortBenchmarkResult RunSortBenchmark(std::uint32_t keyCount, std::uint32_t frames, std::uint32_t seed);
@@ -0,0 +1,282 @@
+﻿#include "StagingRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include "d3dUtils.h"
+
+namespace
+{
+    // Copies have no alignment requirement, 16 bytes keeps the CPU writes aligned
+    const UINT64 UploadAlignment = 16;
+
+    bool NeedsBarriers(D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+    {
+        return stateBefore != D3D12_RESOURCE_STATE_COMMON || stateAfter != D3D12_RESOURCE_STATE_COMMON;
+    }
+
+    // Keep the first transition of every resource, sorted by resource
+    void RemoveDuplicateTransitions(std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+    {
+        auto byResource = [](const D3D12_RESOURCE_BARRIER& a, const D3D12_RESOURCE_BARRIER& b)
+        {
+            return std::less<ID3D12Resource*>()(a.Transition.pResource, b.Transition.pResource);
+        };
+        auto sameResource = [](const D3D12_RESOURCE_BARRIER& a, const D3D12_RESOURCE_BARRIER& b)
+        {
+            return a.Transition.pResource == b.Transition.pResource;
+        };
+
+        std::stable_sort(barriers.begin(), barriers.end(), byResource);
+        barriers.erase(std::unique(barriers.begin(), barriers.end(), sameResource), barriers.end());
+    }
+}
+
+StagingRing::StagingRing()
+{
+}
+
+StagingRing::~StagingRing()
+{
+    Release();
+}
+
+void StagingRing::Initialize(ID3D12Device* device, ID3D12CommandQueue* queue, IGpuQueue* gpuQueue, UINT64 capacity)
+{
+    mQueue = queue;
+    mGpuQueue = gpuQueue;
+
+    D3D12_COMMAND_LIST_TYPE listType = queue->GetDesc().Type;
+    mCopyQueue = listType == D3D12_COMMAND_LIST_TYPE_COPY;
+
+    CD3DX12_HEAP_PROPERTIES heapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC buffer = CD3DX12_RESOURCE_DESC::Buffer(capacity);
+    HRESULT result = device->CreateCommittedResource(
+        &heapProp,
+        D3D12_HEAP_FLAG_NONE,
+        &buffer,
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&mBuffer));
+
+    if (FAILED(result))
+    {
+        std::cerr << "Failed to create staging ring buffer !\n";
+        mBuffer = nullptr;
+        return;
+    }
+
+    // Stay mapped for the buffer lifetime, upload heaps allow it
+    mBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData));
+    mAllocator.Reset(capacity);
+    mStats.Capacity = capacity;
+
+    for (Batch& batch : mBatches)
+    {
+        result = device->CreateCommandAllocator(listType, IID_PPV_ARGS(&batch.Allocator));
+        if (FAILED(result)) { std::cerr << "Failed to create staging command allocator !\n"; return; }
+
+        result = device->CreateCommandList(0, listType, batch.Allocator, nullptr, IID_PPV_ARGS(&batch.List));
+        if (FAILED(result)) { std::cerr << "Failed to create staging command list !\n"; return; }
+
+        // Created open, closed until a flush records in it
+        batch.List->Close();
+    }
+}
+
+void StagingRing::Release()
+{
+    for (Batch& batch : mBatches)
+    {
+        if (batch.List != nullptr) batch.List->Release();
+        if (batch.Allocator != nullptr) batch.Allocator->Release();
+        batch = Batch();
+    }
+
+    if (mBuffer != nullptr)
+    {
+        mBuffer->Unmap(0, nullptr);
+        mBuffer->Release();
+    }
+    mBuffer = nullptr;
+    mMappedData = nullptr;
+}
+
+void StagingRing::WaitForValue(UINT64 fence)
+{
+    if (fence == 0 || mGpuQueue->GetCompletedValue() >= fence) return;
+
+    mGpuQueue->WaitForValue(fence);
+    mStats.Waits++;
+}
+
+bool StagingRing::Upload(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size,
+                         D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+{
+    if (mBuffer == nullptr) return false;
+
+    if (mCopyQueue)
+    {
+        stateBefore = D3D12_RESOURCE_STATE_COMMON;
+        stateAfter = D3D12_RESOURCE_STATE_COMMON;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const BYTE* source = static_cast<const BYTE*>(data);
+    UINT64 copied = 0;
+    while (copied < size)
+    {
+        // Half the ring at most so the next piece can be written while the GPU copies this one
+        UINT64 pieceSize = std::min(size - copied, std::max(mAllocator.GetCapacity() / 2, UploadAlignment));
+
+        UINT64 offset = mAllocator.Allocate(pieceSize, UploadAlignment);
+        if (offset == RingAllocator::InvalidOffset)
+        {
+            // Full, what is pending is submitted and we wait for the oldest flush to give space back
+            if (mAllocator.GetOpenBytes() != 0)
+            {
+                Submit();
+
+                // The destination left the first part of this upload in stateAfter
+                if (copied != 0) stateBefore = stateAfter;
+            }
+
+            mAllocator.Reclaim(mGpuQueue->GetCompletedValue());
+            offset = mAllocator.Allocate(pieceSize, UploadAlignment);
+            while (offset == RingAllocator::InvalidOffset && mAllocator.GetOldestFence() != 0)
+            {
+                WaitForValue(mAllocator.GetOldestFence());
+                mAllocator.Reclaim(mGpuQueue->GetCompletedValue());
+                offset = mAllocator.Allocate(pieceSize, UploadAlignment);
+            }
+
+            if (offset == RingAllocator::InvalidOffset)
+            {
+                std::cerr << "Failed to allocate staging memory !\n";
+                return false;
+            }
+        }
+
+        memcpy(mMappedData + offset, source + copied, pieceSize);
+
+        PendingCopy copy;
+        copy.Destination = destination;
+        copy.DestinationOffset = destinationOffset + copied;
+        copy.SourceOffset = offset;
+        copy.Size = pieceSize;
+        copy.StateBefore = stateBefore;
+        copy.StateAfter = stateAfter;
+        mPendingCopies.push_back(copy);
+
+        copied += pieceSize;
+    }
+
+    mStats.BytesUploaded += size;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    mStats.UploadTimeMs += std::chrono::duration<double, std::milli>(end - start).count();
+    return true;
+}
+
+void StagingRing::Flush()
+{
+    if (mPendingCopies.empty()) return;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    Submit();
+    auto end = std::chrono::high_resolution_clock::now();
+    mStats.UploadTimeMs += std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void StagingRing::Submit()
+{
+    // The command list of this batch may still be executing
+    Batch& batch = mBatches[mNextBatch];
+    mNextBatch = (mNextBatch + 1) % MaxBatches;
+    WaitForValue(batch.Fence);
+
+    batch.Allocator->Reset();
+    batch.List->Reset(batch.Allocator, nullptr);
+
+    // One transition per destination even when several copies write in it
+    mBarriers.clear();
+    for (const PendingCopy& copy : mPendingCopies)
+    {
+        if (!NeedsBarriers(copy.StateBefore, copy.StateAfter) || copy.StateBefore == D3D12_RESOURCE_STATE_COPY_DEST)
+            continue;
+
+        mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(copy.Destination, copy.StateBefore, D3D12_RESOURCE_STATE_COPY_DEST));
+    }
+    RemoveDuplicateTransitions(mBarriers);
+    if (!mBarriers.empty())
+        batch.List->ResourceBarrier((UINT)mBarriers.size(), mBarriers.data());
+
+    for (const PendingCopy& copy : mPendingCopies)
+        batch.List->CopyBufferRegion(copy.Destination, copy.DestinationOffset, mBuffer, copy.SourceOffset, copy.Size);
+
+    mBarriers.clear();
+    for (const PendingCopy& copy : mPendingCopies)
+    {
+        if (!NeedsBarriers(copy.StateBefore, copy.StateAfter) || copy.StateAfter == D3D12_RESOURCE_STATE_COPY_DEST)
+            continue;
+
+        mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(copy.Destination, D3D12_RESOURCE_STATE_COPY_DEST, copy.StateAfter));
+    }
+    RemoveDuplicateTransitions(mBarriers);
+    if (!mBarriers.empty())
+        batch.List->ResourceBarrier((UINT)mBarriers.size(), mBarriers.data());
+
+    batch.List->Close();
+    ID3D12CommandList* lists[] = { batch.List };
+    mQueue->ExecuteCommandLists(_countof(lists), lists);
+
+    batch.Fence = mGpuQueue->Signal();
+    mAllocator.Close(batch.Fence);
+    mTicketFences.push_back(batch.Fence);
+    mPendingCopies.clear();
+    mStats.Flushes++;
+}
+
+void StagingRing::WaitIdle()
+{
+    Flush();
+
+    for (const Batch& batch : mBatches)
+        WaitForValue(batch.Fence);
+    mAllocator.Reclaim(mGpuQueue->GetCompletedValue());
+}
+
+UINT64 StagingRing::GetCurrentTicket() const
+{
+    return mCompletedTicket + mTicketFences.size() + 1;
+}
+
+UINT64 StagingRing::GetCompletedTicket()
+{
+    UINT64 completedFence = mGpuQueue->GetCompletedValue();
+    while (!mTicketFences.empty() && mTicketFences.front() <= completedFence)
+    {
+        mCompletedFence = mTicketFences.front();
+        mTicketFences.pop_front();
+        mCompletedTicket++;
+    }
+    return mCompletedTicket;
+}
+
+UINT64 StagingRing::GetTicketFence(UINT64 ticket) const
+{
+    if (ticket <= mCompletedTicket) return mCompletedFence;
+
+    UINT64 index = ticket - mCompletedTicket - 1;
+    return index < mTicketFences.size() ? mTicketFences[(size_t)index] : 0;
+}
+
+StagingStats StagingRing::GetStats() const
+{
+    StagingStats stats = mStats;
+    stats.PeakUsed = mAllocator.GetPeakUsed();
+    stats.BytesPerSecond = stats.UploadTimeMs > 0.0 ? stats.BytesUploaded * 1000.0 / stats.UploadTimeMs : 0.0;
+    return stats;
+}
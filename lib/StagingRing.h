@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <deque>
+#include <vector>
+
+#include "GpuQueue.h"
+#include "RingAllocator.h"
+
+struct StagingStats
+{
+    UINT64 Capacity = 0;
+    UINT64 PeakUsed = 0; // High water mark of the ring
+    UINT64 BytesUploaded = 0;
+    UINT Flushes = 0;
+    UINT Waits = 0; // Uploads that waited for the GPU to give space back
+
+    // CPU time spent in Upload and Flush, waits included, and the bytes per second it gives
+    double UploadTimeMs = 0.0;
+    double BytesPerSecond = 0.0;
+};
+
+// Upload memory shared by every buffer initialization. Uploads are packed in one persistently
+// mapped buffer used as a ring, their copies are recorded at Flush in one command list with
+// a single barrier call before and after them. Space comes back when the GPU reached the fence
+// of the flush that used it, an upload waits for it when the ring is full.
+// On a copy queue the uploads run beside the frames. Each flush is a ticket, a buffer can be
+// read once its ticket is complete and the reading queue waited for the ticket fence.
+class StagingRing
+{
+public:
+    static const UINT64 DefaultCapacity = 16ull * 1024 * 1024;
+    static const UINT MaxBatches = 4; // Flushes in flight, each has its own command list
+
+    StagingRing();
+    ~StagingRing();
+
+    StagingRing(const StagingRing& rhs) = delete;
+    StagingRing& operator=(const StagingRing& rhs) = delete;
+
+    // queue is the command queue the copies are submitted to, gpuQueue its fence timeline.
+    // A copy queue can not transition to read states, destinations stay on implicit promotion and decay.
+    void Initialize(ID3D12Device* device, ID3D12CommandQueue* queue, IGpuQueue* gpuQueue, UINT64 capacity = DefaultCapacity);
+
+    // Copy size bytes of data to destination at destinationOffset, recorded at the next Flush.
+    // With stateBefore and stateAfter COMMON the copy relies on implicit promotion and decay,
+    // otherwise destination is transitioned stateBefore -> COPY_DEST -> stateAfter.
+    // Uploads bigger than the ring are split, the ring is flushed when it fills up.
+    bool Upload(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size,
+                D3D12_RESOURCE_STATES stateBefore = D3D12_RESOURCE_STATE_COMMON,
+                D3D12_RESOURCE_STATES stateAfter = D3D12_RESOURCE_STATE_COMMON);
+
+    // Submit the pending copies, work submitted later on the queue sees them done
+    void Flush();
+
+    // Flush and wait for the GPU to be done with every copy
+    void WaitIdle();
+
+    // Ticket of the flush the next copies go in, flushes are numbered from 1
+    UINT64 GetCurrentTicket() const;
+
+    // Highest ticket whose copies are done, the copies of lower tickets are done too
+    UINT64 GetCompletedTicket();
+
+    // Fence value on the copy timeline a queue reading the ticket buffers must wait for.
+    // Tickets up to the completed one give its fence, which the GPU already reached.
+    UINT64 GetTicketFence(UINT64 ticket) const;
+
+    StagingStats GetStats() const;
+
+private:
+    struct PendingCopy
+    {
+        ID3D12Resource* Destination = nullptr;
+        UINT64 DestinationOffset = 0;
+        UINT64 SourceOffset = 0;
+        UINT64 Size = 0;
+        D3D12_RESOURCE_STATES StateBefore = D3D12_RESOURCE_STATE_COMMON;
+        D3D12_RESOURCE_STATES StateAfter = D3D12_RESOURCE_STATE_COMMON;
+    };
+
+    struct Batch
+    {
+        ID3D12CommandAllocator* Allocator = nullptr;
+        ID3D12GraphicsCommandList* List = nullptr;
+        UINT64 Fence = 0;
+    };
+
+    void Release();
+    void Submit(); // Flush without the timing, also called by Upload when the ring is full
+    void WaitForValue(UINT64 fence);
+
+    ID3D12CommandQueue* mQueue = nullptr;
+    IGpuQueue* mGpuQueue = nullptr;
+    bool mCopyQueue = false;
+
+    ID3D12Resource* mBuffer = nullptr;
+    BYTE* mMappedData = nullptr;
+    RingAllocator mAllocator;
+
+    Batch mBatches[MaxBatches];
+    UINT mNextBatch = 0;
+
+    // Fence of the flushes after the completed ticket, ticket t at t - mCompletedTicket - 1.
+    // Completed tickets are dropped so the queue stays as long as the flushes in flight.
+    std::deque<UINT64> mTicketFences;
+    UINT64 mCompletedTicket = 0;
+    UINT64 mCompletedFence = 0; // Of mCompletedTicket
+
+    std::vector<PendingCopy> mPendingCopies;
+    std::vector<D3D12_RESOURCE_BARRIER> mBarriers;
+    StagingStats mStats;
+};
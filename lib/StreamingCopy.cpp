@@ -0,0 +1,92 @@
+﻿#include "StreamingCopy.h"
+
+#include <cstdint>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+    bool IsAligned(const void* pointer, std::size_t alignment)
+    {
+        return (reinterpret_cast<std::uintptr_t>(pointer) & (alignment - 1)) == 0;
+    }
+
+    // destination is line aligned, size is a multiple of the line size
+    void StreamLines(std::uint8_t* destination, const std::uint8_t* source, std::size_t size)
+    {
+        for (std::size_t offset = 0; offset < size; offset += StreamLineSize)
+        {
+            const __m128i* src = reinterpret_cast<const __m128i*>(source + offset);
+            __m128i* dst = reinterpret_cast<__m128i*>(destination + offset);
+
+            // Loaded first so the four stores of the line go out back to back
+            __m128i a = _mm_loadu_si128(src + 0);
+            __m128i b = _mm_loadu_si128(src + 1);
+            __m128i c = _mm_loadu_si128(src + 2);
+            __m128i d = _mm_loadu_si128(src + 3);
+            _mm_stream_si128(dst + 0, a);
+            _mm_stream_si128(dst + 1, b);
+            _mm_stream_si128(dst + 2, c);
+            _mm_stream_si128(dst + 3, d);
+        }
+    }
+}
+
+void StreamCopy(void* destination, const void* source, std::size_t size)
+{
+    std::uint8_t* dst = static_cast<std::uint8_t*>(destination);
+    const std::uint8_t* src = static_cast<const std::uint8_t*>(source);
+
+    // Head up to the first line boundary
+    std::size_t head = (StreamLineSize - (reinterpret_cast<std::uintptr_t>(dst) & (StreamLineSize - 1))) & (StreamLineSize - 1);
+    if (head > size) head = size;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    std::size_t lines = size & ~(StreamLineSize - 1);
+    StreamLines(dst, src, lines);
+
+    memcpy(dst + lines, src + lines, size - lines);
+}
+
+void StreamCopyElements(void* destination, std::size_t destinationStride,
+                        const void* source, std::size_t sourceStride,
+                        std::size_t elementSize, std::size_t count)
+{
+    std::uint8_t* dst = static_cast<std::uint8_t*>(destination);
+    const std::uint8_t* src = static_cast<const std::uint8_t*>(source);
+
+    // Both sides packed, one contiguous copy
+    if (destinationStride == elementSize && sourceStride == elementSize)
+    {
+        StreamCopy(dst, src, elementSize * count);
+        return;
+    }
+
+    std::size_t paddedSize = (elementSize + StreamLineSize - 1) & ~(StreamLineSize - 1);
+    bool wholeLines = IsAligned(dst, StreamLineSize) && destinationStride % StreamLineSize == 0 &&
+                      paddedSize <= destinationStride;
+
+    const std::size_t StagingSize = 1024;
+    if (!wholeLines || paddedSize > StagingSize)
+    {
+        for (std::size_t i = 0; i < count; i++)
+            StreamCopy(dst + i * destinationStride, src + i * sourceStride, elementSize);
+        return;
+    }
+
+    alignas(64) std::uint8_t staging[StagingSize];
+    memset(staging + elementSize, 0, paddedSize - elementSize);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        memcpy(staging, src + i * sourceStride, elementSize);
+        StreamLines(dst + i * destinationStride, staging, paddedSize);
+    }
+}
+
+void StreamCopyFence()
+{
+    _mm_sfence();
+}
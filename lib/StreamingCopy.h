@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include <cstddef>
+
+// Copies into write-combined memory, like the mapped upload heap buffers.
+// Write-combined memory is not cached: the CPU gathers stores in a few line sized buffers
+// and sends a line in one burst only when it was written whole. Partial lines or lines
+// written out of order are flushed in pieces and the copy stalls on every one of them.
+// These copies write whole 64 bytes lines in order with non-temporal stores.
+
+const std::size_t StreamLineSize = 64;
+
+// Contiguous copy, the parts of the destination outside the aligned lines are written with memcpy
+void StreamCopy(void* destination, const void* source, std::size_t size);
+
+// Copy count elements of elementSize bytes. When the destination is line aligned and the
+// stride leaves room, each element is padded with zeros to whole lines in an aligned staging
+// block so the lines are sent whole, the padding lands in the unused end of the stride.
+void StreamCopyElements(void* destination, std::size_t destinationStride,
+                        const void* source, std::size_t sourceStride,
+                        std::size_t elementSize, std::size_t count);
+
+// Non-temporal stores are not ordered with the other stores, call this before the
+// GPU can read what was written (before the command lists are submitted)
+void StreamCopyFence();
@@ -0,0 +1,103 @@
+﻿#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(std::uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        std::uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    for (std::uint32_t i = 0; i < threadCount; i++)
+        mThreads.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mJobAvailable.notify_all();
+
+    for (std::thread& thread : mThreads)
+        thread.join();
+}
+
+std::uint32_t ThreadPool::GetThreadCount() const
+{
+    return (std::uint32_t)mThreads.size();
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(std::move(job));
+        mActiveJobs++;
+    }
+    mJobAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJobsDone.wait(lock, [this] { return mActiveJobs == 0; });
+}
+
+void ThreadPool::ParallelFor(std::uint32_t count, std::uint32_t rangeCount,
+                             const std::function<void(std::uint32_t, std::uint32_t, std::uint32_t)>& func)
+{
+    if (rangeCount == 0) rangeCount = 1;
+
+    std::uint32_t rangeSize = (count + rangeCount - 1) / rangeCount;
+
+    // Only this call ranges are waited for, other jobs can still be running
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    std::uint32_t remaining = rangeCount - 1;
+
+    for (std::uint32_t r = 1; r < rangeCount; r++)
+    {
+        std::uint32_t begin = std::min(count, r * rangeSize);
+        std::uint32_t end = std::min(count, begin + rangeSize);
+        Submit([&, r, begin, end]
+        {
+            func(r, begin, end);
+
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (--remaining == 0)
+                doneCondition.notify_one();
+        });
+    }
+
+    func(0, 0, std::min(count, rangeSize));
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCondition.wait(lock, [&] { return remaining == 0; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mJobAvailable.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+            if (mStopping && mJobs.empty()) return;
+
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mActiveJobs--;
+            if (mActiveJobs == 0)
+                mJobsDone.notify_all();
+        }
+    }
+}
@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running queued jobs
+class ThreadPool
+{
+public:
+    // 0 threads means one per hardware thread minus the calling one
+    ThreadPool(std::uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& rhs) = delete;
+    ThreadPool& operator=(const ThreadPool& rhs) = delete;
+
+    std::uint32_t GetThreadCount() const;
+
+    void Submit(std::function<void()> job);
+
+    // Block until every submitted job is done
+    void Wait();
+
+    // Split [0, count) in rangeCount contiguous ranges and call func(rangeIndex, begin, end) for each one.
+    // The calling thread runs the first range and the call returns when all the ranges are done.
+    void ParallelFor(std::uint32_t count, std::uint32_t rangeCount,
+                     const std::function<void(std::uint32_t, std::uint32_t, std::uint32_t)>& func);
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()>> mJobs;
+
+    std::mutex mMutex;
+    std::condition_variable mJobAvailable;
+    std::condition_variable mJobsDone;
+    std::uint32_t mActiveJobs = 0;
+    bool mStopping = false;
+};
@@ -0,0 +1,305 @@
+﻿#include "TlsfAllocator.h"
+
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    std::uint32_t HighestBit(std::uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return (std::uint32_t)index;
+#else
+        return 63u - (std::uint32_t)__builtin_clzll(value);
+#endif
+    }
+
+    std::uint32_t LowestBit(std::uint32_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return (std::uint32_t)index;
+#else
+        return (std::uint32_t)__builtin_ctz(value);
+#endif
+    }
+
+    // Size classes are computed on granularity units
+    void Mapping(std::uint64_t units, std::uint32_t& firstLevel, std::uint32_t& secondLevel)
+    {
+        if (units < TlsfAllocator::SecondLevelCount)
+        {
+            firstLevel = 0;
+            secondLevel = (std::uint32_t)units;
+            return;
+        }
+
+        std::uint32_t log = HighestBit(units);
+        firstLevel = log - TlsfAllocator::SecondLevelBits + 1;
+        secondLevel = (std::uint32_t)(units >> (log - TlsfAllocator::SecondLevelBits)) - TlsfAllocator::SecondLevelCount;
+    }
+
+    std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+TlsfAllocator::TlsfAllocator(std::uint64_t capacity)
+{
+    Reset(capacity);
+}
+
+void TlsfAllocator::Reset(std::uint64_t capacity)
+{
+    mCapacity = capacity & ~(Granularity - 1);
+    mUsed = 0;
+    mAllocationCount = 0;
+
+    mFirstLevelMask = 0;
+    for (std::uint32_t fl = 0; fl < FirstLevelCount; fl++)
+    {
+        mSecondLevelMasks[fl] = 0;
+        for (std::uint32_t sl = 0; sl < SecondLevelCount; sl++)
+            mFreeHeads[fl][sl] = InvalidBlock;
+    }
+
+    mBlocks.clear();
+    mUnusedBlocks.clear();
+
+    if (mCapacity == 0) return;
+
+    std::uint32_t block = NewBlock();
+    mBlocks[block].Offset = 0;
+    mBlocks[block].Size = mCapacity;
+    InsertFree(block);
+}
+
+std::uint32_t TlsfAllocator::NewBlock()
+{
+    if (!mUnusedBlocks.empty())
+    {
+        std::uint32_t block = mUnusedBlocks.back();
+        mUnusedBlocks.pop_back();
+        mBlocks[block] = Block();
+        return block;
+    }
+
+    mBlocks.push_back(Block());
+    return (std::uint32_t)mBlocks.size() - 1;
+}
+
+void TlsfAllocator::DeleteBlock(std::uint32_t block)
+{
+    mUnusedBlocks.push_back(block);
+}
+
+void TlsfAllocator::InsertFree(std::uint32_t block)
+{
+    Block& b = mBlocks[block];
+    std::uint32_t fl, sl;
+    Mapping(b.Size / Granularity, fl, sl);
+
+    b.Free = true;
+    b.PrevFree = InvalidBlock;
+    b.NextFree = mFreeHeads[fl][sl];
+    if (b.NextFree != InvalidBlock)
+        mBlocks[b.NextFree].PrevFree = block;
+    mFreeHeads[fl][sl] = block;
+
+    mFirstLevelMask |= 1u << fl;
+    mSecondLevelMasks[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFree(std::uint32_t block)
+{
+    Block& b = mBlocks[block];
+    std::uint32_t fl, sl;
+    Mapping(b.Size / Granularity, fl, sl);
+
+    if (b.PrevFree != InvalidBlock)
+        mBlocks[b.PrevFree].NextFree = b.NextFree;
+    else
+        mFreeHeads[fl][sl] = b.NextFree;
+    if (b.NextFree != InvalidBlock)
+        mBlocks[b.NextFree].PrevFree = b.PrevFree;
+
+    if (mFreeHeads[fl][sl] == InvalidBlock)
+    {
+        mSecondLevelMasks[fl] &= ~(1u << sl);
+        if (mSecondLevelMasks[fl] == 0)
+            mFirstLevelMask &= ~(1u << fl);
+    }
+
+    b.Free = false;
+    b.PrevFree = InvalidBlock;
+    b.NextFree = InvalidBlock;
+}
+
+std::uint32_t TlsfAllocator::FindFree(std::uint64_t size) const
+{
+    // Round up to the next class so any block of the list found is big enough
+    std::uint64_t units = size / Granularity;
+    if (units >= SecondLevelCount)
+        units += (1ull << (HighestBit(units) - SecondLevelBits)) - 1;
+
+    std::uint32_t fl, sl;
+    Mapping(units, fl, sl);
+    if (fl >= FirstLevelCount) return InvalidBlock;
+
+    std::uint32_t secondMask = mSecondLevelMasks[fl] & (~0u << sl);
+    if (secondMask == 0)
+    {
+        std::uint32_t firstMask = fl + 1 < 32 ? mFirstLevelMask & (~0u << (fl + 1)) : 0;
+        if (firstMask == 0) return InvalidBlock;
+
+        fl = LowestBit(firstMask);
+        secondMask = mSecondLevelMasks[fl];
+    }
+
+    return mFreeHeads[fl][LowestBit(secondMask)];
+}
+
+void TlsfAllocator::SplitTail(std::uint32_t block, std::uint64_t size)
+{
+    if (mBlocks[block].Size <= size) return;
+
+    std::uint32_t tail = NewBlock();
+    Block& b = mBlocks[block];
+    Block& t = mBlocks[tail];
+    t.Offset = b.Offset + size;
+    t.Size = b.Size - size;
+    t.PrevPhysical = block;
+    t.NextPhysical = b.NextPhysical;
+    if (t.NextPhysical != InvalidBlock)
+        mBlocks[t.NextPhysical].PrevPhysical = tail;
+    b.NextPhysical = tail;
+    b.Size = size;
+
+    // The next block is never free, it would have been merged with this one
+    InsertFree(tail);
+}
+
+void TlsfAllocator::MergeNext(std::uint32_t block, std::uint32_t next)
+{
+    Block& b = mBlocks[block];
+    Block& n = mBlocks[next];
+    b.Size += n.Size;
+    b.NextPhysical = n.NextPhysical;
+    if (b.NextPhysical != InvalidBlock)
+        mBlocks[b.NextPhysical].PrevPhysical = block;
+    DeleteBlock(next);
+}
+
+TlsfAllocation TlsfAllocator::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    TlsfAllocation allocation;
+    if (size == 0) return allocation;
+
+    if (alignment < Granularity) alignment = Granularity;
+    size = AlignUp(size, Granularity);
+
+    // Room to move the start to the alignment inside the block
+    std::uint32_t block = FindFree(size + alignment - Granularity);
+    if (block == InvalidBlock) return allocation;
+
+    RemoveFree(block);
+
+    // Padding before the aligned start goes back to the free lists
+    std::uint64_t padding = AlignUp(mBlocks[block].Offset, alignment) - mBlocks[block].Offset;
+    if (padding != 0)
+    {
+        SplitTail(block, padding);
+        std::uint32_t aligned = mBlocks[block].NextPhysical;
+        RemoveFree(aligned);
+        InsertFree(block);
+        block = aligned;
+    }
+
+    SplitTail(block, size);
+
+    mUsed += mBlocks[block].Size;
+    mAllocationCount++;
+
+    allocation.Offset = mBlocks[block].Offset;
+    allocation.Size = mBlocks[block].Size;
+    allocation.Block = block;
+    return allocation;
+}
+
+void TlsfAllocator::Free(const TlsfAllocation& allocation)
+{
+    if (!allocation.IsValid()) return;
+
+    std::uint32_t block = allocation.Block;
+    assert(block < mBlocks.size() && !mBlocks[block].Free);
+
+    mUsed -= mBlocks[block].Size;
+    mAllocationCount--;
+
+    std::uint32_t next = mBlocks[block].NextPhysical;
+    if (next != InvalidBlock && mBlocks[next].Free)
+    {
+        RemoveFree(next);
+        MergeNext(block, next);
+    }
+
+    std::uint32_t prev = mBlocks[block].PrevPhysical;
+    if (prev != InvalidBlock && mBlocks[prev].Free)
+    {
+        RemoveFree(prev);
+        MergeNext(prev, block);
+        block = prev;
+    }
+
+    InsertFree(block);
+}
+
+std::uint64_t TlsfAllocator::GetCapacity() const
+{
+    return mCapacity;
+}
+
+std::uint64_t TlsfAllocator::GetUsed() const
+{
+    return mUsed;
+}
+
+std::uint32_t TlsfAllocator::GetAllocationCount() const
+{
+    return mAllocationCount;
+}
+
+TlsfStats TlsfAllocator::GetStats() const
+{
+    TlsfStats stats;
+    stats.Capacity = mCapacity;
+    stats.UsedBytes = mUsed;
+    stats.FreeBytes = mCapacity - mUsed;
+    stats.AllocationCount = mAllocationCount;
+
+    for (std::uint32_t fl = 0; fl < FirstLevelCount; fl++)
+    {
+        for (std::uint32_t sl = 0; sl < SecondLevelCount; sl++)
+        {
+            for (std::uint32_t block = mFreeHeads[fl][sl]; block != InvalidBlock; block = mBlocks[block].NextFree)
+            {
+                stats.FreeBlockCount++;
+                if (mBlocks[block].Size > stats.LargestFreeBlock)
+                    stats.LargestFreeBlock = mBlocks[block].Size;
+            }
+        }
+    }
+
+    if (stats.FreeBytes != 0)
+        stats.Fragmentation = 1.0f - (float)((double)stats.LargestFreeBlock / (double)stats.FreeBytes);
+    return stats;
+}
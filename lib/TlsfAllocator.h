@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct TlsfStats
+{
+    std::uint64_t Capacity = 0;
+    std::uint64_t UsedBytes = 0; // Allocated blocks, with their alignment padding
+    std::uint64_t FreeBytes = 0;
+    std::uint64_t LargestFreeBlock = 0;
+    std::uint32_t AllocationCount = 0;
+    std::uint32_t FreeBlockCount = 0;
+
+    // 0 when the free bytes are in one block, close to 1 when they are scattered in small ones
+    float Fragmentation = 0.0f;
+};
+
+// Allocated range, Block is the handle given back to Free
+struct TlsfAllocation
+{
+    std::uint64_t Offset = ~0ull;
+    std::uint64_t Size = 0;
+    std::uint32_t Block = ~0u;
+
+    bool IsValid() const { return Block != ~0u; }
+};
+
+// Two level segregated fit allocator handing out offsets in a range of bytes.
+// Free blocks are kept in lists by size class: the first level is the power of two of the size,
+// the second splits it in 16 linear classes. A bitmap per level finds a big enough list in
+// constant time, neighbour free blocks are merged when a block is freed.
+// The block headers live in a separate pool so the range can be GPU memory the CPU can not write.
+class TlsfAllocator
+{
+public:
+    // Every size and offset is a multiple of this, also the default alignment (constant buffers)
+    static const std::uint64_t Granularity = 256;
+
+    static const std::uint32_t SecondLevelBits = 4;
+    static const std::uint32_t SecondLevelCount = 1u << SecondLevelBits;
+    static const std::uint32_t FirstLevelCount = 32; // Up to 4 TB
+
+    TlsfAllocator(std::uint64_t capacity = 0);
+
+    // Forget every allocation, the whole range is one free block
+    void Reset(std::uint64_t capacity);
+
+    // alignment must be a power of two, the allocation is invalid when no free block is big enough
+    TlsfAllocation Allocate(std::uint64_t size, std::uint64_t alignment = Granularity);
+    void Free(const TlsfAllocation& allocation);
+
+    std::uint64_t GetCapacity() const;
+    std::uint64_t GetUsed() const;
+    std::uint32_t GetAllocationCount() const;
+    TlsfStats GetStats() const;
+
+private:
+    static const std::uint32_t InvalidBlock = ~0u;
+
+    struct Block
+    {
+        std::uint64_t Offset = 0;
+        std::uint64_t Size = 0;
+        std::uint32_t PrevPhysical = InvalidBlock;
+        std::uint32_t NextPhysical = InvalidBlock;
+        std::uint32_t PrevFree = InvalidBlock;
+        std::uint32_t NextFree = InvalidBlock;
+        bool Free = false;
+    };
+
+    std::uint32_t NewBlock();
+    void DeleteBlock(std::uint32_t block);
+
+    void InsertFree(std::uint32_t block);
+    void RemoveFree(std::uint32_t block);
+
+    // Split the end of block past size in a new free block
+    void SplitTail(std::uint32_t block, std::uint64_t size);
+    // Merge next into block, both are out of the free lists
+    void MergeNext(std::uint32_t block, std::uint32_t next);
+
+    std::uint32_t FindFree(std::uint64_t size) const;
+
+    std::uint64_t mCapacity = 0;
+    std::uint64_t mUsed = 0;
+    std::uint32_t mAllocationCount = 0;
+
+    std::uint32_t mFirstLevelMask = 0;
+    std::uint32_t mSecondLevelMasks[FirstLevelCount] = {};
+    std::uint32_t mFreeHeads[FirstLevelCount][SecondLevelCount];
+
+    std::vector<Block> mBlocks;
+    std::vector<std::uint32_t> mUnusedBlocks; // Headers to reuse
+};
@@ -0,0 +1,118 @@
+﻿#include "TlsfBenchmark.h"
+
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Request
+    {
+        bool Allocate = true;
+        std::uint64_t Size = 0;
+        std::uint64_t Alignment = 0;
+        std::uint32_t Victim = 0; // Random pick among the live allocations when freeing
+    };
+
+    std::vector<Request> MakeRequests(std::uint32_t operations, std::uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<double> logSize(8.0, 20.0);
+        std::uniform_int_distribution<std::uint32_t> pick(0, 99);
+        const std::uint64_t alignments[] = { 256, 4096, 65536 };
+
+        std::vector<Request> requests(operations);
+        for (Request& request : requests)
+        {
+            request.Allocate = pick(random) < 50;
+            request.Size = (std::uint64_t)std::exp2(logSize(random));
+            std::uint32_t alignmentClass = pick(random);
+            request.Alignment = alignments[alignmentClass < 80 ? 0 : (alignmentClass < 95 ? 1 : 2)];
+            request.Victim = random();
+        }
+        return requests;
+    }
+}
+
+TlsfBenchmarkResult RunTlsfBenchmark(std::uint64_t capacity, std::uint32_t operations, std::uint32_t seed)
+{
+    TlsfBenchmarkResult result;
+    result.Operations = operations;
+
+    std::vector<Request> requests = MakeRequests(operations, seed);
+    TlsfAllocator allocator(capacity);
+    std::vector<TlsfAllocation> live;
+    live.reserve(operations);
+
+    // Timed run
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const Request& request : requests)
+    {
+        if (request.Allocate || live.empty())
+        {
+            TlsfAllocation allocation = allocator.Allocate(request.Size, request.Alignment);
+            if (allocation.IsValid())
+                live.push_back(allocation);
+            else
+                result.FailedAllocations++;
+        }
+        else
+        {
+            std::uint32_t victim = request.Victim % (std::uint32_t)live.size();
+            TlsfAllocation allocation = live[victim];
+            live[victim] = live.back();
+            live.pop_back();
+            allocator.Free(allocation);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    result.OperationNs = operations != 0 ? std::chrono::duration<double, std::nano>(end - start).count() / operations : 0.0;
+    result.Stats = allocator.GetStats();
+
+    // Checked run, the live ranges are kept sorted by offset to find overlaps
+    allocator.Reset(capacity);
+    live.clear();
+    std::map<std::uint64_t, std::uint64_t> ranges;
+    for (const Request& request : requests)
+    {
+        if (request.Allocate || live.empty())
+        {
+            TlsfAllocation allocation = allocator.Allocate(request.Size, request.Alignment);
+            if (!allocation.IsValid()) continue;
+
+            std::uint64_t rangeEnd = allocation.Offset + allocation.Size;
+            bool bad = allocation.Offset % request.Alignment != 0 || allocation.Size < request.Size || rangeEnd > capacity;
+
+            auto next = ranges.lower_bound(allocation.Offset);
+            if (next != ranges.end() && next->first < rangeEnd) bad = true;
+            if (next != ranges.begin() && std::prev(next)->second > allocation.Offset) bad = true;
+
+            if (bad) result.Errors++;
+            ranges[allocation.Offset] = rangeEnd;
+            live.push_back(allocation);
+        }
+        else
+        {
+            std::uint32_t victim = request.Victim % (std::uint32_t)live.size();
+            TlsfAllocation allocation = live[victim];
+            live[victim] = live.back();
+            live.pop_back();
+
+            ranges.erase(allocation.Offset);
+            allocator.Free(allocation);
+        }
+    }
+
+    // Everything freed, the range must be one block again
+    for (const TlsfAllocation& allocation : live)
+        allocator.Free(allocation);
+    TlsfStats empty = allocator.GetStats();
+    if (empty.FreeBlockCount != 1 || empty.LargestFreeBlock != allocator.GetCapacity())
+        result.Errors++;
+
+    return result;
+}
@@ -0,0 +1,22 @@
+﻿#pragma once
+
+#include <cstdint>
+
+#include "TlsfAllocator.h"
+
+struct TlsfBenchmarkResult
+{
+    std::uint32_t Operations = 0;
+    double OperationNs = 0.0; // Average of an allocation or a free
+    std::uint32_t FailedAllocations = 0;
+
+    // Allocations overlapping a live one, misaligned or out of the range, checked on a second run
+    std::uint32_t Errors = 0;
+
+    // Allocator state once the run is over, half the allocations are still live
+    TlsfStats Stats;
+};
+
+// Random allocations and frees of vertex, index and constant buffer like sizes (256 bytes to 1 MB)
+// with 256, 4 KB and 64 KB alignments in a range of capacity bytes. Same seed, same run.
+TlsfBenchmarkResult RunTlsfBenchmark(std::uint64_t capacity, std::uint32_t operations, std::uint32_t seed);
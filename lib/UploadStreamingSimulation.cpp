@@ -0,0 +1,125 @@
+﻿#include "UploadStreamingSimulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <thread>
+
+#include "FakeGpuQueue.h"
+#include "FrameRing.h"
+
+namespace
+{
+    void Busy(double ms)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+    }
+
+    struct PendingMesh
+    {
+        std::uint32_t RequestFrame = 0;
+        std::uint64_t CopyFence = 0;
+    };
+}
+
+const char* GetUploadPathName(UploadPath path)
+{
+    switch (path)
+    {
+    case UploadPath::DirectQueue: return "direct queue + flush";
+    case UploadPath::CopyQueueWait: return "copy queue, GPU wait";
+    case UploadPath::CopyQueueStreaming: return "copy queue, streaming";
+    default: return "?";
+    }
+}
+
+UploadStreamingResult SimulateUploadStreaming(UploadPath path, std::uint32_t frames, double cpuMs, double gpuMs,
+                                              double transferMs, std::uint32_t uploadEvery)
+{
+    UploadStreamingResult result;
+    result.Path = path;
+    result.Frames = frames;
+
+    // The work sleeps instead of the queue latency so a submission can take any time
+    FakeGpuQueue directQueue;
+    FakeGpuQueue copyQueue;
+    FrameRing ring;
+    ring.Initialize(&directQueue, 3);
+
+    std::deque<PendingMesh> pending;
+    std::uint64_t framesToResident = 0;
+    std::uint32_t resident = 0;
+
+    double totalMs = 0.0;
+    double hitchMs = 1.5 * std::max(cpuMs, gpuMs);
+    auto last = std::chrono::high_resolution_clock::now();
+
+    for (std::uint32_t frame = 0; frame < frames; frame++)
+    {
+        ring.BeginFrame();
+
+        // Time since the previous frame started
+        auto now = std::chrono::high_resolution_clock::now();
+        if (frame != 0)
+        {
+            double frameMs = std::chrono::duration<double, std::milli>(now - last).count();
+            totalMs += frameMs;
+            result.WorstFrameMs = std::max(result.WorstFrameMs, frameMs);
+            if (frameMs > hitchMs) result.Hitches++;
+        }
+        last = now;
+
+        if (uploadEvery != 0 && frame % uploadEvery == uploadEvery / 2)
+        {
+            result.Uploads++;
+            if (path == UploadPath::DirectQueue)
+            {
+                // Recorded on the direct queue and flushed, the mesh is there for this frame
+                directQueue.Submit([transferMs] { Busy(transferMs); });
+                directQueue.WaitForValue(directQueue.Signal());
+                resident++;
+            }
+            else
+            {
+                copyQueue.Submit([transferMs] { Busy(transferMs); });
+
+                PendingMesh mesh;
+                mesh.RequestFrame = frame;
+                mesh.CopyFence = copyQueue.Signal();
+
+                if (path == UploadPath::CopyQueueWait)
+                {
+                    // Cross queue wait right away, the direct queue stalls until the copy is done
+                    directQueue.Submit([&copyQueue, mesh] { copyQueue.WaitForValue(mesh.CopyFence); });
+                    resident++;
+                }
+                else
+                {
+                    pending.push_back(mesh);
+                }
+            }
+        }
+
+        // Streaming, meshes whose copy is done are drawn from this frame, the wait is already satisfied
+        std::uint64_t copied = copyQueue.GetCompletedValue();
+        while (!pending.empty() && pending.front().CopyFence <= copied)
+        {
+            std::uint64_t fence = pending.front().CopyFence;
+            directQueue.Submit([&copyQueue, fence] { copyQueue.WaitForValue(fence); });
+            framesToResident += frame - pending.front().RequestFrame;
+            resident++;
+            pending.pop_front();
+        }
+
+        Busy(cpuMs);
+        directQueue.Submit([gpuMs] { Busy(gpuMs); });
+        ring.EndFrame();
+    }
+
+    ring.WaitIdle();
+    copyQueue.WaitForValue(copyQueue.Signal());
+
+    result.AverageFrameMs = frames > 1 ? totalMs / (frames - 1) : 0.0;
+    result.FramesToResident = resident != 0 ? (double)framesToResident / resident : 0.0;
+    return result;
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <cstdint>
+
+enum class UploadPath
+{
+    DirectQueue,        // Copies on the direct queue then a flush, like the renderer used to
+    CopyQueueWait,      // Copies on the copy queue, the next frame waits for them on the GPU
+    CopyQueueStreaming, // Copies on the copy queue, frames draw the mesh once its fence is reached
+
+    Count
+};
+
+const char* GetUploadPathName(UploadPath path);
+
+struct UploadStreamingResult
+{
+    UploadPath Path = UploadPath::DirectQueue;
+    std::uint32_t Frames = 0;
+    std::uint32_t Uploads = 0;
+    double AverageFrameMs = 0.0;
+    double WorstFrameMs = 0.0;
+
+    // Frames more than 1.5 times longer than the slowest of the CPU and GPU frame times
+    std::uint32_t Hitches = 0;
+
+    // Frames between an upload request and the first frame drawing its mesh, on average
+    double FramesToResident = 0.0;
+};
+
+// Run frames of cpuMs of recording and gpuMs of rendering with 3 frames in flight against
+// FakeGpuQueues, every uploadEvery frames a mesh taking transferMs to copy is uploaded through path.
+// The frame time is measured between two frame starts on the CPU, the waits of the frame ring included.
+UploadStreamingResult SimulateUploadStreaming(UploadPath path, std::uint32_t frames, double cpuMs, double gpuMs,
+                                              double transferMs, std::uint32_t uploadEvery);
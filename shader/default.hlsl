@@ -28,6 +28,26 @@ cbuffer cbPass : register(b1)
  float gDeltaTime;
 };
 
+// Object data of the instanced variant, same layout as cbPerObject padded to
+// the 256 bytes of a constant buffer so both read the same object array
+struct InstanceData
+{
+ float4x4 World;
+ float4 Color;
+ float4 Pad[11];
+};
+
+StructuredBuffer<InstanceData> gInstances : register(t0);
+
+// Object index of every instance of the frame
+StructuredBuffer<uint> gInstanceItems : register(t1);
+
+// Index of the first instance of the draw in gInstanceItems
+cbuffer cbInstance : register(b2)
+{
+ uint gInstanceOffset;
+};
+
 struct VertexIn
 {
  float3 PosL  : POSITION;
@@ -40,16 +60,25 @@ struct VertexOut
  float4 Color : COLOR;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
  VertexOut vout;
+
+#if INSTANCED
+ InstanceData instance = gInstances[gInstanceItems[gInstanceOffset + instanceID]];
+ float4x4 world = instance.World;
+ float4 color = instance.Color;
+#else
+ float4x4 world = gWorld;
+ float4 color = gColor;
+#endif
 	
  // Transform to homogeneous clip space.
- float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+ float4 posW = mul(float4(vin.PosL, 1.0f), world);
  vout.PosH = mul(posW, gViewProj);
 	
  // Just pass vertex color into the pixel shader.
- vout.Color = gColor;
+ vout.Color = color;
     
  return vout;
 }
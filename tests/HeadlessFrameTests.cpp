@@ -0,0 +1,70 @@
+﻿#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "../HeadlessBenchmark.h"
+#include "../lib/Maths.h"
+
+// The application Renderer on a recording device, the frame the Windows build draws without a GPU
+namespace
+{
+    int sFailures = 0;
+
+    void Expect(bool condition, const char* what)
+    {
+        if (condition) return;
+        std::printf("FAILED: %s\n", what);
+        sFailures++;
+    }
+
+    void TestInverse()
+    {
+        Float4x4 world = Maths::Multiply(Maths::Multiply(Maths::RotationQuaternion(Maths::QuaternionRotationAxis(Float3(0.0f, 1.0f, 0.0f), 0.7f)),
+            Maths::Scaling(Float3(2.0f, 3.0f, 0.5f))), Maths::Translation(Float3(1.0f, -4.0f, 9.0f)));
+        Float4x4 product = Maths::Multiply(Maths::Inverse(world), world);
+
+        float error = 0.0f;
+        for (int r = 0; r < 4; r++)
+            for (int c = 0; c < 4; c++)
+                error = std::fmax(error, std::fabs(product.m[r][c] - (r == c ? 1.0f : 0.0f)));
+        Expect(error < 1e-5f, "a matrix times its inverse is the identity");
+
+        Float3 point = Maths::TransformCoord(Float3(1.0f, 2.0f, 3.0f), world);
+        Float3 back = Maths::TransformCoord(point, Maths::Inverse(world));
+        Expect(std::fabs(back.x - 1.0f) < 1e-4f && std::fabs(back.y - 2.0f) < 1e-4f && std::fabs(back.z - 3.0f) < 1e-4f,
+            "a point transformed by the inverse comes back");
+    }
+
+    void TestFrame(const char* name, bool instancing, bool indirect)
+    {
+        HeadlessBenchmarkDesc desc;
+        desc.ItemCount = 1000;
+        desc.Instancing = instancing;
+        desc.Indirect = indirect;
+
+        HeadlessBenchmarkResult first = RunHeadlessBenchmark(desc, 4, 0.0);
+        HeadlessBenchmarkResult second = RunHeadlessBenchmark(desc, 4, 0.0);
+
+        std::printf("%s: %.0f draws, %.0f indirect calls, %.0f visible items, %.0f commands\n", name,
+            first.Draws, first.IndirectCalls, first.VisibleItems, first.Commands);
+        if (!first.Valid)
+            std::printf("%s\n", first.Error.c_str());
+        Expect(first.Valid, "the frames are valid");
+        Expect(first.Frames == 4, "every frame is measured");
+        Expect(first.Draws + first.IndirectCalls > 0.0, "the frames draw");
+        Expect(first.VisibleItems > 0.0, "the camera sees the grid");
+        Expect(first.StreamHash == second.StreamHash, "the same scene records the same commands");
+    }
+}
+
+int main()
+{
+    TestInverse();
+    TestFrame("Instancing", true, false);
+    TestFrame("Indirect", true, true);
+    TestFrame("One draw per item", false, false);
+
+    if (sFailures == 0)
+        std::printf("Headless frame tests passed\n");
+    return sFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+﻿#include <cstdio>
+
+#include "../lib/PipelineStateKey.h"
+
+// The description normalization of MakePipelineStateKey: equivalent descriptions give the same key,
+// a state the pipeline uses gives another one
+namespace
+{
+    int sFailures = 0;
+
+    void Expect(bool condition, const char* what)
+    {
+        if (condition) return;
+        std::printf("FAILED: %s\n", what);
+        sFailures++;
+    }
+
+    PipelineStateDescription MakeDescription()
+    {
+        PipelineStateDescription description;
+        description.Shaders[(size_t)PipelineShaderStage::Vertex] = 0x1234;
+        description.Shaders[(size_t)PipelineShaderStage::Pixel] = 0x5678;
+        description.Blend[0].RenderTargetWriteMask = 0xF;
+        description.SampleMask = 0xFFFFFFFF;
+        description.FillMode = 3;
+        description.CullMode = 3;
+        description.DepthEnable = true;
+        description.DepthWriteMask = 1;
+        description.DepthFunc = 2;
+
+        PipelineInputElement position;
+        position.SemanticName = "POSITION";
+        position.Format = 6;
+        PipelineInputElement color;
+        color.SemanticName = "COLOR";
+        color.Format = 2;
+        color.AlignedByteOffset = 12;
+        description.InputLayout = { position, color };
+
+        description.PrimitiveTopologyType = 3;
+        description.NumRenderTargets = 1;
+        description.RTVFormats[0] = 28;
+        description.DSVFormat = 45;
+        return description;
+    }
+
+    bool SameKey(const PipelineStateDescription& a, const PipelineStateDescription& b)
+    {
+        return MakePipelineStateKey(a) == MakePipelineStateKey(b);
+    }
+
+    void TestNegativeZero()
+    {
+        PipelineStateDescription a = MakeDescription();
+        PipelineStateDescription b = MakeDescription();
+        b.DepthBiasClamp = -0.0f;
+        b.SlopeScaledDepthBias = -0.0f;
+        Expect(SameKey(a, b), "-0 and 0 biases give the same key");
+
+        b.SlopeScaledDepthBias = 0.5f;
+        Expect(!SameKey(a, b), "a non zero bias gives another key");
+    }
+
+    void TestSemanticCase()
+    {
+        PipelineStateDescription a = MakeDescription();
+        PipelineStateDescription b = MakeDescription();
+        b.InputLayout[0].SemanticName = "position";
+        b.InputLayout[1].SemanticName = "Color";
+        Expect(SameKey(a, b), "semantic names are case insensitive");
+
+        b.InputLayout[1].SemanticName = "TEXCOORD";
+        Expect(!SameKey(a, b), "another semantic gives another key");
+    }
+
+    void TestStepRate()
+    {
+        PipelineStateDescription a = MakeDescription();
+        PipelineStateDescription b = MakeDescription();
+        b.InputLayout[1].InstanceDataStepRate = 3;
+        Expect(SameKey(a, b), "the step rate of a per vertex element is ignored");
+
+        a.InputLayout[1].InputSlotClass = 1;
+        a.InputLayout[1].InstanceDataStepRate = 1;
+        b.InputLayout[1].InputSlotClass = 1;
+        Expect(!SameKey(a, b), "the step rate of a per instance element is kept");
+    }
+
+    void TestDisabledStates()
+    {
+        PipelineStateDescription a = MakeDescription();
+        PipelineStateDescription b = MakeDescription();
+        b.Blend[0].SrcBlend = 5;
+        b.Blend[3].BlendEnable = true;
+        b.RTVFormats[2] = 10;
+        b.FrontFace.Func = 4;
+        Expect(SameKey(a, b), "disabled blend, unused render targets and disabled stencil are ignored");
+
+        a.DepthEnable = false;
+        b = a;
+        b.DepthFunc = 8;
+        Expect(SameKey(a, b), "the depth function of a disabled depth test is ignored");
+    }
+
+    void TestStableHash()
+    {
+        PipelineStateKey key = MakePipelineStateKey(MakeDescription());
+        Expect(key.Hash == MakePipelineStateKey(MakeDescription()).Hash, "the same description gives the same hash");
+        Expect(GetPipelineStateName(key).size() == 16, "the pipeline name is 16 digits");
+    }
+}
+
+int main()
+{
+    TestNegativeZero();
+    TestSemanticCase();
+    TestStepRate();
+    TestDisabledStates();
+    TestStableHash();
+
+    if (sFailures == 0)
+        std::printf("PipelineStateKey tests passed\n");
+    return sFailures == 0 ? 0 : 1;
+}
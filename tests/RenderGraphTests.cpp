@@ -0,0 +1,153 @@
+﻿#include <cstdio>
+#include <string>
+
+#include "../lib/RenderGraph.h"
+
+// Pass culling and transient aliasing of RenderGraph::Compile, no device needed
+namespace
+{
+    int sFailures = 0;
+
+    void Expect(bool condition, const char* what)
+    {
+        if (condition) return;
+        std::printf("FAILED: %s\n", what);
+        sFailures++;
+    }
+
+    // D3D12_RESOURCE_STATES values
+    const ResourceState StatePresent = 0;
+    const ResourceState StateRenderTarget = 0x4;
+    const ResourceState StatePixelShaderResource = 0x80;
+
+    const std::uint64_t TextureSize = 4 * 1024 * 1024;
+    const std::uint64_t TextureAlignment = 64 * 1024;
+
+    void* const BackBuffer = reinterpret_cast<void*>(0x100);
+
+    RenderGraphResource CreateTexture(RenderGraph& graph, const char* name)
+    {
+        RenderGraphTextureDesc desc;
+        desc.Width = 1024;
+        desc.Height = 512;
+        desc.Format = 10; // DXGI_FORMAT_R16G16B16A16_FLOAT
+        desc.SizeInBytes = TextureSize;
+        desc.Alignment = TextureAlignment;
+        return graph.CreateTexture(name, desc);
+    }
+
+    bool Overlap(const RenderGraph& graph, RenderGraphResource a, RenderGraphResource b)
+    {
+        std::uint64_t startA = graph.GetHeapOffset(a);
+        std::uint64_t startB = graph.GetHeapOffset(b);
+        return startA < startB + TextureSize && startB < startA + TextureSize;
+    }
+
+    void TestCulling()
+    {
+        RenderGraph graph;
+        RenderGraphResource backBuffer = graph.Import("BackBuffer", BackBuffer, StatePresent, StatePresent);
+        RenderGraphResource gbuffer = CreateTexture(graph, "GBuffer");
+        RenderGraphResource unused = CreateTexture(graph, "Unused");
+        RenderGraphResource chained = CreateTexture(graph, "Chained");
+        RenderGraphResource chainEnd = CreateTexture(graph, "ChainEnd");
+        RenderGraphResource debug = CreateTexture(graph, "Debug");
+
+        RenderGraphPass geometry = graph.AddPass("Geometry", nullptr);
+        graph.Write(geometry, gbuffer, StateRenderTarget);
+
+        // Nothing reads what these write, the second one makes the first one useless too
+        RenderGraphPass unusedPass = graph.AddPass("Unused", nullptr);
+        graph.Write(unusedPass, unused, StateRenderTarget);
+        RenderGraphPass chainStart = graph.AddPass("ChainStart", nullptr);
+        graph.Write(chainStart, chained, StateRenderTarget);
+        RenderGraphPass chainPass = graph.AddPass("Chain", nullptr);
+        graph.Read(chainPass, chained, StatePixelShaderResource);
+        graph.Write(chainPass, chainEnd, StateRenderTarget);
+
+        // Kept for its side effect even though nothing reads its texture
+        RenderGraphPass debugPass = graph.AddPass("Debug", nullptr);
+        graph.Write(debugPass, debug, StateRenderTarget);
+        graph.SetSideEffect(debugPass);
+
+        // Writes an imported resource, a root of the graph
+        RenderGraphPass lighting = graph.AddPass("Lighting", nullptr);
+        graph.Read(lighting, gbuffer, StatePixelShaderResource);
+        graph.Write(lighting, backBuffer, StateRenderTarget);
+
+        std::string error;
+        Expect(graph.Compile(&error), "the culling graph compiles");
+
+        Expect(!graph.IsCulled(geometry), "a pass read by a kept pass is kept");
+        Expect(!graph.IsCulled(lighting), "a pass writing an imported resource is kept");
+        Expect(!graph.IsCulled(debugPass), "a pass with a side effect is kept");
+        Expect(graph.IsCulled(unusedPass), "a pass whose writes nothing reads is culled");
+        Expect(graph.IsCulled(chainPass) && graph.IsCulled(chainStart), "a pass only read by culled passes is culled");
+        Expect(graph.GetStats().CulledPasses == 3, "three passes are culled");
+
+        Expect(graph.IsAllocated(gbuffer) && graph.IsAllocated(debug), "the textures of kept passes are allocated");
+        Expect(!graph.IsAllocated(unused) && !graph.IsAllocated(chained) && !graph.IsAllocated(chainEnd),
+            "the textures of culled passes are not allocated");
+    }
+
+    void TestAliasing()
+    {
+        RenderGraph graph;
+        RenderGraphResource backBuffer = graph.Import("BackBuffer", BackBuffer, StatePresent, StatePresent);
+        RenderGraphResource first = CreateTexture(graph, "First");
+        RenderGraphResource second = CreateTexture(graph, "Second");
+        RenderGraphResource third = CreateTexture(graph, "Third");
+
+        // Each texture lives two passes, the first and the third ones never at the same time
+        RenderGraphPass pass0 = graph.AddPass("Pass0", nullptr);
+        graph.Write(pass0, first, StateRenderTarget);
+        RenderGraphPass pass1 = graph.AddPass("Pass1", nullptr);
+        graph.Read(pass1, first, StatePixelShaderResource);
+        graph.Write(pass1, second, StateRenderTarget);
+        RenderGraphPass pass2 = graph.AddPass("Pass2", nullptr);
+        graph.Read(pass2, second, StatePixelShaderResource);
+        graph.Write(pass2, third, StateRenderTarget);
+        RenderGraphPass pass3 = graph.AddPass("Pass3", nullptr);
+        graph.Read(pass3, third, StatePixelShaderResource);
+        graph.Write(pass3, backBuffer, StateRenderTarget);
+
+        std::string error;
+        Expect(graph.Compile(&error), "the aliasing graph compiles");
+
+        Expect(!Overlap(graph, first, second), "textures alive at the same time do not share memory");
+        Expect(!Overlap(graph, second, third), "textures alive at the same time do not share memory");
+        Expect(Overlap(graph, first, third), "textures with disjoint lifetimes share memory");
+        Expect(graph.GetHeapSize() == 2 * TextureSize, "the heap holds two textures instead of three");
+        Expect(graph.GetStats().TransientBytes == 3 * TextureSize, "the three textures are counted without aliasing");
+        Expect(graph.GetStats().AliasingBarriers >= 1, "the texture placed over another one gets an aliasing barrier");
+
+        for (RenderGraphResource texture : { first, second, third })
+            Expect(graph.GetHeapOffset(texture) % TextureAlignment == 0, "the heap offsets are aligned");
+    }
+
+    void TestMissingWrite()
+    {
+        RenderGraph graph;
+        RenderGraphResource backBuffer = graph.Import("BackBuffer", BackBuffer, StatePresent, StatePresent);
+        RenderGraphResource never = CreateTexture(graph, "NeverWritten");
+
+        RenderGraphPass pass = graph.AddPass("Reader", nullptr);
+        graph.Read(pass, never, StatePixelShaderResource);
+        graph.Write(pass, backBuffer, StateRenderTarget);
+
+        std::string error;
+        Expect(!graph.Compile(&error), "reading a texture no pass wrote fails");
+        Expect(!error.empty(), "the failure is explained");
+    }
+}
+
+int main()
+{
+    TestCulling();
+    TestAliasing();
+    TestMissingWrite();
+
+    if (sFailures == 0)
+        std::printf("RenderGraph tests passed\n");
+    return sFailures == 0 ? 0 : 1;
+}